@@ -56,6 +56,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/Math.h"
 #include "platform/Thread.h"
 #include "platform/Lock.h"
+#include "platform/profiler/Profiler.h"
 #include "physics/Anchors.h"
 #include "scene/Light.h"
 
@@ -256,6 +257,7 @@ void PathFinderThread::run() {
 
 		if (EERIE_PATHFINDER_Get_Next_Request(&pr) && pr.isvalid)
 		{
+			ARX_PROFILE("PathFinder request");
 
 			PATHFINDER_REQUEST curpr;
 			memcpy(&curpr, &pr, sizeof(PATHFINDER_REQUEST));
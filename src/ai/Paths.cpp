@@ -49,9 +49,16 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <vector>
 
 #include <boost/foreach.hpp>
 
+#include "platform/Architecture.h"
+
+#if defined(ARX_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
 #include "animation/AnimationRender.h"
 
 #include "core/GameTime.h"
@@ -78,6 +85,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "math/Random.h"
 
+#include "platform/JobSystem.h"
 #include "platform/Platform.h"
 
 #include "physics/Box.h"
@@ -1154,143 +1162,389 @@ void ARX_THROWN_OBJECT_Manage(unsigned long time_offset)
 
 extern bool IsValidPos3(Vec3f * pos);
 
-static EERIEPOLY * LAST_COLLISION_POLY = NULL;
-extern long CUR_COLLISION_MATERIAL;
-
 float VELOCITY_THRESHOLD = 850.f;
 
-void ARX_ApplySpring(PHYSVERT * phys, long k, long l, float PHYSICS_constant,
-                     float PHYSICS_Damp) {
+namespace {
+	
+//! Maximum number of vertices in a physics box
+const size_t MAX_PHYSVERTS = 32;
+
+//! Maximum number of points tested against background polygons, see CollisionPoints
+const size_t MAX_COLLISION_POINTS = MAX_PHYSVERTS * (MAX_PHYSVERTS + 1) / 2;
+
+//! Amount of scaled frame time simulated in one physics step
+const float PHYSICS_STEP = 0.18f;
+
+const float PHYSICS_GRAVITY = 65.f;
+const float PHYSICS_DAMPING = 0.5f;
+const float PHYSICS_SPRING_CONSTANT = 15.f;
+const float PHYSICS_SPRING_DAMPING = 0.99f;
+
+/*!
+ * Simulation state of a physics box in ARX_PHYSICS_BOX_ApplyModels()
+ *
+ * The vertex data is copied from the box into a structure of arrays for each step.
+ * All arrays are padded with zeros to a multiple of four vertices.
+ */
+struct PhysicsBox {
+	
+	EERIE_3DOBJ * obj;
+	long source;
+	
+	//! Remaining time to simulate in this frame
+	float timing;
+	
+	size_t count;
+	size_t padded;
+	
+	float posx[MAX_PHYSVERTS], posy[MAX_PHYSVERTS], posz[MAX_PHYSVERTS];
+	float velx[MAX_PHYSVERTS], vely[MAX_PHYSVERTS], velz[MAX_PHYSVERTS];
+	float forcex[MAX_PHYSVERTS], forcey[MAX_PHYSVERTS], forcez[MAX_PHYSVERTS];
+	float initx[MAX_PHYSVERTS], inity[MAX_PHYSVERTS], initz[MAX_PHYSVERTS];
+	float mass[MAX_PHYSVERTS];
+	
+	Vec3f oldpos[MAX_PHYSVERTS];
+	
+	// Results of the last step
+	bool valid; //!< No vertex touches a background polygon
+	bool outside; //!< A vertex has left the background
+	EERIEPOLY * collisionPoly;
+	long collisionMaterial;
+	
+};
+
+//! Vertices of a physics box and the midpoints between them
+struct CollisionPoints {
 	
-	Vec3f deltaP, deltaV, springforce;
-	PHYSVERT * pv_k = &phys[k];
-	PHYSVERT * pv_l = &phys[l];
-	float Dterm, Hterm;
+	size_t count;
+	float x[MAX_COLLISION_POINTS];
+	float y[MAX_COLLISION_POINTS];
+	float z[MAX_COLLISION_POINTS];
+	
+};
 
-	float restlength = dist(pv_k->initpos, pv_l->initpos);
-	// Computes Spring Magnitude
-	deltaP = pv_k->pos - pv_l->pos;
-	float dist = deltaP.length(); // Magnitude of delta
-	dist = std::max(dist, 0.000001f); //TODO workaround for division by zero
-	float divdist = 1.f / dist;
-	Hterm = (dist - restlength) * PHYSICS_constant;
+std::vector<PhysicsBox> g_physicsBoxes;
+std::vector<PhysicsBox *> g_physicsStep;
 
-	deltaV = pv_k->velocity - pv_l->velocity; // Delta Velocity Vector
-	Dterm = dot(deltaV, deltaP) * PHYSICS_Damp * divdist; // Damping Term
-	Dterm = (-(Hterm + Dterm));
-	divdist *= Dterm;
-	springforce = deltaP * divdist; // Normalize Distance Vector & Calc Force
+#if defined(ARX_HAVE_SSE2)
 
-	pv_k->force += springforce; // + force on particle 1
+inline float horizontalSum(__m128 v) {
+	__m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
 
-	pv_l->force -= springforce; // - force on particle 2
+#endif // defined(ARX_HAVE_SSE2)
+	
+void loadPhysicsBox(PhysicsBox & box) {
+	
+	const PHYSVERT * vert = box.obj->pbox->vert;
+	
+	for(size_t i = 0; i < box.count; i++) {
+		box.posx[i] = vert[i].pos.x, box.posy[i] = vert[i].pos.y, box.posz[i] = vert[i].pos.z;
+		box.velx[i] = vert[i].velocity.x;
+		box.vely[i] = vert[i].velocity.y;
+		box.velz[i] = vert[i].velocity.z;
+		box.forcex[i] = vert[i].inertia.x;
+		box.forcey[i] = vert[i].inertia.y;
+		box.forcez[i] = vert[i].inertia.z;
+		box.initx[i] = vert[i].initpos.x;
+		box.inity[i] = vert[i].initpos.y;
+		box.initz[i] = vert[i].initpos.z;
+		box.mass[i] = vert[i].mass;
+	}
+	
+	for(size_t i = box.count; i < box.padded; i++) {
+		box.posx[i] = box.posy[i] = box.posz[i] = 0.f;
+		box.velx[i] = box.vely[i] = box.velz[i] = 0.f;
+		box.forcex[i] = box.forcey[i] = box.forcez[i] = 0.f;
+		box.initx[i] = box.inity[i] = box.initz[i] = 0.f;
+		box.mass[i] = 0.f;
+	}
 }
 
-void ComputeForces(PHYSVERT * phys, long nb) {
+void storePhysicsBox(const PhysicsBox & box) {
+
+	PHYSVERT * vert = box.obj->pbox->vert;
 	
-	const Vec3f PHYSICS_Gravity(0.f, 65.f, 0.f);
-	const float PHYSICS_Damping = 0.5f;
+	for(size_t i = 0; i < box.count; i++) {
+		vert[i].pos = Vec3f(box.posx[i], box.posy[i], box.posz[i]);
+		vert[i].velocity = Vec3f(box.velx[i], box.vely[i], box.velz[i]);
+		vert[i].force = Vec3f(box.forcex[i], box.forcey[i], box.forcez[i]);
+		vert[i].inertia = Vec3f::ZERO;
+	}
+}
 	
-	float lastmass = 1.f;
-	float div = 1.f;
+/*!
+ * Compute the forces acting on each vertex
+ *
+ * The force arrays must contain the inertia of the vertices. Every pair of vertices is
+ * connected by a damped spring with the rest length of their initial distance. Like in the
+ * original solver, each spring is applied twice - once from each end.
+ */
+void computeForces(PhysicsBox & box) {
 	
-	for(long k = 0; k < nb; k++) {
+	for(size_t k = 0; k < box.count; k++) {
+		if(box.mass[k] > 0.f) {
+			box.forcey[k] += PHYSICS_GRAVITY * (1.f / box.mass[k]);
+		}
+		box.forcex[k] += box.velx[k] * -PHYSICS_DAMPING;
+		box.forcey[k] += box.vely[k] * -PHYSICS_DAMPING;
+		box.forcez[k] += box.velz[k] * -PHYSICS_DAMPING;
+	}
+		
+	for(size_t k = 0; k < box.count; k++) {
+		
+#if defined(ARX_HAVE_SSE2)
+		
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 minDist = _mm_set1_ps(0.000001f);
+		const __m128 constant = _mm_set1_ps(PHYSICS_SPRING_CONSTANT);
+		const __m128 damping = _mm_set1_ps(PHYSICS_SPRING_DAMPING);
+		const __m128i count = _mm_set1_epi32(int(box.count));
+		const __m128i self = _mm_set1_epi32(int(k));
 		
-		PHYSVERT * pv = &phys[k];
+		__m128 px = _mm_set1_ps(box.posx[k]), py = _mm_set1_ps(box.posy[k]);
+		__m128 pz = _mm_set1_ps(box.posz[k]);
+		__m128 vx = _mm_set1_ps(box.velx[k]), vy = _mm_set1_ps(box.vely[k]);
+		__m128 vz = _mm_set1_ps(box.velz[k]);
+		__m128 ix = _mm_set1_ps(box.initx[k]), iy = _mm_set1_ps(box.inity[k]);
+		__m128 iz = _mm_set1_ps(box.initz[k]);
 		
-		// Reset Force
-		pv->force = pv->inertia;
+		__m128 fx = zero, fy = zero, fz = zero;
 		
-		// Apply Gravity
-		if(pv->mass > 0.f) {
+		for(size_t l = 0; l < box.padded; l += 4) {
 			
-			// need to be precomputed...
-			if(lastmass != pv->mass) {
-				div = 1.f / pv->mass;
-				lastmass = pv->mass;
-			}
+			__m128 rx = _mm_sub_ps(ix, _mm_loadu_ps(box.initx + l));
+			__m128 ry = _mm_sub_ps(iy, _mm_loadu_ps(box.inity + l));
+			__m128 rz = _mm_sub_ps(iz, _mm_loadu_ps(box.initz + l));
+			__m128 restlength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx),
+			                                _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)));
+			
+			__m128 dx = _mm_sub_ps(px, _mm_loadu_ps(box.posx + l));
+			__m128 dy = _mm_sub_ps(py, _mm_loadu_ps(box.posy + l));
+			__m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(box.posz + l));
+			__m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+			                                     _mm_mul_ps(dz, dz)));
+			dist = _mm_max_ps(dist, minDist);
+			__m128 divdist = _mm_div_ps(one, dist);
+			__m128 hterm = _mm_mul_ps(_mm_sub_ps(dist, restlength), constant);
+			
+			__m128 dvx = _mm_sub_ps(vx, _mm_loadu_ps(box.velx + l));
+			__m128 dvy = _mm_sub_ps(vy, _mm_loadu_ps(box.vely + l));
+			__m128 dvz = _mm_sub_ps(vz, _mm_loadu_ps(box.velz + l));
+			__m128 dterm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dvx, dx), _mm_mul_ps(dvy, dy)),
+			                          _mm_mul_ps(dvz, dz));
+			dterm = _mm_mul_ps(_mm_mul_ps(dterm, damping), divdist);
+			
+			__m128 factor = _mm_mul_ps(divdist, _mm_sub_ps(zero, _mm_add_ps(hterm, dterm)));
 			
-			pv->force += (PHYSICS_Gravity * div);
+			// Skip the padding and the vertex itself
+			__m128i index = _mm_add_epi32(_mm_set1_epi32(int(l)), _mm_setr_epi32(0, 1, 2, 3));
+			__m128i used = _mm_andnot_si128(_mm_cmpeq_epi32(index, self),
+			                                _mm_cmplt_epi32(index, count));
+			factor = _mm_and_ps(factor, _mm_castsi128_ps(used));
+			
+			fx = _mm_add_ps(fx, _mm_mul_ps(dx, factor));
+			fy = _mm_add_ps(fy, _mm_mul_ps(dy, factor));
+			fz = _mm_add_ps(fz, _mm_mul_ps(dz, factor));
 		}
 		
-		// Apply Damping
-		pv->force += pv->velocity * -PHYSICS_Damping;
-	}
-	
-	for(int k = 0; k < nb; k++) {
-		// Now Resolves Spring System
-		for(long l = 0; l < nb; l++) {
-			if(l != k) {
-				ARX_ApplySpring(phys, l, k, 15.f, 0.99f);
+		box.forcex[k] += 2.f * horizontalSum(fx);
+		box.forcey[k] += 2.f * horizontalSum(fy);
+		box.forcez[k] += 2.f * horizontalSum(fz);
+			
+#else // !defined(ARX_HAVE_SSE2)
+			
+		Vec3f pos(box.posx[k], box.posy[k], box.posz[k]);
+		Vec3f velocity(box.velx[k], box.vely[k], box.velz[k]);
+		Vec3f initpos(box.initx[k], box.inity[k], box.initz[k]);
+			
+		Vec3f force = Vec3f::ZERO;
+			
+		for(size_t l = 0; l < box.count; l++) {
+			
+			if(l == k) {
+				continue;
 			}
+			
+			float restlength = dist(initpos, Vec3f(box.initx[l], box.inity[l], box.initz[l]));
+			
+			Vec3f deltaP = pos - Vec3f(box.posx[l], box.posy[l], box.posz[l]);
+			float dist = std::max(deltaP.length(), 0.000001f);
+			float divdist = 1.f / dist;
+			float hterm = (dist - restlength) * PHYSICS_SPRING_CONSTANT;
+			
+			Vec3f deltaV = velocity - Vec3f(box.velx[l], box.vely[l], box.velz[l]);
+			float dterm = dot(deltaV, deltaP) * PHYSICS_SPRING_DAMPING * divdist;
+			
+			force += deltaP * (divdist * -(hterm + dterm));
 		}
+		
+		box.forcex[k] += 2.f * force.x;
+		box.forcey[k] += 2.f * force.y;
+		box.forcez[k] += 2.f * force.z;
+		
+#endif // !defined(ARX_HAVE_SSE2)
+		
 	}
 }
 
-bool ARX_INTERACTIVE_CheckFULLCollision(EERIE_3DOBJ * obj, long source);
-
-//! Calculate new Positions and Velocities given a deltatime
-//! @param DeltaTime that has passed since last iteration
-void RK4Integrate(EERIE_3DOBJ * obj, float DeltaTime) {
+void clampVelocities(PhysicsBox & box) {
 	
-	PHYSVERT * source, * target, * accum1, * accum2, * accum3, * accum4;
-	float halfDeltaT, sixthDeltaT;
-	halfDeltaT = DeltaTime * .5f; // some time values i will need
-	sixthDeltaT = ( 1.0f / 6 );
+#if defined(ARX_HAVE_SSE2)
 	
-	PHYSVERT m_TempSys[5][32];
+	const __m128 max = _mm_set1_ps(VELOCITY_THRESHOLD);
+	const __m128 min = _mm_set1_ps(-VELOCITY_THRESHOLD);
+	
+	for(size_t i = 0; i < box.padded; i += 4) {
+		_mm_storeu_ps(box.velx + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(box.velx + i), min), max));
+		_mm_storeu_ps(box.vely + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(box.vely + i), min), max));
+		_mm_storeu_ps(box.velz + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(box.velz + i), min), max));
+	}
 	
-	for(long jj = 0; jj < 4; jj++) {
+#else // !defined(ARX_HAVE_SSE2)
 		
-		arx_assert(size_t(obj->pbox->nb_physvert) <= ARRAY_SIZE(m_TempSys[jj + 1]));
-		memcpy(m_TempSys[jj + 1], obj->pbox->vert, sizeof(PHYSVERT) * obj->pbox->nb_physvert);
+	for(size_t i = 0; i < box.count; i++) {
+		box.velx[i] = clamp(box.velx[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
+		box.vely[i] = clamp(box.vely[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
+		box.velz[i] = clamp(box.velz[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
+	}
 		
-		if(jj == 3) {
-			halfDeltaT = DeltaTime;
-		}
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
+/*!
+ * Calculate new positions and velocities after a time step
+ *
+ * This is what remains of the old RK4 integrator: all four stages used the forces at the
+ * start of the step, so the intermediate force evaluations had no effect.
+ */
+void integrate(PhysicsBox & box, float deltaTime) {
+	
+	const float halfDeltaTime = deltaTime * .5f;
+	const float sixth = 1.0f / 6;
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	const __m128 half = _mm_set1_ps(halfDeltaTime);
+	const __m128 full = _mm_set1_ps(deltaTime);
+	const __m128 two = _mm_set1_ps(2.f);
+	const __m128 sixths = _mm_set1_ps(sixth);
+	const __m128 scale = _mm_set1_ps(1.2f);
+	
+	float * pos[3] = { box.posx, box.posy, box.posz };
+	float * vel[3] = { box.velx, box.vely, box.velz };
+	float * force[3] = { box.forcex, box.forcey, box.forcez };
+	
+	for(size_t i = 0; i < box.padded; i += 4) {
+		
+		__m128 mass = _mm_loadu_ps(box.mass + i);
+		__m128 halfMass = _mm_mul_ps(mass, half);
+		__m128 fullMass = _mm_mul_ps(mass, full);
 		
-		for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
+		for(size_t c = 0; c < 3; c++) {
 			
-			source = &obj->pbox->vert[kk];
-			accum1 = &m_TempSys[jj + 1][kk];
-			target = &m_TempSys[0][kk];
+			__m128 f = _mm_loadu_ps(force[c] + i);
+			__m128 v = _mm_loadu_ps(vel[c] + i);
+			__m128 p = _mm_loadu_ps(pos[c] + i);
 			
-			accum1->force = source->force * (source->mass * halfDeltaT);
-			accum1->velocity = source->velocity * halfDeltaT;
+			__m128 dv = _mm_mul_ps(f, halfMass);
+			dv = _mm_add_ps(_mm_add_ps(dv, _mm_mul_ps(_mm_add_ps(dv, dv), two)),
+			                _mm_mul_ps(f, fullMass));
 			
-			// determine the new velocity for the particle over 1/2 time
-			target->velocity = source->velocity + accum1->force;
-			target->mass = source->mass;
+			__m128 dp = _mm_mul_ps(v, half);
+			dp = _mm_add_ps(_mm_add_ps(dp, _mm_mul_ps(_mm_add_ps(dp, dp), two)),
+			                _mm_mul_ps(v, full));
 			
-			// set the new position
-			target->pos = source->pos + accum1->velocity;
+			_mm_storeu_ps(vel[c] + i, _mm_add_ps(v, _mm_mul_ps(dv, sixths)));
+			_mm_storeu_ps(pos[c] + i, _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(dp, sixths), scale)));
 		}
-		
-		ComputeForces(m_TempSys[0], obj->pbox->nb_physvert); // compute the new forces
 	}
 	
-	for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < box.count; i++) {
 		
-		source = &obj->pbox->vert[kk]; // current state of particle
-		target = &obj->pbox->vert[kk];
-		accum1 = &m_TempSys[1][kk];
-		accum2 = &m_TempSys[2][kk];
-		accum3 = &m_TempSys[3][kk];
-		accum4 = &m_TempSys[4][kk];
+		Vec3f force(box.forcex[i], box.forcey[i], box.forcez[i]);
+		Vec3f velocity(box.velx[i], box.vely[i], box.velz[i]);
 		
-		// determine the new velocity for the particle using rk4 formula
-		Vec3f dv = accum1->force + ((accum2->force + accum3->force) * 2.f) + accum4->force;
-		target->velocity = source->velocity + (dv * sixthDeltaT);
-		// determine the new position for the particle using rk4 formula
-		Vec3f dp = accum1->velocity + ((accum2->velocity + accum3->velocity) * 2.f)
-		           + accum4->velocity;
-		target->pos = source->pos + (dp * sixthDeltaT * 1.2f);
+		Vec3f dv = force * (box.mass[i] * halfDeltaTime);
+		dv = dv + ((dv + dv) * 2.f) + force * (box.mass[i] * deltaTime);
+		
+		Vec3f dp = velocity * halfDeltaTime;
+		dp = dp + ((dp + dp) * 2.f) + velocity * deltaTime;
+		
+		box.velx[i] += dv.x * sixth, box.vely[i] += dv.y * sixth, box.velz[i] += dv.z * sixth;
+		box.posx[i] += dp.x * sixth * 1.2f;
+		box.posy[i] += dp.y * sixth * 1.2f;
+		box.posz[i] += dp.z * sixth * 1.2f;
+	}
+	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
+void getCollisionPoints(const PhysicsBox & box, CollisionPoints & points) {
+	
+	size_t n = 0;
+	
+	for(size_t k = 0; k < box.count; k++, n++) {
+		points.x[n] = box.posx[k], points.y[n] = box.posy[k], points.z[n] = box.posz[k];
+	}
+	
+	for(size_t k = 0; k < box.count; k++) {
+		for(size_t l = k + 1; l < box.count; l++, n++) {
+			points.x[n] = (box.posx[k] + box.posx[l]) * .5f;
+			points.y[n] = (box.posy[k] + box.posy[l]) * .5f;
+			points.z[n] = (box.posz[k] + box.posz[l]) * .5f;
+		}
+	}
+	
+	// Pad with copies of the first point, duplicates don't change the result
+	points.count = n;
+	for(; n % 4 != 0; n++) {
+		points.x[n] = points.x[0], points.y[n] = points.y[0], points.z[n] = points.z[0];
+	}
+}
+
+bool isAnyPointNear(const CollisionPoints & points, const Vec3f & pos, float radius) {
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	const __m128 x = _mm_set1_ps(pos.x), y = _mm_set1_ps(pos.y), z = _mm_set1_ps(pos.z);
+	const __m128 maxDist = _mm_set1_ps(radius * radius);
+	
+	for(size_t i = 0; i < points.count; i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(points.x + i), x);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(points.y + i), y);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(points.z + i), z);
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		if(_mm_movemask_ps(_mm_cmple_ps(d, maxDist))) {
+			return true;
+		}
+	}
+	
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < points.count; i++) {
+		if(!fartherThan(Vec3f(points.x[i], points.y[i], points.z[i]), pos, radius)) {
+			return true;
+		}
 	}
 	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+	return false;
 }
 
+} // anonymous namespace
+
 static bool IsPointInField(Vec3f * pos) {
 	
+	
 	for(size_t i = 0; i < MAX_SPELLS; i++) {
 		
 		if(spells[i].exist && spells[i].type == SPELL_CREATE_FIELD) {
@@ -1371,9 +1625,20 @@ static bool IsObjectVertexCollidingPoly(EERIE_3DOBJ * obj, EERIEPOLY * ep,
 	return false;
 }
 
-static bool IsFULLObjectVertexInValidPosition(EERIE_3DOBJ * obj) {
+static long GetCollisionMaterial(const EERIEPOLY * ep) {
+	if(ep->type & POLY_METAL) return MATERIAL_METAL;
+	else if(ep->type & POLY_WOOD) return MATERIAL_WOOD;
+	else if(ep->type & POLY_STONE) return MATERIAL_STONE;
+	else if(ep->type & POLY_GRAVEL) return MATERIAL_GRAVEL;
+	else if(ep->type & POLY_WATER) return MATERIAL_WATER;
+	else if(ep->type & POLY_EARTH) return MATERIAL_EARTH;
+	else return MATERIAL_STONE;
+}
+	
+//! Check if the vertices of the box or the midpoints between them touch the background
+static bool IsFULLObjectVertexInValidPosition(PhysicsBox & box) {
 	
-	bool ret = true;
+	EERIE_3DOBJ * obj = box.obj;
 
 	float x = obj->pbox->vert[0].pos.x;
 	float z = obj->pbox->vert[0].pos.z;
@@ -1388,256 +1653,235 @@ static bool IsFULLObjectVertexInValidPosition(EERIE_3DOBJ * obj) {
 	long iz = std::max(pz - n, 0L);
 	long az = std::min(pz + n, ACTIVEBKG->Zsize - 1L);
 
-	LAST_COLLISION_POLY = NULL;
-	EERIEPOLY * ep;
-	EERIE_BKG_INFO * eg;
+	box.collisionPoly = NULL;
 
 	float rad = obj->pbox->radius;
 
-	for (pz = iz; pz <= az; pz++)
-		for (px = ix; px <= ax; px++)
-		{
-			eg = &ACTIVEBKG->Backg[px+pz*ACTIVEBKG->Xsize];
+	CollisionPoints points;
+	getCollisionPoints(box, points);
 
-			for (long k = 0; k < eg->nbpoly; k++)
-			{
+	for(pz = iz; pz <= az; pz++)
+	for(px = ix; px <= ax; px++) {
 			
-				ep = &eg->polydata[k];
-
-				if ( (ep->area > 190.f)
-				    && (!(ep->type & (POLY_WATER)))
-				    && (!(ep->type & (POLY_TRANS)))
-				    && (!(ep->type & (POLY_NOCOL)))
-				)
-				{
-					if (fartherThan(ep->center, obj->pbox->vert[0].pos, rad + 75.f))
-						continue;
+		EERIE_BKG_INFO * eg = &ACTIVEBKG->Backg[px + pz * ACTIVEBKG->Xsize];
 
-					for (long kk = 0; kk < obj->pbox->nb_physvert; kk++)
-					{
-						float radd = 4.f;
-
-						if(!fartherThan(obj->pbox->vert[kk].pos, ep->center, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[0].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[1].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[2].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[0].p + ep->v[1].p) * .5f, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[2].p + ep->v[1].p) * .5f, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[0].p + ep->v[2].p) * .5f, radd)) {
-							
-							LAST_COLLISION_POLY = ep;
+		for(long k = 0; k < eg->nbpoly; k++) {
 
-							if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-							else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-							else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-							else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-							else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-							else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-							else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
-							return false;
-						}
+			EERIEPOLY * ep = &eg->polydata[k];
 
-						// Last addon
-						for (long kl = 1; kl < obj->pbox->nb_physvert; kl++)
-						{
-							if (kl != kk)
-							{
-								Vec3f pos = (obj->pbox->vert[kk].pos + obj->pbox->vert[kl].pos) * .5f;
-
-								if(!fartherThan(pos, ep->center, radd)
-								   || !fartherThan(pos, ep->v[0].p, radd)
-								   || !fartherThan(pos, ep->v[1].p, radd)
-								   || !fartherThan(pos, ep->v[2].p, radd)
-								   || !fartherThan(pos, (ep->v[0].p + ep->v[1].p) * .5f, radd)
-								   || !fartherThan(pos, (ep->v[2].p + ep->v[1].p) * .5f, radd)
-								   || !fartherThan(pos, (ep->v[0].p + ep->v[2].p) * .5f, radd)) {
-									
-									LAST_COLLISION_POLY = ep;
-
-									if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-									else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-									else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-									else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-									else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-									else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-									else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
-									return false;
-								}
-							}
-						}
-					}
+			if(ep->area <= 190.f || (ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))) {
+				continue;
+			}
+							
+			if(fartherThan(ep->center, obj->pbox->vert[0].pos, rad + 75.f)) {
+				continue;
+			}
 
-				
-					if (IsObjectVertexCollidingPoly(obj, ep, -1, NULL))
-					{
-						
-						LAST_COLLISION_POLY = ep;
-
-						if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-						else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-						else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-						else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-						else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-						else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-						else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
-						return false;
-					}
-				}
+			const float radd = 4.f;
+
+			if(isAnyPointNear(points, ep->center, radd)
+			   || isAnyPointNear(points, ep->v[0].p, radd)
+			   || isAnyPointNear(points, ep->v[1].p, radd)
+			   || isAnyPointNear(points, ep->v[2].p, radd)
+			   || isAnyPointNear(points, (ep->v[0].p + ep->v[1].p) * .5f, radd)
+			   || isAnyPointNear(points, (ep->v[2].p + ep->v[1].p) * .5f, radd)
+			   || isAnyPointNear(points, (ep->v[0].p + ep->v[2].p) * .5f, radd)
+			   || IsObjectVertexCollidingPoly(obj, ep, -1, NULL)) {
+				box.collisionPoly = ep;
+				box.collisionMaterial = GetCollisionMaterial(ep);
+				return false;
 			}
 		}
+	}
 
-	return ret;
+	return true;
 }
 
-static bool ARX_EERIE_PHYSICS_BOX_Compute(EERIE_3DOBJ * obj, float framediff, long source) {
+//! Run one step for a box - this must not access any entities
+static void ARX_EERIE_PHYSICS_BOX_Step(PhysicsBox & box) {
 	
-	Vec3f oldpos[32];
-	long COUNT = 0;
-	COUNT++;
+	float deltaTime = std::min(0.11f, box.timing * 10);
 
-	for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
-		PHYSVERT *pv = &obj->pbox->vert[kk];
-		oldpos[kk] = pv->pos;
-		pv->inertia = Vec3f::ZERO;
+	loadPhysicsBox(box);
 
-		pv->velocity.x = clamp(pv->velocity.x, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
-		pv->velocity.y = clamp(pv->velocity.y, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
-		pv->velocity.z = clamp(pv->velocity.z, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
+	computeForces(box);
+	
+	for(size_t k = 0; k < box.count; k++) {
+		box.oldpos[k] = Vec3f(box.posx[k], box.posy[k], box.posz[k]);
 	}
 	
-	CUR_COLLISION_MATERIAL = MATERIAL_STONE;
+	clampVelocities(box);
 	
-	RK4Integrate(obj, framediff);
+	integrate(box, deltaTime);
 
-	EERIE_SPHERE sphere;
-	PHYSVERT *pv = &obj->pbox->vert[0];
-	sphere.origin = pv->pos;
-	sphere.radius = obj->pbox->radius;
-	long colidd = 0;
+	storePhysicsBox(box);
 
-	for(int kk = 0; kk < obj->pbox->nb_physvert; kk += 2) {
-		pv = &obj->pbox->vert[kk];
+	box.collisionMaterial = MATERIAL_STONE;
 
-		if(!IsValidPos3(&pv->pos)) {
-			colidd = 1;
+	box.outside = false;
+	for(size_t k = 0; k < box.count; k += 2) {
+		if(!IsValidPos3(&box.obj->pbox->vert[k].pos)) {
+			box.outside = true;
 			break;
 		}
 	}
 
-	if ((!IsFULLObjectVertexInValidPosition(obj))
-	    || ARX_INTERACTIVE_CheckFULLCollision(obj, source)
-	    || colidd
-	    || (IsObjectInField(obj))
-	)
-	{
-		colidd = 1;
+	box.valid = IsFULLObjectVertexInValidPosition(box);
+}
+
+namespace {
+
+class PhysicsBoxStepTask : public jobs::ParallelTask {
+	
+	void run(size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			ARX_EERIE_PHYSICS_BOX_Step(*g_physicsStep[i]);
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+bool ARX_INTERACTIVE_CheckFULLCollision(EERIE_3DOBJ * obj, long source);
+
+//! Handle collisions with entities and collision responses after a step
+static void ARX_EERIE_PHYSICS_BOX_Collide(PhysicsBox & box) {
+	
+	EERIE_3DOBJ * obj = box.obj;
+	long source = box.source;
+	
+	bool colidd = (!box.valid)
+	              || ARX_INTERACTIVE_CheckFULLCollision(obj, source)
+	              || box.outside
+	              || IsObjectInField(obj);
+	
+	if(colidd) {
+		
 		float power = (EEfabs(obj->pbox->vert[0].velocity.x)
 		               + EEfabs(obj->pbox->vert[0].velocity.y)
 		               + EEfabs(obj->pbox->vert[0].velocity.z)) * .01f;
 
+		if(ValidIONum(source) && !(entities[source]->ioflags & IO_BODY_CHUNK)) {
+			ARX_TEMPORARY_TrySound(entities[source], 0.4f + power, box.collisionMaterial);
+		}
 
-		if(!(ValidIONum(source) && (entities[source]->ioflags & IO_BODY_CHUNK)))
-			ARX_TEMPORARY_TrySound(0.4f + power);
-
-		if(!LAST_COLLISION_POLY) {
-			for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-				pv = &obj->pbox->vert[k];
+		const EERIEPOLY * ep = box.collisionPoly;
 
-				pv->velocity.x *= -0.3f;
-				pv->velocity.z *= -0.3f;
-				pv->velocity.y *= -0.4f;
+		for(size_t k = 0; k < box.count; k++) {
+			PHYSVERT * pv = &obj->pbox->vert[k];
 
-				pv->pos = oldpos[k];
-			}
-		} else {
-			for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-				pv = &obj->pbox->vert[k];
-				
-				float t = dot(LAST_COLLISION_POLY->norm, pv->velocity);
-				pv->velocity -= LAST_COLLISION_POLY->norm * (2.f * t);
-				
+			if(ep) {
+				float t = dot(ep->norm, pv->velocity);
+				pv->velocity -= ep->norm * (2.f * t);
 				pv->velocity.x *= 0.3f;
 				pv->velocity.z *= 0.3f;
 				pv->velocity.y *= 0.4f;
-				
-				pv->pos = oldpos[k];
+			} else {
+				pv->velocity.x *= -0.3f;
+				pv->velocity.z *= -0.3f;
+				pv->velocity.y *= -0.4f;
 			}
-		}
-	}
 
-	if(colidd) {
+			pv->pos = box.oldpos[k];
+		}
+				
 		obj->pbox->stopcount += 1;
+				
 	} else {
+				
 		obj->pbox->stopcount -= 2;
 
 		if(obj->pbox->stopcount < 0)
 			obj->pbox->stopcount = 0;
 	}
-
-	return true;
 }
 
-long ARX_PHYSICS_BOX_ApplyModel(EERIE_3DOBJ * obj, float framediff, float rubber, long source) {
+void ARX_PHYSICS_BOX_ApplyModels(PhysicsBoxModel * models, size_t count, float framediff) {
 	
 	VELOCITY_THRESHOLD = 400.f;
-	long ret = 0;
 
-	if(!obj || !obj->pbox)
-		return ret;
+	g_physicsBoxes.clear();
 
-	if(obj->pbox->active == 2)
-		return ret;
+	for(size_t i = 0; i < count; i++) {
 
-	if(framediff == 0.f)
-		return ret;
+		EERIE_3DOBJ * obj = models[i].obj;
+		models[i].ret = 0;
 
-	PHYSVERT * pv;
+		if(!obj || !obj->pbox || obj->pbox->active == 2 || framediff == 0.f) {
+			continue;
+		}
 
-	// Memorizes initpos
-	for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-		pv = &obj->pbox->vert[k];
-		pv->temp = pv->pos;
+		arx_assert(size_t(obj->pbox->nb_physvert) <= MAX_PHYSVERTS);
+		
+		// Memorizes initpos
+		for(long k = 0; k < obj->pbox->nb_physvert; k++) {
+			PHYSVERT * pv = &obj->pbox->vert[k];
+			pv->temp = pv->pos;
+		}
+		
+		float timing = obj->pbox->storedtiming + framediff * models[i].rubber * 0.0055f;
+		
+		if(timing < PHYSICS_STEP) {
+			obj->pbox->storedtiming = timing;
+			models[i].ret = 1;
+			continue;
+		}
+		
+		PhysicsBox box;
+		box.obj = obj;
+		box.source = models[i].source;
+		box.timing = timing;
+		box.count = size_t(obj->pbox->nb_physvert);
+		box.padded = (box.count + 3) & ~size_t(3);
+		g_physicsBoxes.push_back(box);
 	}
 
-	float timing = obj->pbox->storedtiming + framediff * rubber * 0.0055f;
-	float t_threshold = 0.18f;
-
-	if(timing < t_threshold) {
-		obj->pbox->storedtiming = timing;
-		return 1;
-	} else {
-		while(timing >= t_threshold) {
-			ComputeForces(obj->pbox->vert, obj->pbox->nb_physvert);
-
-			if(!ARX_EERIE_PHYSICS_BOX_Compute(obj, std::min(0.11f, timing * 10), source))
-				ret = 1;
+	// Step all boxes that still have time left together, integrating them in parallel
+	for(;;) {
 
-			timing -= t_threshold;
+		g_physicsStep.clear();
+		BOOST_FOREACH(PhysicsBox & box, g_physicsBoxes) {
+			if(box.timing >= PHYSICS_STEP) {
+				g_physicsStep.push_back(&box);
+			}
+		}
+		if(g_physicsStep.empty()) {
+			break;
 		}
 
-		obj->pbox->storedtiming = timing;
+		PhysicsBoxStepTask task;
+		jobs::parallelFor(task, g_physicsStep.size());
+		
+		BOOST_FOREACH(PhysicsBox * box, g_physicsStep) {
+			ARX_EERIE_PHYSICS_BOX_Collide(*box);
+			box->timing -= PHYSICS_STEP;
+		}
 	}
 
-	if(obj->pbox->stopcount < 16)
-		return ret;
+	BOOST_FOREACH(PhysicsBox & box, g_physicsBoxes) {
 
-	obj->pbox->active = 2;
-	obj->pbox->stopcount = 0;
+		PHYSICS_BOX_DATA * pbox = box.obj->pbox;
 
-	if(ValidIONum(source)) {
-		entities[source]->soundcount = 0;
-		entities[source]->soundtime = (unsigned long)(arxtime) + 2000;
+		pbox->storedtiming = box.timing;
+		
+		if(pbox->stopcount < 16) {
+			continue;
+		}
+		
+		pbox->active = 2;
+		pbox->stopcount = 0;
+		
+		if(ValidIONum(box.source)) {
+			entities[box.source]->soundcount = 0;
+			entities[box.source]->soundtime = (unsigned long)(arxtime) + 2000;
+		}
 	}
-
-	return ret;
 }
 
-void ARX_PrepareBackgroundNRMLs()
-{
-	long i, j, k;
+static void ARX_PrepareBackgroundNRMLs(long i, long j) {
+	
+	long k;
 	long i2, j2, k2;
 	EERIE_BKG_INFO * eg;
 	EERIE_BKG_INFO * eg2;
@@ -1647,120 +1891,133 @@ void ARX_PrepareBackgroundNRMLs()
 	Vec3f cur_nrml;
 	float count;
 
-	for (j = 0; j < ACTIVEBKG->Zsize; j++)
-		for (i = 0; i < ACTIVEBKG->Xsize; i++)
+	eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
+
+	for (long l = 0; l < eg->nbpoly; l++)
+	{
+		ep = &eg->polydata[l];
+
+		long nbvert = (ep->type & POLY_QUAD) ? 4 : 3;
+
+		for (k = 0; k < nbvert; k++)
 		{
-			eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
+			float ttt = 1.f;
+
+			if(k == 3) {
+				nrml = ep->norm2;
+				count = 1.f;
+			} else if(k > 0 && nbvert > 3) {
+				nrml = (ep->norm + ep->norm2);
+				count = 2.f;
+				ttt = .5f;
+			} else {
+				nrml = ep->norm;
+				count = 1.f;
+			}
 
-			for (long l = 0; l < eg->nbpoly; l++)
-			{
-				ep = &eg->polydata[l];
+			cur_nrml = nrml * ttt;
 
-				long nbvert = (ep->type & POLY_QUAD) ? 4 : 3;
+			long mii = std::max(i - 4, 0L);
+			long mai = std::min(i + 4, ACTIVEBKG->Xsize - 1L);
+			long mij = std::max(j - 4, 0L);
+			long maj = std::min(j + 4, ACTIVEBKG->Zsize - 1L);
 
-				for (k = 0; k < nbvert; k++)
+			for (j2 = mij; j2 < maj; j2++)
+				for (i2 = mii; i2 < mai; i2++)
 				{
-					float ttt = 1.f;
-
-					if(k == 3) {
-						nrml = ep->norm2;
-						count = 1.f;
-					} else if(k > 0 && nbvert > 3) {
-						nrml = (ep->norm + ep->norm2);
-						count = 2.f;
-						ttt = .5f;
-					} else {
-						nrml = ep->norm;
-						count = 1.f;
-					}
+					eg2 = &ACTIVEBKG->Backg[i2+j2*ACTIVEBKG->Xsize];
 
-					cur_nrml = nrml * ttt;
+					for (long kr = 0; kr < eg2->nbpoly; kr++)
+					{
+						ep2 = &eg2->polydata[kr];
 
-					long mii = std::max(i - 4, 0L);
-					long mai = std::min(i + 4, ACTIVEBKG->Xsize - 1L);
-					long mij = std::max(j - 4, 0L);
-					long maj = std::min(j + 4, ACTIVEBKG->Zsize - 1L);
+						long nbvert2 = (ep2->type & POLY_QUAD) ? 4 : 3;
 
-					for (j2 = mij; j2 < maj; j2++)
-						for (i2 = mii; i2 < mai; i2++)
-						{
-							eg2 = &ACTIVEBKG->Backg[i2+j2*ACTIVEBKG->Xsize];
+						if (ep != ep2)
 
-							for (long kr = 0; kr < eg2->nbpoly; kr++)
+							for (k2 = 0; k2 < nbvert2; k2++)
 							{
-								ep2 = &eg2->polydata[kr];
+								if ((EEfabs(ep2->v[k2].p.x - ep->v[k].p.x) < 2.f)
+								        && (EEfabs(ep2->v[k2].p.y - ep->v[k].p.y) < 2.f)
+								        && (EEfabs(ep2->v[k2].p.z - ep->v[k].p.z) < 2.f))
+								{
+									if(k2 == 3) {
 
-								long nbvert2 = (ep2->type & POLY_QUAD) ? 4 : 3;
+										if(LittleAngularDiff(&cur_nrml, &ep2->norm2)) {
+											nrml += ep2->norm2;
+											count += 1.f;
+											nrml += cur_nrml;
+											count += 1.f;
+										}
 
-								if (ep != ep2)
+									} else if(k2 > 0 && nbvert2 > 3) {
 
-									for (k2 = 0; k2 < nbvert2; k2++)
-									{
-										if ((EEfabs(ep2->v[k2].p.x - ep->v[k].p.x) < 2.f)
-										        && (EEfabs(ep2->v[k2].p.y - ep->v[k].p.y) < 2.f)
-										        && (EEfabs(ep2->v[k2].p.z - ep->v[k].p.z) < 2.f))
-										{
-											if(k2 == 3) {
-												
-												if(LittleAngularDiff(&cur_nrml, &ep2->norm2)) {
-													nrml += ep2->norm2;
-													count += 1.f;
-													nrml += cur_nrml;
-													count += 1.f;
-												}
-												
-											} else if(k2 > 0 && nbvert2 > 3) {
-												
-												Vec3f tnrml = (ep2->norm + ep2->norm2) * .5f;
-												if(LittleAngularDiff(&cur_nrml, &tnrml)) {
-													nrml += tnrml * 2.f;
-													count += 2.f;
-												}
-												
-											} else {
+										Vec3f tnrml = (ep2->norm + ep2->norm2) * .5f;
+										if(LittleAngularDiff(&cur_nrml, &tnrml)) {
+											nrml += tnrml * 2.f;
+											count += 2.f;
+										}
+
+									} else {
 												
-												if(LittleAngularDiff(&cur_nrml, &ep2->norm)) {
-													nrml += ep2->norm;
-													count += 1.f;
-												}
-											}
+										if(LittleAngularDiff(&cur_nrml, &ep2->norm)) {
+											nrml += ep2->norm;
+											count += 1.f;
 										}
 									}
+								}
 							}
-						}
+					}
+				}
 
-					count = 1.f / count;
-					ep->tv[k].p = nrml * count;
+			count = 1.f / count;
+			ep->tv[k].p = nrml * count;
 
-				}
-			}
 		}
+	}
 
-	for (j = 0; j < ACTIVEBKG->Zsize; j++)
-		for (i = 0; i < ACTIVEBKG->Xsize; i++)
-		{
-			eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
+	// Neighbouring cells only read the original normals and positions of this cell,
+	// so the smoothed normals can be applied right away.
+	for (long l = 0; l < eg->nbpoly; l++)
+	{
+		ep = &eg->polydata[l];
 
-			for (long l = 0; l < eg->nbpoly; l++)
-			{
-				ep = &eg->polydata[l];
+		long nbvert = (ep->type & POLY_QUAD) ? 4 : 3;
 
-				long nbvert = (ep->type & POLY_QUAD) ? 4 : 3;
+		for(k = 0; k < nbvert; k++) {
+			ep->nrml[k] = ep->tv[k].p;
+		}
 
-				for(k = 0; k < nbvert; k++) {
-					ep->nrml[k] = ep->tv[k].p;
-				}
+		float d = 0.f;
 
-				float d = 0.f;
+		for(long ii = 0; ii < nbvert; ii++) {
+			d = max(d, dist(ep->center, ep->v[ii].p));
+		}
 
-				for(long ii = 0; ii < nbvert; ii++) {
-					d = max(d, dist(ep->center, ep->v[ii].p));
-				}
+		ep->v[0].rhw = d;
+	}
 
-				ep->v[0].rhw = d;
+}
+
+namespace {
+
+class PrepareBackgroundNRMLsTask : public jobs::ParallelTask {
+	
+	void run(size_t begin, size_t end) {
+		for(size_t j = begin; j < end; j++) {
+			for(long i = 0; i < ACTIVEBKG->Xsize; i++) {
+				ARX_PrepareBackgroundNRMLs(i, long(j));
 			}
 		}
+	}
+
+};
+
+} // anonymous namespace
 
+void ARX_PrepareBackgroundNRMLs() {
+	PrepareBackgroundNRMLsTask task;
+	jobs::parallelFor(task, ACTIVEBKG->Zsize);
 }
 
 void EERIE_PHYSICS_BOX_Launch_NOCOL(Entity * io, EERIE_3DOBJ * obj, Vec3f * pos,
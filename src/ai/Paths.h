@@ -213,6 +213,21 @@ void ARX_THROWN_OBJECT_KillAll();
 void ARX_THROWN_OBJECT_Manage(unsigned long time_offset);
 void EERIE_PHYSICS_BOX_Launch_NOCOL(Entity * io, EERIE_3DOBJ * obj, Vec3f * pos, Vec3f * vect, long flags = 0, Anglef * angle = NULL);
 
-long ARX_PHYSICS_BOX_ApplyModel(EERIE_3DOBJ * obj, float framediff, float rubber, long source);
+//! A physics box to be simulated by ARX_PHYSICS_BOX_ApplyModels()
+struct PhysicsBoxModel {
+	EERIE_3DOBJ * obj;
+	float rubber;
+	long source; //!< Index of the entity that owns the box
+	long ret; //!< Set to 1 if the box has not been simulated as the elapsed time was too short
+};
+
+/*!
+ * Simulate a number of physics boxes for one frame.
+ *
+ * The forces, integration and collisions with the background are computed for all boxes
+ * at once on the worker threads. Collisions with entities, collision responses and
+ * sounds are then handled on the calling thread.
+ */
+void ARX_PHYSICS_BOX_ApplyModels(PhysicsBoxModel * models, size_t count, float framediff);
 
 #endif // ARX_AI_PATHS_H
@@ -1435,9 +1435,9 @@ void ApplyDynLight_VertexBuffer_2(EERIEPOLY * ep, short _x, short _y, SMY_VERTEX
 		return;
 	}
 
-	float epr[4];
-	float epg[4];
-	float epb[4];
+	float epr[4] = { 0.f, 0.f, 0.f, 0.f };
+	float epg[4] = { 0.f, 0.f, 0.f, 0.f };
+	float epb[4] = { 0.f, 0.f, 0.f, 0.f };
 	
 	for(long i = 0; i < nbvert; i++) {
 		long c = ep->v[i].color;
@@ -1446,36 +1446,7 @@ void ApplyDynLight_VertexBuffer_2(EERIEPOLY * ep, short _x, short _y, SMY_VERTEX
 		epb[i] = (float)(long)(c & 255);
 	}
 
-	for(long i = 0; i < tls->num; i++) {
-		EERIE_LIGHT * el = tls->el[i];
-	
-		for(long j = 0; j < nbvert; j++) {
-			float d = fdist(el->pos, ep->v[j].p);
-
-			if (d < el->fallend) {
-				float nvalue;
-				
-				nvalue =	((el->pos.x - ep->v[j].p.x) * ep->nrml[j].x
-				             +	(el->pos.y - ep->v[j].p.y) * ep->nrml[j].y
-				             +	(el->pos.z - ep->v[j].p.z) * ep->nrml[j].z
-				         ) * 0.5f / d; 
-				
-				if(nvalue > 0.f) {
-					if(d <= el->fallstart) {
-						d = el->precalc * nvalue; 
-					} else {
-						d -= el->fallstart;
-						d = (el->falldiff - d) * el->falldiffmul * el->precalc * nvalue; 
-					}
-					epr[j] += el->rgb255.r * d;
-					epg[j] += el->rgb255.g * d;
-					epb[j] += el->rgb255.b * d;
-				}
-			}
-			else if (d > el->fallend + 100.f)
-				break;
-		}	
-	}
+	AccumulateDynLights(*ep, tls->el, tls->num, epr, epg, epb, DynLightVertexBuffer);
 
 	u8 lepr, lepg, lepb;
 
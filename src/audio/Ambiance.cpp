@@ -318,6 +318,7 @@ void Ambiance::Track::keyPlay() {
 		}
 		
 		channel.pitch = key_i->pitch.cur;
+		channel.priority = ambiance->channel.priority;
 		
 		if(flags & POSITION) {
 			channel.flags |= FLAG_POSITION;
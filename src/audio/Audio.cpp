@@ -43,6 +43,11 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "audio/Audio.h"
 
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include "Configure.h"
 
 #include "audio/AudioResource.h"
@@ -53,6 +58,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/AudioBackend.h"
 #include "audio/AudioSource.h"
 #include "audio/AudioEnvironment.h"
+#include "audio/CommandQueue.h"
+#include "audio/SampleCache.h"
+#include "audio/null/NullBackend.h"
 #ifdef ARX_HAVE_DSOUND
 	#include "audio/dsound/DSoundBackend.h"
 #endif
@@ -62,6 +70,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "io/log/Logger.h"
 
+#include "math/Vector3.h"
+
 #include "platform/Lock.h"
 #include "platform/Time.h"
 
@@ -70,9 +80,175 @@ using std::string;
 namespace audio {
 
 namespace {
+
 static Lock * mutex = NULL;
+static CommandQueue * commands = NULL;
+
+//! The active backend if it is the null backend
+static NullBackend * null_backend = NULL;
+static size_t offline_start = 0;
+
+// Voice prioritization
+static size_t max_voices = DEFAULT_MAX_VOICES;
+static VoiceStats voice_stats;
+static Vec3f listener_position = Vec3f::ZERO;
+static float rolloff_factor = 1.f;
+
+//! Sources that already have a voice are preferred to avoid switching back and forth
+static const float VOICE_HYSTERESIS = 1.25f;
+
+//! Offline mixing is not tied to the system clock
+size_t getSessionTime() {
+	if(null_backend && null_backend->isOffline()) {
+		return offline_start + null_backend->getTime();
+	}
+	return Time::getMs();
+}
+
+//! Apply one deferred command - the audio mutex must be locked
+aalError execute(const Command & command) {
+	
+	switch(command.type) {
+		case Command::SetListenerPosition: {
+			listener_position = command.vector;
+			return backend->setListenerPosition(command.vector);
+		}
+		case Command::SetListenerDirection: {
+			return backend->setListenerOrientation(command.vector, command.up);
+		}
+		default: break;
+	}
+	
+	Source * source = backend->getSource(command.source);
+	if(!source) {
+		return AAL_ERROR_HANDLE;
+	}
+	
+	switch(command.type) {
+		case Command::SetSampleVolume: return source->setVolume(command.value);
+		case Command::SetSamplePitch: return source->setPitch(command.value);
+		case Command::SetSamplePosition: return source->setPosition(command.vector);
+		case Command::SampleStop: {
+			LogDebug("SampleStop " << source->getSample()->getName());
+			return source->stop();
+		}
+		default: break;
+	}
+	
+	arx_assert(false);
+	return AAL_ERROR;
+}
+
+//! How loud a source is expected to be, scaled by its priority
+float getAudibility(const Source * source) {
+	
+	const Channel & channel = source->getChannel();
+	
+	float audibility = channel.priority;
+	
+	if(channel.flags & FLAG_VOLUME) {
+		audibility *= channel.volume;
+		if(_mixer.isValid(channel.mixer)) {
+			audibility *= _mixer[channel.mixer]->getFinalVolume();
+		}
+	}
+	
+	if((channel.flags & FLAG_POSITION) && (channel.flags & FLAG_FALLOFF)) {
+		Vec3f listener = (channel.flags & FLAG_RELATIVE) ? Vec3f::ZERO : listener_position;
+		float d = dist(channel.position, listener);
+		const SourceFalloff & falloff = channel.falloff;
+		if(d > falloff.end) {
+			return 0.f;
+		}
+		if(d > falloff.start && falloff.start > 0.f) {
+			audibility *= falloff.start / (falloff.start + rolloff_factor * (d - falloff.start));
+		}
+	}
+	
+	if(!source->isVirtual()) {
+		audibility *= VOICE_HYSTERESIS;
+	}
+	
+	return audibility;
+}
+
+/*!
+ * Give the backend voices to the most audible sources and virtualize the rest.
+ * The audio mutex must be locked.
+ */
+void updateVoices() {
+	
+	typedef std::vector<std::pair<float, Source *> > Candidates;
+	static Candidates candidates;
+	candidates.clear();
+	
+	for(Backend::source_iterator p = backend->sourcesBegin(); p != backend->sourcesEnd(); ++p) {
+		Source * source = *p;
+		if(source && !source->isIdle()) {
+			float audibility = max_voices ? getAudibility(source) : 0.f;
+			candidates.push_back(std::make_pair(audibility, source));
+		}
+	}
+	
+	size_t count = candidates.size();
+	if(max_voices && max_voices < count) {
+		std::nth_element(candidates.begin(), candidates.begin() + max_voices, candidates.end(),
+		                 std::greater<Candidates::value_type>());
+		count = max_voices;
+	}
+	
+	voice_stats.sources = candidates.size();
+	voice_stats.promoted = voice_stats.demoted = 0;
+	
+	// Release voices first so that the backend has them available for the promoted sources
+	for(size_t i = count; i < candidates.size(); i++) {
+		Source * source = candidates[i].second;
+		if(!source->isVirtual() && !source->setVirtual(true)) {
+			voice_stats.demoted++;
+		}
+	}
+	
+	for(size_t i = 0; i < count; i++) {
+		Source * source = candidates[i].second;
+		if(source->isVirtual() && !source->setVirtual(false)) {
+			voice_stats.promoted++;
+		}
+	}
+	
+	voice_stats.virtualVoices = 0;
+	for(size_t i = 0; i < candidates.size(); i++) {
+		if(candidates[i].second->isVirtual()) {
+			voice_stats.virtualVoices++;
+		}
+	}
+	voice_stats.voices = candidates.size() - voice_stats.virtualVoices;
 }
 
+//! Apply all deferred commands in order - the audio mutex must be locked
+void executeQueued() {
+	Command command;
+	while(commands->pop(command)) {
+		execute(command);
+	}
+}
+
+/*!
+ * Defer a command to the next audio call that locks the mutex.
+ * If the queue is full the command is executed directly.
+ */
+aalError enqueue(const Command & command) {
+	
+	if(commands->push(command)) {
+		return AAL_OK;
+	}
+	
+	Autolock lock(mutex);
+	executeQueued();
+	return execute(command);
+}
+
+} // anonymous namespace
+
 aalError init(const string & backendName, bool enableEAX) {
 	
 	// Clean any initialized data
@@ -118,6 +294,19 @@ aalError init(const string & backendName, bool enableEAX) {
 		}
 		#endif
 		
+		// Never selected automatically as it does not produce any audible output
+		if(!backend && first && backendName == "Null") {
+			matched = true;
+			LogDebug("initializing null backend");
+			NullBackend * _backend = new NullBackend();
+			error = _backend->init();
+			if(!error) {
+				backend = null_backend = _backend;
+			} else {
+				delete _backend;
+			}
+		}
+		
 		if(first && !matched) {
 			LogError << "Unknown backend: " << backendName;
 		}
@@ -133,6 +322,7 @@ aalError init(const string & backendName, bool enableEAX) {
 	}
 	
 	mutex = new Lock();
+	commands = new CommandQueue();
 	
 	session_time = Time::getMs();
 	
@@ -152,12 +342,20 @@ aalError clean() {
 	_mixer.clear();
 	_env.clear();
 	
+	sample_cache.clear();
+	
 	delete backend, backend = NULL;
+	null_backend = NULL;
+	
+	max_voices = DEFAULT_MAX_VOICES;
+	listener_position = Vec3f::ZERO;
+	rolloff_factor = 1.f;
 	
 	sample_path.clear();
 	ambiance_path.clear();
 	environment_path.clear();
 	
+	delete commands, commands = NULL;
 	delete mutex, mutex = NULL;
 	
 	return AAL_OK;
@@ -167,13 +365,21 @@ aalError clean() {
 	if(!backend) { \
 		return AAL_ERROR_INIT; \
 	} \
-	Autolock lock(mutex);
+	Autolock lock(mutex); \
+	executeQueued();
 
 #define AAL_ENTRY_V(value) \
 	if(!backend) { \
 		return (value); \
 	} \
-	Autolock lock(mutex);
+	Autolock lock(mutex); \
+	executeQueued();
+	
+#define AAL_DEFERRED \
+	if(!backend) { \
+		return AAL_ERROR_INIT; \
+	} \
+	Command command;
 
 aalError setStreamLimit(size_t limit) {
 	
@@ -218,11 +424,18 @@ aalError setReverbEnabled(bool enable) {
 	return backend->setReverbEnabled(enable);
 }
 
+aalError processCommands() {
+	
+	AAL_ENTRY
+	
+	return AAL_OK;
+}
+
 aalError update() {
 	
 	AAL_ENTRY
 	
-	session_time = Time::getMs();
+	session_time = getSessionTime();
 	
 	// Update sources
 	for(Backend::source_iterator p = backend->sourcesBegin(); p != backend->sourcesEnd();) {
@@ -234,6 +447,8 @@ aalError update() {
 		}
 	}
 	
+	updateVoices();
+	
 	// Update ambiances
 	for(size_t i = 0; i < _amb.size(); i++) {
 		Ambiance * ambiance = _amb[i];
@@ -316,6 +531,103 @@ EnvId createEnvironment(const res::path & name) {
 	return e_id;
 }
 
+aalError preloadSamples() {
+	
+	AAL_ENTRY
+	
+	aalError ret = AAL_OK;
+	
+	for(size_t i = 0; i < _sample.size(); i++) {
+		Sample * sample = _sample[i];
+		if(sample) {
+			if(aalError error = backend->preloadSample(sample)) {
+				ret = error;
+			}
+		}
+	}
+	
+	return ret;
+}
+
+aalError getSampleCacheStats(SampleCacheStats & stats) {
+	
+	AAL_ENTRY
+	
+	stats = sample_cache.getStats();
+	
+	return AAL_OK;
+}
+
+aalError setMaxVoices(size_t count) {
+	
+	AAL_ENTRY
+	
+	LogDebug("SetMaxVoices " << count);
+	
+	max_voices = count;
+	
+	return AAL_OK;
+}
+
+aalError getVoiceStats(VoiceStats & stats) {
+	
+	AAL_ENTRY
+	
+	stats = voice_stats;
+	
+	return AAL_OK;
+}
+
+aalError setOffline(const fs::path & file) {
+	
+	AAL_ENTRY
+	
+	if(!null_backend) {
+		return AAL_ERROR_SYSTEM;
+	}
+	
+	offline_start = session_time;
+	
+	return null_backend->setOffline(file);
+}
+
+aalError renderOffline(size_t ms, std::vector<s16> * output) {
+	
+	AAL_ENTRY
+	
+	if(!null_backend || !null_backend->isOffline()) {
+		return AAL_ERROR_INIT;
+	}
+	
+	return null_backend->render(ms * NullBackend::FREQUENCY / 1000, output);
+}
+
+aalError getMixStats(MixStats & stats) {
+	
+	AAL_ENTRY
+	
+	if(!null_backend) {
+		return AAL_ERROR_SYSTEM;
+	}
+	
+	stats = null_backend->getStats();
+	
+	return AAL_OK;
+}
+
+aalError getSourceStats(std::vector<SourceStats> & stats) {
+	
+	AAL_ENTRY
+	
+	if(!null_backend) {
+		return AAL_ERROR_SYSTEM;
+	}
+	
+	null_backend->getSourceStats(stats);
+	
+	return AAL_OK;
+}
+
 // Resource destruction
 
 aalError deleteSample(SampleId sample_id) {
@@ -412,21 +724,30 @@ aalError setRolloffFactor(float factor) {
 	
 	LogDebug("SetRolloffFactor " << factor);
 	
+	rolloff_factor = factor;
+	
 	return backend->setRolloffFactor(factor);
 }
 
 aalError setListenerPosition(const Vec3f & position) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
+	
+	command.type = Command::SetListenerPosition;
+	command.vector = position;
 	
-	return backend->setListenerPosition(position);
+	return enqueue(command);
 }
 
 aalError setListenerDirection(const Vec3f & front, const Vec3f & up) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
 	
-	return backend->setListenerOrientation(front, up);
+	command.type = Command::SetListenerDirection;
+	command.vector = front;
+	command.up = up;
+	
+	return enqueue(command);
 }
 
 aalError setListenerEnvironment(EnvId e_id) {
@@ -532,38 +853,35 @@ aalError mixerResume(MixerId m_id) {
 
 aalError setSampleVolume(SourceId sample_id, float volume) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
 	
-	Source * source = backend->getSource(sample_id);
-	if(!source) {
-		return AAL_ERROR_HANDLE;
-	}
+	command.type = Command::SetSampleVolume;
+	command.source = sample_id;
+	command.value = volume;
 	
-	return source->setVolume(volume);
+	return enqueue(command);
 }
 
 aalError setSamplePitch(SourceId sample_id, float pitch) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
 	
-	Source * source = backend->getSource(sample_id);
-	if(!source) {
-		return AAL_ERROR_HANDLE;
-	}
+	command.type = Command::SetSamplePitch;
+	command.source = sample_id;
+	command.value = pitch;
 	
-	return source->setPitch(pitch);
+	return enqueue(command);
 }
 
 aalError setSamplePosition(SourceId sample_id, const Vec3f & position) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
 	
-	Source * source = backend->getSource(sample_id);
-	if(!source) {
-		return AAL_ERROR_HANDLE;
-	}
+	command.type = Command::SetSamplePosition;
+	command.source = sample_id;
+	command.vector = position;
 	
-	return source->setPosition(position);
+	return enqueue(command);
 }
 
 // Sample status
@@ -676,18 +994,18 @@ aalError samplePlay(SampleId & sample_id, const Channel & channel, unsigned play
 
 aalError sampleStop(SourceId & sample_id) {
 	
-	AAL_ENTRY
+	AAL_DEFERRED
 	
-	Source * source = backend->getSource(sample_id);
-	if(!source) {
+	if(sample_id == Backend::clearSource(sample_id)) {
 		return AAL_ERROR_HANDLE;
 	}
 	
-	LogDebug("SampleStop " << source->getSample()->getName());
+	command.type = Command::SampleStop;
+	command.source = sample_id;
 	
 	sample_id = Backend::clearSource(sample_id);
 	
-	return source->stop();
+	return enqueue(command);
 }
 
 // Track setup
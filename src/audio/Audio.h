@@ -46,10 +46,12 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include <stddef.h>
 #include <string>
+#include <vector>
 
 #include "audio/AudioTypes.h"
 #include "math/MathFwd.h"
 
+namespace fs { class path; }
 namespace res { class path; }
 
 namespace audio {
@@ -73,6 +75,18 @@ aalError setSamplePath(const res::path & path);
 aalError setAmbiancePath(const res::path & path);
 aalError setEnvironmentPath(const res::path & path);
 aalError setReverbEnabled(bool enable);
+
+/*!
+ * Apply queued source and listener updates.
+ *
+ * setSampleVolume(), setSamplePitch(), setSamplePosition(), sampleStop(),
+ * setListenerPosition() and setListenerDirection() do not lock the audio mutex but
+ * only queue the change. Queued changes are applied in order by the next call that
+ * locks the mutex, including this function and update().
+ * Only one thread may queue changes at a time.
+ */
+aalError processCommands();
+
 aalError update();
 
 // Resource
@@ -81,6 +95,42 @@ MixerId createMixer();
 SampleId createSample(const res::path & name);
 AmbianceId createAmbiance(const res::path & name);
 EnvId createEnvironment(const res::path & name);
+
+/*!
+ * Decode all loaded short samples ahead of time so that the first play does not have to.
+ * Samples that are long enough to be streamed are ignored.
+ */
+aalError preloadSamples();
+aalError getSampleCacheStats(SampleCacheStats & stats);
+
+/*!
+ * Limit the number of sources that are played by the backend at the same time.
+ * The least audible sources are virtualized: they keep track of their play position
+ * without being heard and continue from there once they are audible enough again.
+ * @param count The maximum number of voices, 0 for no limit.
+ */
+aalError setMaxVoices(size_t count);
+aalError getVoiceStats(VoiceStats & stats);
+
+// Offline mixing - only supported by the "Null" backend
+
+/*!
+ * Stop mixing in real time: from now on audio is only mixed by renderOffline().
+ * The session time used by ambiances then follows the mixed output.
+ * @param file WAV file to write the mixed output to, or an empty path to discard it.
+ */
+aalError setOffline(const fs::path & file);
+
+/*!
+ * Mix the given time of audio as fast as possible.
+ * Sources and ambiances are not updated, call update() between renderOffline() calls.
+ * @param output If not NULL, the interleaved 16-bit stereo output is appended to this.
+ */
+aalError renderOffline(size_t ms, std::vector<s16> * output = NULL);
+
+aalError getMixStats(MixStats & stats);
+aalError getSourceStats(std::vector<SourceStats> & stats);
+
 aalError deleteSample(SampleId sample_id);
 aalError deleteAmbiance(AmbianceId ambiance_id);
 
@@ -57,6 +57,12 @@ public:
 	 */
 	virtual Source * getSource(SourceId sourceId) = 0;
 	
+	/*!
+	 * Decode a sample into the sample cache the same way that a new source would.
+	 * Samples that would be streamed are ignored.
+	 */
+	virtual aalError preloadSample(const Sample * sample) = 0;
+	
 	/*!
 	 * Enable or disable effects.
 	 */
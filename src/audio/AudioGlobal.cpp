@@ -49,6 +49,11 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/AudioEnvironment.h"
 
 #include "io/resource/ResourcePath.h"
+#include "platform/Architecture.h"
+
+#if defined(ARX_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
 
 namespace audio {
 
@@ -91,4 +96,66 @@ size_t bytesToUnits(size_t v, const PCMFormat & _format, TimeUnit unit) {
 	}
 }
 
+/*!
+ * Convert as many whole batches of stereo samples as possible.
+ * @return the number of input samples converted
+ */
+static size_t stereoToMonoBatch(s8 * buf, size_t nbsamples) {
+	ARX_UNUSED(buf), ARX_UNUSED(nbsamples);
+	return 0;
+}
+
+static size_t stereoToMonoBatch(s16 * buf, size_t nbsamples) {
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	const __m128i ones = _mm_set1_epi16(1);
+	
+	size_t in = 0;
+	for(; in + 16 <= nbsamples; in += 16) {
+		
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + in));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + in + 8));
+		
+		// Sum the left and right samples of each frame
+		a = _mm_madd_epi16(a, ones);
+		b = _mm_madd_epi16(b, ones);
+		
+		// Halve, rounding towards zero like the integer division
+		a = _mm_srai_epi32(_mm_add_epi32(a, _mm_srli_epi32(a, 31)), 1);
+		b = _mm_srai_epi32(_mm_add_epi32(b, _mm_srli_epi32(b, 31)), 1);
+		
+		// The output never overtakes the input that has not been loaded yet
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(buf + in / 2), _mm_packs_epi32(a, b));
+	}
+	
+	return in;
+	
+#else // !defined(ARX_HAVE_SSE2)
+	ARX_UNUSED(buf), ARX_UNUSED(nbsamples);
+	return 0;
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
+template <class T>
+static size_t stereoToMono(char * data, size_t size) {
+	
+	T * buf = reinterpret_cast<T *>(data);
+	
+	size_t nbsamples = size / sizeof(T);
+	arx_assert(nbsamples % 2 == 0);
+	
+	size_t in = stereoToMonoBatch(buf, nbsamples);
+	for(size_t out = in / 2; in + 1 < nbsamples; in += 2, out++) {
+		buf[out] = T((int(buf[in]) + int(buf[in + 1])) / 2);
+	}
+	
+	return size / 2;
+}
+
+size_t stereoToMono(char * data, size_t size, const PCMFormat & format) {
+	return (format.quality == 8) ? stereoToMono<s8>(data, size) : stereoToMono<s16>(data, size);
+}
+
 } // namespace audio
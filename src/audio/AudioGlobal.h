@@ -86,6 +86,12 @@ size_t unitsToBytes(size_t v, const PCMFormat & format, TimeUnit unit = UNIT_MS)
 //! Convert a value from bytes to time units
 size_t bytesToUnits(size_t v, const PCMFormat & format, TimeUnit unit = UNIT_MS);
 
+/*!
+ * Convert a stereo buffer to mono in-place.
+ * @return the size of the converted buffer
+ */
+size_t stereoToMono(char * data, size_t size, const PCMFormat & format);
+
 inline float LinearToLogVolume(float volume) {
 	return 0.2F * (float)log10(volume) + 1.0F;
 }
@@ -26,7 +26,9 @@
 
 namespace audio {
 
-Source::Source(Sample * _sample) : id(INVALID_ID), sample(_sample), status(Idle), time(0), callback_i(0) {
+Source::Source(Sample * _sample)
+	: id(INVALID_ID), sample(_sample), status(Idle), time(0), remaining(0), callback_i(0),
+	  virtualVoice(false), virtualTime(0) {
 	sample->reference();
 }
 
@@ -53,6 +55,11 @@ void Source::addCallback(Callback * callback, size_t time, TimeUnit unit) {
 
 aalError Source::update() {
 	
+	if(virtualVoice) {
+		updateVirtual();
+		return AAL_OK;
+	}
+	
 	if(status != Playing || updateCulling()) {
 		return AAL_OK;
 	}
@@ -79,6 +86,9 @@ void Source::updateCallbacks() {
 		
 		time -= sample->getLength();
 		callback_i = 0;
+		if(remaining && remaining != (unsigned)-1) {
+			remaining--;
+		}
 		
 		if(!time && status != Playing) {
 			// Prevent callback for time==0 being called again after playing.
@@ -91,6 +101,74 @@ void Source::updateCallbacks() {
 	
 }
 
+void Source::updateVirtual() {
+	
+	size_t elapsed = session_time - virtualTime;
+	virtualTime = session_time;
+	
+	if(status != Playing || !elapsed) {
+		return;
+	}
+	
+	const PCMFormat & format = sample->getFormat();
+	size_t frameSize = format.channels * (format.quality >> 3);
+	float pitch = (channel.flags & FLAG_PITCH) ? channel.pitch : 1.f;
+	size_t frames = size_t(float(elapsed) * pitch * 0.001f * float(format.frequency));
+	size_t advance = frames * frameSize;
+	
+	if(remaining != (unsigned)-1) {
+		size_t total = size_t(remaining) * sample->getLength();
+		size_t left = (total > time) ? total - time : 0;
+		if(advance >= left) {
+			// Like a real source, stop before informing the callbacks about the last play
+			time += left;
+			stop();
+			updateCallbacks();
+			return;
+		}
+	}
+	
+	time += advance;
+	
+	updateCallbacks();
+}
+
+void Source::addPlays(unsigned playCount) {
+	if(playCount && remaining != (unsigned)-1) {
+		remaining += playCount;
+	} else {
+		remaining = (unsigned)-1;
+	}
+}
+
+aalError Source::setVirtual(bool virtualize) {
+	
+	if(virtualize == virtualVoice) {
+		return AAL_OK;
+	}
+	
+	if(virtualize) {
+		if(aalError error = releaseVoice()) {
+			return error;
+		}
+		updateCallbacks();
+		virtualVoice = true;
+		virtualTime = session_time;
+		return AAL_OK;
+	}
+	
+	// Catch up with the time since the last update before continuing
+	updateVirtual();
+	
+	virtualVoice = false;
+	if(aalError error = acquireVoice()) {
+		virtualVoice = true;
+		return error;
+	}
+	
+	return AAL_OK;
+}
+
 aalError Source::setVolume(float v) {
 	
 	if(!(channel.flags & FLAG_VOLUME)) {
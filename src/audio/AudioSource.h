@@ -114,6 +114,15 @@ public:
 	 */
 	virtual aalError updateVolume() = 0;
 	
+	/*!
+	 * Release or reacquire the backend voice used by this source.
+	 * Virtual sources are not heard but keep their play position and callbacks up to date
+	 * so that they continue where they would have been once they get a voice again.
+	 * @param virtualize true to release the voice, false to acquire a new one
+	 */
+	aalError setVirtual(bool virtualize);
+	inline bool isVirtual() const { return virtualVoice; }
+	
 	void addCallback(Callback * callback, size_t time, TimeUnit unit = UNIT_MS);
 	
 protected:
@@ -130,7 +139,12 @@ protected:
 	
 	size_t time; // Elapsed 'time'
 	
-	inline void reset() { time = 0, callback_i = 0; }
+	unsigned remaining; // Plays left including the current one, (unsigned)-1 to loop forever
+	
+	inline void reset() { time = 0, callback_i = 0, remaining = 0; }
+	
+	//! Add to the number of remaining plays. 0 means loop forever.
+	void addPlays(unsigned playCount);
 	
 	/*!
 	 * Check if this source is too far from the listener and play/pause it accordingly.
@@ -140,14 +154,31 @@ protected:
 	
 	virtual aalError updateBuffers() = 0;
 	
+	/*!
+	 * Free the backend resources used to play this source.
+	 * The current play position is in time.
+	 */
+	virtual aalError releaseVoice() = 0;
+	
+	/*!
+	 * Re-create the backend resources and continue playing at the current time.
+	 */
+	virtual aalError acquireVoice() = 0;
+	
 private:
 	
 	typedef std::vector<std::pair<Callback*, size_t> > CallbackList;
 	CallbackList callbacks;
 	size_t callback_i;
 	
+	bool virtualVoice;
+	size_t virtualTime; // Session time of the last virtual update
+	
 	void updateCallbacks();
 	
+	//! Advance the play position of a virtual source
+	void updateVirtual();
+	
 };
 
 } // namespace audio
@@ -52,6 +52,7 @@ namespace audio {
 
 // Default values
 const size_t DEFAULT_STREAMLIMIT = 88200; // in Bytes; ~1 second for the correct format
+const size_t DEFAULT_SAMPLE_CACHE_LIMIT = 32 * 1024 * 1024; // in Bytes
 
 const float DEFAULT_ENVIRONMENT_SIZE = 7.5f;
 const float DEFAULT_ENVIRONMENT_DIFFUSION = 1.f; // High density echoes
@@ -64,6 +65,8 @@ const float DEFAULT_ENVIRONMENT_REVERBERATION_DECAY = 1500.f;
 const float DEFAULT_ENVIRONMENT_REVERBERATION_HFDECAY = 1200.f;
 
 const float DEFAULT_VOLUME = 1.f; // Original gain
+const float DEFAULT_PRIORITY = 1.f; // Audibility multiplier used to rank voices
+const size_t DEFAULT_MAX_VOICES = 0; // Backend voices, 0 for unlimited
 
 // Flags
 enum ChannelFlag {
@@ -131,8 +134,59 @@ typedef s32 MixerId;
 typedef s32 EnvId;
 typedef s32 AmbianceId;
 
+// Decoded sample cache statistics
+struct SampleCacheStats {
+	size_t entries; // Number of cached samples
+	size_t size; // Size of all cached samples in bytes
+	size_t limit; // Maximum size in bytes
+	size_t hits;
+	size_t misses;
+	u64 decodeTime; // Time spent decoding samples in microseconds
+	u64 savedTime; // Decode time saved by cache hits in microseconds
+};
+
+// Software mixer statistics of the null backend
+struct MixStats {
+	size_t sources; // Number of allocated sources
+	size_t voices; // Number of sources mixed in the last render pass
+	size_t maxVoices; // Highest number of sources mixed in a single render pass
+	u64 frames; // Mixed output frames
+	u64 mixTime; // Time spent mixing in microseconds, including decodeTime
+	u64 decodeTime; // Time spent decoding sample data in microseconds
+};
+
+// Voice prioritization statistics of the last update
+struct VoiceStats {
+	size_t sources; // Number of playing or paused sources
+	size_t voices; // Sources with a backend voice
+	size_t virtualVoices; // Sources that are only tracked in software
+	size_t promoted; // Sources that got a voice in the last update
+	size_t demoted; // Sources that lost their voice in the last update
+};
+
+// Per-source statistics of the null backend
+struct SourceStats {
+	SourceId id;
+	bool streaming;
+	bool playing;
+	size_t decoded; // Bytes decoded for this source
+	u64 decodeTime; // Time spent decoding in microseconds
+	u64 frames; // Sample frames mixed
+};
+
 // Play channel initialization parameters
 struct Channel {
+	
+	Channel()
+		: mixer(INVALID_ID), volume(DEFAULT_VOLUME), pitch(1.f), pan(0.f),
+		  position(0.f, 0.f, 0.f), velocity(0.f, 0.f, 0.f), direction(0.f, 0.f, 0.f),
+		  priority(DEFAULT_PRIORITY) {
+		cone.inner_angle = cone.outer_angle = 360.f;
+		cone.outer_volume = 1.f;
+		falloff.start = 0.f;
+		falloff.end = 0.f;
+	}
+	
 	ChannelFlags flags;
 	MixerId mixer;
 	float volume;
@@ -143,6 +197,7 @@ struct Channel {
 	Vec3f direction;
 	SourceCone cone;
 	SourceFalloff falloff;
+	float priority; // Sources with a higher priority keep their voices longer
 };
 
 } // namespace audio
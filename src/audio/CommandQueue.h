@@ -0,0 +1,97 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_COMMANDQUEUE_H
+#define ARX_AUDIO_COMMANDQUEUE_H
+
+#include "audio/AudioTypes.h"
+#include "math/Vector3.h"
+#include "platform/Atomic.h"
+#include "platform/Platform.h"
+
+namespace audio {
+
+//! A deferred source or listener update
+struct Command {
+	
+	enum Type {
+		SetSampleVolume,
+		SetSamplePitch,
+		SetSamplePosition,
+		SampleStop,
+		SetListenerPosition,
+		SetListenerDirection
+	};
+	
+	Type type;
+	SourceId source;
+	float value;
+	Vec3f vector; //!< Position or listener front direction
+	Vec3f up; //!< Listener up direction
+	
+};
+
+/*!
+ * Lock-free ring buffer of commands with a single producer and a single consumer.
+ *
+ * The producer is the thread making the audio calls. The consumer must hold the audio
+ * mutex, so that it does not matter which thread ends up processing the commands.
+ */
+class CommandQueue {
+	
+public:
+	
+	CommandQueue() : m_read(0), m_write(0) { }
+	
+	//! \return false if the queue is full
+	bool push(const Command & command) {
+		u32 write = m_write;
+		if(write - atomicLoad(&m_read) == Size) {
+			return false;
+		}
+		m_commands[write % Size] = command;
+		atomicStore(&m_write, write + 1);
+		return true;
+	}
+	
+	//! \return false if the queue is empty
+	bool pop(Command & command) {
+		u32 read = m_read;
+		if(read == atomicLoad(&m_write)) {
+			return false;
+		}
+		command = m_commands[read % Size];
+		atomicStore(&m_read, read + 1);
+		return true;
+	}
+	
+private:
+	
+	static const u32 Size = 1024;
+	
+	// The commands keep the two indices on separate cache lines
+	volatile u32 m_read;
+	Command m_commands[Size];
+	volatile u32 m_write;
+	
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_COMMANDQUEUE_H
@@ -47,6 +47,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/Stream.h"
 #include "audio/AudioBackend.h"
 #include "audio/AudioSource.h"
+#include "audio/SampleCache.h"
 
 namespace audio {
 
@@ -64,6 +65,7 @@ Sample::~Sample() {
 		}
 	}
 	
+	sample_cache.remove(this);
 }
 
 aalError Sample::load() {
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/SampleCache.h"
+
+#include <algorithm>
+
+#include "audio/AudioGlobal.h"
+#include "audio/Sample.h"
+#include "audio/Stream.h"
+#include "io/log/Logger.h"
+#include "platform/Time.h"
+
+namespace audio {
+
+SampleCache sample_cache;
+
+SampleCache::SampleCache() {
+	m_stats.entries = 0;
+	m_stats.size = 0;
+	m_stats.limit = DEFAULT_SAMPLE_CACHE_LIMIT;
+	m_stats.hits = 0;
+	m_stats.misses = 0;
+	m_stats.decodeTime = 0;
+	m_stats.savedTime = 0;
+}
+
+SampleCache::~SampleCache() {
+	clear();
+}
+
+const std::vector<char> * SampleCache::get(const Sample * sample, bool mono) {
+	
+	// Mono samples don't need to be converted
+	mono = mono && sample->getFormat().channels == 2;
+	
+	Key key(sample, mono);
+	
+	Index::iterator it = m_index.find(key);
+	if(it != m_index.end()) {
+		m_stats.hits++;
+		m_stats.savedTime += it->second->decodeTime;
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return &it->second->data;
+	}
+	
+	m_stats.misses++;
+	
+	u64 start = Time::getUs();
+	
+	Stream * stream = createStream(sample->getName());
+	if(!stream) {
+		LogError << "Error decoding sample " << sample->getName();
+		return NULL;
+	}
+	
+	m_entries.push_front(Entry());
+	Entry & entry = m_entries.front();
+	entry.key = key;
+	entry.data.resize(sample->getLength());
+	
+	size_t read = 0;
+	if(!entry.data.empty()) {
+		stream->read(&entry.data[0], entry.data.size(), read);
+	}
+	deleteStream(stream);
+	if(read != entry.data.size()) {
+		LogError << "Error decoding sample " << sample->getName();
+		m_entries.pop_front();
+		return NULL;
+	}
+	
+	if(mono) {
+		entry.data.resize(stereoToMono(&entry.data[0], entry.data.size(), sample->getFormat()));
+	}
+	
+	entry.decodeTime = Time::getElapsedUs(start);
+	m_stats.decodeTime += entry.decodeTime;
+	
+	m_index[key] = m_entries.begin();
+	m_stats.entries++;
+	m_stats.size += entry.data.size();
+	
+	// Never drop the entry we are about to return
+	evict(std::max(m_stats.limit, entry.data.size()));
+	
+	return &entry.data;
+}
+
+void SampleCache::remove(const Sample * sample) {
+	for(size_t i = 0; i < 2; i++) {
+		Index::iterator it = m_index.find(Key(sample, i != 0));
+		if(it != m_index.end()) {
+			m_stats.entries--;
+			m_stats.size -= it->second->data.size();
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+	}
+}
+
+void SampleCache::clear() {
+	m_entries.clear();
+	m_index.clear();
+	m_stats.entries = 0;
+	m_stats.size = 0;
+}
+
+void SampleCache::setLimit(size_t limit) {
+	m_stats.limit = limit;
+	evict(limit);
+}
+
+SampleCacheStats SampleCache::getStats() const {
+	return m_stats;
+}
+
+void SampleCache::evict(size_t limit) {
+	while(m_stats.size > limit && !m_entries.empty()) {
+		Entry & entry = m_entries.back();
+		m_stats.entries--;
+		m_stats.size -= entry.data.size();
+		m_index.erase(entry.key);
+		m_entries.pop_back();
+	}
+}
+
+} // namespace audio
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_SAMPLECACHE_H
+#define ARX_AUDIO_SAMPLECACHE_H
+
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "audio/AudioTypes.h"
+
+namespace audio {
+
+class Sample;
+
+/*!
+ * Decoded PCM data of whole samples, shared by all sources that play a sample.
+ *
+ * Short sounds like footsteps are played many times per session - with the cache they
+ * are only read and decoded once. The least recently used samples are dropped once the
+ * cache grows beyond its size limit.
+ *
+ * The cache is not threadsafe and must only be used with the audio mutex locked.
+ */
+class SampleCache {
+	
+public:
+	
+	SampleCache();
+	~SampleCache();
+	
+	/*!
+	 * Get the decoded data for a sample, decoding it if it is not cached yet.
+	 * \param mono Convert stereo samples to mono.
+	 * \return the PCM data or NULL if the sample could not be decoded. The data is only
+	 *         valid until the next call to a non-const method of the cache.
+	 */
+	const std::vector<char> * get(const Sample * sample, bool mono = false);
+	
+	//! Drop all cached data for a sample
+	void remove(const Sample * sample);
+	
+	void clear();
+	
+	void setLimit(size_t limit);
+	
+	SampleCacheStats getStats() const;
+	
+private:
+	
+	typedef std::pair<const Sample *, bool> Key;
+	
+	struct Entry {
+		Key key;
+		std::vector<char> data;
+		u64 decodeTime;
+	};
+	
+	//! Entries, most recently used first
+	typedef std::list<Entry> Entries;
+	typedef std::map<Key, Entries::iterator> Index;
+	
+	Entries m_entries;
+	Index m_index;
+	SampleCacheStats m_stats;
+	
+	void evict(size_t limit);
+	
+};
+
+extern SampleCache sample_cache;
+
+} // namespace audio
+
+#endif // ARX_AUDIO_SAMPLECACHE_H
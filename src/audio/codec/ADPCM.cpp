@@ -44,6 +44,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/codec/ADPCM.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include "audio/AudioTypes.h"
 #include "audio/codec/WAVFormat.h"
@@ -51,30 +52,51 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 namespace audio {
 
+namespace {
+
 // Fixed point delta adaption table
-static const short gai_p4[] = {
+const s32 gai_p4[] = {
 	230, 230, 230, 230, 307, 409, 512, 614,
 	768, 614, 512, 409, 307, 230, 230, 230
 };
 
+//! Decoder state of one channel
+struct ChannelState {
+	s16 delta;
+	s16 samp1;
+	s16 samp2;
+	s16 coef1;
+	s16 coef2;
+};
+
+inline s16 decodeNybble(ChannelState & state, u8 nybble) {
+	
+	// Update delta
+	s32 old_delta = state.delta;
+	s16 new_delta = s16((gai_p4[nybble] * old_delta) >> 8);
+	state.delta = std::max(new_delta, s16(16));
+	
+	// Sign-extend the nybble
+	s32 value = s32(nybble ^ 0x08) - 0x08;
+	
+	// Predict and reconstruct the original PCM sample, clipped to 16 bits
+	s32 predict = (s32(state.samp1) * state.coef1 + s32(state.samp2) * state.coef2) >> 8;
+	s32 pcm = std::min(std::max(value * old_delta + predict, s32(-32768)), s32(32767));
+	
+	state.samp2 = state.samp1;
+	state.samp1 = s16(pcm);
+	
+	return s16(pcm);
+}
+
+} // anonymous namespace
+
 CodecADPCM::CodecADPCM() :
 	stream(NULL), header(NULL), padding(0), shift(0),
-	sample_i(0xffffffff), predictor(NULL), delta(NULL),
-	samp1(NULL), samp2(NULL), coef1(NULL), coef2(NULL),
-	nybble_l(NULL), nybble_c(0), nybble_i(0), nybble(0), odd(false),
-	cache_c(0), cache_i(0), cache_l(NULL), cursor(0) {
+	decoded_c(0), decoded_i(0), cursor(0) {
 }
 
-CodecADPCM::~CodecADPCM() {
-	delete[] predictor;
-	delete[] delta;
-	delete[] samp1;
-	delete[] samp2;
-	delete[] coef1;
-	delete[] coef2;
-	delete[] (s8*)cache_l;
-	delete[] nybble_l;
-}
+CodecADPCM::~CodecADPCM() { }
 
 aalError CodecADPCM::setHeader(void * _header) {
 	
@@ -88,36 +110,20 @@ aalError CodecADPCM::setHeader(void * _header) {
 		return AAL_ERROR_FORMAT;
 	}
 	
-	shift = header->wfx.channels - 1;
-	padding = 0;
-	sample_i = 0xffffffff;
-	
-	size_t nb = 1 << shift;
-	
-	predictor = new char[nb];
-	delta = new s16[nb];
-	coef1 = new s16[nb];
-	coef2 = new s16[nb];
-	samp1 = new s16[nb];
-	samp2 = new s16[nb];
-	if(!predictor || !delta || !coef1 || !coef2 || !samp1 || !samp2) {
-		return AAL_ERROR_MEMORY;
+	if(header->samplesPerBlock < 2) {
+		return AAL_ERROR_FORMAT;
 	}
 	
-	cache_c = cache_i = (u8)(sizeof(s16) << shift);
-	cache_l = new s8[cache_c];
-	if(!cache_l) {
-		return AAL_ERROR_MEMORY;
-	}
+	shift = header->wfx.channels - 1;
 	
-	nybble_c = header->samplesPerBlock - 2;
+	size_t nybble_c = header->samplesPerBlock - 2;
 	if(!shift) {
 		nybble_c >>= 1;
 	}
-	nybble_l = new s8[nybble_c];
-	if(!nybble_l) {
-		return AAL_ERROR_MEMORY;
-	}
+	block.resize((7 << shift) + nybble_c);
+	
+	// Two samples per channel from the block header, two more per nybble byte
+	decoded.resize((size_t(2) << shift) + nybble_c * 2);
 	
 	padding = ((header->wfx.blockAlign - (7 << shift)) << 3) -
 	          (header->samplesPerBlock - 2) * (header->wfx.bitsPerSample << shift);
@@ -126,7 +132,8 @@ aalError CodecADPCM::setHeader(void * _header) {
 		return error;
 	}
 	
-	sample_i++;
+	// The first sample frame of the stream is skipped
+	decoded_i = sizeof(s16) << shift;
 	
 	return AAL_OK;
 }
@@ -150,9 +157,6 @@ aalError CodecADPCM::setPosition(size_t _position) {
 		return error;
 	}
 	
-	sample_i++;
-	cache_i = 0;
-	
 	while(i) {
 		char buffer[256];
 		size_t nRead;
@@ -172,52 +176,13 @@ size_t CodecADPCM::getPosition() {
 	return cursor;
 }
 
-void CodecADPCM::getSample(size_t i, s8 adpcm_sample) {
-	
-	// Update delta
-	s32 old_delta = delta[i];
-	delta[i] = s16((gai_p4[adpcm_sample] * old_delta) >> 8);
-	
-	if(delta[i] < 16) {
-		delta[i] = 16;
-	}
-	
-	// Sign-extend adpcm_sample
-	if(adpcm_sample & 0x08) {
-		adpcm_sample -= 16;
-	}
-	
-	// Predict next sample
-	s32 predict = ((s32)samp1[i] * coef1[i] + (s32)samp2[i] * coef2[i]) >> 8;
-	
-	// Reconstruct original PCM
-	s32 pcm_sample = adpcm_sample * old_delta + predict;
-	
-	// Clip value to signed 16 bits limits
-	if(pcm_sample > 32767) {
-		pcm_sample = 32767;
-	} else if(pcm_sample < -32768) {
-		pcm_sample = -32768;
-	}
-	
-	// Update samples
-	samp2[i] = samp1[i];
-	samp1[i] = (s16)pcm_sample;
-}
-
 aalError CodecADPCM::read(void * buffer, size_t to_read, size_t & read) {
 	
 	read = 0;
 	while(read < to_read) {
 		
-		// If prefetched bytes are remaining, put the next one into the buffer
-		if(cache_i < cache_c) {
-			((s8 *)buffer)[read++] = ((s8 *)cache_l)[cache_i++];
-			continue;
-		}
-		
-		// Load next block header if there is no more sample in current one
-		if(sample_i >= header->samplesPerBlock) {
+		// Load and decode the next block if all samples of the current one have been read
+		if(decoded_i >= decoded_c) {
 			
 			if(padding) {
 				stream->seek(SeekCur, padding);
@@ -227,28 +192,13 @@ aalError CodecADPCM::read(void * buffer, size_t to_read, size_t & read) {
 				return error;
 			}
 			
-		} else if(sample_i == 1) {
-			for(size_t i = 0; i < header->wfx.channels; i++) {
-				((s16 *)cache_l)[i] = samp1[i];
-			}
-		} else {
-			
-			// Get new sample for each channel
-			for(size_t i = 0; i < header->wfx.channels; i++) {
-				if(odd) {
-					getSample(i, (s8)(nybble & 0x0f));
-					odd = false;
-				} else {
-					nybble = nybble_l[nybble_i++];
-					getSample(i, s8((nybble >> 4) & 0x0f));
-					odd = true;
-				}
-				((s16 *)cache_l)[i] = samp1[i];
-			}
+			continue;
 		}
 		
-		sample_i++;
-		cache_i = 0;
+		size_t count = std::min(to_read - read, decoded_c - decoded_i);
+		std::memcpy((char *)buffer + read, (const char *)&decoded[0] + decoded_i, count);
+		read += count;
+		decoded_i += count;
 	}
 	
 	return AAL_OK;
@@ -256,40 +206,52 @@ aalError CodecADPCM::read(void * buffer, size_t to_read, size_t & read) {
 
 aalError CodecADPCM::getNextBlock() {
 	
-	// Load and check block header
-	if(!stream->read(predictor, sizeof(*predictor) << shift)) {
-		return AAL_ERROR_FILEIO;
-	}
-	
-	if(!stream->read(delta, sizeof(*delta) << shift)) {
-		return AAL_ERROR_FILEIO;
-	}
-	
-	if(!stream->read(samp1, sizeof(*samp1) << shift)) {
-		return AAL_ERROR_FILEIO;
-	}
+	size_t channels = size_t(1) << shift;
+	size_t header_size = 7 << shift;
 	
-	if(!stream->read(samp2, sizeof(*samp2) << shift)) {
+	/*
+	 * Load the block header and all nybbles at once - the last block may be truncated,
+	 * but there must be at least one byte of nybbles.
+	 */
+	if(stream->read(&block[0], block.size()) <= header_size) {
 		return AAL_ERROR_FILEIO;
 	}
 	
-	odd = false;
-	sample_i = 0;
-	nybble_i = 0;
+	const u8 * predictor = &block[0];
+	const u8 * data = predictor + channels;
 	
-	for(size_t i = 0; i < header->wfx.channels; i++) {
+	ChannelState state[2];
+	for(size_t i = 0; i < channels; i++) {
 		if(predictor[i] >= header->coefficientCount) {
 			return AAL_ERROR_FORMAT;
 		}
-		coef1[i] = header->coefficients[(size_t)predictor[i]].coef1;
-		coef2[i] = header->coefficients[(size_t)predictor[i]].coef2;
-		((s16 *)cache_l)[i] = samp2[i];
+		state[i].coef1 = header->coefficients[predictor[i]].coef1;
+		state[i].coef2 = header->coefficients[predictor[i]].coef2;
+		std::memcpy(&state[i].delta, data + (0 * channels + i) * sizeof(s16), sizeof(s16));
+		std::memcpy(&state[i].samp1, data + (1 * channels + i) * sizeof(s16), sizeof(s16));
+		std::memcpy(&state[i].samp2, data + (2 * channels + i) * sizeof(s16), sizeof(s16));
 	}
 	
-	if(!stream->read(nybble_l, nybble_c)) {
-		return AAL_ERROR_FILEIO;
+	// The first two samples of each channel are stored in the block header
+	s16 * out = &decoded[0];
+	for(size_t i = 0; i < channels; i++) {
+		out[i] = state[i].samp2;
+		out[channels + i] = state[i].samp1;
+	}
+	out += 2 * channels;
+	
+	// Each byte holds two nybbles, alternating between channels for stereo data
+	const u8 * nybbles = &block[header_size];
+	const u8 * end = &block[0] + block.size();
+	ChannelState & low = state[channels - 1];
+	for(; nybbles != end; nybbles++) {
+		*out++ = decodeNybble(state[0], *nybbles >> 4);
+		*out++ = decodeNybble(low, *nybbles & 0x0f);
 	}
 	
+	decoded_c = decoded.size() * sizeof(s16);
+	decoded_i = 0;
+	
 	return AAL_OK;
 }
 
@@ -45,6 +45,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #define ARX_AUDIO_CODEC_ADPCM_H
 
 #include <stddef.h>
+#include <vector>
 
 #include "audio/AudioTypes.h"
 #include "audio/codec/Codec.h"
@@ -72,26 +73,16 @@ public:
 	
 private:
 	
-	void getSample(size_t channel_i, s8 nybble);
 	aalError getNextBlock();
 	
 	PakFileHandle * stream;
 	ADPCMHeader * header;
 	u32 padding;
 	u32 shift;
-	u32 sample_i;
-	char * predictor;
-	s16 * delta;
-	s16 * samp1;
-	s16 * samp2;
-	s16 * coef1;
-	s16 * coef2;
-	s8 * nybble_l;
-	u32 nybble_c, nybble_i;
-	s8 nybble;
-	bool odd;
-	u8 cache_c, cache_i;
-	void * cache_l;
+	std::vector<u8> block; //!< Encoded data of the current block
+	std::vector<s16> decoded; //!< Interleaved PCM data of the current block
+	size_t decoded_c; //!< Number of decoded bytes in the current block
+	size_t decoded_i; //!< Number of decoded bytes already read from the current block
 	size_t cursor;
 	
 };
@@ -216,6 +216,10 @@ Source * DSoundBackend::getSource(SourceId sourceId) {
 	return source;
 }
 
+aalError DSoundBackend::preloadSample(const Sample * sample) {
+	return DSoundSource::preload(sample);
+}
+
 aalError DSoundBackend::setReverbEnabled(bool enable) {
 	
 	if(!enable) {
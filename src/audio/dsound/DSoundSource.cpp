@@ -44,6 +44,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/dsound/DSoundSource.h"
 
 #include <cstdio>
+#include <cstring>
+#include <vector>
 
 #include "audio/dsound/eax.h"
 #include "audio/dsound/DSoundBackend.h"
@@ -51,6 +53,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/Stream.h"
 #include "audio/Sample.h"
 #include "audio/Mixer.h"
+#include "audio/SampleCache.h"
 #include "io/log/Logger.h"
 
 const GUID DSPROPSETID_EAX20_BufferProperties = { 0x306a6a7, 0xb224, 0x11d2, { 0x99, 0xe5, 0x0, 0x0, 0xe8, 0xd8, 0xc7, 0x22 } };
@@ -69,6 +72,15 @@ DSoundSource::~DSoundSource() {
 	clean();
 }
 
+aalError DSoundSource::preload(const Sample * sample) {
+	
+	if(sample->getLength() > stream_limit_bytes) {
+		return AAL_OK;
+	}
+	
+	return sample_cache.get(sample) ? AAL_OK : AAL_ERROR_FILEIO;
+}
+
 aalError DSoundSource::init(SourceId _id, const Channel & _channel) {
 	
 	id = _id;
@@ -127,16 +139,14 @@ aalError DSoundSource::init(SourceId _id, const Channel & _channel) {
 		return error;
 	}
 	
-	stream = createStream(sample->getName());
-	
-	if(!stream) {
-		return AAL_ERROR_FILEIO;
-	}
-	
 	// Load sample data if not streamed
 	if(!streaming) {
 		
-		if(stream->setPosition(0)) {
+		const std::vector<char> * data = sample_cache.get(sample);
+		if(!data) {
+			return AAL_ERROR_FILEIO;
+		}
+		if(data->size() != size) {
 			return AAL_ERROR_SYSTEM;
 		}
 		
@@ -146,17 +156,22 @@ aalError DSoundSource::init(SourceId _id, const Channel & _channel) {
 			return AAL_ERROR_SYSTEM;
 		}
 		
-		stream->read(ptr0, size, write);
+		if(size) {
+			memcpy(ptr0, &(*data)[0], size);
+		}
+		write = size;
 		
 		if(lpdsb->Unlock(ptr0, cur0, ptr1, cur1)) {
 			return AAL_ERROR_SYSTEM;
 		}
 		
-		if(write != size) {
-			return AAL_ERROR_SYSTEM;
-		}
+		return AAL_OK;
+	}
 		
-		deleteStream(stream);
+	stream = createStream(sample->getName());
+	
+	if(!stream) {
+		return AAL_ERROR_FILEIO;
 	}
 	
 	return AAL_OK;
@@ -416,6 +431,7 @@ aalError DSoundSource::play(unsigned play_count) {
 	
 	// Enqueue _loop count if instance is already playing
 	if(isPlaying()) {
+		addPlays(play_count);
 		if(play_count) {
 			loop += play_count;
 		} else {
@@ -454,6 +470,7 @@ aalError DSoundSource::play(unsigned play_count) {
 	read = write = 0;
 	loop = play_count - 1;
 	reset();
+	addPlays(play_count);
 	
 	if(lpdsb->SetCurrentPosition(0)) {
 		return AAL_ERROR_SYSTEM;
@@ -636,4 +653,13 @@ aalError DSoundSource::updateBuffers() {
 	return AAL_OK;
 }
 
+aalError DSoundSource::releaseVoice() {
+	// DirectSound buffers can't be recreated at an arbitrary position, keep the voice
+	return AAL_ERROR_SYSTEM;
+}
+
+aalError DSoundSource::acquireVoice() {
+	return AAL_ERROR_SYSTEM;
+}
+
 } // namespace audio
@@ -65,6 +65,9 @@ public:
 	aalError init(SourceId _id, const Channel & channel);
 	aalError init(SourceId _id, DSoundSource * instance, const Channel & channel);
 	
+	//! Decode a sample into the sample cache unless it would be streamed
+	static aalError preload(const Sample * sample);
+	
 	aalError setPitch(float pitch);
 	aalError setPan(float pan);
 	
@@ -88,6 +91,9 @@ protected:
 	
 	aalError updateBuffers();
 	
+	aalError releaseVoice();
+	aalError acquireVoice();
+	
 private:
 	
 	aalError init();
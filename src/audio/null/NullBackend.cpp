@@ -0,0 +1,306 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/null/NullBackend.h"
+
+#include <algorithm>
+
+#include "audio/null/NullSource.h"
+#include "audio/AudioGlobal.h"
+#include "audio/Sample.h"
+#include "io/fs/FilePath.h"
+#include "io/log/Logger.h"
+#include "platform/Platform.h"
+#include "platform/Time.h"
+
+namespace audio {
+
+//! Maximum number of frames mixed at once
+static const size_t MIX_BLOCK = 1024;
+
+NullBackend::NullBackend() :
+	listenerPosition(Vec3f::ZERO), listenerFront(0.f, 0.f, 1.f), listenerUp(0.f, 1.f, 0.f),
+	rolloffFactor(1.f), offline(false), startTime(0), frames(0), fileFrames(0) {
+	stats.sources = 0;
+	stats.voices = 0;
+	stats.maxVoices = 0;
+	stats.frames = 0;
+	stats.mixTime = 0;
+	stats.decodeTime = 0;
+}
+
+NullBackend::~NullBackend() {
+	sources.clear();
+	closeFile();
+}
+
+aalError NullBackend::init() {
+	
+	startTime = Time::getUs();
+	frames = 0;
+	
+	LogInfo << "Using the null audio backend, mixing at " << FREQUENCY << " Hz";
+	
+	return AAL_OK;
+}
+
+aalError NullBackend::updateDeferred() {
+	
+	if(offline) {
+		return AAL_OK;
+	}
+	
+	u64 target = Time::getElapsedUs(startTime) * FREQUENCY / 1000000;
+	if(target <= frames) {
+		return AAL_OK;
+	}
+	
+	// Don't try to catch up more than a second after a stall
+	if(target - frames > FREQUENCY) {
+		frames = target - FREQUENCY;
+	}
+	
+	return render(size_t(target - frames));
+}
+
+Source * NullBackend::createSource(SampleId sampleId, const Channel & channel) {
+	
+	SampleId s_id = getSampleId(sampleId);
+	
+	if(!_sample.isValid(s_id)) {
+		return NULL;
+	}
+	
+	Sample * sample = _sample[s_id];
+	
+	NullSource * source = new NullSource(sample, this);
+	
+	size_t index = sources.add(source);
+	if(index == (size_t)INVALID_ID) {
+		delete source;
+		return NULL;
+	}
+	
+	SourceId id = (index << 16) | s_id;
+	if(source->init(id, channel)) {
+		sources.remove(index);
+		return NULL;
+	}
+	
+	return source;
+}
+
+Source * NullBackend::getSource(SourceId sourceId) {
+	
+	size_t index = ((sourceId >> 16) & 0x0000ffff);
+	if(!sources.isValid(index)) {
+		return NULL;
+	}
+	
+	Source * source = sources[index];
+	
+	SampleId sample = getSampleId(sourceId);
+	if(!_sample.isValid(sample) || source->getSample() != _sample[sample]) {
+		return NULL;
+	}
+	
+	arx_assert(source->getId() == sourceId);
+	
+	return source;
+}
+
+aalError NullBackend::preloadSample(const Sample * sample) {
+	return NullSource::preload(sample);
+}
+
+aalError NullBackend::setReverbEnabled(bool enable) {
+	ARX_UNUSED(enable);
+	return AAL_ERROR_SYSTEM;
+}
+
+aalError NullBackend::setUnitFactor(float factor) {
+	ARX_UNUSED(factor);
+	return AAL_OK;
+}
+
+aalError NullBackend::setRolloffFactor(float factor) {
+	rolloffFactor = factor;
+	return AAL_OK;
+}
+
+aalError NullBackend::setListenerPosition(const Vec3f & position) {
+	listenerPosition = position;
+	return AAL_OK;
+}
+
+aalError NullBackend::setListenerOrientation(const Vec3f & front, const Vec3f & up) {
+	listenerFront = front;
+	listenerUp = up;
+	return AAL_OK;
+}
+
+aalError NullBackend::setListenerEnvironment(const Environment & env) {
+	ARX_UNUSED(env);
+	return AAL_ERROR_SYSTEM;
+}
+
+aalError NullBackend::setRoomRolloffFactor(float factor) {
+	ARX_UNUSED(factor);
+	return AAL_ERROR_SYSTEM;
+}
+
+Backend::source_iterator NullBackend::sourcesBegin() {
+	return (source_iterator)sources.begin();
+}
+
+Backend::source_iterator NullBackend::sourcesEnd() {
+	return (source_iterator)sources.end();
+}
+
+Backend::source_iterator NullBackend::deleteSource(source_iterator it) {
+	arx_assert(it >= sourcesBegin() && it < sourcesEnd());
+	return (source_iterator)sources.remove((ResourceList<NullSource>::iterator)it);
+}
+
+aalError NullBackend::setOffline(const fs::path & path) {
+	
+	closeFile();
+	
+	offline = true;
+	frames = 0;
+	
+	if(path.empty()) {
+		return AAL_OK;
+	}
+	
+	file.open(path, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+	if(!file.is_open()) {
+		LogError << "Could not open " << path << " for writing";
+		return AAL_ERROR_FILEIO;
+	}
+	
+	// The sizes are filled in once the file is closed
+	u16 channels = 2;
+	u16 bits = 16;
+	u16 blockAlign = channels * (bits / 8);
+	fs::write(file, "RIFF", 4);
+	fs::write(file, u32(0));
+	fs::write(file, "WAVEfmt ", 8);
+	fs::write(file, u32(16));
+	fs::write(file, u16(1)); // PCM
+	fs::write(file, channels);
+	fs::write(file, u32(FREQUENCY));
+	fs::write(file, u32(FREQUENCY * blockAlign));
+	fs::write(file, blockAlign);
+	fs::write(file, bits);
+	fs::write(file, "data", 4);
+	fs::write(file, u32(0));
+	fileFrames = 0;
+	
+	return AAL_OK;
+}
+
+void NullBackend::closeFile() {
+	
+	if(!file.is_open()) {
+		return;
+	}
+	
+	u32 size = u32(fileFrames * 2 * sizeof(s16));
+	file.seekp(4);
+	fs::write(file, u32(36 + size));
+	file.seekp(40);
+	fs::write(file, size);
+	
+	file.close();
+}
+
+aalError NullBackend::render(size_t count, std::vector<s16> * output) {
+	
+	u64 start = Time::getUs();
+	
+	size_t voices = 0;
+	
+	while(count) {
+		
+		size_t n = std::min(count, MIX_BLOCK);
+		
+		mixBuffer.assign(n * 2, 0.f);
+		
+		voices = 0;
+		for(size_t i = 0; i < sources.size(); i++) {
+			if(sources[i] && sources[i]->mix(&mixBuffer[0], n)) {
+				voices++;
+			}
+		}
+		stats.maxVoices = std::max(stats.maxVoices, voices);
+		
+		outputBuffer.resize(n * 2);
+		for(size_t i = 0; i < n * 2; i++) {
+			outputBuffer[i] = s16(clamp(mixBuffer[i], -32768.f, 32767.f));
+		}
+		
+		if(output) {
+			output->insert(output->end(), outputBuffer.begin(), outputBuffer.end());
+		}
+		
+		if(file.is_open()) {
+			fs::write(file, &outputBuffer[0], outputBuffer.size() * sizeof(s16));
+			fileFrames += n;
+		}
+		
+		frames += n;
+		stats.frames += n;
+		count -= n;
+	}
+	
+	stats.voices = voices;
+	stats.mixTime += Time::getElapsedUs(start);
+	
+	return AAL_OK;
+}
+
+size_t NullBackend::getTime() const {
+	return size_t(frames * 1000 / FREQUENCY);
+}
+
+MixStats NullBackend::getStats() {
+	
+	stats.sources = 0;
+	for(size_t i = 0; i < sources.size(); i++) {
+		if(sources[i]) {
+			stats.sources++;
+		}
+	}
+	
+	return stats;
+}
+
+void NullBackend::getSourceStats(std::vector<SourceStats> & result) {
+	
+	result.clear();
+	
+	for(size_t i = 0; i < sources.size(); i++) {
+		if(sources[i]) {
+			result.push_back(sources[i]->getStats());
+		}
+	}
+}
+
+} // namespace audio
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_NULL_NULLBACKEND_H
+#define ARX_AUDIO_NULL_NULLBACKEND_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "audio/AudioBackend.h"
+#include "audio/AudioResource.h"
+#include "audio/AudioTypes.h"
+#include "io/fs/FileStream.h"
+#include "math/Vector3.h"
+
+namespace fs { class path; }
+
+namespace audio {
+
+class NullSource;
+
+/*!
+ * Audio backend that does not need an audio device.
+ *
+ * All sources are decoded, resampled and mixed in software into a stereo buffer that is
+ * then discarded, written to a WAV file or returned to the caller. By default the mixer
+ * follows the system clock; once offline, it only advances in render() calls, so that
+ * a session can be mixed faster than real time.
+ *
+ * There is no reverb and no doppler effect.
+ */
+class NullBackend : public Backend {
+	
+public:
+	
+	//! Output sample rate in frames per second
+	static const size_t FREQUENCY = 44100;
+	
+	NullBackend();
+	~NullBackend();
+	
+	aalError init();
+	
+	aalError updateDeferred();
+	
+	Source * createSource(SampleId sampleId, const Channel & channel);
+	
+	Source * getSource(SourceId sourceId);
+	
+	aalError preloadSample(const Sample * sample);
+	
+	aalError setReverbEnabled(bool enable);
+	
+	aalError setUnitFactor(float factor);
+	aalError setRolloffFactor(float factor);
+	
+	aalError setListenerPosition(const Vec3f & position);
+	aalError setListenerOrientation(const Vec3f & front, const Vec3f & up);
+	
+	aalError setListenerEnvironment(const Environment & env);
+	aalError setRoomRolloffFactor(float factor);
+	
+	source_iterator sourcesBegin();
+	source_iterator sourcesEnd();
+	source_iterator deleteSource(source_iterator it);
+	
+	/*!
+	 * Stop following the system clock and reset the output time.
+	 * @param file WAV file to write all further output to, or an empty path to discard it.
+	 */
+	aalError setOffline(const fs::path & file);
+	
+	inline bool isOffline() const { return offline; }
+	
+	/*!
+	 * Mix the next frames of output.
+	 * @param output If not NULL, the interleaved stereo output is appended to this.
+	 */
+	aalError render(size_t frames, std::vector<s16> * output = NULL);
+	
+	//! @return the output time mixed since the backend was created or went offline in ms
+	size_t getTime() const;
+	
+	MixStats getStats();
+	void getSourceStats(std::vector<SourceStats> & stats);
+	
+private:
+	
+	void closeFile();
+	
+	ResourceList<NullSource> sources;
+	
+	Vec3f listenerPosition;
+	Vec3f listenerFront;
+	Vec3f listenerUp;
+	float rolloffFactor;
+	
+	bool offline;
+	u64 startTime; //!< System time in microseconds corresponding to the first frame
+	u64 frames; //!< Frames mixed since startTime
+	
+	fs::ofstream file;
+	size_t fileFrames;
+	
+	std::vector<float> mixBuffer;
+	std::vector<s16> outputBuffer;
+	
+	MixStats stats;
+	
+	friend class NullSource;
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_NULL_NULLBACKEND_H
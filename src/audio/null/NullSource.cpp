@@ -0,0 +1,589 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/null/NullSource.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "audio/null/NullBackend.h"
+#include "audio/AudioGlobal.h"
+#include "audio/AudioResource.h"
+#include "audio/Mixer.h"
+#include "audio/Sample.h"
+#include "audio/SampleCache.h"
+#include "audio/Stream.h"
+#include "io/log/Logger.h"
+#include "io/resource/ResourcePath.h"
+#include "math/Vector3.h"
+#include "platform/Platform.h"
+#include "platform/Time.h"
+
+namespace audio {
+
+// Samples longer than this many stream buffers are streamed instead of decoded at once
+static const size_t NBUFFERS = 2;
+
+NullSource::NullSource(Sample * _sample, NullBackend * _backend) :
+	Source(_sample),
+	backend(_backend),
+	tooFar(false), finished(false),
+	streaming(false), loadCount(0), written(0), stream(NULL),
+	channels(1), position(0.), played(0),
+	volume(1.f),
+	decoded(0), decodeTime(0), mixed(0) {
+}
+
+NullSource::~NullSource() {
+	if(stream) {
+		deleteStream(stream);
+	}
+}
+
+static bool isStreamed(const Sample * sample) {
+	return (sample->getLength() > (stream_limit_bytes * NBUFFERS));
+}
+
+aalError NullSource::preload(const Sample * sample) {
+	
+	if(isStreamed(sample)) {
+		return AAL_OK;
+	}
+	
+	return sample_cache.get(sample) ? AAL_OK : AAL_ERROR_FILEIO;
+}
+
+aalError NullSource::init(SourceId _id, const Channel & _channel) {
+	
+	id = _id;
+	
+	channel = _channel;
+	if(channel.flags & FLAG_ANY_3D_FX) {
+		channel.flags &= ~FLAG_PAN;
+	}
+	
+	const PCMFormat & f = sample->getFormat();
+	if((f.channels != 1 && f.channels != 2) || (f.quality != 8 && f.quality != 16)) {
+		LogError << "Unsupported audio format: quality=" << f.quality << " channels=" << f.channels;
+		return AAL_ERROR_FORMAT;
+	}
+	channels = f.channels;
+	
+	streaming = isStreamed(sample);
+	
+	if(!streaming) {
+		if(aalError error = loadStatic()) {
+			return error;
+		}
+	}
+	
+	setVolume(channel.volume);
+	setPitch(channel.pitch);
+	
+	return AAL_OK;
+}
+
+aalError NullSource::loadStatic() {
+	
+	u64 start = Time::getUs();
+	
+	const std::vector<char> * data = sample_cache.get(sample);
+	if(!data) {
+		LogError << "Error decoding sample " << sample->getName();
+		return AAL_ERROR_FILEIO;
+	}
+	
+	setBufferData(data->empty() ? NULL : &(*data)[0], data->size());
+	
+	u64 elapsed = Time::getElapsedUs(start);
+	decodeTime += elapsed;
+	backend->stats.decodeTime += elapsed;
+	decoded += data->size();
+	
+	return AAL_OK;
+}
+
+void NullSource::setBufferData(const char * data, size_t size) {
+	
+	if(sample->getFormat().quality == 8) {
+		// 8-bit WAV data is unsigned
+		buffer.resize(size);
+		for(size_t i = 0; i < size; i++) {
+			buffer[i] = s16((s32(u8(data[i])) - 128) << 8);
+		}
+	} else {
+		buffer.resize(size / sizeof(s16));
+		if(!buffer.empty()) {
+			std::memcpy(&buffer[0], data, buffer.size() * sizeof(s16));
+		}
+	}
+	
+	// Drop incomplete frames
+	buffer.resize(buffer.size() - buffer.size() % channels);
+}
+
+bool NullSource::nextBuffer() {
+	
+	if(!streaming) {
+		return markAsLoaded();
+	}
+	
+	if(written == sample->getLength()) {
+		if(!markAsLoaded()) {
+			return false;
+		}
+		stream->setPosition(0);
+		written = 0;
+	}
+	
+	size_t size = std::min(stream_limit_bytes, sample->getLength() - written);
+	std::vector<char> data(size);
+	
+	u64 start = Time::getUs();
+	
+	size_t read = 0;
+	if(size) {
+		stream->read(&data[0], size, read);
+	}
+	
+	u64 elapsed = Time::getElapsedUs(start);
+	decodeTime += elapsed;
+	backend->stats.decodeTime += elapsed;
+	decoded += read;
+	
+	if(read != size) {
+		LogError << "Error streaming sample " << sample->getName();
+		return false;
+	}
+	
+	written += read;
+	
+	setBufferData(data.empty() ? NULL : &data[0], data.size());
+	
+	return !buffer.empty();
+}
+
+void NullSource::getGains(float & left, float & right) const {
+	
+	float gain = volume;
+	float pan = 0.f;
+	
+	if(channel.flags & FLAG_POSITION) {
+		
+		Vec3f offset = channel.position;
+		if(!(channel.flags & FLAG_RELATIVE)) {
+			offset -= backend->listenerPosition;
+		}
+		float distance = offset.length();
+		
+		// Inverse distance attenuation, clamped to the falloff range
+		float start = 1.f;
+		float end = std::numeric_limits<float>::max();
+		if(channel.flags & FLAG_FALLOFF) {
+			start = channel.falloff.start;
+			end = channel.falloff.end;
+		}
+		if(start > 0.f) {
+			float clamped = clamp(distance, start, end);
+			gain *= start / (start + backend->rolloffFactor * (clamped - start));
+		}
+		
+		// Pan towards the side of the listener the source is on
+		if(distance > 0.f) {
+			Vec3f side = Vec3f(1.f, 0.f, 0.f);
+			if(!(channel.flags & FLAG_RELATIVE)) {
+				side = cross(backend->listenerUp, backend->listenerFront);
+			}
+			float length = side.length();
+			if(length > 0.f) {
+				pan = clamp(dot(offset, side) / (distance * length), -1.f, 1.f);
+			}
+		}
+		
+	} else if(channel.flags & FLAG_PAN) {
+		pan = channel.pan;
+	}
+	
+	left = gain * std::min(1.f, 1.f - pan);
+	right = gain * std::min(1.f, 1.f + pan);
+}
+
+bool NullSource::mix(float * output, size_t frames) {
+	
+	if(status != Playing || isVirtual() || tooFar || finished || buffer.empty()) {
+		return false;
+	}
+	
+	float left, right;
+	getGains(left, right);
+	
+	double step = double(sample->getFormat().frequency) / double(NullBackend::FREQUENCY);
+	if(channel.flags & FLAG_PITCH) {
+		step *= channel.pitch;
+	}
+	
+	// Positioned stereo samples are played as mono, like the other backends do
+	bool downmix = (channels == 2 && (channel.flags & FLAG_ANY_3D_FX));
+	
+	size_t count = buffer.size() / channels;
+	size_t start = std::min(size_t(position), count);
+	
+	size_t i = 0;
+	for(; i < frames; i++) {
+		
+		while(size_t(position) >= count) {
+			played += count - start;
+			position -= double(count);
+			start = 0;
+			if(!nextBuffer()) {
+				finished = true;
+				mixed += i;
+				return true;
+			}
+			count = buffer.size() / channels;
+		}
+		
+		// Linear interpolation between the two nearest frames
+		size_t index = size_t(position);
+		float t = float(position - double(index));
+		const s16 * a = &buffer[index * channels];
+		const s16 * b = &buffer[std::min(index + 1, count - 1) * channels];
+		float l = float(a[0]) + float(b[0] - a[0]) * t;
+		float r = (channels == 2) ? float(a[1]) + float(b[1] - a[1]) * t : l;
+		if(downmix) {
+			l = r = (l + r) * 0.5f;
+		}
+		
+		output[2 * i] += l * left;
+		output[2 * i + 1] += r * right;
+		
+		position += step;
+	}
+	
+	played += std::min(size_t(position), count) - start;
+	mixed += i;
+	
+	return true;
+}
+
+SourceStats NullSource::getStats() const {
+	SourceStats stats;
+	stats.id = id;
+	stats.streaming = streaming;
+	stats.playing = (status == Playing && !isVirtual() && !tooFar && !finished);
+	stats.decoded = decoded;
+	stats.decodeTime = decodeTime;
+	stats.frames = mixed;
+	return stats;
+}
+
+aalError NullSource::updateVolume() {
+	
+	if(!(channel.flags & FLAG_VOLUME)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	const Mixer * mixer = _mixer[channel.mixer];
+	float v = mixer ? mixer->getFinalVolume() : 1.f;
+	
+	if(v) {
+		// LogToLinearVolume(LinearToLogVolume(volume) * channel.volume)
+		v = std::pow(100000.f * v, channel.volume) / 100000.f;
+	}
+	
+	volume = v;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setPitch(float p) {
+	
+	if(!(channel.flags & FLAG_PITCH)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.pitch = clamp(p, 0.1f, 2.f);
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setPan(float p) {
+	
+	if(!(channel.flags & FLAG_PAN)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.pan = clamp(p, -1.f, 1.f);
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setPosition(const Vec3f & position) {
+	
+	if(!(channel.flags & FLAG_POSITION)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.position = position;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setVelocity(const Vec3f & velocity) {
+	
+	if(!(channel.flags & FLAG_VELOCITY)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.velocity = velocity;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setDirection(const Vec3f & direction) {
+	
+	if(!(channel.flags & FLAG_DIRECTION)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.direction = direction;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setCone(const SourceCone & cone) {
+	
+	if(!(channel.flags & FLAG_CONE)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.cone.inner_angle = cone.inner_angle;
+	channel.cone.outer_angle = cone.outer_angle;
+	channel.cone.outer_volume = clamp(cone.outer_volume, 0.f, 1.f);
+	
+	return AAL_OK;
+}
+
+aalError NullSource::setFalloff(const SourceFalloff & falloff) {
+	
+	if(!(channel.flags & FLAG_FALLOFF)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.falloff = falloff;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::play(unsigned playCount) {
+	
+	bool start = (status != Playing);
+	if(start) {
+		status = Playing;
+		finished = false;
+		position = 0.;
+		played = 0;
+		reset();
+	}
+	
+	if(playCount && loadCount != (unsigned)-1) {
+		loadCount += playCount;
+	} else {
+		loadCount = (unsigned)-1;
+	}
+	
+	addPlays(playCount);
+	
+	if(isVirtual()) {
+		// The stream is opened when the source gets a voice again
+		return AAL_OK;
+	}
+	
+	if(start && streaming) {
+		
+		if(!stream) {
+			stream = createStream(sample->getName());
+			if(!stream) {
+				LogError << "Error creating stream for " << sample->getName();
+				finished = true;
+				return AAL_ERROR_FILEIO;
+			}
+		} else {
+			stream->setPosition(0);
+		}
+		written = 0;
+		
+		if(!nextBuffer()) {
+			finished = true;
+			return AAL_ERROR_FILEIO;
+		}
+		
+	} else if(buffer.empty()) {
+		finished = true;
+	}
+	
+	return AAL_OK;
+}
+
+aalError NullSource::stop() {
+	
+	if(status == Idle) {
+		return AAL_OK;
+	}
+	
+	status = Idle;
+	loadCount = 0;
+	
+	if(streaming) {
+		if(stream) {
+			deleteStream(stream), stream = NULL;
+		}
+		buffer.clear();
+	}
+	
+	return AAL_OK;
+}
+
+aalError NullSource::pause() {
+	
+	if(status == Playing) {
+		status = Paused;
+	}
+	
+	return AAL_OK;
+}
+
+aalError NullSource::resume() {
+	
+	if(status == Paused) {
+		status = Playing;
+		updateCulling();
+	}
+	
+	return AAL_OK;
+}
+
+bool NullSource::updateCulling() {
+	
+	arx_assert(status == Playing);
+	
+	if(!(channel.flags & FLAG_POSITION) || !(channel.flags & FLAG_FALLOFF)) {
+		return false;
+	}
+	
+	Vec3f listener = (channel.flags & FLAG_RELATIVE) ? Vec3f::ZERO : backend->listenerPosition;
+	float d = dist(channel.position, listener);
+	
+	if(tooFar) {
+		if(d > channel.falloff.end) {
+			return true;
+		}
+		tooFar = false;
+		return false;
+	}
+	
+	if(d <= channel.falloff.end) {
+		return false;
+	}
+	
+	tooFar = true;
+	if(loadCount <= 1) {
+		stop();
+	}
+	return true;
+}
+
+aalError NullSource::updateBuffers() {
+	
+	const PCMFormat & f = sample->getFormat();
+	time += played * f.channels * (f.quality >> 3);
+	played = 0;
+	
+	if(finished) {
+		return stop();
+	}
+	
+	return AAL_OK;
+}
+
+aalError NullSource::releaseVoice() {
+	
+	// Account for the frames already mixed
+	updateBuffers();
+	
+	// Static sources keep their data so that they can continue without decoding again
+	if(streaming) {
+		if(stream) {
+			deleteStream(stream), stream = NULL;
+		}
+		buffer.clear();
+	}
+	
+	tooFar = false;
+	
+	return AAL_OK;
+}
+
+aalError NullSource::acquireVoice() {
+	
+	if(status == Idle) {
+		return AAL_OK;
+	}
+	
+	const PCMFormat & f = sample->getFormat();
+	
+	loadCount = remaining;
+	finished = false;
+	played = 0;
+	
+	if(streaming) {
+		
+		stream = createStream(sample->getName());
+		if(!stream) {
+			LogError << "Error creating stream for " << sample->getName();
+			finished = true;
+			return AAL_ERROR_FILEIO;
+		}
+		if(stream->setPosition(time)) {
+			LogError << "Error seeking in " << sample->getName();
+			finished = true;
+			return AAL_ERROR_FILEIO;
+		}
+		written = time;
+		position = 0.;
+		
+		if(!nextBuffer()) {
+			finished = true;
+			return AAL_ERROR_FILEIO;
+		}
+		
+	} else {
+		position = double(time / (f.channels * (f.quality >> 3)));
+	}
+	
+	return AAL_OK;
+}
+
+bool NullSource::markAsLoaded() {
+	return (loadCount == (unsigned)-1 || --loadCount);
+}
+
+} // namespace audio
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_NULL_NULLSOURCE_H
+#define ARX_AUDIO_NULL_NULLSOURCE_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "audio/AudioSource.h"
+#include "audio/AudioTypes.h"
+#include "math/MathFwd.h"
+
+namespace audio {
+
+class NullBackend;
+class Sample;
+class Stream;
+
+//! A source that is decoded and mixed in software by the NullBackend
+class NullSource : public Source {
+	
+public:
+	
+	NullSource(Sample * sample, NullBackend * backend);
+	~NullSource();
+	
+	aalError init(SourceId id, const Channel & channel);
+	
+	//! Decode a sample into the sample cache unless it would be streamed
+	static aalError preload(const Sample * sample);
+	
+	aalError setPitch(float pitch);
+	aalError setPan(float pan);
+	
+	aalError setPosition(const Vec3f & position);
+	aalError setVelocity(const Vec3f & velocity);
+	aalError setDirection(const Vec3f & direction);
+	aalError setCone(const SourceCone & cone);
+	aalError setFalloff(const SourceFalloff & falloff);
+	
+	aalError play(unsigned playCount = 1);
+	aalError stop();
+	aalError pause();
+	aalError resume();
+	
+	aalError updateVolume();
+	
+	/*!
+	 * Add the next frames of this source to an interleaved stereo buffer.
+	 * @return false if the source is not audible and nothing was mixed
+	 */
+	bool mix(float * output, size_t frames);
+	
+	SourceStats getStats() const;
+	
+protected:
+	
+	bool updateCulling();
+	
+	aalError updateBuffers();
+	
+	aalError releaseVoice();
+	aalError acquireVoice();
+	
+private:
+	
+	//! Load the next part of a streamed sample or rewind a static one
+	bool nextBuffer();
+	
+	//! Convert decoded sample data to 16-bit samples
+	void setBufferData(const char * data, size_t size);
+	
+	aalError loadStatic();
+	
+	bool markAsLoaded();
+	
+	//! Compute the gain of the left and right output channels
+	void getGains(float & left, float & right) const;
+	
+	NullBackend * backend;
+	
+	bool tooFar; // True if the listener is too far from this source.
+	bool finished; // True if all requested loops have been mixed.
+	
+	bool streaming;
+	unsigned loadCount; // Remaining play count, including the current one
+	size_t written; // Bytes read from the stream
+	Stream * stream;
+	
+	std::vector<s16> buffer; // Decoded samples of the current buffer
+	size_t channels;
+	double position; // Play position in the buffer in frames
+	size_t played; // Frames played since the last update
+	
+	float volume; // Gain calculated from the channel and mixer volumes
+	
+	size_t decoded;
+	u64 decodeTime;
+	u64 mixed;
+	
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_NULL_NULLSOURCE_H
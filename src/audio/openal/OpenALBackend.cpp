@@ -206,6 +206,10 @@ Source * OpenALBackend::getSource(SourceId sourceId) {
 	return source;
 }
 
+aalError OpenALBackend::preloadSample(const Sample * sample) {
+	return OpenALSource::preload(sample);
+}
+
 aalError OpenALBackend::setRolloffFactor(float factor) {
 	
 	rolloffFactor = factor;
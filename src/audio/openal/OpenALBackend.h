@@ -52,6 +52,8 @@ public:
 	
 	Source * getSource(SourceId sourceId);
 	
+	aalError preloadSample(const Sample * sample);
+	
 	aalError setReverbEnabled(bool enable);
 	
 	aalError setUnitFactor(float factor);
@@ -21,6 +21,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 #include "audio/openal/OpenALUtils.h"
 #include "audio/AudioGlobal.h"
@@ -28,6 +29,7 @@
 #include "audio/Stream.h"
 #include "audio/Sample.h"
 #include "audio/Mixer.h"
+#include "audio/SampleCache.h"
 #include "io/resource/ResourcePath.h"
 #include "io/log/Logger.h"
 #include "math/Vector3.h"
@@ -92,7 +94,8 @@ OpenALSource::OpenALSource(Sample * _sample) :
 	streaming(false), loadCount(0), written(0), stream(NULL),
 	read(0),
 	source(0),
-	refcount(NULL) {
+	refcount(NULL),
+	rolloffFactor(1.f) {
 	for(size_t i = 0; i < NBUFFERS; i++) {
 		buffers[i] = 0;
 	}
@@ -155,6 +158,28 @@ bool OpenALSource::convertStereoToMono() {
 	return ((channel.flags & FLAG_ANY_3D_FX) && sample->getFormat().channels == 2);
 }
 
+bool OpenALSource::isStreamed(const Sample * sample) {
+	return (sample->getLength() > (stream_limit_bytes * NBUFFERS));
+}
+
+aalError OpenALSource::preload(const Sample * sample) {
+	
+	if(isStreamed(sample)) {
+		return AAL_OK;
+	}
+	
+	if(!sample_cache.get(sample)) {
+		return AAL_ERROR_FILEIO;
+	}
+	
+	// 3D sources use a mono copy of stereo samples, see convertStereoToMono()
+	if(sample->getFormat().channels == 2 && !sample_cache.get(sample, true)) {
+		return AAL_ERROR_FILEIO;
+	}
+	
+	return AAL_OK;
+}
+
 aalError OpenALSource::init(SourceId _id, OpenALSource * inst, const Channel & _channel) {
 	
 	arx_assert(!source);
@@ -187,33 +212,40 @@ aalError OpenALSource::init(SourceId _id, OpenALSource * inst, const Channel & _
 	alSourcei(source, AL_LOOPING, AL_FALSE);
 	AL_CHECK_ERROR("generating source")
 	
-	streaming = (sample->getLength() > (stream_limit_bytes * NBUFFERS));
+	streaming = isStreamed(sample);
 	
 	LogAL("init: length=" << sample->getLength() << " " << (streaming ? "streaming" : "static") << (buffers[0] ? " (copy)" : ""));
 	
 	if(!streaming && !buffers[0]) {
-		stream = createStream(sample->getName());
-		if(!stream) {
-			ALError << "error creating stream";
+		const std::vector<char> * data = sample_cache.get(sample, convertStereoToMono());
+		if(!data) {
+			ALError << "error decoding sample";
 			return AAL_ERROR_FILEIO;
 		}
 		alGenBuffers(1, &buffers[0]);
 		nbbuffers++;
 		AL_CHECK_ERROR("generating buffer")
 		arx_assert(buffers[0] != 0);
-		loadCount = 1;
-		if(aalError error = fillBuffer(0, sample->getLength())) {
+		const char * pcm = data->empty() ? NULL : &(*data)[0];
+		if(aalError error = setBufferData(0, pcm, data->size())) {
 			return error;
 		}
-		arx_assert(!stream && !loadCount);
+		bufferSizes[0] = sample->getLength();
 	}
 	
+	setSourceProperties();
+	
+	return AAL_OK;
+}
+
+void OpenALSource::setSourceProperties() {
+	
 	setVolume(channel.volume);
 	setPitch(channel.pitch);
 	
 	if(!(channel.flags & FLAG_POSITION) || (channel.flags & FLAG_RELATIVE)) {
 		alSourcei(source, AL_SOURCE_RELATIVE, AL_TRUE);
-		AL_CHECK_ERROR("setting relative flag")
+		AL_CHECK_ERROR_N("setting relative flag",)
 	}
 	
 	// Create 3D interface if required
@@ -233,7 +265,6 @@ aalError OpenALSource::init(SourceId _id, OpenALSource * inst, const Channel & _
 		setPan(channel.pan);
 	}
 	
-	return AAL_OK;
 }
 
 aalError OpenALSource::fillAllBuffers() {
@@ -276,26 +307,6 @@ aalError OpenALSource::fillAllBuffers() {
 	return AAL_OK;
 }
 
-/*!
- * Convert a stereo buffer to mono in-place.
- * @param T The type of one (mono) sound sample.
- * @return the size of the converted buffer
- */
-template <class T>
-static size_t stereoToMono(char * data, size_t size) {
-	
-	T * buf = reinterpret_cast<T *>(data);
-	
-	size_t nbsamples = size / sizeof(T);
-	arx_assert(nbsamples % 2 == 0);
-	
-	for(size_t in = 0, out = 0; in < nbsamples - 1; in += 2, out++) {
-		buf[out] = T((int(buf[in]) + int(buf[in + 1])) / 2);
-	}
-	
-	return size / 2;
-}
-
 aalError OpenALSource::fillBuffer(size_t i, size_t size) {
 	
 	arx_assert(loadCount > 0);
@@ -339,6 +350,24 @@ aalError OpenALSource::fillBuffer(size_t i, size_t size) {
 		}
 	}
 	
+	size_t alsize = size;
+	if(convertStereoToMono()) {
+		alsize = stereoToMono(data, size, sample->getFormat());
+	}
+	
+	aalError error = setBufferData(i, data, alsize);
+	delete[] data;
+	if(error) {
+		return error;
+	}
+	
+	bufferSizes[i] = size;
+	
+	return AAL_OK;
+}
+
+aalError OpenALSource::setBufferData(size_t i, const char * data, size_t size) {
+	
 	const PCMFormat & f = sample->getFormat();
 	if((f.channels != 1 && f.channels != 2) || (f.quality != 8 && f.quality != 16)) {
 		LogError << "Unsupported audio format: quality=" << f.quality << " channels=" << f.channels;
@@ -352,26 +381,22 @@ aalError OpenALSource::fillBuffer(size_t i, size_t size) {
 		alformat = (f.quality == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
 	}
 	
-	size_t alsize = size;
-	if(convertStereoToMono()) {
-		alsize = (f.quality == 8) ? stereoToMono<s8>(data, size) : stereoToMono<s16>(data, size);
-	}
-	
-	alBufferData(buffers[i], alformat, data, alsize, f.frequency);
-	delete[] data;
+	alBufferData(buffers[i], alformat, data, size, f.frequency);
 	AL_CHECK_ERROR("setting buffer data")
 	
-	bufferSizes[i] = size;
-	
 	return AAL_OK;
 }
 
 aalError OpenALSource::updateVolume() {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_VOLUME)) {
+	if(!(channel.flags & FLAG_VOLUME)) {
 		return AAL_ERROR_INIT;
 	}
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	const Mixer * mixer = _mixer[channel.mixer];
 	float volume = mixer ? mixer->getFinalVolume() : 1.f;
 	
@@ -388,12 +413,16 @@ aalError OpenALSource::updateVolume() {
 
 aalError OpenALSource::setPitch(float p) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_PITCH)) {
+	if(!(channel.flags & FLAG_PITCH)) {
 		return AAL_ERROR_INIT;
 	}
 	
 	channel.pitch = clamp(p, 0.1f, 2.f);
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSourcef(source, AL_PITCH, channel.pitch);
 	AL_CHECK_ERROR("setting source pitch")
 	
@@ -402,7 +431,7 @@ aalError OpenALSource::setPitch(float p) {
 
 aalError OpenALSource::setPan(float p) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_PAN)) {
+	if(!(channel.flags & FLAG_PAN)) {
 		return AAL_ERROR_INIT;
 	}
 	
@@ -410,7 +439,7 @@ aalError OpenALSource::setPan(float p) {
 	
 	channel.pan = clamp(p, -1.f, 1.f);
 	
-	if(channel.pan != 0.f && oldPan == 0.f) {
+	if(channel.pan != 0.f && oldPan == 0.f && source) {
 		// TODO OpenAL doesn't have a pan feature, but it isn't used much (only in abiances?)
 		ALWarning << "paning not supported";
 	}
@@ -420,12 +449,16 @@ aalError OpenALSource::setPan(float p) {
 
 aalError OpenALSource::setPosition(const Vec3f & position) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_POSITION)) {
+	if(!(channel.flags & FLAG_POSITION)) {
 		return AAL_ERROR_INIT;
 	}
 	
 	channel.position = position;
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	if(!isallfinite(position)) {
 		return AAL_ERROR; // OpenAL soft will lock up if given NaN or +-Inf here
 	}
@@ -438,12 +471,16 @@ aalError OpenALSource::setPosition(const Vec3f & position) {
 
 aalError OpenALSource::setVelocity(const Vec3f & velocity) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_VELOCITY)) {
+	if(!(channel.flags & FLAG_VELOCITY)) {
 		return AAL_ERROR_INIT;
 	}
 	
 	channel.velocity = velocity;
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	if(!isallfinite(velocity)) {
 		return AAL_ERROR; // OpenAL soft will lock up if given NaN or +-Inf here
 	}
@@ -456,12 +493,16 @@ aalError OpenALSource::setVelocity(const Vec3f & velocity) {
 
 aalError OpenALSource::setDirection(const Vec3f & direction) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_DIRECTION)) {
+	if(!(channel.flags & FLAG_DIRECTION)) {
 		return AAL_ERROR_INIT;
 	}
 	
 	channel.direction = direction;
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSource3f(source, AL_DIRECTION, direction.x, direction.y, direction.z);
 	AL_CHECK_ERROR("setting source direction")
 	
@@ -470,7 +511,7 @@ aalError OpenALSource::setDirection(const Vec3f & direction) {
 
 aalError OpenALSource::setCone(const SourceCone & cone) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_CONE)) {
+	if(!(channel.flags & FLAG_CONE)) {
 		return AAL_ERROR_INIT;
 	}
 	
@@ -478,6 +519,10 @@ aalError OpenALSource::setCone(const SourceCone & cone) {
 	channel.cone.outer_angle = cone.outer_angle;
 	channel.cone.outer_volume = clamp(cone.outer_volume, 0.f, 1.f);
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSourcef(source, AL_CONE_INNER_ANGLE, channel.cone.inner_angle);
 	alSourcef(source, AL_CONE_OUTER_ANGLE, channel.cone.outer_angle);
 	alSourcef(source, AL_CONE_OUTER_GAIN, channel.cone.outer_volume);
@@ -488,12 +533,16 @@ aalError OpenALSource::setCone(const SourceCone & cone) {
 
 aalError OpenALSource::setFalloff(const SourceFalloff & falloff) {
 	
-	if(!alIsSource(source) || !(channel.flags & FLAG_FALLOFF)) {
+	if(!(channel.flags & FLAG_FALLOFF)) {
 		return AAL_ERROR_INIT;
 	}
 	
 	channel.falloff = falloff;
 	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSourcef(source, AL_MAX_DISTANCE, falloff.end);
 	alSourcef(source, AL_REFERENCE_DISTANCE, falloff.start);
 	AL_CHECK_ERROR("setting source falloff")
@@ -512,13 +561,22 @@ aalError OpenALSource::play(unsigned play_count) {
 		read = written = 0;
 		reset();
 		
-		alSourcei(source, AL_SEC_OFFSET, 0);
-		AL_CHECK_ERROR("set source offset")
+		if(source) {
+			alSourcei(source, AL_SEC_OFFSET, 0);
+			AL_CHECK_ERROR("set source offset")
+		}
 		
 	} else {
 		TraceAL("play(+" << play_count << ") vol=" << channel.volume);
 	}
 	
+	addPlays(play_count);
+	
+	if(!source) {
+		// Virtual source - the buffers will be queued when it gets a voice again
+		return AAL_OK;
+	}
+	
 	if(play_count && loadCount != (unsigned)-1) {
 		loadCount += play_count;
 	} else {
@@ -553,6 +611,12 @@ aalError OpenALSource::stop() {
 	
 	LogAL("stop");
 	
+	status = Idle;
+	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSourceStop(source);
 	alSourceRewind(source);
 	alSourcei(source, AL_BUFFER, 0);
@@ -570,8 +634,6 @@ aalError OpenALSource::stop() {
 		}
 	}
 	
-	status = Idle;
-	
 	return AAL_OK;
 }
 
@@ -585,7 +647,9 @@ aalError OpenALSource::pause() {
 	
 	status = Paused;
 	
-	sourcePause();
+	if(source) {
+		sourcePause();
+	}
 	
 	return AAL_OK;
 }
@@ -600,7 +664,7 @@ aalError OpenALSource::resume() {
 	
 	status = Playing;
 	
-	if(updateCulling()) {
+	if(!source || updateCulling()) {
 		return AAL_OK;
 	}
 	
@@ -792,12 +856,160 @@ aalError OpenALSource::updateBuffers() {
 	return ret;
 }
 
+aalError OpenALSource::releaseVoice() {
+	
+	LogAL("release voice");
+	
+	// Account for the data already played
+	if(status == Playing && !tooFar) {
+		updateBuffers();
+	}
+	
+	alSourceStop(source);
+	alSourcei(source, AL_BUFFER, 0);
+	alDeleteSources(1, &source);
+	nbsources--;
+	source = 0;
+	AL_CHECK_ERROR("deleting source")
+	
+	// Static buffers are kept as they may be shared with other sources
+	if(streaming) {
+		for(size_t i = 0; i < NBUFFERS; i++) {
+			if(buffers[i] && alIsBuffer(buffers[i])) {
+				TraceAL("deleting buffer " << buffers[i]);
+				alDeleteBuffers(1, &buffers[i]);
+				nbbuffers--;
+				AL_CHECK_ERROR("deleting buffer")
+				buffers[i] = 0;
+			}
+		}
+		if(stream) {
+			deleteStream(stream), stream = NULL;
+		}
+	}
+	
+	read = 0;
+	tooFar = false;
+	
+	return AAL_OK;
+}
+
+aalError OpenALSource::acquireVoice() {
+	
+	arx_assert(!source);
+	
+	LogAL("acquire voice at " << time);
+	
+	aalError error = setupVoice();
+	if(error) {
+		// Stay virtual without leaking the OpenAL source, buffers or stream
+		discardVoice();
+	}
+	
+	return error;
+}
+
+void OpenALSource::discardVoice() {
+	
+	if(source) {
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+		alDeleteSources(1, &source);
+		nbsources--;
+		source = 0;
+		AL_CHECK_ERROR_N("deleting source",)
+	}
+	
+	if(streaming) {
+		for(size_t i = 0; i < NBUFFERS; i++) {
+			if(buffers[i] && alIsBuffer(buffers[i])) {
+				TraceAL("deleting buffer " << buffers[i]);
+				alDeleteBuffers(1, &buffers[i]);
+				nbbuffers--;
+				AL_CHECK_ERROR_N("deleting buffer",)
+			}
+			buffers[i] = 0;
+		}
+		if(stream) {
+			deleteStream(stream), stream = NULL;
+		}
+	}
+	
+	read = 0;
+}
+
+aalError OpenALSource::setupVoice() {
+	
+	alGenSources(1, &source);
+	AL_CHECK_ERROR("generating source")
+	nbsources++;
+	alSourcei(source, AL_LOOPING, AL_FALSE);
+	AL_CHECK_ERROR("setting source looping")
+	
+	setSourceProperties();
+	setRolloffFactor(rolloffFactor);
+	
+	if(status == Idle) {
+		return AAL_OK;
+	}
+	
+	loadCount = remaining;
+	read = 0;
+	
+	if(streaming) {
+		
+		stream = createStream(sample->getName());
+		if(!stream) {
+			ALError << "error creating stream";
+			return AAL_ERROR_FILEIO;
+		}
+		if(stream->setPosition(time)) {
+			ALError << "error seeking stream";
+			return AAL_ERROR_FILEIO;
+		}
+		written = time;
+		
+		if(aalError error = fillAllBuffers()) {
+			return error;
+		}
+		
+	} else {
+		
+		size_t nbuffers = MAXLOOPBUFFERS;
+		for(size_t i = 0; i < nbuffers && loadCount; i++) {
+			TraceAL("queueing buffer " << buffers[0]);
+			alSourceQueueBuffers(source, 1, &buffers[0]);
+			AL_CHECK_ERROR("queueing buffer")
+			markAsLoaded();
+		}
+		
+		// Continue where the virtual source is now
+		ALint offset = ALint(convertStereoToMono() ? time / 2 : time);
+		alSourcei(source, AL_BYTE_OFFSET, offset);
+		AL_CHECK_ERROR("setting source offset")
+		read = time;
+		
+	}
+	
+	if(status == Playing) {
+		return sourcePlay();
+	}
+	
+	return AAL_OK;
+}
+
 bool OpenALSource::markAsLoaded() {
 	return (loadCount == (unsigned)-1 || --loadCount);
 }
 
 aalError OpenALSource::setRolloffFactor(float factor) {
 	
+	rolloffFactor = factor;
+	
+	if(!source) {
+		return AAL_OK;
+	}
+	
 	alSourcef(source, AL_ROLLOFF_FACTOR, factor);
 	AL_CHECK_ERROR("setting rolloff factor");
 	
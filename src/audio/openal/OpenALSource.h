@@ -42,6 +42,9 @@ public:
 	
 	aalError init(SourceId id, OpenALSource * instance, const Channel & channel);
 	
+	//! Decode a sample into the sample cache unless it would be streamed
+	static aalError preload(const Sample * sample);
+	
 	aalError setPitch(float pitch);
 	aalError setPan(float pan);
 	
@@ -66,8 +69,20 @@ protected:
 	
 	aalError updateBuffers();
 	
+	aalError releaseVoice();
+	aalError acquireVoice();
+	
 private:
 	
+	//! Apply the channel properties to a new OpenAL source
+	void setSourceProperties();
+	
+	//! Create the OpenAL source for acquireVoice() and continue playback
+	aalError setupVoice();
+	
+	//! Free the OpenAL source, streaming buffers and stream after a failed setupVoice()
+	void discardVoice();
+	
 	aalError sourcePlay();
 	aalError sourcePause();
 	
@@ -83,6 +98,12 @@ private:
 	 */
 	aalError fillBuffer(size_t i, size_t size);
 	
+	/*!
+	 * Upload PCM data that has already been converted to mono if needed.
+	 * @param i The index of the buffer to fill.
+	 */
+	aalError setBufferData(size_t i, const char * data, size_t size);
+	
 	bool markAsLoaded();
 	
 	/*!
@@ -90,6 +111,8 @@ private:
 	 */
 	bool convertStereoToMono();
 	
+	static bool isStreamed(const Sample * sample);
+	
 	bool tooFar; // True if the listener is too far from this source.
 	
 	/*
@@ -112,6 +135,8 @@ private:
 	size_t bufferSizes[NBUFFERS];
 	unsigned int * refcount; // reference count for shared buffers
 	
+	float rolloffFactor;
+	
 };
 
 } // namespace audio
@@ -62,6 +62,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "core/Config.h"
 #include "core/GameTime.h"
 #include "core/Localisation.h"
+#include "core/Replay.h"
 #include "core/SaveGame.h"
 #include "core/Version.h"
 
@@ -116,6 +117,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "platform/Flags.h"
 #include "platform/Platform.h"
+#include "platform/profiler/Profiler.h"
 
 #include "scene/ChangeLevel.h"
 #include "scene/Interactive.h"
@@ -140,12 +142,57 @@ enum InfoPanels {
 	InfoPanelFps,
 	InfoPanelDebug,
 	InfoPanelTest,
+#ifdef BUILD_PROFILER_INSTRUMENT
+	InfoPanelProfiler,
+#endif
 
 	InfoPanelEnumSize
 };
 
 static InfoPanels showInfo = InfoPanelNone;
 
+#ifdef BUILD_PROFILER_INSTRUMENT
+
+//! Number of zones to show in the profiler overlay
+static const size_t PROFILER_OVERLAY_ZONES = 20;
+
+//! Text statistics of the last complete frame
+static Font::Stats lastTextStats = Font::Stats();
+
+static void ShowProfilerText() {
+	
+	TextBatch batch;
+	
+	std::vector<profiler::ZoneStats> zones;
+	profiler::getTopZones(zones, PROFILER_OVERLAY_ZONES);
+	
+	int lineHeight = hFontInGame->getLineHeight();
+	int y = lineHeight;
+	
+	char tex[256];
+	BOOST_FOREACH(const profiler::ZoneStats & zone, zones) {
+		sprintf(tex, "%8.3f ms %5u  %s", zone.time * 0.001f, zone.calls, zone.tag);
+		mainApp->outputText(lineHeight, y, tex);
+		y += lineHeight;
+	}
+	
+	const SceneCullingStats & culling = ARX_SCENE_GetCullingStats();
+	sprintf(tex, "%lu rooms%s  %lu / %lu polys drawn", (unsigned long)culling.rooms,
+	        culling.cached ? " (cached)" : "", (unsigned long)culling.polysDrawn,
+	        (unsigned long)culling.polysTested);
+	mainApp->outputText(lineHeight, y + lineHeight, tex);
+	
+	// Each glyph used to be drawn with its own draw call
+	const Font::Stats & text = lastTextStats;
+	sprintf(tex, "%lu strings  %lu glyphs  %lu text draw calls  %lu / %lu layouts cached",
+	        (unsigned long)text.strings, (unsigned long)text.glyphs,
+	        (unsigned long)text.drawCalls, (unsigned long)text.layoutHits,
+	        (unsigned long)(text.layoutHits + text.layoutMisses));
+	mainApp->outputText(lineHeight, y + 2 * lineHeight, tex);
+}
+
+#endif // BUILD_PROFILER_INSTRUMENT
+
 using std::string;
 
 extern long PLAY_LOADED_CINEMATIC;
@@ -236,6 +283,12 @@ bool ArxGame::initialize()
 		return false;
 	}
 	
+	init = replay::initialize();
+	if(!init) {
+		LogCritical << "Failed to initialize the replay system.";
+		return false;
+	}
+	
 	init = initLocalisation();
 	if(!init) {
 		LogCritical << "Failed to initialize the localisation subsystem.";
@@ -429,6 +482,22 @@ static const char * default_paks[][2] = {
 	{ "speech.pak", "speech_default.pak" },
 };
 
+/*!
+ * Add a pak file, preferring an indexed .ipak version created by arxunpak --convert.
+ * The .ipak file is ignored if the .pak file has changed since it was converted.
+ */
+static bool addPak(const char * name) {
+	
+	fs::path pakfile = fs::paths.find(name);
+	
+	fs::path indexed = fs::paths.find(fs::path(name).set_ext("ipak"));
+	if(!indexed.empty() && resources->addArchive(indexed, pakfile)) {
+		return true;
+	}
+	
+	return resources->addArchive(pakfile);
+}
+
 bool ArxGame::addPaks() {
 	
 	arx_assert(!resources);
@@ -438,11 +507,10 @@ bool ArxGame::addPaks() {
 	// Load required pak files
 	std::vector<size_t> missing;
 	for(size_t i = 0; i < ARRAY_SIZE(default_paks); i++) {
-		if(resources->addArchive(fs::paths.find(default_paks[i][0]))) {
+		if(addPak(default_paks[i][0])) {
 			continue;
 		}
-		if(default_paks[i][1]
-		   && resources->addArchive(fs::paths.find(default_paks[i][1]))) {
+		if(default_paks[i][1] && addPak(default_paks[i][1])) {
 			continue;
 		}
 		missing.push_back(i);
@@ -592,6 +660,13 @@ void ArxGame::run() {
 			
 			// Show the frame on the primary surface.
 			m_MainWindow->showFrame();
+			
+			profiler::frame();
+			
+#ifdef BUILD_PROFILER_INSTRUMENT
+			lastTextStats = Font::getStats();
+			Font::resetStats();
+#endif
 		}
 	}
 }
@@ -600,6 +675,10 @@ void ArxGame::run() {
  * \brief Draws the scene.
  */
 void ArxGame::doFrame() {
+	
+	ARX_PROFILE_FUNC();
+	
+	replay::beginFrame();
 		
 	updateTime();
 
@@ -1322,6 +1401,8 @@ extern void Cedric_ApplyLightingFirstPartRefactor(Entity *io, Color3f &special_c
 
 void ArxGame::renderLevel() {
 
+	ARX_PROFILE_FUNC();
+
 	if(!PLAYER_PARALYSED) {
 		manageEditorControls();
 
@@ -1688,6 +1769,8 @@ void ArxGame::renderLevel() {
 
 void ArxGame::update() {
 	
+	ARX_PROFILE_FUNC();
+	
 	if(!WILL_LAUNCH_CINE.empty()) {
 		// A cinematic is waiting to be played...
 		LaunchWaitingCine();
@@ -1696,6 +1779,8 @@ void ArxGame::update() {
 
 void ArxGame::render() {
 	
+	ARX_PROFILE_FUNC();
+	
 	ACTIVECAM = &subj;
 
 	// Update Various Player Infos for this frame.
@@ -1794,6 +1879,12 @@ void ArxGame::render() {
 			ShowTestText();
 			break;
 		}
+#ifdef BUILD_PROFILER_INSTRUMENT
+		case InfoPanelProfiler: {
+			ShowProfilerText();
+			break;
+		}
+#endif
 		default: break;
 		}
 		GRenderer->EndScene();
@@ -1988,6 +2079,7 @@ bool ArxGame::initDeviceObjects() {
 bool ArxGame::finalCleanup() {
 	
 	EERIE_PATHFINDER_Release();
+	replay::shutdown();
 	ARX_INPUT_Release();
 	ARX_SOUND_Release();
 	
@@ -522,8 +522,8 @@ void InitializeDanae() {
 #else
 			LogError << "FastSceneLoad failed";
 #endif
+			EERIEPOLY_Compute_PolyIn();
 		}
-		EERIEPOLY_Compute_PolyIn();
 		LastLoadedScene = levelPath;
 		USE_PLAYERCOLLISIONS=0;
 	}
@@ -3119,8 +3119,8 @@ void ShowInfoText() {
 
 	sprintf(tex,"Position  x:%7.0f y:%7.0f [%7.0f] z:%6.0f a%3.0f b%3.0f FOK %3.0f",player.pos.x,player.pos.y+player.size.y,poss,player.pos.z,player.angle.a,player.angle.b,ACTIVECAM->focal);
 	mainApp->outputText( 70, 48, tex );
-	sprintf(tex,"AnchorPos x:%6.0f y:%6.0f z:%6.0f TIME %lds Part %ld - %d",player.pos.x-Mscenepos.x,player.pos.y+player.size.y-Mscenepos.y,player.pos.z-Mscenepos.z
-		,GAT, getParticleCount(),player.doingmagic);
+	sprintf(tex,"AnchorPos x:%6.0f y:%6.0f z:%6.0f TIME %lds Part %ld (%lu failed) - %d",player.pos.x-Mscenepos.x,player.pos.y+player.size.y-Mscenepos.y,player.pos.z-Mscenepos.z
+		,GAT, getParticleCount(), (unsigned long)getParticleSpawnFailures(),player.doingmagic);
 	mainApp->outputText( 70, 64, tex );
 
 	if (player.onfirmground==0) mainApp->outputText( 200, 280, "OFFGRND" );
@@ -54,6 +54,8 @@ arx::time::time() {
 
 	// TODO can't call init from constructor Time::getUs() requires init
 	// potential out-of-order construction resulting in a divide-by-zero
+	manual_clock       = false;
+	manual_time_us     = 0;
 	start_time         = 0;
 	pause_time         = 0;
 	paused             = false;
@@ -65,7 +67,7 @@ arx::time::time() {
 
 void arx::time::init() {
 	
-	start_time         = Time::getUs();
+	start_time         = now();
 	pause_time         = 0;
 	paused             = false;
 	delta_time_us      = 0;
@@ -76,14 +78,14 @@ void arx::time::init() {
 
 void arx::time::pause() {
 	if(!is_paused()) {
-		pause_time = Time::getUs();
+		pause_time = now();
 		paused     = true;
 	}
 }
 
 void arx::time::resume() {
 	if(is_paused()) {
-		start_time += Time::getElapsedUs(pause_time);
+		start_time += Time::getElapsedUs(pause_time, now());
 		pause_time = 0;
 		paused     = false;
 	}
@@ -93,9 +95,29 @@ void arx::time::force_time_restore(const float &time) {
 	
 	u64 requested_time = u64(time * 1000.0f);
 	
-	start_time = Time::getElapsedUs(requested_time);
+	start_time = Time::getElapsedUs(requested_time, now());
 	delta_time_us = requested_time;
 	
 	pause_time = 0;
 	paused     = false;
 }
+
+void arx::time::use_manual_clock(bool enable) {
+	
+	if(enable == manual_clock) {
+		return;
+	}
+	
+	// Continue from the current time so that no jumps are visible
+	u64 current_time = now();
+	manual_clock = enable;
+	if(manual_clock) {
+		manual_time_us = current_time;
+	} else {
+		u64 offset = Time::getUs() - current_time;
+		start_time += offset;
+		if(paused) {
+			pause_time += offset;
+		}
+	}
+}
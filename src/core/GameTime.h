@@ -99,7 +99,7 @@ namespace arx
 			if (is_paused() && use_pause) {
 				delta_time_us = Time::getElapsedUs(start_time, pause_time);
 			} else {
-				delta_time_us = Time::getElapsedUs(start_time);
+				delta_time_us = Time::getElapsedUs(start_time, now());
 			}
 		}
 
@@ -146,8 +146,28 @@ namespace arx
 			last_frame_time_us = frame_time_us;
 		}
 
+		/*!
+		 * Use a clock that is only advanced by advance_manual_clock() instead of the
+		 * system time. This is used to make recorded sessions deterministic.
+		 */
+		void use_manual_clock(bool enable);
+
+		//! Advance the manual clock by the given number of microseconds.
+		inline void advance_manual_clock(u64 us) {
+			manual_time_us += us;
+		}
+
 	private:
+		
+		//! @return the current time in microseconds from either the system or manual clock
+		inline u64 now() const {
+			return manual_clock ? manual_time_us : Time::getUs();
+		}
+		
 		bool paused;
+		
+		bool manual_clock;
+		u64 manual_time_us;
 
 		// these values are expected to wrap
 		u64 pause_time;
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/Replay.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "core/Application.h"
+#include "core/GameTime.h"
+#include "input/Input.h"
+#include "input/InputBackend.h"
+#include "input/Keyboard.h"
+#include "input/Mouse.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/log/Logger.h"
+#include "math/Random.h"
+#include "platform/Platform.h"
+#include "platform/ProgramOptions.h"
+#include "platform/Time.h"
+
+namespace replay {
+
+namespace {
+
+const char REPLAY_MAGIC[4] = { 'A', 'R', 'X', 'R' };
+const u32 REPLAY_VERSION = 1;
+
+struct ReplayHeader {
+	char magic[4];
+	u32 version;
+	u32 seed;
+	u32 keyCount;
+	u32 buttonCount;
+};
+
+//! Complete input state for one frame as seen through the InputBackend interface.
+struct FrameRecord {
+	
+	u32 frameTime; //!< Duration of the frame in microseconds.
+	
+	s32 absX;
+	s32 absY;
+	s32 relX;
+	s32 relY;
+	s32 wheelDir;
+	u8 inWindow;
+	
+	u8 buttonPressed[Mouse::ButtonCount];
+	s32 buttonDeltaTime[Mouse::ButtonCount];
+	s32 buttonClicks[Mouse::ButtonCount];
+	s32 buttonUnclicks[Mouse::ButtonCount];
+	
+	u8 keyPressed[Keyboard::KeyCount];
+	char keyText[Keyboard::KeyCount]; //!< 0 if the key has no text representation.
+};
+
+enum Mode {
+	Disabled,
+	Recording,
+	Playing
+};
+
+/*!
+ * Input backend that wraps the real backend.
+ *
+ * While recording, the state of the real backend is captured once per update and written
+ * to the replay file. All queries are answered from that snapshot so that the game sees
+ * exactly the state that was recorded.
+ * During playback, the real backend is still updated to process window events, but its
+ * state is replaced with the recorded one.
+ */
+class ReplayInputBackend : public InputBackend {
+	
+public:
+	
+	explicit ReplayInputBackend(InputBackend * backend, std::ostream * output)
+		: backend(backend), output(output) {
+		memset(&frame, 0, sizeof(frame));
+	}
+	
+	~ReplayInputBackend() {
+		delete backend;
+	}
+	
+	bool init() { return true; }
+	void acquireDevices() { backend->acquireDevices(); }
+	void unacquireDevices() { backend->unacquireDevices(); }
+	
+	bool update();
+	
+	bool getAbsoluteMouseCoords(int & absX, int & absY) const {
+		absX = frame.absX, absY = frame.absY;
+		return frame.inWindow != 0;
+	}
+	
+	void setAbsoluteMouseCoords(int absX, int absY) {
+		if(output) {
+			backend->setAbsoluteMouseCoords(absX, absY);
+		}
+	}
+	
+	void getRelativeMouseCoords(int & relX, int & relY, int & wheelDir) const {
+		relX = frame.relX, relY = frame.relY, wheelDir = frame.wheelDir;
+	}
+	
+	bool isMouseButtonPressed(int buttonId, int & deltaTime) const {
+		size_t i = buttonId - Mouse::ButtonBase;
+		deltaTime = frame.buttonDeltaTime[i];
+		return frame.buttonPressed[i] != 0;
+	}
+	
+	void getMouseButtonClickCount(int buttonId, int & numClick, int & numUnClick) const {
+		size_t i = buttonId - Mouse::ButtonBase;
+		numClick = frame.buttonClicks[i], numUnClick = frame.buttonUnclicks[i];
+	}
+	
+	bool isKeyboardKeyPressed(int keyId) const {
+		return frame.keyPressed[keyId - Keyboard::KeyBase] != 0;
+	}
+	
+	bool getKeyAsText(int keyId, char & result) const {
+		result = frame.keyText[keyId - Keyboard::KeyBase];
+		return result != 0;
+	}
+	
+	FrameRecord frame;
+	
+private:
+	
+	void capture();
+	
+	InputBackend * backend;
+	std::ostream * output; //!< NULL during playback.
+};
+
+void ReplayInputBackend::capture() {
+	
+	u32 frameTime = frame.frameTime;
+	memset(&frame, 0, sizeof(frame));
+	frame.frameTime = frameTime;
+	
+	int absX, absY;
+	frame.inWindow = backend->getAbsoluteMouseCoords(absX, absY) ? 1 : 0;
+	frame.absX = absX, frame.absY = absY;
+	
+	int relX, relY, wheelDir;
+	backend->getRelativeMouseCoords(relX, relY, wheelDir);
+	frame.relX = relX, frame.relY = relY, frame.wheelDir = wheelDir;
+	
+	for(int buttonId = Mouse::ButtonBase; buttonId < Mouse::ButtonMax; buttonId++) {
+		size_t i = buttonId - Mouse::ButtonBase;
+		int deltaTime, numClick, numUnClick;
+		frame.buttonPressed[i] = backend->isMouseButtonPressed(buttonId, deltaTime) ? 1 : 0;
+		backend->getMouseButtonClickCount(buttonId, numClick, numUnClick);
+		frame.buttonDeltaTime[i] = deltaTime;
+		frame.buttonClicks[i] = numClick, frame.buttonUnclicks[i] = numUnClick;
+	}
+	
+	for(int keyId = Keyboard::KeyBase; keyId < Keyboard::KeyMax; keyId++) {
+		size_t i = keyId - Keyboard::KeyBase;
+		frame.keyPressed[i] = backend->isKeyboardKeyPressed(keyId) ? 1 : 0;
+		char text;
+		if(backend->getKeyAsText(keyId, text)) {
+			frame.keyText[i] = text;
+		}
+	}
+}
+
+bool ReplayInputBackend::update() {
+	
+	bool result = backend->update();
+	
+	if(output) {
+		capture();
+		fs::write(*output, frame);
+	}
+	
+	return result;
+}
+
+Mode mode = Disabled;
+fs::path replayFile;
+fs::ofstream recordStream;
+fs::ifstream playStream;
+ReplayInputBackend * replayBackend = NULL;
+
+u64 lastFrameStart = 0;
+std::vector<u32> frameTimes; //!< Measured wall-clock frame times during playback.
+bool finished = false;
+
+void recordOption(const std::string & file) {
+	mode = Recording;
+	replayFile = file;
+}
+
+void replayOption(const std::string & file) {
+	mode = Playing;
+	replayFile = file;
+}
+
+void reportStatistics() {
+	
+	if(frameTimes.empty()) {
+		LogWarning << "No frames were played back from " << replayFile;
+		return;
+	}
+	
+	u64 total = 0;
+	u32 minimum = std::numeric_limits<u32>::max();
+	u32 maximum = 0;
+	for(std::vector<u32>::const_iterator i = frameTimes.begin(); i != frameTimes.end(); ++i) {
+		total += *i;
+		minimum = std::min(minimum, *i);
+		maximum = std::max(maximum, *i);
+	}
+	
+	std::vector<u32> sorted = frameTimes;
+	size_t index = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	u32 percentile = sorted[index];
+	
+	float average = float(total) / float(frameTimes.size());
+	
+	LogInfo << "Replay finished: " << frameTimes.size() << " frames in "
+	        << (total / 1000) << " ms, " << (1000000.f / average) << " fps average";
+	LogInfo << "Frame times: min " << (minimum / 1000.f) << " ms, avg " << (average / 1000.f)
+	        << " ms, max " << (maximum / 1000.f) << " ms, 99th percentile "
+	        << (percentile / 1000.f) << " ms";
+}
+
+void finish() {
+	
+	if(finished) {
+		return;
+	}
+	finished = true;
+	
+	reportStatistics();
+	
+	// Release all recorded input so that nothing remains pressed
+	u32 frameTime = replayBackend->frame.frameTime;
+	memset(&replayBackend->frame, 0, sizeof(replayBackend->frame));
+	replayBackend->frame.frameTime = frameTime;
+	
+	mainApp->quit();
+}
+
+} // anonymous namespace
+
+bool initialize() {
+	
+	if(mode == Disabled) {
+		return true;
+	}
+	
+	arx_assert(GInput != NULL);
+	
+	ReplayHeader header;
+	
+	if(mode == Recording) {
+		
+		recordStream.open(replayFile, fs::fstream::out | fs::fstream::binary
+		                              | fs::fstream::trunc);
+		if(!recordStream.is_open()) {
+			LogError << "Could not open " << replayFile << " for recording";
+			mode = Disabled;
+			return false;
+		}
+		
+		memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+		header.version = REPLAY_VERSION;
+		header.seed = u32(Time::getUs());
+		header.keyCount = Keyboard::KeyCount;
+		header.buttonCount = Mouse::ButtonCount;
+		fs::write(recordStream, header);
+		
+		LogInfo << "Recording session to " << replayFile;
+	
+	} else {
+		
+		playStream.open(replayFile, fs::fstream::in | fs::fstream::binary);
+		if(!playStream.is_open()) {
+			LogError << "Could not open " << replayFile << " for playback";
+			mode = Disabled;
+			return false;
+		}
+		
+		if(!fs::read(playStream, header)
+		   || memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0
+		   || header.version != REPLAY_VERSION
+		   || header.keyCount != u32(Keyboard::KeyCount)
+		   || header.buttonCount != u32(Mouse::ButtonCount)) {
+			LogError << replayFile << " is not a valid replay file for this version";
+			playStream.close();
+			mode = Disabled;
+			return false;
+		}
+		
+		LogInfo << "Playing back session from " << replayFile;
+	}
+	
+	Random::seed(header.seed);
+	srand(header.seed);
+	
+	std::ostream * output = (mode == Recording) ? &recordStream : NULL;
+	replayBackend = new ReplayInputBackend(GInput->setBackend(NULL), output);
+	GInput->setBackend(replayBackend);
+	
+	arxtime.use_manual_clock(true);
+	
+	lastFrameStart = 0;
+	frameTimes.clear();
+	finished = false;
+	
+	return true;
+}
+
+void beginFrame() {
+	
+	if(mode == Disabled) {
+		return;
+	}
+	
+	u64 now = Time::getUs();
+	u64 elapsed = (lastFrameStart == 0) ? 0 : Time::getElapsedUs(lastFrameStart, now);
+	lastFrameStart = now;
+	u32 measured = u32(std::min(elapsed, u64(std::numeric_limits<u32>::max())));
+	
+	if(mode == Recording) {
+		replayBackend->frame.frameTime = measured;
+	} else if(!finished) {
+		if(elapsed != 0) {
+			frameTimes.push_back(measured);
+		}
+		if(!fs::read(playStream, replayBackend->frame)) {
+			finish();
+			replayBackend->frame.frameTime = 0;
+		}
+	} else {
+		replayBackend->frame.frameTime = 0;
+	}
+	
+	arxtime.advance_manual_clock(replayBackend->frame.frameTime);
+}
+
+void shutdown() {
+	
+	if(mode == Playing && !finished) {
+		reportStatistics();
+	}
+	
+	recordStream.close();
+	playStream.close();
+	
+	if(mode != Disabled) {
+		arxtime.use_manual_clock(false);
+	}
+	
+	// The backend itself is owned and released by the input system
+	replayBackend = NULL;
+	mode = Disabled;
+}
+
+} // namespace replay
+
+ARX_PROGRAM_OPTION("record", "r", "Record input and frame times to a replay file",
+                   &replay::recordOption, "FILE");
+ARX_PROGRAM_OPTION("replay", "R", "Play back a recorded replay file and report frame times",
+                   &replay::replayOption, "FILE");
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Deterministic recording and playback of game sessions.
+ *
+ * When recording (--record FILE), the random seed, the per-frame input state and the
+ * duration of each frame are written to a file. Playing back that file (--replay FILE)
+ * reproduces the same session independent of the speed of the machine, which makes
+ * it usable as a repeatable benchmark workload. At the end of the playback, frame time
+ * statistics are logged and the game exits.
+ */
+#ifndef ARX_CORE_REPLAY_H
+#define ARX_CORE_REPLAY_H
+
+namespace replay {
+
+/*!
+ * Start recording or playback if requested on the command line.
+ * Must be called after the input system has been initialized.
+ * @return false if the replay file could not be opened.
+ */
+bool initialize();
+
+//! Advance the game clock for a new frame. Must be called before updating the time.
+void beginFrame();
+
+//! Stop recording or playback and close the replay file.
+void shutdown();
+
+} // namespace replay
+
+#endif // ARX_CORE_REPLAY_H
@@ -53,6 +53,7 @@
 #include "core/Version.h"
 #include "io/fs/Filesystem.h"
 #include "io/fs/SystemPaths.h"
+#include "io/log/AsyncLogger.h"
 #include "io/log/CriticalLogger.h"
 #include "io/log/FileLogger.h"
 #include "io/log/Logger.h"
@@ -60,7 +61,9 @@
 #include "platform/Compiler.h"
 #include "platform/CrashHandler.h"
 #include "platform/Environment.h"
+#include "platform/JobSystem.h"
 #include "platform/ProgramOptions.h"
+#include "platform/profiler/Profiler.h"
 #include "platform/Time.h"
 #include "util/String.h"
 #include "util/cmdline/Parser.h"
@@ -143,6 +146,7 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
 	
 	// Also intialize the logging system early as we might need it
 	Logger::initialize();
+	profiler::registerThread("main");
 	CrashHandler::registerCrashCallback(Logger::quickShutdown);
 	Logger::add(new logger::CriticalErrorDialog);
 	
@@ -167,16 +171,24 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
 			CrashHandler::addAttachedFile(logFile);
 		}
 		
+		// Don't let slow log backends block the game threads
+		logger::startAsyncWriter();
+		
 		Time::init();
 		
+		jobs::initialize();
+		
 		// 14: Start the game already!
 		LogInfo << "Starting " << arx_version;
 		runGame();
 		
+		jobs::shutdown();
+		
 	}
 	
 	// Shutdown the logging system
 	// If there has been a critical error, a dialog will be shown now
+	logger::stopAsyncWriter();
 	Logger::shutdown();
 	
 	CrashHandler::shutdown();
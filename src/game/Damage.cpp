@@ -1276,12 +1276,11 @@ bool ARX_DAMAGES_TryToDoDamage(Vec3f * pos, float dmg, float radius, long source
 
 void CheckForIgnition(Vec3f * pos, float radius, bool mode, long flag) {
 	
-	if(!(flag & 1))
-		for(size_t i = 0; i < MAX_LIGHTS; i++) {
-			EERIE_LIGHT * el = GLight[i];
-
-			if(el == NULL)
-				continue;
+	if(!(flag & 1)) {
+		std::vector<size_t> lights;
+		EERIE_LIGHT_GetNear(*pos, radius, lights);
+		for(size_t l = 0; l < lights.size(); l++) {
+			EERIE_LIGHT * el = GLight[lights[l]];
 
 			if((el->extras & EXTRAS_EXTINGUISHABLE) && (el->extras & (EXTRAS_SEMIDYNAMIC | EXTRAS_SPAWNFIRE | EXTRAS_SPAWNSMOKE)))
 			{
@@ -1299,6 +1298,7 @@ void CheckForIgnition(Vec3f * pos, float radius, bool mode, long flag) {
 
 			}
 		}
+	}
 
 	for(size_t i = 0; i < entities.size(); i++) {
 		Entity * io = entities[i];
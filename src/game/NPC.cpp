@@ -101,6 +101,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "platform/Flags.h"
 #include "platform/Platform.h"
+#include "platform/profiler/Profiler.h"
 
 #include "scene/Object.h"
 #include "scene/Interactive.h"
@@ -786,35 +787,30 @@ bool ARX_NPC_SetStat(Entity& io, const string & statname, float value) {
 	return true;
 }
 
-extern long CUR_COLLISION_MATERIAL;
-static Entity * PHYSICS_CURIO = NULL;
+void ARX_TEMPORARY_TrySound(Entity * io, float volume, long collisionMaterial) {
 
-void ARX_TEMPORARY_TrySound(float volume) {
+	if(io->ioflags & IO_BODY_CHUNK)
+		return;
 	
-	if(PHYSICS_CURIO) {
-		if(PHYSICS_CURIO->ioflags & IO_BODY_CHUNK)
-			return;
+	unsigned long at = (unsigned long)(arxtime);
 
-		unsigned long at = (unsigned long)(arxtime);
+	if(at > io->soundtime) {
 
-		if(at > PHYSICS_CURIO->soundtime) {
+		io->soundcount++;
 
-			PHYSICS_CURIO->soundcount++;
-
-			if(PHYSICS_CURIO->soundcount < 5) {
-				long material;
-				if(EEIsUnderWater(&PHYSICS_CURIO->pos))
-					material = MATERIAL_WATER;
-				else if(PHYSICS_CURIO->material)
-					material = PHYSICS_CURIO->material;
-				else
-					material = MATERIAL_STONE;
+		if(io->soundcount < 5) {
+			long material;
+			if(EEIsUnderWater(&io->pos))
+				material = MATERIAL_WATER;
+			else if(io->material)
+				material = io->material;
+			else
+				material = MATERIAL_STONE;
 
-				if(volume > 1.f)
-					volume = 1.f;
+			if(volume > 1.f)
+				volume = 1.f;
 
-				PHYSICS_CURIO->soundtime = at + (ARX_SOUND_PlayCollision(material, CUR_COLLISION_MATERIAL, volume, 1.f, &PHYSICS_CURIO->pos, PHYSICS_CURIO) >> 4) + 50;
-			}
+			io->soundtime = at + (ARX_SOUND_PlayCollision(material, collisionMaterial, volume, 1.f, &io->pos, io) >> 4) + 50;
 		}
 	}
 }
@@ -955,6 +951,9 @@ static void ManageNPCMovement(Entity * io);
 extern float MAX_ALLOWED_PER_SECOND;
 
 void ARX_PHYSICS_Apply() {
+	
+	ARX_PROFILE_FUNC();
+	
 	static long CURRENT_DETECT = 0;
 
 	CURRENT_DETECT++;
@@ -962,10 +961,33 @@ void ARX_PHYSICS_Apply() {
 	if(CURRENT_DETECT > TREATZONE_CUR)
 		CURRENT_DETECT = 1;
 
+	// Simulate all active physics boxes together, the results are applied below
+	static std::vector<PhysicsBoxModel> boxes;
+	boxes.clear();
+	for(long i = 1; i < TREATZONE_CUR; i++) {
+		Entity * io = treatio[i].io;
+		if(treatio[i].show == 1 && !(treatio[i].ioflags & (IO_FIX | IO_JUST_COLLIDE))
+		   && io && io->obj && io->obj->pbox && io->obj->pbox->active == 1) {
+			PhysicsBoxModel model;
+			model.obj = io->obj;
+			model.rubber = io->rubber;
+			model.source = treatio[i].num;
+			boxes.push_back(model);
+		}
+	}
+	ARX_PHYSICS_BOX_ApplyModels(boxes.empty() ? NULL : &boxes[0], boxes.size(),
+	                            float(framedelay));
+	size_t nextBox = 0;
+	
 	// We don't manage Player(0) this way
 	for (long i = 1; i < TREATZONE_CUR; i++) {
 		if(treatio[i].show != 1)
 			continue;
+		
+		const PhysicsBoxModel * box = NULL;
+		if(nextBox < boxes.size() && boxes[nextBox].source == treatio[i].num) {
+			box = &boxes[nextBox++];
+		}
 
 		if(treatio[i].ioflags & (IO_FIX | IO_JUST_COLLIDE))
 			continue;
@@ -1017,10 +1039,10 @@ void ARX_PHYSICS_Apply() {
 		if(io->obj && io->obj->pbox) {
 			io->gameFlags &= ~GFLAG_NOCOMPUTATION;
 
-			if(io->obj->pbox->active == 1) {
-				PHYSICS_CURIO = io;
+			// Boxes activated during this loop are simulated in the next frame
+			if(box || io->obj->pbox->active == 1) {
 
-				if(ARX_PHYSICS_BOX_ApplyModel(io->obj, (float)framedelay, io->rubber, treatio[i].num)) {
+				if(box && box->ret) {
 					if(io->damagedata >= 0) {
 						damages[io->damagedata].active = 1;
 						ARX_DAMAGES_UpdateDamage(io->damagedata, float(arxtime));
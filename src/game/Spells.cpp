@@ -112,6 +112,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "physics/Collisions.h"
 
 #include "platform/Platform.h"
+#include "platform/profiler/Profiler.h"
 
 #include "scene/Light.h"
 #include "scene/Scene.h"
@@ -3161,9 +3162,11 @@ bool ARX_SPELLS_Launch(Spell typ, long source, SpellcastFlags flagss, long level
 			effect->Create(&target, fPerimeter, 500);
 			CheckForIgnition(&target, fPerimeter, 1, 1);
 			
-			for(size_t ii = 0; ii < MAX_LIGHTS; ii++) {
+			std::vector<size_t> lights;
+			EERIE_LIGHT_GetNear(target, effect->GetPerimetre(), lights);
+			BOOST_FOREACH(size_t ii, lights) {
 				
-				if(!GLight[ii] || !(GLight[ii]->extras & EXTRAS_EXTINGUISHABLE)) {
+				if(!(GLight[ii]->extras & EXTRAS_EXTINGUISHABLE)) {
 					continue;
 				}
 				
@@ -3228,9 +3231,11 @@ bool ARX_SPELLS_Launch(Spell typ, long source, SpellcastFlags flagss, long level
 			effect->CreateDoze(&target, fPerimeter, 500);
 			CheckForIgnition(&target, fPerimeter, 0, 1);
 			
-			for(size_t ii = 0; ii < MAX_LIGHTS; ii++) {
+			std::vector<size_t> lights;
+			EERIE_LIGHT_GetNear(target, effect->GetPerimetre(), lights);
+			BOOST_FOREACH(size_t ii, lights) {
 				
-				if(!GLight[ii] || !(GLight[ii]->extras & EXTRAS_EXTINGUISHABLE)) {
+				if(!(GLight[ii]->extras & EXTRAS_EXTINGUISHABLE)) {
 					continue;
 				}
 				
@@ -5354,6 +5359,7 @@ float ARX_SPELLS_ApplyColdProtection(Entity * io,float damages)
  */
 void ARX_SPELLS_Update()
 {
+	ARX_PROFILE_FUNC();
 	
 	unsigned long tim;
 	long framediff,framediff3;
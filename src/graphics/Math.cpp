@@ -48,6 +48,12 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include <algorithm>
 
+#include "platform/Architecture.h"
+
+#if defined(ARX_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
 #include "graphics/GraphicsTypes.h"
 
 using std::min;
@@ -623,11 +629,10 @@ void Quat_Slerp(EERIE_QUAT * result, const EERIE_QUAT * from, EERIE_QUAT * to, f
 //*************************************************************************************
 void Quat_Reverse(EERIE_QUAT * q)
 {
-	EERIE_QUAT qw, qr;
-	Quat_Init(&qw);
-	Quat_Divide(&qr, q, &qw);
-	Quat_Copy(q, &qr);
-
+	// Same as dividing the identity quaternion by q
+	q->x = -q->x;
+	q->y = -q->y;
+	q->z = -q->z;
 }
 
 
@@ -969,6 +974,216 @@ void VectorMatrixMultiply(Vec3f * vDest, const Vec3f * vSrc, const EERIEMATRIX *
 	*vDest = Vec3f(x, y, z);
 }
 
+// Batch functions
+
+#if defined(ARX_HAVE_SSE2)
+
+namespace {
+
+struct QuatBlock {
+	__m128 x, y, z, w;
+};
+
+inline QuatBlock loadQuats(const EERIE_QUAT * q) {
+	QuatBlock b;
+	b.x = _mm_loadu_ps(&q[0].x);
+	b.y = _mm_loadu_ps(&q[1].x);
+	b.z = _mm_loadu_ps(&q[2].x);
+	b.w = _mm_loadu_ps(&q[3].x);
+	_MM_TRANSPOSE4_PS(b.x, b.y, b.z, b.w);
+	return b;
+}
+
+inline void storeQuats(EERIE_QUAT * q, QuatBlock b) {
+	_MM_TRANSPOSE4_PS(b.x, b.y, b.z, b.w);
+	_mm_storeu_ps(&q[0].x, b.x);
+	_mm_storeu_ps(&q[1].x, b.y);
+	_mm_storeu_ps(&q[2].x, b.z);
+	_mm_storeu_ps(&q[3].x, b.w);
+}
+
+//! Transform vectors by the upper 3x4 part of a matrix, returning the w component in lane 3
+inline __m128 transformVector(const Vec3f & v, __m128 r1, __m128 r2, __m128 r3, __m128 r4) {
+	__m128 x = _mm_mul_ps(_mm_set1_ps(v.x), r1);
+	__m128 y = _mm_mul_ps(_mm_set1_ps(v.y), r2);
+	__m128 z = _mm_mul_ps(_mm_set1_ps(v.z), r3);
+	return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, r4));
+}
+
+inline void storeVector(Vec3f & v, __m128 r) {
+	_mm_storel_pi(reinterpret_cast<__m64 *>(&v.x), r);
+	_mm_store_ss(&v.z, _mm_movehl_ps(r, r));
+}
+
+} // anonymous namespace
+
+#endif // defined(ARX_HAVE_SSE2)
+
+void Quat_MultiplyArray(EERIE_QUAT * dest, const EERIE_QUAT * q1, const EERIE_QUAT * q2,
+                        size_t count) {
+	
+	size_t i = 0;
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		QuatBlock a = loadQuats(q1 + i);
+		QuatBlock b = loadQuats(q2 + i);
+		
+		QuatBlock r;
+		r.x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.x), _mm_mul_ps(a.x, b.w)),
+		                            _mm_mul_ps(a.y, b.z)), _mm_mul_ps(a.z, b.y));
+		r.y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.y), _mm_mul_ps(a.y, b.w)),
+		                            _mm_mul_ps(a.z, b.x)), _mm_mul_ps(a.x, b.z));
+		r.z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.z), _mm_mul_ps(a.z, b.w)),
+		                            _mm_mul_ps(a.x, b.y)), _mm_mul_ps(a.y, b.x));
+		r.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(a.w, b.w), _mm_mul_ps(a.x, b.x)),
+		                            _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+		
+		storeQuats(dest + i, r);
+	}
+	
+#endif // defined(ARX_HAVE_SSE2)
+	
+	for(; i < count; i++) {
+		EERIE_QUAT a = q1[i], b = q2[i];
+		Quat_Multiply(&dest[i], &a, &b);
+	}
+}
+
+void Quat_SlerpArray(EERIE_QUAT * dest, const EERIE_QUAT * from, const EERIE_QUAT * to,
+                     float ratio, size_t count) {
+	
+	size_t i = 0;
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		QuatBlock a = loadQuats(from + i);
+		QuatBlock b = loadQuats(to + i);
+		
+		__m128 cosTheta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)),
+		                             _mm_add_ps(_mm_mul_ps(a.z, b.z), _mm_mul_ps(a.w, b.w)));
+		
+		// Take the shorter path
+		__m128 sign = _mm_and_ps(cosTheta, signMask);
+		cosTheta = _mm_xor_ps(cosTheta, sign);
+		
+		float c[4], fromWeight[4], toWeight[4];
+		_mm_storeu_ps(c, cosTheta);
+		for(size_t k = 0; k < 4; k++) {
+			fromWeight[k] = 1.f - ratio;
+			toWeight[k] = ratio;
+			if(1.0f - c[k] > 0.001f) {
+				float theta = acosf(c[k]);
+				float t = 1 / EEsin(theta);
+				fromWeight[k] = EEsin(theta * fromWeight[k]) * t;
+				toWeight[k] = EEsin(theta * ratio) * t;
+			}
+		}
+		
+		__m128 fw = _mm_loadu_ps(fromWeight);
+		__m128 tw = _mm_xor_ps(_mm_loadu_ps(toWeight), sign);
+		
+		QuatBlock r;
+		r.x = _mm_add_ps(_mm_mul_ps(fw, a.x), _mm_mul_ps(tw, b.x));
+		r.y = _mm_add_ps(_mm_mul_ps(fw, a.y), _mm_mul_ps(tw, b.y));
+		r.z = _mm_add_ps(_mm_mul_ps(fw, a.z), _mm_mul_ps(tw, b.z));
+		r.w = _mm_add_ps(_mm_mul_ps(fw, a.w), _mm_mul_ps(tw, b.w));
+		
+		storeQuats(dest + i, r);
+	}
+	
+#endif // defined(ARX_HAVE_SSE2)
+	
+	for(; i < count; i++) {
+		EERIE_QUAT a = from[i], b = to[i];
+		Quat_Slerp(&dest[i], &a, &b, ratio);
+	}
+}
+
+void TransformVertexQuatArray(const EERIE_QUAT * quat, const Vec3f * vertexin,
+                              Vec3f * vertexout, size_t count) {
+	
+	// Rotate by the equivalent matrix - this also works for quaternions that are not normalized
+	const float x = quat->x, y = quat->y, z = quat->z, w = quat->w;
+	EERIEMATRIX mat;
+	mat._11 = w * w + x * x - y * y - z * z;
+	mat._21 = 2.f * (x * y - w * z);
+	mat._31 = 2.f * (x * z + w * y);
+	mat._12 = 2.f * (x * y + w * z);
+	mat._22 = w * w - x * x + y * y - z * z;
+	mat._32 = 2.f * (y * z - w * x);
+	mat._13 = 2.f * (x * z - w * y);
+	mat._23 = 2.f * (y * z + w * x);
+	mat._33 = w * w - x * x - y * y + z * z;
+	mat._14 = mat._24 = mat._34 = 0.f;
+	mat._41 = mat._42 = mat._43 = 0.f;
+	mat._44 = 1.f;
+	
+	VectorMatrixMultiplyArray(vertexout, vertexin, count, &mat);
+}
+
+void VectorMatrixMultiplyArray(Vec3f * vDest, const Vec3f * vSrc, size_t count,
+                               const EERIEMATRIX * mat) {
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	__m128 r1 = _mm_loadu_ps(&mat->_11);
+	__m128 r2 = _mm_loadu_ps(&mat->_21);
+	__m128 r3 = _mm_loadu_ps(&mat->_31);
+	__m128 r4 = _mm_loadu_ps(&mat->_41);
+	
+	for(size_t i = 0; i < count; i++) {
+		storeVector(vDest[i], transformVector(vSrc[i], r1, r2, r3, r4));
+	}
+	
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < count; i++) {
+		VectorMatrixMultiply(&vDest[i], &vSrc[i], mat);
+	}
+	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
+void ProjectVertexArray(Vec3f * vDest, float * rhw, const Vec3f * vSrc, size_t count,
+                        const EERIEMATRIX * mat) {
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	__m128 r1 = _mm_loadu_ps(&mat->_11);
+	__m128 r2 = _mm_loadu_ps(&mat->_21);
+	__m128 r3 = _mm_loadu_ps(&mat->_31);
+	__m128 r4 = _mm_loadu_ps(&mat->_41);
+	
+	for(size_t i = 0; i < count; i++) {
+		__m128 p = transformVector(vSrc[i], r1, r2, r3, r4);
+		__m128 w = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 invW = _mm_div_ss(_mm_set_ss(1.f), w);
+		_mm_store_ss(&rhw[i], invW);
+		storeVector(vDest[i], _mm_mul_ps(p, _mm_shuffle_ps(invW, invW, 0)));
+	}
+	
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < count; i++) {
+		const Vec3f & v = vSrc[i];
+		float w = v.x * mat->_14 + v.y * mat->_24 + v.z * mat->_34 + mat->_44;
+		rhw[i] = 1.f / w;
+		VectorMatrixMultiply(&vDest[i], &v, mat);
+		vDest[i] *= rhw[i];
+	}
+	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
 #undef X
 #undef Y
 #undef Z
@@ -191,6 +191,15 @@ inline float fnormalize(Vec3f & v) {
 void MatrixSetByVectors(EERIEMATRIX * m, const Vec3f * d, const Vec3f * u);
 void MatrixMultiply(EERIEMATRIX * q, const EERIEMATRIX * a, const EERIEMATRIX * b);
 void VectorMatrixMultiply(Vec3f * vDest, const Vec3f * vSrc, const EERIEMATRIX * mat);
+//! Same as VectorMatrixMultiply() for count vectors. vDest may be the same as vSrc.
+void VectorMatrixMultiplyArray(Vec3f * vDest, const Vec3f * vSrc, size_t count,
+                               const EERIEMATRIX * mat);
+/*!
+ * Transform count points by a projection matrix and divide by w.
+ * \param rhw receives 1 / w for each point
+ */
+void ProjectVertexArray(Vec3f * vDest, float * rhw, const Vec3f * vSrc, size_t count,
+                        const EERIEMATRIX * mat);
 void GenerateMatrixUsingVector(EERIEMATRIX * matrix, const Vec3f * vect, float rollDegrees);
 
 // Rotation Functions
@@ -249,6 +258,16 @@ void Quat_Divide(EERIE_QUAT * dest, const EERIE_QUAT * q1, const EERIE_QUAT * q2
 void Quat_Multiply(EERIE_QUAT * dest , const EERIE_QUAT * q1, const EERIE_QUAT * q2);
 
 void Quat_Slerp(EERIE_QUAT * result, const EERIE_QUAT * from, EERIE_QUAT * to, float t);
+
+//! Same as TransformVertexQuat() for count vertices. vertexout may be the same as vertexin.
+void TransformVertexQuatArray(const EERIE_QUAT * quat, const Vec3f * vertexin,
+                              Vec3f * vertexout, size_t count);
+//! Same as Quat_Multiply() for count pairs of quaternions. dest may be the same as q1 or q2.
+void Quat_MultiplyArray(EERIE_QUAT * dest, const EERIE_QUAT * q1, const EERIE_QUAT * q2,
+                        size_t count);
+//! Same as Quat_Slerp() for count pairs of quaternions, but does not modify to.
+void Quat_SlerpArray(EERIE_QUAT * dest, const EERIE_QUAT * from, const EERIE_QUAT * to,
+                     float ratio, size_t count);
 void Quat_Reverse(EERIE_QUAT * quat);
 
 void worldAngleToQuat(EERIE_QUAT *dest, Anglef *src, bool isNpc = false);
@@ -70,6 +70,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/IO.h"
 #include "io/log/Logger.h"
 
+#include "platform/profiler/LoadStatistics.h"
+
 #include "scene/Object.h"
 
 #include "util/String.h"
@@ -420,6 +422,8 @@ static char * MCache_Pop(const res::path & file, size_t & size) {
 
 EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 	
+	ARX_LOAD_PHASE(LoadModels);
+	
 	// Creates FTL file name
 	res::path filename = (res::path("game") / file).set_ext("ftl");
 	
@@ -77,6 +77,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/fs/FileStream.h"
 #include "io/resource/PakReader.h"
 #include "io/fs/Filesystem.h"
+#include "io/fs/SystemPaths.h"
 #include "io/Blast.h"
 #include "io/Implode.h"
 #include "io/IO.h"
@@ -84,6 +85,11 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "physics/Anchors.h"
 
+#include "platform/Atomic.h"
+#include "platform/JobSystem.h"
+#include "platform/Thread.h"
+#include "platform/profiler/LoadStatistics.h"
+
 #include "scene/Scene.h"
 #include "scene/Light.h"
 #include "scene/Interactive.h"
@@ -1265,91 +1271,105 @@ bool PointInBBox(Vec3f * point, EERIE_2D_BBOX * bb)
 	return true;
 }
 
-void EERIEPOLY_Compute_PolyIn()
-{
-	for(long j = 0; j < ACTIVEBKG->Zsize; j++)
-		for(long i = 0; i < ACTIVEBKG->Xsize; i++) {
+static void EERIEPOLY_Compute_PolyIn(long i, long j) {
 			
-			EERIE_BKG_INFO *eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
+	EERIE_BKG_INFO *eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
 			
-			free(eg->polyin), eg->polyin = NULL;
-			eg->nbpolyin = 0;
+	free(eg->polyin), eg->polyin = NULL;
+	eg->nbpolyin = 0;
 			
-			long ii = max(i - 2, 0L);
-			long ij = max(j - 2, 0L);
-			long ai = min(i + 2, ACTIVEBKG->Xsize - 1L);
-			long aj = min(j + 2, ACTIVEBKG->Zsize - 1L);
-
-			EERIE_2D_BBOX bb;
-			bb.min.x = (float)i * ACTIVEBKG->Xdiv - 10;
-			bb.max.x = (float)bb.min.x + ACTIVEBKG->Xdiv + 20;
-			bb.min.y = (float)j * ACTIVEBKG->Zdiv - 10;
-			bb.max.y = (float)bb.min.y + ACTIVEBKG->Zdiv + 20;
-			Vec3f bbcenter;
-			bbcenter.x = (bb.min.x + bb.max.x) * .5f;
-			bbcenter.z = (bb.min.y + bb.max.y) * .5f;
-
-			for(long cj = ij; cj < aj; cj++)
-				for(long ci = ii; ci < ai; ci++) {
-					EERIE_BKG_INFO *eg2 = &ACTIVEBKG->Backg[ci+cj*ACTIVEBKG->Xsize];
-
-					for(long l = 0; l < eg2->nbpoly; l++) {
-						EERIEPOLY *ep2 = &eg2->polydata[l];
-
-						if(fartherThan(Vec2f(bbcenter.x, bbcenter.z), Vec2f(ep2->center.x, ep2->center.z), 120.f))
-							continue;
+	long ii = max(i - 2, 0L);
+	long ij = max(j - 2, 0L);
+	long ai = min(i + 2, ACTIVEBKG->Xsize - 1L);
+	long aj = min(j + 2, ACTIVEBKG->Zsize - 1L);
+
+	EERIE_2D_BBOX bb;
+	bb.min.x = (float)i * ACTIVEBKG->Xdiv - 10;
+	bb.max.x = (float)bb.min.x + ACTIVEBKG->Xdiv + 20;
+	bb.min.y = (float)j * ACTIVEBKG->Zdiv - 10;
+	bb.max.y = (float)bb.min.y + ACTIVEBKG->Zdiv + 20;
+	Vec3f bbcenter;
+	bbcenter.x = (bb.min.x + bb.max.x) * .5f;
+	bbcenter.z = (bb.min.y + bb.max.y) * .5f;
+
+	for(long cj = ij; cj < aj; cj++)
+		for(long ci = ii; ci < ai; ci++) {
+			EERIE_BKG_INFO *eg2 = &ACTIVEBKG->Backg[ci+cj*ACTIVEBKG->Xsize];
+
+			for(long l = 0; l < eg2->nbpoly; l++) {
+				EERIEPOLY *ep2 = &eg2->polydata[l];
+
+				if(fartherThan(Vec2f(bbcenter.x, bbcenter.z), Vec2f(ep2->center.x, ep2->center.z), 120.f))
+					continue;
 
-						long nbvert = (ep2->type & POLY_QUAD) ? 4 : 3;
+				long nbvert = (ep2->type & POLY_QUAD) ? 4 : 3;
 
-						if(PointInBBox(&ep2->center, &bb)) {
+				if(PointInBBox(&ep2->center, &bb)) {
+					EERIEPOLY_Add_PolyIn(eg, ep2);
+				} else {
+					for(long k = 0; k < nbvert; k++) {
+						if(PointInBBox(&ep2->v[k].p, &bb)) {
 							EERIEPOLY_Add_PolyIn(eg, ep2);
+							break;
 						} else {
-							for(long k = 0; k < nbvert; k++) {
-								if(PointInBBox(&ep2->v[k].p, &bb)) {
-									EERIEPOLY_Add_PolyIn(eg, ep2);
-									break;
-								} else {
-									Vec3f pt = (ep2->v[k].p + ep2->center) * .5f;
-									if(PointInBBox(&pt, &bb)) {
-										EERIEPOLY_Add_PolyIn(eg, ep2);
-										break;
-									}
-								}
+							Vec3f pt = (ep2->v[k].p + ep2->center) * .5f;
+							if(PointInBBox(&pt, &bb)) {
+								EERIEPOLY_Add_PolyIn(eg, ep2);
+								break;
 							}
 						}
 					}
 				}
-
-			if(eg->nbpolyin)
-				eg->nothing = 0;
-			else
-				eg->nothing = 1;
+			}
 		}
 
-	for(int j = 0; j < ACTIVEBKG->Zsize; j++)
-		for(long i = 0; i < ACTIVEBKG->Xsize; i++) {
-			EERIE_BKG_INFO *eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
-			eg->tile_miny = 999999999.f;
-			eg->tile_maxy = -999999999.f;
-
-			for(long kk = 0; kk < eg->nbpolyin; kk++) {
-				EERIEPOLY *ep = eg->polyin[kk];
-				eg->tile_miny = min(eg->tile_miny, ep->min.y);
-				eg->tile_maxy = max(eg->tile_maxy, ep->max.y);
-			}
+	if(eg->nbpolyin)
+		eg->nothing = 0;
+	else
+		eg->nothing = 1;
+
+	eg->tile_miny = 999999999.f;
+	eg->tile_maxy = -999999999.f;
+	
+	for(long kk = 0; kk < eg->nbpolyin; kk++) {
+		EERIEPOLY *ep = eg->polyin[kk];
+		eg->tile_miny = min(eg->tile_miny, ep->min.y);
+		eg->tile_maxy = max(eg->tile_maxy, ep->max.y);
+	}
+	
+	FAST_BKG_DATA * fbd = &ACTIVEBKG->fastdata[i][j];
+	fbd->treat = eg->treat;
+	fbd->nothing = eg->nothing;
+	fbd->nbpoly = eg->nbpoly;
+	fbd->nbianchors = eg->nbianchors;
+	fbd->nbpolyin = eg->nbpolyin;
+	fbd->frustrum_miny = eg->frustrum_miny;
+	fbd->frustrum_maxy = eg->frustrum_maxy;
+	fbd->polydata = eg->polydata;
+	fbd->polyin = eg->polyin;
+	fbd->ianchors = eg->ianchors;
+}
+
+namespace {
 
-			FAST_BKG_DATA * fbd = &ACTIVEBKG->fastdata[i][j];
-			fbd->treat = eg->treat;
-			fbd->nothing = eg->nothing;
-			fbd->nbpoly = eg->nbpoly;
-			fbd->nbianchors = eg->nbianchors;
-			fbd->nbpolyin = eg->nbpolyin;
-			fbd->frustrum_miny = eg->frustrum_miny;
-			fbd->frustrum_maxy = eg->frustrum_maxy;
-			fbd->polydata = eg->polydata;
-			fbd->polyin = eg->polyin;
-			fbd->ianchors = eg->ianchors;
+//! Each tile only modifies its own data, so rows can be processed in parallel
+class ComputePolyInTask : public jobs::ParallelTask {
+	
+	void run(size_t begin, size_t end) {
+		for(size_t j = begin; j < end; j++) {
+			for(long i = 0; i < ACTIVEBKG->Xsize; i++) {
+				EERIEPOLY_Compute_PolyIn(i, long(j));
+			}
 		}
+	}
+
+};
+
+} // anonymous namespace
+
+void EERIEPOLY_Compute_PolyIn() {
+	ComputePolyInTask task;
+	jobs::parallelFor(task, ACTIVEBKG->Zsize);
 }
 
 float GetTileMinY(long i, long j) {
@@ -1455,6 +1475,8 @@ void EERIE_PORTAL_Blend_Portals_And_Rooms() {
 
 static void EERIE_PORTAL_Release() {
 	
+	ARX_SCENE_InvalidateRoomVisibility();
+	
 	if(!portals)
 		return;
 	
@@ -1697,8 +1719,200 @@ const T * fts_read(const char * & data, const char * end, size_t n = 1) {
 }
 
 
-static bool loadFastScene(const res::path & file, const char * data,
-                          const char * end);
+namespace {
+
+/*!
+ * Decompresses the scene data on a worker thread.
+ *
+ * The amount of data decompressed so far is published so that the loader can start
+ * working on the beginning of the scene while the rest is still being decompressed.
+ */
+class SceneDecompressJob : public jobs::Job {
+	
+	const char * m_input;
+	size_t m_inputSize;
+	char * m_output;
+	size_t m_outputSize;
+	
+	volatile u32 m_available; //!< Number of bytes decompressed so far
+	volatile u32 m_done;
+	BlastResult m_result;
+	
+	static int write(void * param, unsigned char * buf, size_t len) {
+		
+		SceneDecompressJob & job = *reinterpret_cast<SceneDecompressJob *>(param);
+		
+		size_t available = job.m_available;
+		if(len > job.m_outputSize - available) {
+			return 1;
+		}
+		
+		memcpy(job.m_output + available, buf, len);
+		atomicStore(&job.m_available, u32(available + len));
+		
+		return 0;
+	}
+	
+public:
+	
+	SceneDecompressJob(const char * input, size_t inputSize, char * output,
+	                   size_t outputSize)
+		: m_input(input), m_inputSize(inputSize), m_output(output),
+		  m_outputSize(outputSize), m_available(0), m_done(0), m_result(BLAST_SUCCESS) { }
+	
+	void run() {
+		BlastMemInBuffer in(m_input, m_inputSize);
+		m_result = blast(blastInMem, &in, write, this);
+		atomicStore(&m_done, 1);
+	}
+	
+	const char * data() const { return m_output; }
+	
+	/*!
+	 * Wait until at least size bytes have been decompressed or decompression has ended.
+	 * @return the end of the available data
+	 */
+	const char * waitFor(size_t size) const {
+		while(atomicLoad(&m_available) < size && !atomicLoad(&m_done)) {
+			Thread::sleep(1);
+		}
+		return m_output + atomicLoad(&m_available);
+	}
+	
+	//! Must only be called after jobs::wait() has returned for this job
+	BlastResult result() const { return m_result; }
+	
+	//! Must only be called after jobs::wait() has returned for this job
+	size_t size() const { return m_available; }
+	
+	size_t capacity() const { return m_outputSize; }
+	
+};
+
+typedef std::map<s32, TextureContainer *> TextureContainerMap;
+
+void loadSceneCell(EERIE_BKG_INFO & bkg, const FAST_SCENE_INFO * fsi,
+                   const TextureContainerMap & textures) {
+	
+	bkg.nbianchors = (short)fsi->nbianchors;
+	bkg.nbpoly = (short)fsi->nbpoly;
+	
+	if(fsi->nbpoly > 0) {
+		bkg.polydata = (EERIEPOLY *)malloc(sizeof(EERIEPOLY) * fsi->nbpoly);
+	} else {
+		bkg.polydata = NULL;
+	}
+	
+	bkg.treat = 0;
+	bkg.nothing = fsi->nbpoly ? 0 : 1;
+	
+	bkg.frustrum_maxy = -99999999.f;
+	bkg.frustrum_miny = 99999999.f;
+	
+	// The cell data has already been validated by the caller
+	const FAST_EERIEPOLY * eps = reinterpret_cast<const FAST_EERIEPOLY *>(fsi + 1);
+	for(long k = 0; k < fsi->nbpoly; k++) {
+		
+		const FAST_EERIEPOLY * ep = &eps[k];
+		EERIEPOLY * ep2 = &bkg.polydata[k];
+		
+		memset(ep2, 0, sizeof(EERIEPOLY));
+		
+		ep2->room = ep->room;
+		ep2->area = ep->area;
+		ep2->norm = ep->norm;
+		ep2->norm2 = ep->norm2;
+		copy(ep->nrml, ep->nrml + 4, ep2->nrml);
+		
+		if(ep->tex != 0) {
+			TextureContainerMap::const_iterator cit = textures.find(ep->tex);
+			ep2->tex = (cit != textures.end()) ? cit->second : NULL;
+		} else {
+			ep2->tex = NULL;
+		}
+		
+		ep2->transval = ep->transval;
+		ep2->type = PolyType::load(ep->type);
+		
+		for(size_t kk = 0; kk < 4; kk++) {
+			ep2->v[kk].color = 0xFFFFFFFF;
+			ep2->v[kk].rhw = 1;
+			ep2->v[kk].specular = 1;
+			ep2->v[kk].p.x = ep->v[kk].ssx;
+			ep2->v[kk].p.y = ep->v[kk].sy;
+			ep2->v[kk].p.z = ep->v[kk].ssz;
+			ep2->v[kk].uv.x = ep->v[kk].stu;
+			ep2->v[kk].uv.y = ep->v[kk].stv;
+		}
+		
+		memcpy(ep2->tv, ep2->v, sizeof(TexturedVertex) * 4);
+		
+		for(size_t kk = 0; kk < 4; kk++) {
+			ep2->tv[kk].color = 0xFF000000;
+		}
+		
+		long to = (ep->type & POLY_QUAD) ? 4 : 3;
+		float div = 1.f / to;
+		
+		ep2->center = Vec3f::ZERO;
+		for(long h = 0; h < to; h++) {
+			ep2->center += ep2->v[h].p;
+			if(h != 0) {
+				ep2->max = componentwise_max(ep2->max, ep2->v[h].p);
+				ep2->min = componentwise_min(ep2->min, ep2->v[h].p);
+			} else {
+				ep2->min = ep2->max = ep2->v[0].p;
+			}
+		}
+		ep2->center *= div;
+		
+		float dist = 0.f;
+		for(int h = 0; h < to; h++) {
+			float x = ep2->v[h].p.x - ep2->center.x;
+			float y = ep2->v[h].p.y - ep2->center.y;
+			float z = ep2->v[h].p.z - ep2->center.z;
+			float d = sqrt((x * x) + (y * y) + (z * z));
+			dist = max(dist, d);
+		}
+		ep2->v[0].rhw = dist;
+		
+		// The nothing flag of the cells touched by this polygon is set by
+		// EERIEPOLY_Compute_PolyIn() once all cells have been loaded.
+	}
+	
+	if(fsi->nbianchors <= 0) {
+		bkg.ianchors = NULL;
+	} else {
+		bkg.ianchors = (long *)malloc(sizeof(long) * fsi->nbianchors);
+		const s32 * anchors = reinterpret_cast<const s32 *>(eps + fsi->nbpoly);
+		std::copy(anchors, anchors + fsi->nbianchors, bkg.ianchors);
+	}
+	
+}
+
+//! Cells only reference their own part of the scene data and can be loaded in parallel
+class LoadSceneCellsTask : public jobs::ParallelTask {
+	
+	const FAST_SCENE_INFO * const * m_cells;
+	const TextureContainerMap & m_textures;
+	
+public:
+	
+	LoadSceneCellsTask(const FAST_SCENE_INFO * const * cells,
+	                   const TextureContainerMap & textures)
+		: m_cells(cells), m_textures(textures) { }
+	
+	void run(size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			loadSceneCell(ACTIVEBKG->Backg[i], m_cells[i], m_textures);
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+static bool loadFastScene(const res::path & file, SceneDecompressJob & job);
 
 template <typename T>
 class scoped_malloc {
@@ -1718,28 +1932,31 @@ public:
 
 bool FastSceneLoad(const res::path & partial_path) {
 	
+	ARX_LOAD_PHASE(LoadScene);
+	
 	res::path file = "game" / partial_path / "fast.fts";
 	
 	const char * data = NULL, * end = NULL;
 	boost::scoped_array<char> bytes;
 	
+	// Load the whole file
+	LogDebug("Loading " << file);
+	size_t size;
+	scoped_malloc<char> dat(resources->readAlloc(file, size));
+	data = dat.get(), end = dat.get() + size;
+	// TODO use new[] instead of malloc so we can use (boost::)unique_ptr
+	LogDebug("FTS: read " << size << " bytes");
+	if(!data) {
+		LogError << "FTS: could not read " << file;
+		return false;
+	}
+	
+	const UNIQUE_HEADER * uh;
+	
 	try {
 		
-		// Load the whole file
-		LogDebug("Loading " << file);
-		size_t size;
-		scoped_malloc<char> dat(resources->readAlloc(file, size));
-		data = dat.get(), end = dat.get() + size;
-		// TODO use new[] instead of malloc so we can use (boost::)unique_ptr
-		LogDebug("FTS: read " << size << " bytes");
-		if(!data) {
-			LogError << "FTS: could not read " << file;
-			return false;
-		}
-		
-		
 		// Read the file header
-		const UNIQUE_HEADER * uh = fts_read<UNIQUE_HEADER>(data, end);
+		uh = fts_read<UNIQUE_HEADER>(data, end);
 		if(uh->version != FTS_VERSION) {
 			LogError << "FTS version mismatch: got " << uh->version << ", expected "
 			         << FTS_VERSION << " in " << file;
@@ -1753,43 +1970,49 @@ bool FastSceneLoad(const res::path & partial_path) {
 		InitBkg(ACTIVEBKG, MAX_BKGX, MAX_BKGZ, BKG_SIZX, BKG_SIZZ);
 		PROGRESS_BAR_COUNT += 1.f, LoadLevelScreen();
 		
-		
-		// Decompress the actual scene data
-		size_t input_size = end - data;
-		LogDebug("FTS: decompressing " << input_size << " -> "
-		                               << uh->uncompressedsize);
-		bytes.reset(new char[uh->uncompressedsize]);
-		if(!bytes) {
-			LogError << "FTS: can't allocate buffer for uncompressed data";
-			return false;
-		}
-		size = blastMem(data, input_size, bytes.get(), uh->uncompressedsize);
-		data = bytes.get(), end = bytes.get() + size;
-		if(!size) {
-			LogError << "FTS: error decompressing scene data in " << file;
-			return false;
-		} else if(size != size_t(uh->uncompressedsize)) {
-			LogWarning << "FTS: unexpected decompressed size: " << size << " < "
-			           << uh->uncompressedsize << " in " << file;
-		}
-		PROGRESS_BAR_COUNT += 3.f, LoadLevelScreen();
-		
-		
 	} catch(file_truncated_exception) {
 		LogError << "FTS: truncated file " << file;
 		return false;
 	}
 	
+	
+	// Decompress the actual scene data in the background
+	size_t input_size = end - data;
+	LogDebug("FTS: decompressing " << input_size << " -> "
+	                               << uh->uncompressedsize);
+	bytes.reset(new char[uh->uncompressedsize]);
+	if(!bytes) {
+		LogError << "FTS: can't allocate buffer for uncompressed data";
+		return false;
+	}
+	SceneDecompressJob job(data, input_size, bytes.get(), uh->uncompressedsize);
+	jobs::submit(job);
+	
+	bool result = false, truncated = false;
 	try {
-		return loadFastScene(file, data, end);
+		result = loadFastScene(file, job);
 	} catch(file_truncated_exception) {
-		LogError << "FTS: truncated compressed data in " << file;
+		truncated = true;
+	}
+	
+	// The job references the buffers and must be finished before returning
+	jobs::wait(job);
+	
+	if(job.result() != BLAST_SUCCESS) {
+		LogError << "FTS: error decompressing scene data in " << file;
 		return false;
+	} else if(truncated) {
+		LogError << "FTS: truncated compressed data in " << file;
 	}
+	
+	return result;
 }
 
 
-static bool loadFastScene(const res::path & file, const char * data, const char * end) {
+static bool loadFastScene(const res::path & file, SceneDecompressJob & job) {
+	
+	const char * data = job.data();
+	const char * end = job.waitFor(sizeof(FAST_SCENE_HEADER));
 	
 	// Read the scene header
 	const FAST_SCENE_HEADER * fsh = fts_read<FAST_SCENE_HEADER>(data, end);
@@ -1806,8 +2029,9 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 	Mscenepos = fsh->Mscenepos;
 	
 	
-	// Load textures
-	typedef std::map<s32, TextureContainer *> TextureContainerMap;
+	// Load textures while the rest of the scene is being decompressed
+	end = job.waitFor((data - job.data())
+	                  + sizeof(FAST_TEXTURE_CONTAINER) * fsh->nb_textures);
 	TextureContainerMap textures;
 	const FAST_TEXTURE_CONTAINER * ftc;
 	ftc = fts_read<FAST_TEXTURE_CONTAINER>(data, end, fsh->nb_textures);
@@ -1822,117 +2046,32 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 	PROGRESS_BAR_COUNT += 4.f, LoadLevelScreen();
 	
 	
+	// Wait for the rest of the scene data
+	jobs::wait(job);
+	if(job.result() != BLAST_SUCCESS) {
+		return false;
+	} else if(job.size() != job.capacity()) {
+		LogWarning << "FTS: unexpected decompressed size: " << job.size() << " < "
+		           << job.capacity() << " in " << file;
+	}
+	end = job.data() + job.size();
+	PROGRESS_BAR_COUNT += 3.f, LoadLevelScreen();
+	
+	
 	// Load cells with polygons and anchors
 	LogDebug("FTS: loading " << fsh->sizex << " x " << fsh->sizez
 	         << " cells ...");
-	for(long j = 0; j < fsh->sizez; j++) {
-		for(long i = 0; i < fsh->sizex; i++) {
-			
-			const FAST_SCENE_INFO * fsi = fts_read<FAST_SCENE_INFO>(data, end);
-			
-			EERIE_BKG_INFO & bkg = ACTIVEBKG->Backg[i + (j * fsh->sizex)];
-			
-			bkg.nbianchors = (short)fsi->nbianchors;
-			bkg.nbpoly = (short)fsi->nbpoly;
-			
-			if(fsi->nbpoly > 0) {
-				bkg.polydata = (EERIEPOLY *)malloc(sizeof(EERIEPOLY) * fsi->nbpoly);
-			} else {
-				bkg.polydata = NULL;
-			}
-			
-			bkg.treat = 0;
-			bkg.nothing = fsi->nbpoly ? 0 : 1;
-			
-			bkg.frustrum_maxy = -99999999.f;
-			bkg.frustrum_miny = 99999999.f;
-			
-			const FAST_EERIEPOLY * eps;
-			eps = fts_read<FAST_EERIEPOLY>(data, end, fsi->nbpoly);
-			for(long k = 0; k < fsi->nbpoly; k++) {
-				
-				const FAST_EERIEPOLY * ep = &eps[k];
-				EERIEPOLY * ep2 = &bkg.polydata[k];
-				
-				memset(ep2, 0, sizeof(EERIEPOLY));
-				
-				ep2->room = ep->room;
-				ep2->area = ep->area;
-				ep2->norm = ep->norm;
-				ep2->norm2 = ep->norm2;
-				copy(ep->nrml, ep->nrml + 4, ep2->nrml);
-				
-				if(ep->tex != 0) {
-					TextureContainerMap::const_iterator cit = textures.find(ep->tex);
-					ep2->tex = (cit != textures.end()) ? cit->second : NULL;
-				} else {
-					ep2->tex = NULL;
-				}
-				
-				ep2->transval = ep->transval;
-				ep2->type = PolyType::load(ep->type);
-				
-				for(size_t kk = 0; kk < 4; kk++) {
-					ep2->v[kk].color = 0xFFFFFFFF;
-					ep2->v[kk].rhw = 1;
-					ep2->v[kk].specular = 1;
-					ep2->v[kk].p.x = ep->v[kk].ssx;
-					ep2->v[kk].p.y = ep->v[kk].sy;
-					ep2->v[kk].p.z = ep->v[kk].ssz;
-					ep2->v[kk].uv.x = ep->v[kk].stu;
-					ep2->v[kk].uv.y = ep->v[kk].stv;
-				}
-				
-				memcpy(ep2->tv, ep2->v, sizeof(TexturedVertex) * 4);
-				
-				for(size_t kk = 0; kk < 4; kk++) {
-					ep2->tv[kk].color = 0xFF000000;
-				}
-				
-				long to = (ep->type & POLY_QUAD) ? 4 : 3;
-				float div = 1.f / to;
-				
-				ep2->center = Vec3f::ZERO;
-				for(long h = 0; h < to; h++) {
-					ep2->center += ep2->v[h].p;
-					if(h != 0) {
-						ep2->max = componentwise_max(ep2->max, ep2->v[h].p);
-						ep2->min = componentwise_min(ep2->min, ep2->v[h].p);
-					} else {
-						ep2->min = ep2->max = ep2->v[0].p;
-					}
-				}
-				ep2->center *= div;
-				
-				float dist = 0.f;
-				for(int h = 0; h < to; h++) {
-					float x = ep2->v[h].p.x - ep2->center.x;
-					float y = ep2->v[h].p.y - ep2->center.y;
-					float z = ep2->v[h].p.z - ep2->center.z;
-					float d = sqrt((x * x) + (y * y) + (z * z));
-					dist = max(dist, d);
-				}
-				ep2->v[0].rhw = dist;
-				
-				DeclareEGInfo(ep2->center.x, ep2->center.z);
-				DeclareEGInfo(ep2->v[0].p.x, ep2->v[0].p.z);
-				DeclareEGInfo(ep2->v[1].p.x, ep2->v[1].p.z);
-				DeclareEGInfo(ep2->v[2].p.x, ep2->v[2].p.z);
-				if(ep->type & POLY_QUAD) {
-					DeclareEGInfo(ep2->v[3].p.x, ep2->v[3].p.z);
-				}
-			}
-			
-			if(fsi->nbianchors <= 0) {
-				bkg.ianchors = NULL;
-			} else {
-				bkg.ianchors = (long *)malloc(sizeof(long) * fsi->nbianchors);
-				const s32 * anchors = fts_read<s32>(data, end, fsi->nbianchors);
-				std::copy(anchors, anchors + fsi->nbianchors, bkg.ianchors);
-			}
-			
+	std::vector<const FAST_SCENE_INFO *> cells(fsh->sizex * fsh->sizez);
+	for(size_t i = 0; i < cells.size(); i++) {
+		const FAST_SCENE_INFO * fsi = fts_read<FAST_SCENE_INFO>(data, end);
+		(void)fts_read<FAST_EERIEPOLY>(data, end, fsi->nbpoly);
+		if(fsi->nbianchors > 0) {
+			(void)fts_read<s32>(data, end, fsi->nbianchors);
 		}
+		cells[i] = fsi;
 	}
+	LoadSceneCellsTask loadCells(&cells[0], textures);
+	jobs::parallelFor(loadCells, cells.size(), 64);
 	PROGRESS_BAR_COUNT += 4.f, LoadLevelScreen();
 	
 	
@@ -2127,6 +2266,61 @@ void EERIEPOLY_FillMissingVertex(EERIEPOLY * po, EERIEPOLY * ep)
 
 #ifdef BUILD_EDIT_LOADSAVE
 
+namespace {
+
+//! Finds the paths from one room to all other rooms, only writes to that room's row
+class ComputeRoomDistanceTask : public jobs::ParallelTask {
+	
+	const PathFinder & m_pathfinder;
+	const ANCHOR_DATA * m_ad;
+	
+public:
+	
+	ComputeRoomDistanceTask(const PathFinder & pathfinder, const ANCHOR_DATA * ad)
+		: m_pathfinder(pathfinder), m_ad(ad) { }
+	
+	void run(size_t begin, size_t end) {
+		for(long i = long(begin); i < long(end); i++) {
+			computeRoomDistances(i);
+		}
+	}
+	
+	void computeRoomDistances(long i) {
+		
+		const ANCHOR_DATA * ad = m_ad;
+		
+		for(long j = 0; j < NbRoomDistance; j++) {
+			if(i == j) {
+				SetRoomDistance(i, j, -1, NULL, NULL);
+				continue;
+			}
+			
+			PathFinder::Result rl;
+
+			bool found = m_pathfinder.move(i, j, rl);
+
+			if(found) {
+				float d = 0.f;
+
+				for(size_t id = 1; id < rl.size() - 1; id++) {
+					d += dist(ad[rl[id - 1]].pos, ad[rl[id]].pos);
+				}
+
+				if(d < 0.f)
+					d = 0.f;
+
+				float old = GetRoomDistance(i, j, NULL, NULL);
+
+				if((d < old || old < 0.f) && rl.size() >= 2)
+					SetRoomDistance(i, j, d, &ad[rl[1]].pos, &ad[rl[rl.size()-2]].pos);
+			}
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
 void ComputeRoomDistance() {
 	
 	free(RoomDistance), RoomDistance = NULL;
@@ -2227,34 +2421,8 @@ void ComputeRoomDistance() {
 
 	PathFinder pathfinder(NbRoomDistance, ad, 0, NULL);
 
-	for(int i = 0; i < NbRoomDistance; i++) {
-		for(long j = 0; j < NbRoomDistance; j++) {
-			if(i == j) {
-				SetRoomDistance(i, j, -1, NULL, NULL);
-				continue;
-			}
-			
-			PathFinder::Result rl;
-
-			bool found = pathfinder.move(i, j, rl);
-
-			if(found) {
-				float d = 0.f;
-
-				for(size_t id = 1; id < rl.size() - 1; id++) {
-					d += dist(ad[rl[id - 1]].pos, ad[rl[id]].pos);
-				}
-
-				if(d < 0.f)
-					d = 0.f;
-
-				float old = GetRoomDistance(i, j, NULL, NULL);
-
-				if((d < old || old < 0.f) && rl.size() >= 2)
-					SetRoomDistance(i, j, d, &ad[rl[1]].pos, &ad[rl[rl.size()-2]].pos);
-			}
-		}
-	}
+	ComputeRoomDistanceTask task(pathfinder, ad);
+	jobs::parallelFor(task, NbRoomDistance);
 
 	// Don't use this for contiguous rooms !
 	for(int i = 0; i < portals->nb_total; i++) {
@@ -2894,7 +3062,7 @@ void SceneAddMultiScnToBackground(EERIE_MULTI3DSCENE * ms) {
 		EERIEPOLY_Compute_PolyIn();
 		EERIE_PORTAL_Blend_Portals_And_Rooms();
 		
-		AnchorData_Create(ACTIVEBKG);
+		AnchorData_Create(ACTIVEBKG, fs::paths.user / "cache" / "anchors");
 		
 		FastSceneSave(ftemp.string());
 		ComputePortalVertexBuffer();
@@ -275,9 +275,13 @@ struct EERIE_FRUSTRUM_PLANE
 	float	d; // dist to origin
 };
 
+//! Four planes, stored per component so that they can be tested together
 struct EERIE_FRUSTRUM
 {
-	EERIE_FRUSTRUM_PLANE plane[4];
+	float a[4];
+	float b[4];
+	float c[4];
+	float d[4]; // dist to origin
 };
 
 struct EERIE_FRUSTRUM_DATA
@@ -46,6 +46,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "graphics/effects/DrawEffects.h"
 
+#include <vector>
+
 #include "animation/AnimationRender.h"
 
 #include "core/Application.h"
@@ -253,18 +255,17 @@ void EERIEDrawLight(EERIE_LIGHT * el)
 }
 
 void ARXDRAW_DrawAllLights(long x0,long z0,long x1,long z1) {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		EERIE_LIGHT *light = GLight[i];
+	const std::vector<size_t> & lights = EERIE_LIGHT_GetAll();
+	for(size_t i = 0; i < lights.size(); i++) {
+		EERIE_LIGHT *light = GLight[lights[i]];
 
-		if(light) {
-			long tx = light->pos.x * ACTIVEBKG->Xmul;
-			long tz = light->pos.z * ACTIVEBKG->Zmul;
-			light->mins.x = 9999999999.f;
+		long tx = light->pos.x * ACTIVEBKG->Xmul;
+		long tz = light->pos.z * ACTIVEBKG->Zmul;
+		light->mins.x = 9999999999.f;
 
-			if(tx >= x0 && tx <= x1 && tz >= z0 && tz <= z1)  {
-				light->treat = 1;
-				EERIEDrawLight(light);
-			}
+		if(tx >= x0 && tx <= x1 && tz >= z0 && tz <= z1)  {
+			light->treat = 1;
+			EERIEDrawLight(light);
 		}
 	}
 }
@@ -19,6 +19,7 @@
 
 #include "graphics/font/Font.h"
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <iterator>
@@ -40,6 +41,16 @@
 //! Pre-load all visible characters below this one when creating a font object
 static const Font::Char FONT_PRELOAD_LIMIT = 127;
 
+//! Maximum number of text layouts cached per font
+static const size_t FONT_LAYOUT_CACHE_SIZE = 256;
+
+//! Maximum number of glyphs drawn in one call - indices are 16-bit
+static const size_t TEXT_BATCH_MAX_QUADS = 65536 / 4;
+
+static Font::Stats stats = Font::Stats();
+
+TextBatch * TextBatch::active = NULL;
+
 Font::Font(const res::path & fontFile, unsigned int fontSize, FT_Face face) 
 	: info(fontFile, fontSize)
 	, referenceCount(0)
@@ -251,45 +262,31 @@ Font::glyph_iterator Font::getNextGlyph(text_iterator & it, text_iterator end) {
 	return glyphs.find(chr); // the newly inserted glyph
 }
 
-template <bool DoDraw>
-Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color color) {
+int Font::getKerning(unsigned int left, unsigned int right) {
 	
-	if(DoDraw) {
-		
-		GRenderer->SetRenderState(Renderer::Lighting, false);
-		GRenderer->SetRenderState(Renderer::AlphaBlending, true);
-		GRenderer->SetBlendFunc(Renderer::BlendSrcAlpha, Renderer::BlendInvSrcAlpha);
-		
-		GRenderer->SetRenderState(Renderer::DepthTest, false);
-		GRenderer->SetRenderState(Renderer::DepthWrite, false);
-		GRenderer->SetCulling(Renderer::CullNone);
-		
-		// 2D projection setup... Put origin (0,0) in the top left corner like GDI...
-		Rect viewport = GRenderer->GetViewport();
-		GRenderer->Begin2DProjection(viewport.left, viewport.right,
-		                             viewport.bottom, viewport.top, -1.f, 1.f);
-		
-		// Fixed pipeline texture stage operation
-		GRenderer->GetTextureStage(0)->SetColorOp(TextureStage::ArgDiffuse);
-		GRenderer->GetTextureStage(0)->SetAlphaOp(TextureStage::ArgTexture);
-		
-		GRenderer->GetTextureStage(0)->SetWrapMode(TextureStage::WrapClamp);
-		GRenderer->GetTextureStage(0)->SetMinFilter(TextureStage::FilterNearest);
-		GRenderer->GetTextureStage(0)->SetMagFilter(TextureStage::FilterNearest);
+	std::pair<unsigned int, unsigned int> key(left, right);
 		
+	KerningCache::const_iterator it = kerning.find(key);
+	if(it != kerning.end()) {
+		return it->second;
 	}
 	
-	float penX = x;
-	float penY = y;
+	FT_Vector delta;
+	FT_Get_Kerning(face, left, right, FT_KERNING_DEFAULT, &delta);
+	
+	int pixels = int(delta.x >> 6);
+	kerning[key] = pixels;
+	
+	return pixels;
+}
+
+Vec2i Font::layout(text_iterator start, text_iterator end, std::vector<Layout::Quad> * quads) {
+	
+	float penX = 0.f;
 	
 	int startX = 0;
 	int endX = 0;
 	
-	if(DoDraw) {
-		// Subtract one line height (since we flipped the Y origin to be like GDI)
-		penY += face->size->metrics.ascender >> 6;
-	}
-	
 	FT_UInt prevGlyphIndex = 0;
 	FT_Pos prevRsbDelta = 0;
 	
@@ -305,9 +302,7 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		// Kerning
 		if(FT_HAS_KERNING(face)) {
 			if(prevGlyphIndex != 0) {
-				FT_Vector delta;
-				FT_Get_Kerning(face, prevGlyphIndex, glyph.index, FT_KERNING_DEFAULT, &delta);
-				penX += delta.x >> 6;
+				penX += getKerning(prevGlyphIndex, glyph.index);
 			}
 			prevGlyphIndex = glyph.index;
 		}
@@ -320,16 +315,11 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		}
 		prevRsbDelta = glyph.rsb_delta;
 		
-		// Draw
-		if(DoDraw && glyph.size.x != 0 && glyph.size.y != 0) {
-			GRenderer->SetTexture(0, &textures->getTexture(glyph.texture));
-			GRenderer->DrawTexturedRect(
-				((int)penX) + glyph.draw_offset.x, ((int)penY) - glyph.draw_offset.y,
-				glyph.size.x, -glyph.size.y, glyph.uv_start.x, glyph.uv_end.y, glyph.uv_end.x,
-				glyph.uv_start.y, color
-			);
-		} else {
-			ARX_UNUSED(penY), ARX_UNUSED(color);
+		if(quads && glyph.size.x != 0 && glyph.size.y != 0) {
+			Layout::Quad quad;
+			quad.pen = penX;
+			quad.glyph = &glyph;
+			quads->push_back(quad);
 		}
 		
 		// If this is the first drawn char, note the start position
@@ -342,38 +332,206 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		penX += glyph.advance.x;
 	}
 	
-	if(DoDraw) {
-		
-		GRenderer->ResetTexture(0);
-		TextureStage * stage = GRenderer->GetTextureStage(0);
-		stage->SetColorOp(TextureStage::OpModulate,
-		                  TextureStage::ArgTexture, TextureStage::ArgCurrent);
-		stage->SetAlphaOp(TextureStage::ArgTexture);
-		stage->SetWrapMode(TextureStage::WrapRepeat);
-		stage->SetMinFilter(TextureStage::FilterLinear);
-		stage->SetMagFilter(TextureStage::FilterLinear);
-		
-		GRenderer->End2DProjection();
-		GRenderer->SetRenderState(Renderer::AlphaBlending, false);
-		GRenderer->SetRenderState(Renderer::DepthWrite, true);
-		GRenderer->SetCulling(Renderer::CullCCW);
-		
-	}
-	
 	int sizeX = endX - startX;
 	int sizeY = face->size->metrics.height >> 6;
 	
 	return Vec2i(sizeX, sizeY);
 }
 
+const Font::Layout & Font::getLayout(text_iterator start, text_iterator end) {
+	
+	std::string text(start, end);
+	
+	LayoutIndex::iterator it = layoutIndex.find(text);
+	if(it != layoutIndex.end()) {
+		stats.layoutHits++;
+		layouts.splice(layouts.begin(), layouts, it->second);
+		return it->second->second;
+	}
+	
+	stats.layoutMisses++;
+	
+	layouts.push_front(std::make_pair(text, Layout()));
+	Layout & result = layouts.front().second;
+	result.size = layout(start, end, &result.quads);
+	layoutIndex[text] = layouts.begin();
+	
+	if(layoutIndex.size() > FONT_LAYOUT_CACHE_SIZE) {
+		layoutIndex.erase(layouts.back().first);
+		layouts.pop_back();
+	}
+	
+	return result;
+}
+
 void Font::draw(int x, int y, text_iterator start, text_iterator end, Color color) {
-	process<true>(x, y, start, end, color);
+	
+	const Layout & text = getLayout(start, end);
+	
+	if(TextBatch::active) {
+		TextBatch::active->add(*this, text, x, y, color);
+	} else {
+		TextBatch batch;
+		batch.add(*this, text, x, y, color);
+	}
 }
 
 Vec2i Font::getTextSize(text_iterator start, text_iterator end) {
-	return process<false>(0, 0, start, end, Color::none);
+	// Not cached: text wrapping measures every prefix of a line
+	return layout(start, end, NULL);
 }
 
 int Font::getLineHeight() const {
 	return face->size->metrics.height >> 6;
 }
+
+const Font::Stats & Font::getStats() {
+	return stats;
+}
+
+void Font::resetStats() {
+	stats = Stats();
+}
+
+TextBatch::TextBatch() : previous(active) {
+	active = this;
+}
+
+TextBatch::~TextBatch() {
+	flush();
+	arx_assert(active == this);
+	active = previous;
+}
+
+void TextBatch::flushActive() {
+	if(active) {
+		active->flush();
+	}
+}
+
+void TextBatch::add(Font & font, const Font::Layout & layout, int x, int y, Color color) {
+	
+	stats.strings++;
+	
+	// Subtract one line height (since we flipped the Y origin to be like GDI)
+	int penY = y + (font.face->size->metrics.ascender >> 6);
+	
+	ColorBGRA col = color.toBGR();
+	ColorBGRA specular = Color::black.toBGR();
+	
+	Texture2D * texture = NULL;
+	Vertices * vertices = NULL;
+	
+	for(size_t i = 0; i < layout.quads.size(); i++) {
+		
+		const Font::Glyph & glyph = *layout.quads[i].glyph;
+		
+		Texture2D * glyphTexture = &font.textures->getTexture(glyph.texture);
+		if(glyphTexture != texture) {
+			texture = glyphTexture;
+			vertices = NULL;
+			for(Pages::iterator page = pages.begin(); page != pages.end(); ++page) {
+				if(page->first == texture) {
+					vertices = &page->second;
+					break;
+				}
+			}
+			if(!vertices) {
+				pages.push_back(std::make_pair(texture, Vertices()));
+				vertices = &pages.back().second;
+			}
+		}
+		
+		// Same pixel offset as Renderer::DrawTexturedRect()
+		float x0 = float(int(float(x) + layout.quads[i].pen) + glyph.draw_offset.x) - .5f;
+		float y0 = float(penY - glyph.draw_offset.y) - .5f;
+		float x1 = x0 + float(glyph.size.x);
+		float y1 = y0 - float(glyph.size.y);
+		
+		vertices->push_back(TexturedVertex(Vec3f(x0, y0, 0.f), 1.f, col, specular,
+		                                   Vec2f(glyph.uv_start.x, glyph.uv_end.y)));
+		vertices->push_back(TexturedVertex(Vec3f(x1, y0, 0.f), 1.f, col, specular,
+		                                   Vec2f(glyph.uv_end.x, glyph.uv_end.y)));
+		vertices->push_back(TexturedVertex(Vec3f(x1, y1, 0.f), 1.f, col, specular,
+		                                   Vec2f(glyph.uv_end.x, glyph.uv_start.y)));
+		vertices->push_back(TexturedVertex(Vec3f(x0, y1, 0.f), 1.f, col, specular,
+		                                   Vec2f(glyph.uv_start.x, glyph.uv_start.y)));
+	}
+}
+
+//! Indices for a list of quads drawn as two triangles each
+static unsigned short * getQuadIndices(size_t count) {
+	
+	static std::vector<unsigned short> indices;
+	
+	for(size_t i = indices.size() / 6; i < count; i++) {
+		unsigned short base = static_cast<unsigned short>(i * 4);
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+	
+	return &indices[0];
+}
+
+void TextBatch::flush() {
+	
+	if(pages.empty()) {
+		return;
+	}
+	
+	GRenderer->SetRenderState(Renderer::Lighting, false);
+	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
+	GRenderer->SetBlendFunc(Renderer::BlendSrcAlpha, Renderer::BlendInvSrcAlpha);
+	
+	GRenderer->SetRenderState(Renderer::DepthTest, false);
+	GRenderer->SetRenderState(Renderer::DepthWrite, false);
+	GRenderer->SetCulling(Renderer::CullNone);
+	
+	// 2D projection setup... Put origin (0,0) in the top left corner like GDI...
+	Rect viewport = GRenderer->GetViewport();
+	GRenderer->Begin2DProjection(viewport.left, viewport.right,
+	                             viewport.bottom, viewport.top, -1.f, 1.f);
+	
+	// Fixed pipeline texture stage operation
+	GRenderer->GetTextureStage(0)->SetColorOp(TextureStage::ArgDiffuse);
+	GRenderer->GetTextureStage(0)->SetAlphaOp(TextureStage::ArgTexture);
+	
+	GRenderer->GetTextureStage(0)->SetWrapMode(TextureStage::WrapClamp);
+	GRenderer->GetTextureStage(0)->SetMinFilter(TextureStage::FilterNearest);
+	GRenderer->GetTextureStage(0)->SetMagFilter(TextureStage::FilterNearest);
+	
+	for(Pages::iterator page = pages.begin(); page != pages.end(); ++page) {
+		
+		GRenderer->SetTexture(0, page->first);
+		
+		Vertices & vertices = page->second;
+		size_t count = vertices.size() / 4;
+		for(size_t i = 0; i < count; i += TEXT_BATCH_MAX_QUADS) {
+			size_t n = std::min(count - i, TEXT_BATCH_MAX_QUADS);
+			GRenderer->drawIndexed(Renderer::TriangleList, &vertices[i * 4], n * 4,
+			                       getQuadIndices(n), n * 6);
+			stats.drawCalls++;
+			stats.glyphs += n;
+		}
+	}
+	
+	pages.clear();
+	
+	GRenderer->ResetTexture(0);
+	TextureStage * stage = GRenderer->GetTextureStage(0);
+	stage->SetColorOp(TextureStage::OpModulate,
+	                  TextureStage::ArgTexture, TextureStage::ArgCurrent);
+	stage->SetAlphaOp(TextureStage::ArgTexture);
+	stage->SetWrapMode(TextureStage::WrapRepeat);
+	stage->SetMinFilter(TextureStage::FilterLinear);
+	stage->SetMagFilter(TextureStage::FilterLinear);
+	
+	GRenderer->End2DProjection();
+	GRenderer->SetRenderState(Renderer::AlphaBlending, false);
+	GRenderer->SetRenderState(Renderer::DepthWrite, true);
+	GRenderer->SetCulling(Renderer::CullCCW);
+}
@@ -20,16 +20,23 @@
 #ifndef ARX_GRAPHICS_FONT_FONT_H
 #define ARX_GRAPHICS_FONT_FONT_H
 
+#include <stddef.h>
 #include <string>
+#include <list>
 #include <map>
+#include <utility>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
 #include "graphics/Color.h"
+#include "graphics/Vertex.h"
 #include "math/Vector2.h"
 
 #include "io/resource/ResourcePath.h"
 
+class Texture2D;
+
 class Font : private boost::noncopyable {
 	
 	friend class FontCache;
@@ -92,6 +99,37 @@ public:
 		
 	};
 	
+	//! Pre-kerned glyph positions of a string
+	struct Layout {
+		
+		struct Quad {
+			
+			//! Horizontal pen position relative to the start of the string
+			float pen;
+			
+			const Glyph * glyph;
+			
+		};
+		
+		//! Visible glyphs only
+		std::vector<Quad> quads;
+		
+		Vec2i size;
+		
+	};
+	
+	//! Text statistics for all fonts since the last call to resetStats()
+	struct Stats {
+		size_t strings; //!< Number of strings drawn
+		size_t glyphs; //!< Number of glyph quads drawn
+		size_t drawCalls; //!< Number of draw calls used for the glyphs
+		size_t layoutHits; //!< Strings drawn from the layout cache
+		size_t layoutMisses; //!< Strings that had to be laid out
+	};
+	
+	static const Stats & getStats();
+	static void resetStats();
+	
 public:
 	
 	typedef u32 Char;
@@ -151,8 +189,21 @@ private:
 	
 private:
 	
-	template <bool Draw>
-	Vec2i process(int pX, int pY, text_iterator start, text_iterator end, Color color);
+	/*!
+	 * Compute the glyph positions of the string [start, end)
+	 * @param quads If not NULL, receives the visible glyphs.
+	 * @return the size of the string
+	 */
+	Vec2i layout(text_iterator start, text_iterator end, std::vector<Layout::Quad> * quads);
+	
+	/*!
+	 * Get the layout for a string that is about to be drawn.
+	 * The result is cached until it is pushed out by newer strings.
+	 */
+	const Layout & getLayout(text_iterator start, text_iterator end);
+	
+	//! Kerning between two glyphs in pixels
+	int getKerning(unsigned int left, unsigned int right);
 	
 	Info info;
 	unsigned int referenceCount;
@@ -170,6 +221,56 @@ private:
 	
 	class PackedTexture * textures;
 	
+	//! Text layouts, most recently used first
+	typedef std::list<std::pair<std::string, Layout> > Layouts;
+	typedef std::map<std::string, Layouts::iterator> LayoutIndex;
+	Layouts layouts;
+	LayoutIndex layoutIndex;
+	
+	typedef std::map<std::pair<unsigned int, unsigned int>, int> KerningCache;
+	KerningCache kerning;
+	
+	friend class TextBatch;
+	
+};
+
+/*!
+ * Collects the glyphs of all strings drawn while the batch is active and draws them with
+ * one draw call per glyph texture. Render states are only set up once per batch.
+ *
+ * Batches are active from construction until destruction and can be nested - strings
+ * are always added to the innermost batch. Strings drawn without an active batch are
+ * drawn immediately.
+ *
+ * The viewport must not be changed while glyphs are queued - call flush() first.
+ */
+class TextBatch : private boost::noncopyable {
+	
+public:
+	
+	TextBatch();
+	~TextBatch();
+	
+	//! Draw all queued glyphs
+	void flush();
+	
+	//! Draw the glyphs queued in the active batch, if any
+	static void flushActive();
+	
+private:
+	
+	void add(Font & font, const Font::Layout & layout, int x, int y, Color color);
+	
+	typedef std::vector<TexturedVertex> Vertices;
+	typedef std::vector<std::pair<Texture2D *, Vertices> > Pages;
+	Pages pages;
+	
+	TextBatch * previous;
+	
+	static TextBatch * active;
+	
+	friend class Font;
+	
 };
 
 #endif // ARX_GRAPHICS_FONT_FONT_H
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graphics/null/NullRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "graphics/Vertex.h"
+#include "graphics/VertexBuffer.h"
+#include "graphics/texture/Texture.h"
+#include "graphics/texture/TextureStage.h"
+
+namespace {
+
+class NullTexture2D : public Texture2D {
+	
+public:
+	
+	bool Create() { return true; }
+	void Upload() { }
+	void Destroy() { }
+	
+};
+
+class NullTextureStage : public TextureStage {
+	
+public:
+	
+	explicit NullTextureStage(unsigned int stage) : TextureStage(stage) { }
+	
+	void SetTexture(Texture * pTexture) { ARX_UNUSED(pTexture); }
+	void ResetTexture() { }
+	
+	void SetColorOp(TextureOp textureOp, TextureArg texArg1, TextureArg texArg2) {
+		ARX_UNUSED(textureOp), ARX_UNUSED(texArg1), ARX_UNUSED(texArg2);
+	}
+	void SetColorOp(TextureOp textureOp) { ARX_UNUSED(textureOp); }
+	
+	void SetAlphaOp(TextureOp textureOp, TextureArg texArg1, TextureArg texArg2) {
+		ARX_UNUSED(textureOp), ARX_UNUSED(texArg1), ARX_UNUSED(texArg2);
+	}
+	void SetAlphaOp(TextureOp textureOp) { ARX_UNUSED(textureOp); }
+	
+	void SetWrapMode(WrapMode wrapMode) { ARX_UNUSED(wrapMode); }
+	
+	void SetMinFilter(FilterMode filterMode) { ARX_UNUSED(filterMode); }
+	void SetMagFilter(FilterMode filterMode) { ARX_UNUSED(filterMode); }
+	void SetMipFilter(FilterMode filterMode) { ARX_UNUSED(filterMode); }
+	
+	void SetMipMapLODBias(float bias) { ARX_UNUSED(bias); }
+	
+};
+
+//! Vertex buffer that only keeps the vertices in memory.
+template <class Vertex>
+class NullVertexBuffer : public VertexBuffer<Vertex> {
+	
+public:
+	
+	using VertexBuffer<Vertex>::capacity;
+	
+	explicit NullVertexBuffer(size_t capacity)
+		: VertexBuffer<Vertex>(capacity), buffer(new Vertex[capacity]) { }
+	
+	void setData(const Vertex * vertices, size_t count, size_t offset, BufferFlags flags) {
+		ARX_UNUSED(flags);
+		arx_assert(offset < capacity());
+		arx_assert(offset + count <= capacity());
+		std::copy(vertices, vertices + count, buffer + offset);
+	}
+	
+	Vertex * lock(BufferFlags flags, size_t offset, size_t count) {
+		ARX_UNUSED(flags), ARX_UNUSED(count);
+		return buffer + offset;
+	}
+	
+	void unlock() { }
+	
+	void draw(Renderer::Primitive primitive, size_t count, size_t offset) const {
+		ARX_UNUSED(primitive), ARX_UNUSED(count), ARX_UNUSED(offset);
+	}
+	
+	void drawIndexed(Renderer::Primitive primitive, size_t count, size_t offset,
+	                 unsigned short * indices, size_t nbindices) const {
+		ARX_UNUSED(primitive), ARX_UNUSED(count), ARX_UNUSED(offset);
+		ARX_UNUSED(indices), ARX_UNUSED(nbindices);
+	}
+	
+	~NullVertexBuffer() {
+		delete[] buffer;
+	}
+	
+private:
+	
+	Vertex * buffer;
+	
+};
+
+//! Number of texture stages reported to the game
+const unsigned int NULL_TEXTURE_STAGES = 3;
+
+} // anonymous namespace
+
+NullRenderer::NullRenderer() : viewport(Rect::ZERO) {
+	memset(&view, 0, sizeof(view));
+	memset(&projection, 0, sizeof(projection));
+}
+
+void NullRenderer::Initialize() {
+	
+	m_TextureStages.resize(NULL_TEXTURE_STAGES, NULL);
+	for(size_t i = 0; i < m_TextureStages.size(); ++i) {
+		m_TextureStages[i] = new NullTextureStage(i);
+	}
+}
+
+void NullRenderer::SetViewMatrix(const EERIEMATRIX & matView) {
+	view = matView;
+}
+
+void NullRenderer::GetViewMatrix(EERIEMATRIX & matView) const {
+	matView = view;
+}
+
+void NullRenderer::SetProjectionMatrix(const EERIEMATRIX & matProj) {
+	projection = matProj;
+}
+
+void NullRenderer::GetProjectionMatrix(EERIEMATRIX & matProj) const {
+	matProj = projection;
+}
+
+Texture2D * NullRenderer::CreateTexture2D() {
+	return new NullTexture2D;
+}
+
+void NullRenderer::SetRenderState(RenderState renderState, bool enable) {
+	ARX_UNUSED(renderState), ARX_UNUSED(enable);
+}
+
+void NullRenderer::SetAlphaFunc(PixelCompareFunc func, float fef) {
+	ARX_UNUSED(func), ARX_UNUSED(fef);
+}
+
+void NullRenderer::SetBlendFunc(PixelBlendingFactor srcFactor, PixelBlendingFactor dstFactor) {
+	ARX_UNUSED(srcFactor), ARX_UNUSED(dstFactor);
+}
+
+void NullRenderer::SetViewport(const Rect & _viewport) {
+	viewport = _viewport;
+}
+
+Rect NullRenderer::GetViewport() {
+	return viewport;
+}
+
+void NullRenderer::Begin2DProjection(float left, float right, float bottom, float top,
+                                     float zNear, float zFar) {
+	ARX_UNUSED(left), ARX_UNUSED(right), ARX_UNUSED(bottom), ARX_UNUSED(top);
+	ARX_UNUSED(zNear), ARX_UNUSED(zFar);
+}
+
+void NullRenderer::Clear(BufferFlags bufferFlags, Color clearColor, float clearDepth,
+                         size_t nrects, Rect * rect) {
+	ARX_UNUSED(bufferFlags), ARX_UNUSED(clearColor), ARX_UNUSED(clearDepth);
+	ARX_UNUSED(nrects), ARX_UNUSED(rect);
+}
+
+void NullRenderer::SetFogColor(Color color) {
+	ARX_UNUSED(color);
+}
+
+void NullRenderer::SetFogParams(FogMode fogMode, float fogStart, float fogEnd, float fogDensity) {
+	ARX_UNUSED(fogMode), ARX_UNUSED(fogStart), ARX_UNUSED(fogEnd), ARX_UNUSED(fogDensity);
+}
+
+void NullRenderer::SetAntialiasing(bool enable) {
+	ARX_UNUSED(enable);
+}
+
+void NullRenderer::SetCulling(CullingMode mode) {
+	ARX_UNUSED(mode);
+}
+
+void NullRenderer::SetDepthBias(int depthBias) {
+	ARX_UNUSED(depthBias);
+}
+
+void NullRenderer::SetFillMode(FillMode mode) {
+	ARX_UNUSED(mode);
+}
+
+void NullRenderer::DrawTexturedRect(float x, float y, float w, float h, float uStart,
+                                    float vStart, float uEnd, float vEnd, Color color) {
+	ARX_UNUSED(x), ARX_UNUSED(y), ARX_UNUSED(w), ARX_UNUSED(h);
+	ARX_UNUSED(uStart), ARX_UNUSED(vStart), ARX_UNUSED(uEnd), ARX_UNUSED(vEnd);
+	ARX_UNUSED(color);
+}
+
+VertexBuffer<TexturedVertex> * NullRenderer::createVertexBufferTL(size_t capacity,
+                                                                  BufferUsage usage) {
+	ARX_UNUSED(usage);
+	return new NullVertexBuffer<TexturedVertex>(capacity);
+}
+
+VertexBuffer<SMY_VERTEX> * NullRenderer::createVertexBuffer(size_t capacity,
+                                                            BufferUsage usage) {
+	ARX_UNUSED(usage);
+	return new NullVertexBuffer<SMY_VERTEX>(capacity);
+}
+
+VertexBuffer<SMY_VERTEX3> * NullRenderer::createVertexBuffer3(size_t capacity,
+                                                              BufferUsage usage) {
+	ARX_UNUSED(usage);
+	return new NullVertexBuffer<SMY_VERTEX3>(capacity);
+}
+
+void NullRenderer::drawIndexed(Primitive primitive, const TexturedVertex * vertices,
+                               size_t nvertices, unsigned short * indices, size_t nindices) {
+	ARX_UNUSED(primitive), ARX_UNUSED(vertices), ARX_UNUSED(nvertices);
+	ARX_UNUSED(indices), ARX_UNUSED(nindices);
+}
+
+bool NullRenderer::getSnapshot(Image & image) {
+	ARX_UNUSED(image);
+	return false;
+}
+
+bool NullRenderer::getSnapshot(Image & image, size_t width, size_t height) {
+	ARX_UNUSED(image), ARX_UNUSED(width), ARX_UNUSED(height);
+	return false;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_GRAPHICS_NULL_NULLRENDERER_H
+#define ARX_GRAPHICS_NULL_NULLRENDERER_H
+
+#include "graphics/BaseGraphicsTypes.h"
+#include "graphics/Renderer.h"
+#include "math/Rectangle.h"
+
+/*!
+ * Renderer that does not need a window and discards everything.
+ *
+ * Textures are still decoded and vertex buffers are kept in memory so that code
+ * loading resources does the same work as with a real renderer, minus the upload.
+ * Used for headless tools and benchmarks.
+ */
+class NullRenderer : public Renderer {
+	
+public:
+	
+	NullRenderer();
+	
+	void Initialize();
+	
+	void BeginScene() { }
+	void EndScene() { }
+	
+	void SetViewMatrix(const EERIEMATRIX & matView);
+	void GetViewMatrix(EERIEMATRIX & matView) const;
+	void SetProjectionMatrix(const EERIEMATRIX & matProj);
+	void GetProjectionMatrix(EERIEMATRIX & matProj) const;
+	
+	Texture2D * CreateTexture2D();
+	
+	void SetRenderState(RenderState renderState, bool enable);
+	
+	void SetAlphaFunc(PixelCompareFunc func, float fef);
+	void SetBlendFunc(PixelBlendingFactor srcFactor, PixelBlendingFactor dstFactor);
+	
+	void SetViewport(const Rect & viewport);
+	Rect GetViewport();
+	
+	void Begin2DProjection(float left, float right, float bottom, float top, float zNear, float zFar);
+	void End2DProjection() { }
+	
+	void Clear(BufferFlags bufferFlags, Color clearColor = Color::none, float clearDepth = 1.f, size_t nrects = 0, Rect * rect = 0);
+	
+	void SetFogColor(Color color);
+	void SetFogParams(FogMode fogMode, float fogStart, float fogEnd, float fogDensity = 1.0f);
+	bool isFogInEyeCoordinates() { return false; }
+	
+	void SetAntialiasing(bool enable);
+	void SetCulling(CullingMode mode);
+	void SetDepthBias(int depthBias);
+	void SetFillMode(FillMode mode);
+	
+	float GetMaxAnisotropy() const { return 0.f; }
+	
+	void DrawTexturedRect(float x, float y, float w, float h, float uStart, float vStart, float uEnd, float vEnd, Color color);
+	
+	VertexBuffer<TexturedVertex> * createVertexBufferTL(size_t capacity, BufferUsage usage);
+	VertexBuffer<SMY_VERTEX> * createVertexBuffer(size_t capacity, BufferUsage usage);
+	VertexBuffer<SMY_VERTEX3> * createVertexBuffer3(size_t capacity, BufferUsage usage);
+	
+	void drawIndexed(Primitive primitive, const TexturedVertex * vertices, size_t nvertices, unsigned short * indices, size_t nindices);
+	
+	bool getSnapshot(Image & image);
+	bool getSnapshot(Image & image, size_t width, size_t height);
+	
+private:
+	
+	EERIEMATRIX view;
+	EERIEMATRIX projection;
+	Rect viewport;
+	
+};
+
+#endif // ARX_GRAPHICS_NULL_NULLRENDERER_H
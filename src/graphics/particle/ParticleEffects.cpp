@@ -48,6 +48,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include <algorithm>
 
+#include <boost/foreach.hpp>
+
 #include "core/Application.h"
 #include "core/Config.h"
 #include "core/Core.h"
@@ -72,6 +74,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "physics/Collisions.h"
 
+#include "platform/profiler/Profiler.h"
+
 #include "scene/GameSound.h"
 #include "scene/Interactive.h"
 #include "scene/Light.h"
@@ -97,9 +101,20 @@ struct OBJFX {
 };
 
 static const size_t MAX_PARTICLES = 2200;
-static long ParticleCount = 0;
 static PARTICLE_DEF particle[MAX_PARTICLES];
 
+/*
+ * Slot allocation for particle[]: live particles are listed densely in creation order
+ * so that the render pass only visits those. Freed slots are kept in a stack, slots
+ * that have never been used since the last clear are taken in order.
+ */
+static size_t liveParticles[MAX_PARTICLES];
+static size_t liveParticleCount = 0;
+static size_t freeParticles[MAX_PARTICLES];
+static size_t freeParticleCount = 0;
+static size_t usedParticleSlots = 0;
+static size_t particleSpawnFailures = 0;
+
 FLARETC			flaretc;
 FLARES			flare[MAX_FLARES];
 static TextureContainer * bloodsplat[6];
@@ -118,7 +133,11 @@ static short shinum = 1;
 long			NewSpell=0;
 
 long getParticleCount() {
-	return ParticleCount;
+	return long(liveParticleCount);
+}
+
+size_t getParticleSpawnFailures() {
+	return particleSpawnFailures;
 }
 
 void LaunchDummyParticle() {
@@ -970,7 +989,10 @@ void ARX_PARTICLES_FirstInit() {
 
 void ARX_PARTICLES_ClearAll() {
 	memset(particle, 0, sizeof(PARTICLE_DEF) * MAX_PARTICLES);
-	ParticleCount = 0;
+	liveParticleCount = 0;
+	freeParticleCount = 0;
+	usedParticleSlots = 0;
+	particleSpawnFailures = 0;
 }
 
 PARTICLE_DEF * createParticle(bool allocateWhilePaused) {
@@ -979,32 +1001,52 @@ PARTICLE_DEF * createParticle(bool allocateWhilePaused) {
 		return NULL;
 	}
 	
-	for(size_t i = 0; i < MAX_PARTICLES; i++) {
-		
-		PARTICLE_DEF * pd = &particle[i];
-		
-		if(pd->exist) {
-			continue;
+	size_t i;
+	if(freeParticleCount > 0) {
+		i = freeParticles[--freeParticleCount];
+	} else if(usedParticleSlots < MAX_PARTICLES) {
+		i = usedParticleSlots++;
+	} else {
+		particleSpawnFailures++;
+		return NULL;
+	}
+	
+	arx_assert(liveParticleCount < MAX_PARTICLES);
+	liveParticles[liveParticleCount++] = i;
+	
+	PARTICLE_DEF * pd = &particle[i];
+	
+	arx_assert(!pd->exist);
+	pd->exist = true;
+	pd->timcreation = long(arxtime);
+	
+	pd->type = 0;
+	pd->rgb = Color3f::white;
+	pd->tc = NULL;
+	pd->special = 0;
+	pd->source = NULL;
+	pd->delay = 0;
+	pd->zdec = false;
+	pd->move = Vec3f::ZERO;
+	pd->scale = Vec3f::ONE;
+	
+	return pd;
+}
+
+//! Move the slots of particles that have died during rendering to the free list
+static void collectDeadParticles() {
+	
+	size_t count = 0;
+	for(size_t i = 0; i < liveParticleCount; i++) {
+		size_t slot = liveParticles[i];
+		if(particle[slot].exist) {
+			liveParticles[count++] = slot;
+		} else {
+			freeParticles[freeParticleCount++] = slot;
 		}
-		
-		ParticleCount++;
-		pd->exist = true;
-		pd->timcreation = long(arxtime);
-		
-		pd->type = 0;
-		pd->rgb = Color3f::white;
-		pd->tc = NULL;
-		pd->special = 0;
-		pd->source = NULL;
-		pd->delay = 0;
-		pd->zdec = false;
-		pd->move = Vec3f::ZERO;
-		pd->scale = Vec3f::ONE;
-		
-		return pd;
 	}
 	
-	return NULL;
+	liveParticleCount = count;
 }
 
 void MagFX(const Vec3f & pos) {
@@ -1208,11 +1250,13 @@ void LaunchFireballBoom(Vec3f * poss, float level, Vec3f * direction, Color3f *
 
 void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 	
+	ARX_PROFILE_FUNC();
+	
 	if(!ACTIVEBKG) {
 		return;
 	}
 	
-	if(ParticleCount == 0) {
+	if(liveParticleCount == 0) {
 		return;
 	}
 	
@@ -1223,14 +1267,13 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 	GRenderer->SetCulling(Renderer::CullNone);
 	GRenderer->SetFogColor(Color::none);
 	
-	long pcc = ParticleCount;
+	// Particles created while rendering are only rendered starting with the next frame
+	size_t count = liveParticleCount;
 	
-	for(size_t i = 0; i < MAX_PARTICLES && pcc > 0; i++) {
+	for(size_t i = 0; i < count; i++) {
 		
-		PARTICLE_DEF * part = &particle[i];
-		if(!part->exist) {
-			continue;
-		}
+		PARTICLE_DEF * part = &particle[liveParticles[i]];
+		arx_assert(part->exist);
 		
 		long framediff = part->timcreation + part->tolive - tim;
 		long framediff2 = tim - part->timcreation;
@@ -1260,7 +1303,6 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 
 			if(!bkgData || !bkgData->treat) {
 				part->exist = false;
-				ParticleCount--;
 				continue;
 			}
 		}
@@ -1293,7 +1335,6 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 				
 			} else {
 				part->exist = false;
-				ParticleCount--;
 				continue;
 			}
 		}
@@ -1416,7 +1457,6 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 						SpawnGroundSplat(&sp, &rgb, sp.radius, 0);
 					}
 					part->exist = false;
-					ParticleCount--;
 					continue;
 				}
 			}
@@ -1430,7 +1470,6 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 						SpawnGroundSplat(&sp, &rgb, sp.radius, 2);
 					}
 					part->exist = false;
-					ParticleCount--;
 					continue;
 				}
 			}
@@ -1443,7 +1482,6 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 		}
 		
 		if(r <= 0.f) {
-			pcc--;
 			continue;
 		}
 		
@@ -1545,23 +1583,22 @@ void ARX_PARTICLES_Render(EERIE_CAMERA * cam)  {
 			}
 		}
 		
-		pcc--;
 	}
 	
+	collectDeadParticles();
+	
 	GRenderer->SetFogColor(ulBKGColor);
 	GRenderer->SetRenderState(Renderer::DepthTest, true);
 }
 
 void RestoreAllLightsInitialStatus() {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i]) {
-			GLight[i]->status = (GLight[i]->extras & EXTRAS_STARTEXTINGUISHED) ? 0 : 1;
-			if(GLight[i]->status == 0) {
-				if(ValidDynLight(GLight[i]->tl)) {
-					DynLight[GLight[i]->tl].exist = 0;
-				}
-				GLight[i]->tl = -1;
+	BOOST_FOREACH(size_t i, EERIE_LIGHT_GetAll()) {
+		GLight[i]->status = (GLight[i]->extras & EXTRAS_STARTEXTINGUISHED) ? 0 : 1;
+		if(GLight[i]->status == 0) {
+			if(ValidDynLight(GLight[i]->tl)) {
+				DynLight[GLight[i]->tl].exist = 0;
 			}
+			GLight[i]->tl = -1;
 		}
 	}
 }
@@ -1571,12 +1608,9 @@ void TreatBackgroundActions() {
 	
 	float fZFar = square(ACTIVECAM->cdepth * fZFogEnd * 1.3f);
 	
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
+	BOOST_FOREACH(size_t i, EERIE_LIGHT_GetAll()) {
 		
 		EERIE_LIGHT * gl = GLight[i];
-		if(!gl) {
-			continue;
-		}
 		
 		float dist = distSqr(gl->pos,	ACTIVECAM->orgTrans.pos);
 		if(dist > fZFar) {
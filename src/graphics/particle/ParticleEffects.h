@@ -219,9 +219,18 @@ void MakePlayerAppearsFX(Entity * io);
 void MakeCoolFx(Vec3f * pos);
 void SpawnGroundSplat(EERIE_SPHERE * sp, Color3f * rgb, float size, long flags);
 
+/*!
+ * Allocate a particle in constant time.
+ * @return NULL if the game is paused or if all particle slots are in use.
+ */
 PARTICLE_DEF * createParticle(bool allocateWhilePaused = false);
+
+//! @return the number of live particles
 long getParticleCount();
 
+//! @return the number of failed createParticle() calls since the last ARX_PARTICLES_ClearAll()
+size_t getParticleSpawnFailures();
+
 void ARX_PARTICLES_FirstInit();
 void ARX_PARTICLES_ClearAll();
 void ARX_PARTICLES_Render(EERIE_CAMERA * cam);
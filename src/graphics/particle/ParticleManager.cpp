@@ -46,8 +46,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <boost/foreach.hpp>
 
 #include "graphics/particle/ParticleSystem.h"
-
-using std::list;
+#include "platform/profiler/Profiler.h"
 
 ParticleManager::ParticleManager() {
 	listParticleSystem.clear();
@@ -67,46 +66,38 @@ void ParticleManager::Clear() {
 }
 
 void ParticleManager::AddSystem(ParticleSystem * _pPS) {
-	listParticleSystem.insert(listParticleSystem.end(), _pPS);
+	listParticleSystem.push_back(_pPS);
 }
 
 //-----------------------------------------------------------------------------
 void ParticleManager::Update(long _lTime)
 {
+	ARX_PROFILE_FUNC();
+	
 	if (listParticleSystem.empty()) return;
 
-	list<ParticleSystem *>::iterator i;
-	i = listParticleSystem.begin();
-
-	while (i != listParticleSystem.end())
-	{
-		ParticleSystem * p = *i;
-		++i;
-
-		if (!p->IsAlive())
-		{
+	// Remove dead systems in a single pass, keeping the others in order
+	size_t alive = 0;
+	for(size_t i = 0; i < listParticleSystem.size(); i++) {
+		ParticleSystem * p = listParticleSystem[i];
+		if(!p->IsAlive()) {
 			delete p;
-			listParticleSystem.remove(p);
-		}
-		else
-		{
+		} else {
 			p->Update(_lTime);
+			listParticleSystem[alive++] = p;
 		}
 	}
+	listParticleSystem.resize(alive);
 }
 
 //-----------------------------------------------------------------------------
 
 void ParticleManager::Render()
 {
-	int ilekel = 0;
-	list<ParticleSystem *>::iterator i;
-
-	for (i = listParticleSystem.begin(); i != listParticleSystem.end(); ++i)
-	{
-		ParticleSystem * p = *i;
+	ARX_PROFILE_FUNC();
+	
+	BOOST_FOREACH(ParticleSystem * p, listParticleSystem) {
 		p->Render();
-		ilekel++;
 	}
 }
 
@@ -44,7 +44,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #ifndef ARX_GRAPHICS_PARTICLE_PARTICLEMANAGER_H
 #define ARX_GRAPHICS_PARTICLE_PARTICLEMANAGER_H
 
-#include <list>
+#include <vector>
 
 class ParticleSystem;
 
@@ -52,7 +52,7 @@ class ParticleManager {
 	
 private:
 	
-	std::list<ParticleSystem *> listParticleSystem;
+	std::vector<ParticleSystem *> listParticleSystem;
 	
 public:
 	
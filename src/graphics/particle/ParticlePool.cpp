@@ -0,0 +1,224 @@
+/*
+ * Copyright 2011-2012 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Based on:
+===========================================================================
+ARX FATALIS GPL Source Code
+Copyright (C) 1999-2010 Arkane Studios SA, a ZeniMax Media company.
+
+This file is part of the Arx Fatalis GPL Source Code ('Arx Fatalis Source Code'). 
+
+Arx Fatalis Source Code is free software: you can redistribute it and/or modify it under the terms of the GNU General Public 
+License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Arx Fatalis Source Code is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied 
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Arx Fatalis Source Code.  If not, see 
+<http://www.gnu.org/licenses/>.
+
+In addition, the Arx Fatalis Source Code is also subject to certain additional terms. You should have received a copy of these 
+additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Arx 
+Fatalis Source Code. If not, please request a copy in writing from Arkane Studios at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing Arkane Studios, c/o 
+ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+===========================================================================
+*/
+
+#include "graphics/particle/ParticlePool.h"
+
+#include <algorithm>
+
+#include "graphics/Math.h"
+
+void ParticlePool::reserve(size_t capacity) {
+	pos.reserve(capacity);
+	velocity.reserve(capacity);
+	time.reserve(capacity);
+	ttl.reserve(capacity);
+	oneOnTTL.reserve(capacity);
+	size.reserve(capacity);
+	sizeStart.reserve(capacity);
+	sizeEnd.reserve(capacity);
+	colorStart.reserve(capacity);
+	colorEnd.reserve(capacity);
+	color.reserve(capacity);
+	rot.reserve(capacity);
+	rotStart.reserve(capacity);
+	texTime.reserve(capacity);
+	texNum.reserve(capacity);
+	dead.reserve(capacity);
+}
+
+size_t ParticlePool::add() {
+	
+	pos.push_back(Vec3f::ZERO);
+	velocity.push_back(Vec3f::ZERO);
+	time.push_back(0);
+	ttl.push_back(2000);
+	oneOnTTL.push_back(1.f / 2000);
+	size.push_back(1.f);
+	sizeStart.push_back(1.f);
+	sizeEnd.push_back(1.f);
+	colorStart.push_back(Color4f(1.f, 1.f, 1.f, 0.5f));
+	colorEnd.push_back(Color4f(1.f, 1.f, 1.f, 0.1f));
+	color.push_back(Color::white);
+	rot.push_back(1);
+	rotStart.push_back(0.f);
+	texTime.push_back(0);
+	texNum.push_back(0);
+	dead.push_back(0);
+	
+	return count() - 1;
+}
+
+template <class T>
+static void swapRemove(std::vector<T> & array, size_t i) {
+	array[i] = array.back();
+	array.pop_back();
+}
+
+void ParticlePool::remove(size_t i) {
+	
+	arx_assert(i < count());
+	
+	swapRemove(pos, i);
+	swapRemove(velocity, i);
+	swapRemove(time, i);
+	swapRemove(ttl, i);
+	swapRemove(oneOnTTL, i);
+	swapRemove(size, i);
+	swapRemove(sizeStart, i);
+	swapRemove(sizeEnd, i);
+	swapRemove(colorStart, i);
+	swapRemove(colorEnd, i);
+	swapRemove(color, i);
+	swapRemove(rot, i);
+	swapRemove(rotStart, i);
+	swapRemove(texTime, i);
+	swapRemove(texNum, i);
+	swapRemove(dead, i);
+}
+
+void ParticlePool::clear() {
+	pos.clear();
+	velocity.clear();
+	time.clear();
+	ttl.clear();
+	oneOnTTL.clear();
+	size.clear();
+	sizeStart.clear();
+	sizeEnd.clear();
+	colorStart.clear();
+	colorEnd.clear();
+	color.clear();
+	rot.clear();
+	rotStart.clear();
+	texTime.clear();
+	texNum.clear();
+	dead.clear();
+}
+
+void ParticlePool::regen(size_t i) {
+	pos[i] = Vec3f::ZERO;
+	time[i] = 0;
+	size[i] = 1;
+	texTime[i] = 0;
+	texNum[i] = 0;
+}
+
+void ParticlePool::validate(size_t i) {
+	
+	size[i] = std::max(size[i], 1.f);
+	sizeStart[i] = std::max(sizeStart[i], 1.f);
+	sizeEnd[i] = std::max(sizeEnd[i], 1.f);
+	
+	Color4f & start = colorStart[i];
+	start.r = clamp(start.r, 0.f, 1.f);
+	start.g = clamp(start.g, 0.f, 1.f);
+	start.b = clamp(start.b, 0.f, 1.f);
+	start.a = clamp(start.a, 0.f, 1.f);
+	
+	Color4f & end = colorEnd[i];
+	end.r = clamp(end.r, 0.f, 1.f);
+	end.g = clamp(end.g, 0.f, 1.f);
+	end.b = clamp(end.b, 0.f, 1.f);
+	end.a = clamp(end.a, 0.f, 1.f);
+	
+	if(ttl[i] < 100) {
+		ttl[i] = 100;
+		oneOnTTL[i] = 1.0f / float(ttl[i]);
+	}
+}
+
+void ParticlePool::interpolate(size_t i) {
+	
+	float ft = oneOnTTL[i] * time[i];
+	
+	size[i] = sizeStart[i] + (sizeEnd[i] - sizeStart[i]) * ft;
+	
+	const Color4f & start = colorStart[i];
+	const Color4f & end = colorEnd[i];
+	Color4f fColor;
+	fColor.r = start.r + (end.r - start.r) * ft;
+	fColor.g = start.g + (end.g - start.g) * ft;
+	fColor.b = start.b + (end.b - start.b) * ft;
+	fColor.a = start.a + (end.a - start.a) * ft;
+	color[i] = fColor.to<u8>();
+}
+
+void ParticlePool::update(long delta, const Vec3f & gravity) {
+	
+	const size_t n = count();
+	
+	float fTimeSec = delta * (1.f / 1000);
+	
+	// The loops below are kept separate and free of branches where possible so that
+	// they operate on one or two arrays at a time and can be vectorized.
+	
+	for(size_t i = 0; i < n; i++) {
+		dead[i] = (time[i] >= ttl[i]) ? 1 : 0;
+	}
+	
+	// Aging
+	for(size_t i = 0; i < n; i++) {
+		long step = dead[i] ? 0 : delta;
+		time[i] += step;
+		texTime[i] += int(step);
+	}
+	
+	// Only particles that are still alive after aging are moved
+	for(size_t i = 0; i < n; i++) {
+		float t = (time[i] < ttl[i]) ? fTimeSec : 0.f;
+		pos[i] += velocity[i] * t;
+	}
+	
+	// Gravity is applied to all particles that were alive before aging
+	Vec3f dv = gravity * fTimeSec;
+	for(size_t i = 0; i < n; i++) {
+		float s = dead[i] ? 0.f : 1.f;
+		velocity[i] += dv * s;
+	}
+	
+	for(size_t i = 0; i < n; i++) {
+		if(time[i] < ttl[i]) {
+			interpolate(i);
+		}
+	}
+}
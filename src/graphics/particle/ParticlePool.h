@@ -41,56 +41,88 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 ===========================================================================
 */
 
-#ifndef ARX_GRAPHICS_PARTICLE_PARTICLE_H
-#define ARX_GRAPHICS_PARTICLE_PARTICLE_H
+#ifndef ARX_GRAPHICS_PARTICLE_PARTICLEPOOL_H
+#define ARX_GRAPHICS_PARTICLE_PARTICLEPOOL_H
+
+#include <stddef.h>
+#include <vector>
 
 #include "graphics/Color.h"
 #include "math/Vector3.h"
+#include "platform/Platform.h"
 
-class Particle {
+/*!
+ * The particles of one ParticleSystem, stored as a structure of arrays.
+ *
+ * Storage is reused when particles die, so spawning particles does not allocate once
+ * the pool has grown to the size of the particle system. Removing a particle moves the
+ * last particle into its slot, so indices are not stable across remove() calls.
+ */
+class ParticlePool {
 	
 public:
 	
-	Vec3f p3Pos;
-	Vec3f p3Velocity;
+	// position
+	std::vector<Vec3f> pos;
+	std::vector<Vec3f> velocity;
 	
 	// time
-	float fOneOnTTL;
-	long ulTime; //!< Age
-	long ulTTL; //!< Time to Live
+	std::vector<long> time; //!< Age
+	std::vector<long> ttl; //!< Time to Live
+	std::vector<float> oneOnTTL;
 	
 	// size
-	float fSize;
-	float fSizeStart;
-	float fSizeEnd;
+	std::vector<float> size;
+	std::vector<float> sizeStart;
+	std::vector<float> sizeEnd;
 	
 	// color
-	float fColorStart[4];
-	float fColorEnd[4];
-	Color ulColor;
+	std::vector<Color4f> colorStart;
+	std::vector<Color4f> colorEnd;
+	std::vector<Color> color;
 	
 	// rotation
-	int iRot;
-	float fRotStart;
-	float fRotation;
+	std::vector<int> rot;
+	std::vector<float> rotStart;
 	
 	// tex infos
-	int iTexTime;
-	int iTexNum;
+	std::vector<int> texTime;
+	std::vector<int> texNum;
 	
-public:
+	//! Set by update() for particles that were already dead before the update
+	std::vector<u8> dead;
+	
+	size_t count() const { return time.size(); }
+	
+	bool isAlive(size_t i) const { return time[i] < ttl[i]; }
+	
+	size_t capacity() const { return time.capacity(); }
+	
+	void reserve(size_t capacity);
+	
+	//! Add a new particle with default parameters @return the index of the particle
+	size_t add();
+	
+	//! Remove a particle by moving the last particle into its place
+	void remove(size_t i);
+	
+	void clear();
+	
+	//! Reset the age, size and texture animation of a dead particle so it can be reused
+	void regen(size_t i);
 	
-	Particle();
-	~Particle();
+	//! Clamp the parameters of a particle to valid ranges
+	void validate(size_t i);
 	
-	void Regen();
-	void Update(long);
+	//! Update the size and color of a particle for its current age
+	void interpolate(size_t i);
 	
-	bool isAlive() {
-		return (ulTime < ulTTL);
-	};
-	void Validate();
+	/*!
+	 * Age and move all live particles and apply gravity to their velocity.
+	 * Particles that are already dead are not modified and are marked in dead.
+	 */
+	void update(long delta, const Vec3f & gravity);
 	
 };
 
-#endif // ARX_GRAPHICS_PARTICLE_PARTICLE_H
+#endif // ARX_GRAPHICS_PARTICLE_PARTICLEPOOL_H
@@ -46,8 +46,6 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <cstdio>
 #include <cstring>
 
-#include <boost/foreach.hpp>
-
 #include "core/GameTime.h"
 
 #include "graphics/Draw.h"
@@ -56,12 +54,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/data/TextureContainer.h"
 #include "graphics/effects/SpellEffects.h"
 #include "graphics/particle/ParticleParams.h"
-#include "graphics/particle/Particle.h"
 
 #include "scene/Light.h"
 
-using std::list;
-
 void ParticleSystem::RecomputeDirection() {
 	Vec3f eVect = p3ParticleDirection;
 	eVect.y = -eVect.y;
@@ -137,14 +132,7 @@ ParticleSystem::ParticleSystem() {
 	iDstBlend = Renderer::BlendOne;
 }
 
-ParticleSystem::~ParticleSystem() {
-	
-	BOOST_FOREACH(Particle * p, listParticle) {
-		delete p;
-	}
-	
-	listParticle.clear();
-}
+ParticleSystem::~ParticleSystem() { }
 
 void ParticleSystem::SetPos(const Vec3f & _p3) {
 	
@@ -279,27 +267,29 @@ void ParticleSystem::SetTexture(const char * _pszTex, int _iNbTex, int _iTime, b
 	}
 }
 
-void ParticleSystem::SpawnParticle(Particle * pP) {
+void ParticleSystem::SpawnParticle(size_t i) {
+	
+	Vec3f & pos = particles.pos[i];
 	
-	pP->p3Pos = Vec3f::ZERO;
+	pos = Vec3f::ZERO;
 	
 	if((ulParticleSpawn & PARTICLE_CIRCULAR) == PARTICLE_CIRCULAR
 	   && (ulParticleSpawn & PARTICLE_BORDER) == PARTICLE_BORDER) {
 		float randd = rnd() * 360.f;
-		pP->p3Pos.x = EEsin(randd) * p3ParticlePos.x;
-		pP->p3Pos.y = rnd() * p3ParticlePos.y;
-		pP->p3Pos.z = EEcos(randd) * p3ParticlePos.z;
+		pos.x = EEsin(randd) * p3ParticlePos.x;
+		pos.y = rnd() * p3ParticlePos.y;
+		pos.z = EEcos(randd) * p3ParticlePos.z;
 	} else if((ulParticleSpawn & PARTICLE_CIRCULAR) == PARTICLE_CIRCULAR) {
 		float randd = rnd() * 360.f;
-		pP->p3Pos.x = EEsin(randd) * rnd() * p3ParticlePos.x;
-		pP->p3Pos.y = rnd() * p3ParticlePos.y;
-		pP->p3Pos.z = EEcos(randd) * rnd() * p3ParticlePos.z;
+		pos.x = EEsin(randd) * rnd() * p3ParticlePos.x;
+		pos.y = rnd() * p3ParticlePos.y;
+		pos.z = EEcos(randd) * rnd() * p3ParticlePos.z;
 	} else {
-		pP->p3Pos = p3ParticlePos * randomVec(-1.f, 1.f);
+		pos = p3ParticlePos * randomVec(-1.f, 1.f);
 	}
 	
 	if(bParticleFollow == false) {
-		pP->p3Pos = p3Pos;
+		pos = p3Pos;
 	}
 }
 
@@ -320,13 +310,13 @@ void VectorRotateZ(Vec3f & _eIn, Vec3f & _eOut, float _fAngle) {
 }
 
 //-----------------------------------------------------------------------------
-void ParticleSystem::SetParticleParams(Particle * pP)
+void ParticleSystem::SetParticleParams(size_t i)
 {
-	SpawnParticle(pP);
+	SpawnParticle(i);
 
 	float fTTL = fParticleLife + rnd() * fParticleLifeRandom;
-	pP->ulTTL = checked_range_cast<long>(fTTL);
-	pP->fOneOnTTL = 1.0f / (float)pP->ulTTL;
+	particles.ttl[i] = checked_range_cast<long>(fTTL);
+	particles.oneOnTTL[i] = 1.0f / (float)particles.ttl[i];
 
 	float fAngleX = rnd() * fParticleAngle; //*0.5f;
  
@@ -343,42 +333,42 @@ void ParticleSystem::SetParticleParams(Particle * pP)
 
 	float fSpeed = fParticleSpeed + rnd() * fParticleSpeedRandom;
 
-	pP->p3Velocity = vvz * fSpeed;
-	pP->fSizeStart = fParticleStartSize + rnd() * fParticleStartSizeRandom;
+	particles.velocity[i] = vvz * fSpeed;
+	particles.sizeStart[i] = fParticleStartSize + rnd() * fParticleStartSizeRandom;
 
 	if (bParticleStartColorRandomLock)
 	{
 		float t = rnd() * fParticleStartColorRandom[0];
-		pP->fColorStart[0] = fParticleStartColor[0] + t;
-		pP->fColorStart[1] = fParticleStartColor[1] + t;
-		pP->fColorStart[2] = fParticleStartColor[2] + t;
+		particles.colorStart[i].r = fParticleStartColor[0] + t;
+		particles.colorStart[i].g = fParticleStartColor[1] + t;
+		particles.colorStart[i].b = fParticleStartColor[2] + t;
 	}
 	else
 	{
-		pP->fColorStart[0] = fParticleStartColor[0] + rnd() * fParticleStartColorRandom[0];
-		pP->fColorStart[1] = fParticleStartColor[1] + rnd() * fParticleStartColorRandom[1];
-		pP->fColorStart[2] = fParticleStartColor[2] + rnd() * fParticleStartColorRandom[2];
+		particles.colorStart[i].r = fParticleStartColor[0] + rnd() * fParticleStartColorRandom[0];
+		particles.colorStart[i].g = fParticleStartColor[1] + rnd() * fParticleStartColorRandom[1];
+		particles.colorStart[i].b = fParticleStartColor[2] + rnd() * fParticleStartColorRandom[2];
 	}
 
-	pP->fColorStart[3] = fParticleStartColor[3] + rnd() * fParticleStartColorRandom[3];
+	particles.colorStart[i].a = fParticleStartColor[3] + rnd() * fParticleStartColorRandom[3];
 
-	pP->fSizeEnd = fParticleEndSize + rnd() * fParticleEndSizeRandom;
+	particles.sizeEnd[i] = fParticleEndSize + rnd() * fParticleEndSizeRandom;
 
 	if (bParticleEndColorRandomLock)
 	{
 		float t = rnd() * fParticleEndColorRandom[0];
-		pP->fColorEnd[0] = fParticleEndColor[0] + t;
-		pP->fColorEnd[1] = fParticleEndColor[1] + t;
-		pP->fColorEnd[2] = fParticleEndColor[2] + t;
+		particles.colorEnd[i].r = fParticleEndColor[0] + t;
+		particles.colorEnd[i].g = fParticleEndColor[1] + t;
+		particles.colorEnd[i].b = fParticleEndColor[2] + t;
 	}
 	else
 	{
-		pP->fColorEnd[0] = fParticleEndColor[0] + rnd() * fParticleEndColorRandom[0];
-		pP->fColorEnd[1] = fParticleEndColor[1] + rnd() * fParticleEndColorRandom[1];
-		pP->fColorEnd[2] = fParticleEndColor[2] + rnd() * fParticleEndColorRandom[2];
+		particles.colorEnd[i].r = fParticleEndColor[0] + rnd() * fParticleEndColorRandom[0];
+		particles.colorEnd[i].g = fParticleEndColor[1] + rnd() * fParticleEndColorRandom[1];
+		particles.colorEnd[i].b = fParticleEndColor[2] + rnd() * fParticleEndColorRandom[2];
 	}
 
-	pP->fColorEnd[3] = fParticleEndColor[3] + rnd() * fParticleEndColorRandom[3];
+	particles.colorEnd[i].a = fParticleEndColor[3] + rnd() * fParticleEndColorRandom[3];
 
 	if (bParticleRotationRandomDirection)
 	{
@@ -386,26 +376,26 @@ void ParticleSystem::SetParticleParams(Particle * pP)
 
 		float fRandom	= frand2();
 
-		pP->iRot = checked_range_cast<int>(fRandom);
+		particles.rot[i] = checked_range_cast<int>(fRandom);
 
-		if (pP->iRot < 0)
-			pP->iRot = -1;
+		if (particles.rot[i] < 0)
+			particles.rot[i] = -1;
 
-		if (pP->iRot >= 0)
-			pP->iRot = 1;
+		if (particles.rot[i] >= 0)
+			particles.rot[i] = 1;
 	}
 	else
 	{
-		pP->iRot = 1;
+		particles.rot[i] = 1;
 	}
 
 	if (bParticleRotationRandomStart)
 	{
-		pP->fRotStart = rnd() * 360.0f;
+		particles.rotStart[i] = rnd() * 360.0f;
 	}
 	else
 	{
-		pP->fRotStart = 0;
+		particles.rotStart[i] = 0;
 	}
 }
 
@@ -424,45 +414,32 @@ void ParticleSystem::Update(long _lTime)
 	if (arxtime.is_paused()) return;
 
 	ulTime += _lTime;
-	int nbtotal = 0;
 	int iNb;
 	float fTimeSec = _lTime * ( 1.0f / 1000 );
-	Particle * pP;
 
-	list<Particle *>::iterator i;
-	iParticleNbAlive = 0;
-
-	i = listParticle.begin();
+	particles.update(_lTime, p3ParticleGravity);
 
-	while (i != listParticle.end())
-	{
-		pP = *i;
-		++i;
-		nbtotal++;
+	// Reuse or remove particles that were already dead before this update
+	iParticleNbAlive = 0;
+	size_t i = 0;
+	while(i < particles.count()) {
 
-		if (pP->isAlive())
-		{
-			pP->Update(_lTime);
-			pP->p3Velocity += p3ParticleGravity * fTimeSec;
-			iParticleNbAlive ++;
-		}
-		else
-		{
-			if (iParticleNbAlive >= iParticleNbMax)
-			{
-				delete pP;
-				listParticle.remove(pP);
-			}
-			else
-			{
-				pP->Regen();
-				SetParticleParams(pP);
-				pP->Validate();
-				pP->Update(0);
-				ulNbParticleGen++;
-				iParticleNbAlive++;
-			}
+		if(!particles.dead[i]) {
+			iParticleNbAlive++;
+		} else if(iParticleNbAlive >= iParticleNbMax) {
+			// The last particle has been moved to this index and still needs to be checked
+			particles.remove(i);
+			continue;
+		} else {
+			particles.regen(i);
+			SetParticleParams(i);
+			particles.validate(i);
+			particles.interpolate(i);
+			ulNbParticleGen++;
+			iParticleNbAlive++;
 		}
+
+		i++;
 	}
 
 	// création de particules en fct de la fréquence
@@ -474,13 +451,17 @@ void ParticleSystem::Update(long _lTime)
 			t = max(min(checked_range_cast<long>(fTimeSec * fParticleFreq), t), 1l);
 		}
 
+		// Only grow the pool when the maximum particle count was raised
+		if(particles.capacity() < size_t(iParticleNbMax)) {
+			particles.reserve(size_t(iParticleNbMax));
+		}
+
 		for (iNb = 0; iNb < t; iNb++)
 		{
-			Particle * pP  = new Particle();
-			SetParticleParams(pP);
-			pP->Validate();
-			pP->Update(0);
-			listParticle.insert(listParticle.end(), pP);
+			size_t p = particles.add();
+			SetParticleParams(p);
+			particles.validate(p);
+			particles.interpolate(p);
 			ulNbParticleGen ++;
 			iParticleNbAlive++;
 		}
@@ -497,13 +478,9 @@ void ParticleSystem::Render() {
 
 	int inumtex = 0;
 
-	list<Particle *>::iterator i;
-
-	for (i = listParticle.begin(); i != listParticle.end(); ++i)
+	for (size_t i = 0; i < particles.count(); i++)
 	{
-		Particle * p = *i;
-
-		if (p->isAlive())
+		if (particles.isAlive(i))
 		{
 			if (fParticleFlash > 0)
 			{
@@ -513,12 +490,12 @@ void ParticleSystem::Render() {
 
 			if (iNbTex > 0)
 			{
-				inumtex = p->iTexNum;
+				inumtex = particles.texNum[i];
 
 				if (iTexTime == 0)
 				{
 
-					float fNbTex	= (p->ulTime * p->fOneOnTTL) * (iNbTex);
+					float fNbTex	= (particles.time[i] * particles.oneOnTTL[i]) * (iNbTex);
 
 					inumtex = checked_range_cast<int>(fNbTex);
 					if(inumtex >= iNbTex) {
@@ -527,30 +504,30 @@ void ParticleSystem::Render() {
 				}
 				else
 				{
-					if (p->iTexTime > iTexTime)
+					if (particles.texTime[i] > iTexTime)
 					{
-						p->iTexTime -= iTexTime;
-						p->iTexNum++;
+						particles.texTime[i] -= iTexTime;
+						particles.texNum[i]++;
 
-						if (p->iTexNum > iNbTex - 1)
+						if (particles.texNum[i] > iNbTex - 1)
 						{
 							if (bTexLoop)
 							{
-								p->iTexNum = 0;
+								particles.texNum[i] = 0;
 							}
 							else
 							{
-								p->iTexNum = iNbTex - 1;
+								particles.texNum[i] = iNbTex - 1;
 							}
 						}
 
-						inumtex = p->iTexNum;
+						inumtex = particles.texNum[i];
 					}
 				}
 			}
 			
 			TexturedVertex p3pos;
-			p3pos.p = p->p3Pos;
+			p3pos.p = particles.pos[i];
 			if(bParticleFollow) {
 				p3pos.p += p3Pos;
 			}
@@ -558,18 +535,18 @@ void ParticleSystem::Render() {
 			if (fParticleRotation != 0)
 			{
 				float fRot;
-				if (p->iRot == 1)
-					fRot = (fParticleRotation) * p->ulTime + p->fRotStart;
+				if (particles.rot[i] == 1)
+					fRot = (fParticleRotation) * particles.time[i] + particles.rotStart[i];
 				else
-					fRot = (-fParticleRotation) * p->ulTime + p->fRotStart;
+					fRot = (-fParticleRotation) * particles.time[i] + particles.rotStart[i];
 
 				if (tex_tab[inumtex])
-					EERIEDrawRotatedSprite(&p3pos, p->fSize, tex_tab[inumtex], p->ulColor, 2, fRot);
+					EERIEDrawRotatedSprite(&p3pos, particles.size[i], tex_tab[inumtex], particles.color[i], 2, fRot);
 			}
 			else
 			{
 				if (tex_tab[inumtex])
-					EERIEDrawSprite(&p3pos, p->fSize, tex_tab[inumtex], p->ulColor, 2);
+					EERIEDrawSprite(&p3pos, particles.size[i], tex_tab[inumtex], particles.color[i], 2);
 			}
 		}
 	}
@@ -44,15 +44,15 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #ifndef ARX_GRAPHICS_PARTICLE_PARTICLESYSTEM_H
 #define ARX_GRAPHICS_PARTICLE_PARTICLESYSTEM_H
 
-#include <list>
+#include <stddef.h>
 
 #include "graphics/BaseGraphicsTypes.h"
 #include "graphics/Renderer.h"
+#include "graphics/particle/ParticlePool.h"
 #include "math/MathFwd.h"
 #include "math/Vector3.h"
 #include "platform/Flags.h"
  
-class Particle;
 class ParticleParams;
 class TextureContainer;
 
@@ -67,7 +67,7 @@ class ParticleSystem {
 	
 public:
 	
-	std::list<Particle *> listParticle;
+	ParticlePool particles;
 	
 	Vec3f p3Pos;
 	
@@ -131,8 +131,8 @@ public:
 	ParticleSystem();
 	~ParticleSystem();
 	
-	void SpawnParticle(Particle * particle);
-	void SetParticleParams(Particle * particle);
+	void SpawnParticle(size_t particle);
+	void SetParticleParams(size_t particle);
 	
 	void SetParams(const ParticleParams & app);
 	
@@ -52,8 +52,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "game/Player.h"
 #include "game/Spells.h"
 
-#include "graphics/particle/Particle.h"
 #include "graphics/particle/ParticleParams.h"
+#include "graphics/particle/ParticlePool.h"
 #include "graphics/particle/ParticleSystem.h"
 
 #include "scene/Light.h"
@@ -192,16 +192,14 @@ void CHeal::Update(unsigned long aulTime)
 		pPS->ulParticleSpawn = PARTICLE_CIRCULAR;
 		pPS->p3ParticleGravity = Vec3f::ZERO;
 
-		std::list<Particle *>::iterator i;
+		ParticlePool & particles = pPS->particles;
 
-		for(i = pPS->listParticle.begin(); i != pPS->listParticle.end(); ++i) {
-			Particle * pP = *i;
+		for(size_t i = 0; i < particles.count(); i++) {
+			if(particles.isAlive(i)) {
+				particles.colorEnd[i].a = 0;
 
-			if(pP->isAlive()) {
-				pP->fColorEnd[3] = 0;
-
-				if(pP->ulTime + ff < pP->ulTTL) {
-					pP->ulTime = pP->ulTTL - ff;
+				if(particles.time[i] + ff < particles.ttl[i]) {
+					particles.time[i] = particles.ttl[i] - ff;
 				}
 			}
 		}
@@ -56,8 +56,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/data/TextureContainer.h"
 #include "graphics/effects/SpellEffects.h"
 #include "graphics/particle/ParticleEffects.h"
-#include "graphics/particle/Particle.h"
 #include "graphics/particle/ParticleParams.h"
+#include "graphics/particle/ParticlePool.h"
 #include "graphics/spells/Spells05.h"
 
 #include "scene/Object.h"
@@ -178,18 +178,16 @@ void CFireBall::SetTTL(unsigned long aulTTL)
 	SetDuration(ulDuration);
 	ulCurrentTime = t;
 
-	std::list<Particle *>::iterator i;
-
 	unsigned long ulCalc = ulDuration - ulCurrentTime ;
 	arx_assert(ulCalc <= LONG_MAX);
 	long ff = static_cast<long>(ulCalc);
 
-	for(i = pPSSmoke.listParticle.begin(); i != pPSSmoke.listParticle.end(); ++i) {
-		Particle * pP = *i;
+	ParticlePool & particles = pPSSmoke.particles;
 
-		if(pP->isAlive()) {
-			if(pP->ulTime + ff < pP->ulTTL) {
-				pP->ulTime = pP->ulTTL - ff;
+	for(size_t i = 0; i < particles.count(); i++) {
+		if(particles.isAlive(i)) {
+			if(particles.time[i] + ff < particles.ttl[i]) {
+				particles.time[i] = particles.ttl[i] - ff;
 			}
 		}
 	}
@@ -918,16 +916,14 @@ if (ulCurrentTime >= ulDuration)
 			pPS->ulParticleSpawn = PARTICLE_CIRCULAR;
 			pPS->p3ParticleGravity = Vec3f::ZERO;
 
-		std::list<Particle *>::iterator i;
-
-		for(i = pPS->listParticle.begin(); i != pPS->listParticle.end(); ++i) {
-			Particle * pP = *i;
+		ParticlePool & particles = pPS->particles;
 
-			if(pP->isAlive()) {
-				pP->fColorEnd[3] = 0;
+		for(size_t i = 0; i < particles.count(); i++) {
+			if(particles.isAlive(i)) {
+				particles.colorEnd[i].a = 0;
 
-					if(pP->ulTime + ff < pP->ulTTL) {
-						pP->ulTime = pP->ulTTL - ff;
+					if(particles.time[i] + ff < particles.ttl[i]) {
+						particles.time[i] = particles.ttl[i] - ff;
 					}
 				}
 			}
@@ -60,9 +60,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/effects/SpellEffects.h"
 #include "graphics/effects/Fog.h"
 #include "graphics/particle/ParticleEffects.h"
-#include "graphics/particle/Particle.h"
 #include "graphics/particle/ParticleManager.h"
 #include "graphics/particle/ParticleParams.h"
+#include "graphics/particle/ParticlePool.h"
 #include "graphics/texture/TextureStage.h"
 
 #include "scene/Interactive.h"
@@ -208,16 +208,14 @@ void CCurePoison::Update(unsigned long aulTime)
 		pPS->ulParticleSpawn = PARTICLE_CIRCULAR;
 		pPS->p3ParticleGravity = Vec3f::ZERO;
 
-		std::list<Particle *>::iterator i;
+		ParticlePool & particles = pPS->particles;
 
-		for(i = pPS->listParticle.begin(); i != pPS->listParticle.end(); ++i) {
-			Particle * pP = *i;
+		for(size_t i = 0; i < particles.count(); i++) {
+			if(particles.isAlive(i)) {
+				particles.colorEnd[i].a = 0;
 
-			if(pP->isAlive()) {
-				pP->fColorEnd[3] = 0;
-
-				if(pP->ulTime + ff < pP->ulTTL) {
-					pP->ulTime = pP->ulTTL - ff;
+				if(particles.time[i] + ff < particles.ttl[i]) {
+					particles.time[i] = particles.ttl[i] - ff;
 				}
 			}
 		}
@@ -477,17 +475,17 @@ void LaunchPoisonExplosion(Vec3f * aePos) {
 	pPS->Update(0);
 	pPS->iParticleNbMax = 0;
 
-	std::list<Particle *>::iterator i;
+	ParticlePool & particles = pPS->particles;
 
-	for(i = pPS->listParticle.begin(); i != pPS->listParticle.end(); ++i) {
-		Particle * pP = *i;
+	for(size_t i = 0; i < particles.count(); i++) {
+		if(particles.isAlive(i)) {
+			Vec3f & velocity = particles.velocity[i];
 
-		if(pP->isAlive()) {
-			if(pP->p3Velocity.y >= 0.5f * 200)
-				pP->p3Velocity.y = 0.5f * 200;
+			if(velocity.y >= 0.5f * 200)
+				velocity.y = 0.5f * 200;
 
-			if(pP->p3Velocity.y <= -0.5f * 200)
-				pP->p3Velocity.y = -0.5f * 200;
+			if(velocity.y <= -0.5f * 200)
+				velocity.y = -0.5f * 200;
 		}
 	}
 
@@ -19,6 +19,8 @@
 
 #include "graphics/texture/Texture.h"
 
+#include "platform/profiler/LoadStatistics.h"
+
 bool Texture2D::Init(const res::path & strFileName, TextureFlags newFlags) {
 	
 	mFileName = strFileName;
@@ -48,6 +50,8 @@ bool Texture2D::Init(unsigned int pWidth, unsigned int pHeight, Image::Format pF
 
 bool Texture2D::Restore() {
 	
+	ARX_LOAD_PHASE(LoadTextures);
+	
 	bool bRestored = false;
 
 	if(!mFileName.empty()) {
@@ -252,6 +252,8 @@ void Credits::render() {
 		ARXmenu.mda->creditspos -= 0.03f * Yratio * dtime;
 		ARXmenu.mda->creditstart = time;
 		
+		TextBatch batch;
+		
 		std::vector<CreditsTextInformations>::const_iterator it = CreditsData.aCreditsInformations.begin() + CreditsData.iFirstLine ;
 		for (; it != CreditsData.aCreditsInformations.end(); ++it)
 		{
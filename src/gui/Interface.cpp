@@ -1845,9 +1845,11 @@ void ArxGame::manageEditorControls() {
 			if(Project.telekinesis)
 				fMaxdist = 850;
 
-			for(size_t i = 0; i < MAX_LIGHTS; i++) {
-				if ((GLight[i]!=NULL) &&
-					(GLight[i]->exist) &&
+			std::vector<size_t> lights;
+			EERIE_LIGHT_GetNear(player.pos, fMaxdist, lights);
+			for(size_t l = 0; l < lights.size(); l++) {
+				size_t i = lights[l];
+				if ((GLight[i]->exist) &&
 					!fartherThan(GLight[i]->pos, player.pos, fMaxdist) &&
 					!(GLight[i]->extras & EXTRAS_NO_IGNIT))
 				{
@@ -1914,9 +1916,11 @@ void ArxGame::manageEditorControls() {
 		if(Project.telekinesis)
 			fMaxdist = 850;
 
-		for(size_t i = 0; i < MAX_LIGHTS; i++) {
-			if ((GLight[i]!=NULL) &&
-				(GLight[i]->exist) &&
+		std::vector<size_t> lights;
+		EERIE_LIGHT_GetNear(player.pos, fMaxdist, lights);
+		for(size_t l = 0; l < lights.size(); l++) {
+			size_t i = lights[l];
+			if ((GLight[i]->exist) &&
 				!fartherThan(GLight[i]->pos, player.pos, fMaxdist) &&
 				!(GLight[i]->extras & EXTRAS_NO_IGNIT))
 			{
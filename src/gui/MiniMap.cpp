@@ -46,6 +46,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "gui/MiniMap.h"
 
+#include <cmath>
 #include <cstdio>
 
 #include "core/Core.h"
@@ -72,6 +73,16 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 MiniMap g_miniMap; // TODO: remove this
 
+//! Unrevealed cells drawn around each side of the map
+static const int MINIMAP_MESH_BORDER = 2;
+static const int MINIMAP_MESH_X = MINIMAP_MAX_X + 2 * MINIMAP_MESH_BORDER;
+static const int MINIMAP_MESH_Z = MINIMAP_MAX_Z + 2 * MINIMAP_MESH_BORDER;
+
+//! Index of the first vertex of a cell in the level meshes
+static size_t getMeshCell(int i, int j) {
+	return size_t((j + MINIMAP_MESH_BORDER) * MINIMAP_MESH_X + (i + MINIMAP_MESH_BORDER)) * 4;
+}
+
 void MiniMap::getData(int showLevel) {
 	
 	if(m_levels[showLevel].m_texContainer == NULL) {
@@ -229,6 +240,8 @@ void MiniMap::reveal() {
 			}
 		}
 	}
+	
+	clearMeshes();
 }
 
 void MiniMap::firstInit(ARXCHARACTER *pl, PakReader *pakRes, EntityManager *entityMng, Font *font) {
@@ -270,6 +283,8 @@ void MiniMap::resetLevels() {
 		m_levels[i].m_height = 0.f;
 		memset(m_levels[i].m_revealed, 0, sizeof(m_levels[i].m_revealed[0][0] * MINIMAP_MAX_X * MINIMAP_MAX_Z)); // Sets the whole array to 0
 	}
+	
+	clearMeshes();
 }
 
 void MiniMap::reset() {
@@ -284,6 +299,8 @@ void MiniMap::purgeTexContainer() {
 		delete m_levels[i].m_texContainer;
 		m_levels[i].m_texContainer = NULL;
 	}
+	
+	clearMeshes();
 }
 
 void MiniMap::showPlayerMiniMap(int showLevel) {
@@ -478,16 +495,21 @@ void MiniMap::revealPlayerPos(int showLevel) {
 	playerPos.x += startX;
 	playerPos.y += startY;
 	
-	// TODO this is inefficient - we don't really need to iterate over the whole minimap!
-	// only the area around the player will be modified
-	for(int j = 0; j < MINIMAP_MAX_Z; j++) {
-		for(int i = 0; i < MINIMAP_MAX_X; i++) {
+	// Only the cells around the player can be revealed
+	float radius = 6.f;
+	int minI = std::max(0, int(std::floor((playerPos.x - radius - startX) / caseX - 0.5f)));
+	int maxI = std::min(MINIMAP_MAX_X - 1, int(std::ceil((playerPos.x + radius - startX) / caseX)));
+	int minJ = std::max(0, int(std::floor((playerPos.y - radius - startY) / caseY)));
+	int maxJ = std::min(MINIMAP_MAX_Z - 1, int(std::ceil((playerPos.y + radius - startY) / caseY)));
+	
+	for(int j = minJ; j <= maxJ; j++) {
+		for(int i = minI; i <= maxI; i++) {
 			
 			float posx = startX + i * caseX;
 			float posy = startY + j * caseY;
 			
 			float d = fdist(Vec2f(posx + caseX * 0.5f, posy), playerPos);
-			if(d > 6.f) {
+			if(d > radius) {
 				continue;
 			}
 			
@@ -503,12 +525,81 @@ void MiniMap::revealPlayerPos(int showLevel) {
 			
 			int r = vv * 255.f;
 			
-			int ucLevel =  max(r, (int)m_levels[showLevel].m_revealed[i][j]);
-			m_levels[showLevel].m_revealed[i][j] = checked_range_cast<unsigned char>(ucLevel);
+			int ucLevel = (int)m_levels[showLevel].m_revealed[i][j];
+			if(r > ucLevel) {
+				m_levels[showLevel].m_revealed[i][j] = checked_range_cast<unsigned char>(r);
+				updateMesh(showLevel, i, j);
+			}
 		}
 	}
 }
 
+void MiniMap::clearMeshes() {
+	for(int i = 0; i < MAX_MINIMAP_LEVELS; i++) {
+		m_meshes[i].clear();
+	}
+}
+
+void MiniMap::buildMesh(int showLevel) {
+	
+	std::vector<MeshVertex> & mesh = m_meshes[showLevel];
+	mesh.resize(size_t(MINIMAP_MESH_X * MINIMAP_MESH_Z) * 4);
+	
+	float div = (1.0f / 25);
+	TextureContainer * tc = m_levels[showLevel].m_texContainer;
+	float dw = 1.f / tc->m_pTexture->getStoredSize().x; 
+	float dh = 1.f / tc->m_pTexture->getStoredSize().y;
+	
+	float vx2 = 4.f * dw * m_modX;
+	float vy2 = 4.f * dh * m_modZ;
+	
+	for(int j = -MINIMAP_MESH_BORDER; j < MINIMAP_MAX_Z + MINIMAP_MESH_BORDER; j++) {
+		for(int i = -MINIMAP_MESH_BORDER; i < MINIMAP_MAX_X + MINIMAP_MESH_BORDER; i++) {
+			
+			float vxx = ((float)i * (float)m_activeBkg->Xdiv * m_modX);
+			float vyy = ((float)j * (float)m_activeBkg->Zdiv * m_modZ);
+			float vx = (vxx * div) * dw;
+			float vy = (vyy * div) * dh;
+			
+			MeshVertex * verts = &mesh[getMeshCell(i, j)];
+			
+			verts[3].uv.x = verts[0].uv.x = vx;
+			verts[1].uv.y = verts[0].uv.y = vy;
+			verts[2].uv.x = verts[1].uv.x = vx + vx2;
+			verts[3].uv.y = verts[2].uv.y = vy + vy2;
+			
+			for(int vert = 0; vert < 4; vert++) {
+				
+				// Array offset according to "vert"
+				int ci = i + ((vert == 1 || vert == 2) ? 1 : 0);
+				int cj = j + ((vert == 2 || vert == 3) ? 1 : 0);
+				
+				if(ci < 0 || ci >= MINIMAP_MAX_X || cj < 0 || cj >= MINIMAP_MAX_Z) {
+					verts[vert].revealed = 0.f;
+				} else {
+					verts[vert].revealed = float(m_levels[showLevel].m_revealed[ci][cj]) * (1.0f / 255);
+				}
+			}
+		}
+	}
+}
+
+void MiniMap::updateMesh(int showLevel, int i, int j) {
+	
+	std::vector<MeshVertex> & mesh = m_meshes[showLevel];
+	if(mesh.empty()) {
+		return;
+	}
+	
+	float revealed = float(m_levels[showLevel].m_revealed[i][j]) * (1.0f / 255);
+	
+	// The corner is shared by the four cells around it
+	mesh[getMeshCell(i, j) + 0].revealed = revealed;
+	mesh[getMeshCell(i - 1, j) + 1].revealed = revealed;
+	mesh[getMeshCell(i - 1, j - 1) + 2].revealed = revealed;
+	mesh[getMeshCell(i, j - 1) + 3].revealed = revealed;
+}
+
 Vec2f MiniMap::computePlayerPos(float zoom, int showLevel) {
 	
 	float caseX = zoom / ((float)MINIMAP_MAX_X);
@@ -530,27 +621,56 @@ Vec2f MiniMap::computePlayerPos(float zoom, int showLevel) {
 	return pos;
 }
 
+//! Fade out the revealed state of a vertex near the border of the map area
+static float fadeRevealed(float v, const Vec2f & pos, const Rect & bounds, float fadeBorder,
+                          float fadeDiv) {
+	
+	float _px = pos.x - bounds.left;
+	
+	if(_px < 0.f) {
+		v = 0.f;
+	} else if(_px < fadeBorder) {
+		v *= _px * fadeDiv;
+	}
+	
+	_px = bounds.right - pos.x;
+	
+	if(_px < 0.f) {
+		v = 0.f;
+	} else if(_px < fadeBorder) {
+		v *= _px * fadeDiv;
+	}
+	
+	_px = pos.y - bounds.top;
+	
+	if(_px < 0.f) {
+		v = 0.f;
+	} else if(_px < fadeBorder) {
+		v *= _px * fadeDiv;
+	}
+	
+	_px = bounds.bottom - pos.y;
+	
+	if(_px < 0.f) {
+		v = 0.f;
+	} else if(_px < fadeBorder) {
+		v *= _px * fadeDiv;
+	}
+	
+	return v;
+}
+
 void MiniMap::drawBackground(int showLevel, Rect boundaries, float startX, float startY, float zoom, float fadeBorder, float decalX, float decalY, bool invColor, float alpha) {
 	
 	float caseX = zoom / ((float)MINIMAP_MAX_X);
 	float caseY = zoom / ((float)MINIMAP_MAX_Z);
 	
-	TexturedVertex verts[4];
-	GRenderer->SetTexture(0, m_levels[showLevel].m_texContainer);
-	
-	for(int k = 0; k < 4; k++) {
-		verts[k].color = 0xFFFFFFFF;
-		verts[k].rhw = 1;
-		verts[k].p.z = 0.00001f;
+	if(m_meshes[showLevel].empty()) {
+		buildMesh(showLevel);
 	}
+	const std::vector<MeshVertex> & mesh = m_meshes[showLevel];
 	
-	float div = (1.0f / 25);
-	TextureContainer * tc = m_levels[showLevel].m_texContainer;
-	float dw = 1.f / tc->m_pTexture->getStoredSize().x; 
-	float dh = 1.f / tc->m_pTexture->getStoredSize().y;
-	
-	float vx2 = 4.f * dw * m_modX;
-	float vy2 = 4.f * dh * m_modZ;
+	GRenderer->SetTexture(0, m_levels[showLevel].m_texContainer);
 	
 	float fadeDiv = 0.f;
 	Rect fadeBounds(0, 0, 0, 0);
@@ -563,22 +683,32 @@ void MiniMap::drawBackground(int showLevel, Rect boundaries, float startX, float
 		fadeBounds.bottom = checked_range_cast<Rect::Num>((boundaries.bottom - fadeBorder) * Yratio);
 	}
 	
-	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
-	if(invColor) {
-		GRenderer->SetBlendFunc(Renderer::BlendOne, Renderer::BlendInvSrcColor);
-	} else {
-		GRenderer->SetBlendFunc(Renderer::BlendZero, Renderer::BlendInvSrcColor);
+	int minI = -MINIMAP_MESH_BORDER;
+	int maxI = MINIMAP_MAX_X + MINIMAP_MESH_BORDER - 1;
+	int minJ = -MINIMAP_MESH_BORDER;
+	int maxJ = MINIMAP_MAX_Z + MINIMAP_MESH_BORDER - 1;
+	
+	if(fadeBorder > 0.f) {
+		// The zoomed in maps only show a few cells: skip rows and columns that are
+		// entirely outside the boundaries, the per-cell test below still applies
+		minI = std::max(minI, int(std::floor((boundaries.left - startX) / caseX)) - 1);
+		maxI = std::min(maxI, int(std::ceil((boundaries.right - startX) / caseX)) + 1);
+		minJ = std::max(minJ, int(std::floor((boundaries.top - startY) / caseY)) - 1);
+		maxJ = std::min(maxJ, int(std::ceil((boundaries.bottom - startY) / caseY)) + 1);
 	}
-	GRenderer->GetTextureStage(0)->SetWrapMode(TextureStage::WrapClamp);
 	
-	for(int j = -2; j < MINIMAP_MAX_Z + 2; j++) {
-		for(int i = -2; i < MINIMAP_MAX_X + 2; i++) {
-			
-			float vx, vy, vxx, vyy;
-			vxx = ((float)i * (float)m_activeBkg->Xdiv * m_modX);
-			vyy = ((float)j * (float)m_activeBkg->Zdiv * m_modZ);
-			vx = (vxx * div) * dw;
-			vy = (vyy * div) * dh;
+	m_drawVertices.clear();
+	m_drawIndices.clear();
+	
+	TexturedVertex verts[4];
+	for(int k = 0; k < 4; k++) {
+		verts[k].rhw = 1;
+		verts[k].p.z = 0.00001f;
+		verts[k].specular = 0xFF000000;
+	}
+	
+	for(int j = minJ; j <= maxJ; j++) {
+		for(int i = minI; i <= maxI; i++) {
 			
 			float posx = (startX + i * caseX) * Xratio;
 			float posy = (startY + j * caseY) * Yratio;
@@ -595,87 +725,61 @@ void MiniMap::drawBackground(int showLevel, Rect boundaries, float startX, float
 			verts[2].p.x = verts[1].p.x = posx + (caseX * Xratio);
 			verts[3].p.y = verts[2].p.y = posy + (caseY * Yratio);
 			
-			verts[3].uv.x = verts[0].uv.x = vx;
-			verts[1].uv.y = verts[0].uv.y = vy;
-			verts[2].uv.x = verts[1].uv.x = vx + vx2;
-			verts[3].uv.y = verts[2].uv.y = vy + vy2;
+			const MeshVertex * cell = &mesh[getMeshCell(i, j)];
 			
-			float v;
 			float oo = 0.f;
 			
 			for(int vert = 0; vert < 4; vert++) {
 				
-				// Array offset according to "vert"
-				int iOffset = 0;
-				int jOffset = 0;
-				
-				if(vert == 1 || vert == 2)
-					iOffset = 1;
-				if(vert == 2 || vert == 3)
-					jOffset = 1;
-				
-				if((i + iOffset < 0) || (i + iOffset >= MINIMAP_MAX_X) || (j + jOffset < 0) || (j + jOffset >= MINIMAP_MAX_Z)) {
-					v = 0;
-				} else {
-					v = ((float)m_levels[showLevel].m_revealed[min(i+iOffset, MINIMAP_MAX_X-iOffset)][min(j+jOffset, MINIMAP_MAX_Z-jOffset)]) * (1.0f / 255);
-				}
+				float v = cell[vert].revealed;
 				
 				if(fadeBorder > 0.f) {
-					
-					float _px = verts[vert].p.x - fadeBounds.left;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = fadeBounds.right - verts[vert].p.x;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = verts[vert].p.y - fadeBounds.top;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = fadeBounds.bottom - verts[vert].p.y;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
+					v = fadeRevealed(v, Vec2f(verts[vert].p.x, verts[vert].p.y), fadeBounds,
+					                 fadeBorder, fadeDiv);
 				}
 				
 				verts[vert].color = Color::gray(v * alpha).toBGR();
+				verts[vert].uv = cell[vert].uv;
 				
 				oo += v;
 			}
 			
 			if(oo > 0.f) {
 				
-				verts[0].p.x += decalX * Xratio;
-				verts[0].p.y += decalY * Yratio;
-				verts[1].p.x += decalX * Xratio;
-				verts[1].p.y += decalY * Yratio;
-				verts[2].p.x += decalX * Xratio;
-				verts[2].p.y += decalY * Yratio;
-				verts[3].p.x += decalX * Xratio;
-				verts[3].p.y += decalY * Yratio;
+				unsigned short base = static_cast<unsigned short>(m_drawVertices.size());
+				
+				for(int vert = 0; vert < 4; vert++) {
+					verts[vert].p.x += decalX * Xratio;
+					verts[vert].p.y += decalY * Yratio;
+					m_drawVertices.push_back(verts[vert]);
+				}
 				
-				EERIEDRAWPRIM(Renderer::TriangleFan, verts, 4);
+				m_drawIndices.push_back(base);
+				m_drawIndices.push_back(base + 1);
+				m_drawIndices.push_back(base + 2);
+				m_drawIndices.push_back(base);
+				m_drawIndices.push_back(base + 2);
+				m_drawIndices.push_back(base + 3);
 			}
 		}
 	}
 	
+	if(m_drawVertices.empty()) {
+		return;
+	}
+	
+	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
+	if(invColor) {
+		GRenderer->SetBlendFunc(Renderer::BlendOne, Renderer::BlendInvSrcColor);
+	} else {
+		GRenderer->SetBlendFunc(Renderer::BlendZero, Renderer::BlendInvSrcColor);
+	}
+	GRenderer->GetTextureStage(0)->SetWrapMode(TextureStage::WrapClamp);
+	
+	// All visible cells in one draw call
+	GRenderer->drawIndexed(Renderer::TriangleList, &m_drawVertices[0], m_drawVertices.size(),
+	                       &m_drawIndices[0], m_drawIndices.size());
+	
 	GRenderer->SetRenderState(Renderer::AlphaBlending, false);
 }
 
@@ -792,6 +896,7 @@ void MiniMap::clearMarkerTexCont() {
 
 void MiniMap::load(const SavedMiniMap *saved, size_t size) {
 	std::copy(saved, saved + size, m_levels);
+	clearMeshes();
 }
 
 void MiniMap::save(SavedMiniMap *toSave, size_t size) {
@@ -861,4 +966,5 @@ MiniMap::MapMarkerData MiniMap::mapMarkerGet(size_t id) {
 
 void MiniMap::setActiveBackground(EERIE_BACKGROUND *activeBkg) {
 	m_activeBkg = activeBkg;
+	clearMeshes(); // The texture coordinates depend on the background grid size
 }
@@ -172,11 +172,35 @@ private:
 	std::vector<MapMarkerData> m_mapMarkers;
 	MiniMapData m_levels[MAX_MINIMAP_LEVELS];
 	
+	//! Corner of a background cell
+	struct MeshVertex {
+		Vec2f uv;
+		float revealed; //!< Revealed state of the corner in [0, 1]
+	};
+	
+	/*!
+	 * Cached background geometry of each level, four vertices per cell including a border
+	 * of unrevealed cells. Built when a level is first drawn and updated by revealPlayerPos().
+	 */
+	std::vector<MeshVertex> m_meshes[MAX_MINIMAP_LEVELS];
+	
+	//! Vertices and indices of the last drawn background, kept to avoid reallocations
+	std::vector<TexturedVertex> m_drawVertices;
+	std::vector<unsigned short> m_drawIndices;
+	
 	void getData(int showLevel);
 	void resetLevels();
 	void loadOffsets(PakReader *pakRes);
 	void validatePos();
 	
+	void buildMesh(int showLevel);
+	
+	//! Update the vertices at a cell corner after its revealed state changed
+	void updateMesh(int showLevel, int i, int j);
+	
+	//! Drop the cached geometry of all levels
+	void clearMeshes();
+	
 	/*!
 	* Reveals the direct surroundings of the player
 	*
@@ -190,6 +190,8 @@ long ARX_UNICODE_DrawTextInRect(Font* font,
 	
 	Rect previousViewport;
 	if(pClipRect) {
+		// Queued glyphs must be drawn with the viewport they were positioned for
+		TextBatch::flushActive();
 		previousViewport = GRenderer->GetViewport();
 		GRenderer->SetViewport(*pClipRect); 
 	}
@@ -203,6 +205,7 @@ long ARX_UNICODE_DrawTextInRect(Font* font,
 	ARX_UNICODE_FormattingInRect(font, _text, rect, col, &height);
 
 	if(pClipRect) {
+		TextBatch::flushActive();
 		GRenderer->SetViewport(previousViewport);
 	}
 
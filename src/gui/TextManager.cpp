@@ -156,6 +156,10 @@ void TextManager::Update(float _fDiffFrame) {
 }
 
 void TextManager::Render() {
+	
+	// Draw all entries together, entries with a clipping rect flush the batch
+	TextBatch batch;
+	
 	vector<ManagedText *>::const_iterator itManage = entries.begin();
 	for(; itManage != entries.end(); ++itManage) {
 		
@@ -293,6 +293,12 @@ void Input::reset()
 	iWheelDir = 0;
 }
 
+InputBackend * Input::setBackend(InputBackend * newBackend) {
+	InputBackend * oldBackend = backend;
+	backend = newBackend;
+	return oldBackend;
+}
+
 void Input::acquireDevices()
 {
 	backend->acquireDevices();
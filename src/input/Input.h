@@ -68,6 +68,14 @@ public:
 	
 	void update();
 	
+	/*!
+	 * Replace the input backend.
+	 * The caller takes ownership of the old backend and the input system takes ownership
+	 * of the new one.
+	 * @return the previous backend
+	 */
+	class InputBackend * setBackend(class InputBackend * newBackend);
+	
 	static std::string getKeyName(InputKeyId key, bool localizedName = false);
 	static InputKeyId getKeyId(const std::string & keyName);
 	
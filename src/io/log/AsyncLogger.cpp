@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io/log/AsyncLogger.h"
+
+#include "io/log/Logger.h"
+#include "platform/Platform.h"
+#include "platform/Thread.h"
+
+namespace logger {
+
+namespace {
+
+//! How long to wait before checking the queue again if it was empty
+const unsigned ASYNC_LOG_INTERVAL = 5; // ms
+
+class AsyncWriterThread : public StoppableThread {
+	
+	void run() {
+		
+		while(!isStopRequested()) {
+			if(!Logger::processQueue()) {
+				sleep(ASYNC_LOG_INTERVAL);
+			}
+		}
+		
+	}
+	
+};
+
+AsyncWriterThread * writerThread = NULL;
+
+} // anonymous namespace
+
+void startAsyncWriter() {
+	
+	arx_assert(!writerThread);
+	
+	Logger::setAsynchronous(true);
+	
+	writerThread = new AsyncWriterThread();
+	writerThread->setThreadName("Log Writer");
+	writerThread->start();
+}
+
+void stopAsyncWriter() {
+	
+	if(!writerThread) {
+		return;
+	}
+	
+	writerThread->stop();
+	delete writerThread, writerThread = NULL;
+	
+	Logger::setAsynchronous(false);
+}
+
+} // namespace logger
@@ -21,6 +21,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <sstream>
 #include <vector>
 #include <algorithm>
 
@@ -31,6 +32,7 @@
 #include "io/log/LogBackend.h"
 #include "io/log/MsvcLogger.h"
 
+#include "platform/Atomic.h"
 #include "platform/Lock.h"
 #include "platform/ProgramOptions.h"
 
@@ -44,6 +46,10 @@ struct LogManager {
 	
 	static const Logger::LogLevel defaultLevel;
 	static Logger::LogLevel minimumLevel;
+	static Logger::LogLevel maximumLevel;
+	
+	//! Incremented whenever the log levels change to invalidate logger::CallSite caches.
+	static volatile u32 generation;
 	
 	static Lock lock;
 	
@@ -59,14 +65,54 @@ struct LogManager {
 	
 	static logger::Source * getSource(const char * file);
 	static void deleteAllBackends();
+	static void rulesChanged();
+	static void write(const char * file, int line, Logger::LogLevel level,
+	                  const string & str);
+	
+	/*!
+	 * Bounded multi-producer single-consumer message queue.
+	 * Producers claim a slot by incrementing queueEnd. Each slot has a sequence number
+	 * that tells the consumer when it has been filled and the producers when it has
+	 * been consumed and can be reused.
+	 */
+	struct QueuedMessage {
+		volatile u32 sequence;
+		const char * file;
+		int line;
+		Logger::LogLevel level;
+		string str;
+	};
+	static const u32 queueSize = 4096; // must be a power of two
+	static QueuedMessage queue[queueSize];
+	static bool queueInitialized;
+	static volatile u32 queueBegin;
+	static volatile u32 queueEnd;
+	static volatile u32 dropped;
+	static volatile u32 asynchronous;
+	
+	//! Serializes consumers of the queue.
+	static Lock queueLock;
+	
+	static void enqueue(const char * file, int line, Logger::LogLevel level,
+	                    const string & str);
+	static bool dequeue(bool locked);
 };
 
 const Logger::LogLevel LogManager::defaultLevel = Logger::Info;
 Logger::LogLevel LogManager::minimumLevel = LogManager::defaultLevel;
+Logger::LogLevel LogManager::maximumLevel = LogManager::defaultLevel;
+volatile u32 LogManager::generation = 1;
 LogManager::Sources LogManager::sources;
 LogManager::Backends LogManager::backends;
 LogManager::Rules LogManager::rules;
 Lock LogManager::lock;
+LogManager::QueuedMessage LogManager::queue[LogManager::queueSize];
+bool LogManager::queueInitialized = false;
+volatile u32 LogManager::queueBegin = 0;
+volatile u32 LogManager::queueEnd = 0;
+volatile u32 LogManager::dropped = 0;
+volatile u32 LogManager::asynchronous = 0;
+Lock LogManager::queueLock;
 
 logger::Source * LogManager::getSource(const char * file) {
 	
@@ -119,6 +165,83 @@ void LogManager::deleteAllBackends() {
 	backends.clear();
 }
 
+void LogManager::rulesChanged() {
+	
+	minimumLevel = maximumLevel = defaultLevel;
+	BOOST_FOREACH(const Rules::value_type & i, rules) {
+		minimumLevel = std::min(minimumLevel, i.second);
+		maximumLevel = std::max(maximumLevel, i.second);
+	}
+	
+	sources.clear();
+	
+	atomicAdd(&generation, 1);
+}
+
+void LogManager::write(const char * file, int line, Logger::LogLevel level,
+                       const string & str) {
+	
+	const logger::Source * source = getSource(file);
+	
+	for(Backends::const_iterator i = backends.begin(); i != backends.end(); ++i) {
+		(*i)->log(*source, line, level, str);
+	}
+}
+
+void LogManager::enqueue(const char * file, int line, Logger::LogLevel level,
+                         const string & str) {
+	
+	u32 pos = atomicLoad(&queueEnd);
+	QueuedMessage * message;
+	for(;;) {
+		message = &queue[pos & (queueSize - 1)];
+		s32 diff = s32(atomicLoad(&message->sequence) - pos);
+		if(diff == 0) {
+			u32 old = atomicCompareExchange(&queueEnd, pos, pos + 1);
+			if(old == pos) {
+				break;
+			}
+			pos = old;
+		} else if(diff < 0) {
+			// The queue is full - drop the message instead of blocking the caller
+			atomicAdd(&dropped, 1);
+			return;
+		} else {
+			pos = atomicLoad(&queueEnd);
+		}
+	}
+	
+	message->file = file;
+	message->line = line;
+	message->level = level;
+	message->str = str;
+	
+	atomicStore(&message->sequence, pos + 1);
+}
+
+bool LogManager::dequeue(bool locked) {
+	
+	QueuedMessage & message = queue[queueBegin & (queueSize - 1)];
+	if(s32(atomicLoad(&message.sequence) - (queueBegin + 1)) < 0) {
+		return false;
+	}
+	
+	string str;
+	str.swap(message.str);
+	
+	if(locked) {
+		Autolock lock(LogManager::lock);
+		write(message.file, message.line, message.level, str);
+	} else {
+		write(message.file, message.line, message.level, str);
+	}
+	
+	atomicStore(&message.sequence, queueBegin + queueSize);
+	queueBegin++;
+	
+	return true;
+}
+
 } // anonymous namespace
 
 void Logger::add(logger::Backend * backend) {
@@ -146,27 +269,96 @@ bool Logger::isEnabled(const char * file, LogLevel level) {
 		return false;
 	}
 	
+	if(level >= LogManager::maximumLevel) {
+		return true;
+	}
+	
 	Autolock lock(LogManager::lock);
 	
 	return (LogManager::getSource(file)->level <= level);
 }
 
+bool Logger::isEnabled(logger::CallSite & site, const char * file, LogLevel level) {
+	
+	if(level < LogManager::minimumLevel) {
+		return false;
+	}
+	
+	u32 state = atomicLoad(&site.state);
+	u32 generation = atomicLoad(&LogManager::generation);
+	if((state >> 4) != generation) {
+		// Read the generation before looking up the level so that a concurrent change
+		// will invalidate the cache entry again.
+		Autolock lock(LogManager::lock);
+		state = (generation << 4) | u32(LogManager::getSource(file)->level);
+		atomicStore(&site.state, state);
+	}
+	
+	return (LogLevel(state & 0xf) <= level);
+}
+
 void Logger::log(const char * file, int line, LogLevel level, const string & str) {
 	
 	if(level == None) {
 		return;
 	}
 	
+	if(level != Critical && atomicLoad(&LogManager::asynchronous)) {
+		LogManager::enqueue(file, line, level, str);
+		return;
+	}
+	
+	// Write any queued messages first to keep the log in order
+	processQueue();
+	
 	Autolock lock(LogManager::lock);
 	
-	const logger::Source * source = LogManager::getSource(file);
+	LogManager::write(file, line, level, str);
+}
 	
-	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
-		  i != LogManager::backends.end(); ++i) {
-		(*i)->log(*source, line, level, str);
+bool Logger::processQueue() {
+	
+	if(!LogManager::queueInitialized) {
+		return false;
+	}
+	
+	Autolock lock(LogManager::queueLock);
+	
+	bool processed = false;
+	while(LogManager::dequeue(true)) {
+		processed = true;
+	}
+	
+	u32 dropped = atomicLoad(&LogManager::dropped);
+	if(dropped != 0) {
+		atomicAdd(&LogManager::dropped, u32(0) - dropped);
+		std::ostringstream oss;
+		oss << "Log queue full, dropped " << dropped << " messages";
+		Autolock lock(LogManager::lock);
+		LogManager::write(__FILE__, __LINE__, Warning, oss.str());
+		processed = true;
 	}
 	
-	LogManager::lock.unlock();
+	return processed;
+}
+
+void Logger::setAsynchronous(bool enable) {
+	
+	{
+		Autolock lock(LogManager::queueLock);
+		if(enable && !LogManager::queueInitialized) {
+			for(u32 i = 0; i < LogManager::queueSize; i++) {
+				LogManager::queue[i].sequence = i;
+			}
+			LogManager::queueInitialized = true;
+		}
+	}
+	
+	atomicStore(&LogManager::asynchronous, enable ? 1 : 0);
+	
+	if(!enable) {
+		processQueue();
+	}
 }
 
 void Logger::set(const string & prefix, Logger::LogLevel level) {
@@ -178,27 +370,14 @@ void Logger::set(const string & prefix, Logger::LogLevel level) {
 	
 	if(!ret.second) {
 		// entry already existed
-		
-		LogLevel oldLevel = ret.first->second;
-		if(level == oldLevel) {
+		if(level == ret.first->second) {
 			// nothing changed
 			return;
 		}
 		ret.first->second = level;
-		
-		if(level > oldLevel && oldLevel < LogManager::defaultLevel) {
-			// minimum log level may have changed
-			LogManager::minimumLevel = LogManager::defaultLevel;
-			BOOST_FOREACH(const LogManager::Rules::value_type & i, LogManager::rules) {
-				LogManager::minimumLevel = std::min(LogManager::minimumLevel, i.second);
-			}
-		}
-		
 	}
 	
-	LogManager::minimumLevel = std::min(LogManager::minimumLevel, level);
-	
-	LogManager::sources.clear();
+	LogManager::rulesChanged();
 }
 
 void Logger::reset(const string & prefix) {
@@ -210,21 +389,15 @@ void Logger::reset(const string & prefix) {
 		return;
 	}
 	
-	if(i->second < LogManager::defaultLevel) {
-		// minimum log level may have changed
-		LogManager::minimumLevel = LogManager::defaultLevel;
-		BOOST_FOREACH(const LogManager::Rules::value_type & i, LogManager::rules) {
-			LogManager::minimumLevel = std::min(LogManager::minimumLevel, i.second);
-		}
-	}
-	
 	LogManager::rules.erase(i);
 	
-	LogManager::sources.clear();
+	LogManager::rulesChanged();
 }
 
 void Logger::flush() {
 	
+	processQueue();
+	
 	Autolock lock(LogManager::lock);
 	
 	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
@@ -294,17 +467,23 @@ void Logger::initialize() {
 
 void Logger::shutdown() {
 	
+	setAsynchronous(false);
+	
 	Autolock lock(LogManager::lock);
 	
-	LogManager::sources.clear();
 	LogManager::rules.clear();
-	
-	LogManager::minimumLevel = LogManager::defaultLevel;
+	LogManager::rulesChanged();
 	
 	LogManager::deleteAllBackends();
 }
 
 void Logger::quickShutdown() {
+	
+	// We may have crashed while holding one of the locks - don't wait for them.
+	if(LogManager::queueInitialized) {
+		while(LogManager::dequeue(false)) { }
+	}
+	
 	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
 	    i != LogManager::backends.end(); ++i) {
 		(*i)->quickShutdown();
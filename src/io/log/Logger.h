@@ -26,10 +26,18 @@
 #include "platform/Platform.h"
 
 #ifdef ARX_DEBUG
-//! Log a Debug message. Arguments are only evaluated if their results will be used.
+/*!
+ * Log a Debug message. Arguments are only evaluated if their results will be used.
+ * The enabled state is cached per call site so that disabled debug output is cheap
+ * and does not need to take any locks.
+ */
 #define LogDebug(...)    \
-	if(::Logger::isEnabled(__FILE__, ::Logger::Debug)) \
-		::Logger(__FILE__, __LINE__, ::Logger::Debug, true) << __VA_ARGS__
+	do { \
+		static ::logger::CallSite arx_log_call_site = { 0 }; \
+		if(::Logger::isEnabled(arx_log_call_site, __FILE__, ::Logger::Debug)) { \
+			::Logger(__FILE__, __LINE__, ::Logger::Debug, true) << __VA_ARGS__; \
+		} \
+	} while(false)
 #else
 #define LogDebug(...)    ARX_DISCARD(__VA_ARGS__)
 #endif
@@ -58,7 +66,22 @@
 //! Test if the Error log level is enabled for the current file.
 #define LogErrorEnabled   ::Logger::isEnabled(__FILE__, ::Logger::Error)
 
-namespace logger { class Backend; }
+namespace logger {
+
+class Backend;
+
+/*!
+ * Cached log level for a single log statement.
+ * Must be statically zero-initialized.
+ */
+struct CallSite {
+	
+	//! Generation of the log configuration and the source log level.
+	volatile u32 state;
+	
+};
+
+} // namespace logger
 
 /*!
  * Logger class that allows longging via the stream operator.
@@ -160,11 +183,39 @@ public:
 	 */
 	static bool isEnabled(const char * file, LogLevel level);
 	
+	/*!
+	 * Same as isEnabled(const char *, LogLevel) but caches the result in the given
+	 * call site until the log configuration changes.
+	 * This does not take any locks unless the cache needs to be updated.
+	 */
+	static bool isEnabled(logger::CallSite & site, const char * file, LogLevel level);
+	
 	/*!
 	 * Flush buffered output in all logging backends.
+	 * This also writes out any queued messages.
 	 */
 	static void flush();
 	
+	/*!
+	 * Enable or disable asynchronous logging.
+	 * 
+	 * While enabled, messages below the Critical level are added to a bounded lock-free
+	 * queue instead of being written to the backends by the logging thread.
+	 * If the queue is full, messages are dropped and the number of dropped messages
+	 * is reported once there is room again.
+	 * Critical messages are always written immediately, after all queued messages.
+	 * 
+	 * Queued messages are written by processQueue(), flush(), quickShutdown() and
+	 * shutdown(). Disabling asynchronous logging writes all queued messages.
+	 */
+	static void setAsynchronous(bool enable);
+	
+	/*!
+	 * Write all queued messages to the logging backends.
+	 * @return true if any messages were written.
+	 */
+	static bool processQueue();
+	
 	/*!
 	* Helper class to pass a C string that might be NULL to the logger.
 	* If the pointer is NULL, the string "NULL" is logged.
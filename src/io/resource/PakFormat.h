@@ -0,0 +1,95 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * On-disk structures of indexed .ipak archives.
+ *
+ * The archive starts with a PAK_INDEXED_HEADER. The index at the end of the archive
+ * contains the file entries, the stored size of each compressed chunk and the
+ * NUL-terminated file paths, in that order. It can be read with a single read and is
+ * not encrypted. The path hash of each entry is only used to validate the path table
+ * when the index is loaded.
+ *
+ * Compressed files are split into chunks of PAK_INDEXED_CHUNK_SIZE bytes that are
+ * deflated independently and stored back to back, so any part of a file can be read
+ * without decompressing everything before it. A chunk whose stored size equals its
+ * uncompressed size is stored as-is. Files that don't compress well are stored
+ * uncompressed at page-aligned offsets.
+ *
+ * The header records the size and modification time of the .pak file the archive was
+ * converted from so that an outdated .ipak can be detected and ignored.
+ *
+ * All values are little-endian.
+ */
+#ifndef ARX_IO_RESOURCE_PAKFORMAT_H
+#define ARX_IO_RESOURCE_PAKFORMAT_H
+
+#include <stddef.h>
+#include <string>
+
+#include "platform/Platform.h"
+
+#pragma pack(push,1)
+
+const u32 PAK_INDEXED_MAGIC = 0x4b505841; // "AXPK"
+const u32 PAK_INDEXED_VERSION = 2;
+
+const size_t PAK_INDEXED_CHUNK_SIZE = 64 * 1024;
+const size_t PAK_INDEXED_ALIGNMENT = 4096;
+
+const u32 PAK_INDEXED_COMPRESSED = 1;
+
+struct PAK_INDEXED_HEADER {
+	u32 magic;
+	u32 version;
+	u32 release; //!< PakReader::ReleaseFlags of the original archives
+	u32 nb_files;
+	u32 nb_chunks;
+	u32 names_size;
+	u64 index_offset;
+	u64 source_size; //!< Size of the original .pak file, 0 if unknown
+	u64 source_time; //!< Modification time of the original .pak file, 0 if unknown
+};
+
+struct PAK_INDEXED_ENTRY {
+	u32 hash; //!< pakPathHash() of the full path
+	u32 name; //!< Offset of the path in the name table
+	u32 flags;
+	u32 first_chunk; //!< Index of the first chunk in the chunk table, if compressed
+	u64 offset;
+	u64 size; //!< Uncompressed size
+};
+
+#pragma pack(pop)
+
+//! 32-bit FNV-1a hash of a lowercase resource path, as stored in the index
+inline u32 pakPathHash(const std::string & path) {
+	u32 hash = 2166136261u;
+	for(size_t i = 0; i < path.length(); i++) {
+		hash = (hash ^ u32((unsigned char)path[i])) * 16777619u;
+	}
+	return hash;
+}
+
+//! Number of chunks used to store a compressed file
+inline size_t pakChunkCount(u64 size) {
+	return size_t((size + PAK_INDEXED_CHUNK_SIZE - 1) / PAK_INDEXED_CHUNK_SIZE);
+}
+
+#endif // ARX_IO_RESOURCE_PAKFORMAT_H
@@ -23,20 +23,68 @@
 #include <algorithm>
 #include <iomanip>
 #include <ios>
+#include <vector>
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/foreach.hpp>
 
+#include <zlib.h>
+
 #include "io/log/Logger.h"
 #include "io/Blast.h"
 #include "io/resource/PakEntry.h"
+#include "io/resource/PakFormat.h"
 #include "io/fs/FilePath.h"
 #include "io/fs/Filesystem.h"
 #include "io/fs/FileStream.h"
+#include "platform/Lock.h"
+#include "platform/profiler/LoadStatistics.h"
 
-namespace {
+/*!
+ * An open archive file shared by all files stored in it.
+ *
+ * The stream position is shared state, so each seek and read pair is done with the
+ * archive locked. Decompression happens outside of the lock.
+ */
+class PakArchive : private boost::noncopyable {
+	
+	fs::ifstream m_stream;
+	Lock m_lock;
+	
+public:
+	
+	explicit PakArchive(const fs::path & path)
+		: m_stream(path, fs::fstream::in | fs::fstream::binary) { }
+	
+	bool is_open() const { return m_stream.is_open(); }
+	
+	//! Stream for reading the archive index before any files are added
+	std::istream & stream() { return m_stream; }
+	
+	/*!
+	 * Read from an absolute offset in the archive. Can be called from any thread.
+	 * \return the number of bytes read.
+	 */
+	size_t read(size_t offset, void * buf, size_t size);
+	
+};
 
-const size_t PAK_READ_BUF_SIZE = 1024;
+size_t PakArchive::read(size_t offset, void * buf, size_t size) {
+	
+	size_t nread;
+	{
+		Autolock lock(m_lock);
+		m_stream.seekg(offset);
+		nread = fs::read(m_stream, buf, size).gcount();
+		m_stream.clear();
+	}
+	
+	profiler::countBytesRead(nread);
+	
+	return nread;
+}
+
+namespace {
 
 static PakReader::ReleaseType guessReleaseType(u32 first_bytes) {
 	switch(first_bytes) {
@@ -73,12 +121,12 @@ static void pakDecrypt(char * fat, size_t fat_size, PakReader::ReleaseType keyId
 /*! Uncompressed file in a .pak file archive. */
 class UncompressedFile : public PakFile {
 	
-	std::istream & archive;
+	PakArchive & archive;
 	size_t offset;
 	
 public:
 	
-	explicit UncompressedFile(std::istream * _archive, size_t _offset, size_t size)
+	explicit UncompressedFile(PakArchive * _archive, size_t _offset, size_t size)
 		: PakFile(size), archive(*_archive), offset(_offset) { }
 	
 	void read(void * buf) const;
@@ -111,14 +159,10 @@ public:
 
 void UncompressedFile::read(void * buf) const {
 	
-	archive.seekg(offset);
-	
-	fs::read(archive, buf, size());
+	size_t nread = archive.read(offset, buf, size());
 	
-	arx_assert(!archive.fail());
-	arx_assert(size_t(archive.gcount()) == size());
-	
-	archive.clear();
+	arx_assert(nread == size());
+	ARX_UNUSED(nread);
 }
 
 PakFileHandle * UncompressedFile::open() const {
@@ -131,19 +175,13 @@ size_t UncompressedFileHandle::read(void * buf, size_t size) {
 		return 0;
 	}
 	
-	file.archive.seekg(file.offset + offset);
-	
 	if(file.size() < offset + size) {
 		size = (offset > file.size()) ? 0 : (file.size() - offset);
 	}
 	
-	fs::read(file.archive, buf, size);
-	
-	size_t nread = file.archive.gcount();
+	size_t nread = file.archive.read(file.offset + offset, buf, size);
 	offset += nread;
 	
-	file.archive.clear();
-	
 	return nread;
 }
 
@@ -173,13 +211,13 @@ size_t UncompressedFileHandle::tell() {
 /*! Compressed file in a .pak file archive. */
 class CompressedFile : public PakFile {
 	
-	std::ifstream & archive;
+	PakArchive & archive;
 	size_t offset;
 	size_t storedSize;
 	
 public:
 	
-	explicit CompressedFile(std::ifstream * _archive, size_t _offset, size_t size,
+	explicit CompressedFile(PakArchive * _archive, size_t _offset, size_t size,
 	                        size_t _storedSize)
 		: PakFile(size), archive(*_archive), offset(_offset), storedSize(_storedSize) { }
 	
@@ -187,6 +225,9 @@ public:
 	
 	PakFileHandle * open() const;
 	
+	//! Read the imploded data into a buffer
+	bool readStored(std::vector<char> & data) const;
+	
 	friend class CompressedFileHandle;
 	
 };
@@ -196,6 +237,9 @@ class CompressedFileHandle : public PakFileHandle {
 	const CompressedFile & file;
 	size_t offset;
 	
+	//! Imploded data, read from the archive on first use and kept for further reads
+	std::vector<char> stored;
+	
 public:
 	
 	explicit CompressedFileHandle(const CompressedFile * _file)
@@ -211,47 +255,34 @@ public:
 	
 };
 
-struct BlastFileInBuffer : private boost::noncopyable {
+bool CompressedFile::readStored(std::vector<char> & data) const {
 	
-	std::ifstream & file;
-	size_t remaining;
+	data.resize(storedSize);
 	
-	unsigned char readbuf[PAK_READ_BUF_SIZE];
-	
-	explicit BlastFileInBuffer(std::ifstream * f, size_t count)
-		: file(*f), remaining(count) { }
-	
-};
-
-size_t blastInFile(void * Param, const unsigned char ** buf) {
-	
-	BlastFileInBuffer * p = (BlastFileInBuffer *)Param;
-	
-	*buf = p->readbuf;
-	
-	size_t count = std::min(p->remaining, ARRAY_SIZE(p->readbuf));
-	p->remaining -= count;
+	if(archive.read(offset, &data[0], storedSize) != storedSize) {
+		LogError << "Error reading compressed file";
+		return false;
+	}
 	
-	return fs::read(p->file, p->readbuf, count).gcount();
+	return true;
 }
 
 void CompressedFile::read(void * buf) const {
 	
-	archive.seekg(offset);
+	std::vector<char> data;
+	if(!readStored(data)) {
+		return;
+	}
 	
-	BlastFileInBuffer in(&archive, storedSize);
+	BlastMemInBuffer in(&data[0], data.size());
 	BlastMemOutBuffer out(reinterpret_cast<char *>(buf), size());
 	
-	int r = blast(blastInFile, &in, blastOutMem, &out);
+	int r = blast(blastInMem, &in, blastOutMem, &out);
 	if(r) {
 		LogError << "Blast error " << r << " outSize=" << size();
 	}
 	
-	arx_assert(!archive.fail());
-	arx_assert(in.remaining == 0);
 	arx_assert(out.size == 0);
-	
-	archive.clear();
 }
 
 PakFileHandle * CompressedFile::open() const {
@@ -310,9 +341,6 @@ size_t CompressedFileHandle::read(void * buf, size_t size) {
 		           << " offset=" << offset << " total=" << file.size();
 	}
 	
-	file.archive.seekg(file.offset);
-	
-	BlastFileInBuffer in(&file.archive, file.storedSize);
 	BlastMemOutBufferOffset out;
 	
 	out.buf = reinterpret_cast<char *>(buf);
@@ -324,8 +352,15 @@ size_t CompressedFileHandle::read(void * buf, size_t size) {
 		return 0;
 	}
 	
-	// TODO this is really inefficient
-	int r = ::blast(blastInFile, &in, blastOutMemOffset, &out);
+	if(stored.empty() && !file.readStored(stored)) {
+		stored.clear();
+		return 0;
+	}
+	
+	BlastMemInBuffer in(&stored[0], stored.size());
+	
+	// TODO this is really inefficient - blast can only decompress from the start
+	int r = ::blast(blastInMem, &in, blastOutMemOffset, &out);
 	if(r && (r != 1 || (size == file.size() && offset == 0))) {
 		LogError << "PakReader::fRead: blast error " << r << " outSize=" << file.size();
 		return 0;
@@ -335,8 +370,6 @@ size_t CompressedFileHandle::read(void * buf, size_t size) {
 	
 	offset += size;
 	
-	file.archive.clear();
-	
 	return size;
 }
 
@@ -363,6 +396,186 @@ size_t CompressedFileHandle::tell() {
 	return offset;
 }
 
+/*! Chunk-compressed file in an indexed .ipak file archive. */
+class ChunkedFile : public PakFile {
+	
+	PakArchive & archive;
+	
+	//! Archive offsets of the chunks, followed by the end of the last chunk
+	std::vector<size_t> chunks;
+	
+public:
+	
+	//! Takes ownership of the contents of _chunks
+	explicit ChunkedFile(PakArchive * _archive, size_t size, std::vector<size_t> & _chunks)
+		: PakFile(size), archive(*_archive) {
+		chunks.swap(_chunks);
+	}
+	
+	void read(void * buf) const;
+	
+	PakFileHandle * open() const;
+	
+	size_t chunkSize(size_t i) const {
+		return std::min(PAK_INDEXED_CHUNK_SIZE, size() - i * PAK_INDEXED_CHUNK_SIZE);
+	}
+	
+	/*!
+	 * Decompress a single chunk.
+	 * \param buf receives chunkSize(i) bytes.
+	 * \param scratch buffer for the compressed data.
+	 */
+	bool readChunk(size_t i, char * buf, std::vector<char> & scratch) const;
+	
+};
+
+class ChunkedFileHandle : public PakFileHandle {
+	
+	const ChunkedFile & file;
+	size_t offset;
+	
+	//! Index of the chunk currently in the buffer
+	size_t chunk;
+	std::vector<char> buffer;
+	std::vector<char> scratch;
+	
+public:
+	
+	explicit ChunkedFileHandle(const ChunkedFile * _file)
+		: file(*_file), offset(0), chunk(size_t(-1)) { }
+	
+	size_t read(void * buf, size_t size);
+	
+	int seek(Whence whence, int offset);
+	
+	size_t tell();
+	
+	~ChunkedFileHandle() { }
+	
+};
+
+static bool inflateChunk(char * buf, size_t size, const char * data, size_t storedSize) {
+	
+	if(storedSize == size) {
+		// Chunk didn't compress and is stored as-is
+		std::memcpy(buf, data, size);
+		return true;
+	}
+	
+	uLongf decompressedSize = size;
+	int ret = uncompress((Bytef *)buf, &decompressedSize, (const Bytef *)data, storedSize);
+	if(ret != Z_OK) {
+		LogError << "Error decompressing chunk: " << zError(ret) << " (" << ret << ')';
+		return false;
+	}
+	if(decompressedSize != size) {
+		LogError << "Unexpected chunk size " << decompressedSize << ", expected " << size;
+		return false;
+	}
+	
+	return true;
+}
+
+void ChunkedFile::read(void * buf) const {
+	
+	if(chunks.size() < 2) {
+		return;
+	}
+	
+	// Read all chunks at once and then decompress them one by one
+	std::vector<char> data(chunks.back() - chunks.front());
+	
+	if(archive.read(chunks.front(), &data[0], data.size()) != data.size()) {
+		LogError << "Error reading compressed file";
+		return;
+	}
+	
+	char * out = reinterpret_cast<char *>(buf);
+	for(size_t i = 0; i + 1 < chunks.size(); i++) {
+		const char * in = &data[chunks[i] - chunks.front()];
+		if(!inflateChunk(out, chunkSize(i), in, chunks[i + 1] - chunks[i])) {
+			LogError << "Error reading chunk " << i << " of compressed file";
+		}
+		out += chunkSize(i);
+	}
+}
+
+bool ChunkedFile::readChunk(size_t i, char * buf, std::vector<char> & scratch) const {
+	
+	arx_assert(i + 1 < chunks.size());
+	
+	size_t storedSize = chunks[i + 1] - chunks[i];
+	scratch.resize(storedSize);
+	
+	if(archive.read(chunks[i], &scratch[0], storedSize) != storedSize) {
+		LogError << "Error reading chunk " << i << " of compressed file";
+		return false;
+	}
+	
+	return inflateChunk(buf, chunkSize(i), &scratch[0], storedSize);
+}
+
+PakFileHandle * ChunkedFile::open() const {
+	return new ChunkedFileHandle(this);
+}
+
+size_t ChunkedFileHandle::read(void * buf, size_t size) {
+	
+	if(offset >= file.size()) {
+		return 0;
+	}
+	
+	size = std::min(size, file.size() - offset);
+	
+	// Only decompress the chunks that overlap the requested range
+	char * out = reinterpret_cast<char *>(buf);
+	size_t nread = 0;
+	while(nread < size) {
+		
+		size_t i = offset / PAK_INDEXED_CHUNK_SIZE;
+		if(i != chunk) {
+			buffer.resize(PAK_INDEXED_CHUNK_SIZE);
+			chunk = size_t(-1);
+			if(!file.readChunk(i, &buffer[0], scratch)) {
+				break;
+			}
+			chunk = i;
+		}
+		
+		size_t start = offset - i * PAK_INDEXED_CHUNK_SIZE;
+		size_t count = std::min(size - nread, file.chunkSize(i) - start);
+		std::memcpy(out + nread, &buffer[start], count);
+		
+		nread += count;
+		offset += count;
+	}
+	
+	return nread;
+}
+
+int ChunkedFileHandle::seek(Whence whence, int _offset) {
+	
+	size_t base;
+	switch(whence) {
+		case SeekSet: base = 0; break;
+		case SeekEnd: base = file.size(); break;
+		case SeekCur: base = offset; break;
+		default: return -1;
+	}
+	
+	if((int)base + _offset < 0) {
+		return -1;
+	}
+	
+	offset = (int)base + _offset;
+	
+	return offset;
+}
+
+size_t ChunkedFileHandle::tell() {
+	return offset;
+}
+
 /*! Plain file not in a .pak file archive. */
 class PlainFile : public PakFile {
 	
@@ -408,6 +621,7 @@ void PlainFile::read(void * buf) const {
 	
 	arx_assert(!ifs.fail());
 	arx_assert(size_t(ifs.gcount()) == size());
+	profiler::countBytesRead(size());
 }
 
 PakFileHandle * PlainFile::open() const {
@@ -415,7 +629,11 @@ PakFileHandle * PlainFile::open() const {
 }
 
 size_t PlainFileHandle::read(void * buf, size_t size) {
-	return fs::read(ifs, buf, size).gcount();
+	
+	size_t nread = fs::read(ifs, buf, size).gcount();
+	profiler::countBytesRead(nread);
+	
+	return nread;
 }
 
 std::ios_base::seekdir arxToStlSeekOrigin[] = {
@@ -439,41 +657,52 @@ PakReader::~PakReader() {
 }
 
 bool PakReader::addArchive(const fs::path & pakfile) {
+	return addArchive(pakfile, fs::path());
+}
+
+bool PakReader::addArchive(const fs::path & pakfile, const fs::path & source) {
 	
-	fs::ifstream * ifs = new fs::ifstream(pakfile, fs::fstream::in | fs::fstream::binary);
+	PakArchive * archive = new PakArchive(pakfile);
 	
-	if(!ifs->is_open()) {
-		delete ifs;
+	if(!archive->is_open()) {
+		delete archive;
 		return false;
 	}
 	
+	std::istream & ifs = archive->stream();
+	
 	// Read fat location and size.
 	u32 fat_offset;
 	u32 fat_size;
 	
-	if(fs::read(*ifs, fat_offset).fail()) {
+	if(fs::read(ifs, fat_offset).fail()) {
 		LogError << pakfile << ": error reading FAT offset";
-		delete ifs;
+		delete archive;
 		return false;
 	}
-	if(ifs->seekg(fat_offset).fail()) {
+	
+	if(fat_offset == PAK_INDEXED_MAGIC) {
+		return addIndexedArchive(archive, pakfile, source);
+	}
+	
+	if(ifs.seekg(fat_offset).fail()) {
 		LogError << pakfile << ": error seeking to FAT offset " << fat_offset;
-		delete ifs;
+		delete archive;
 		return false;
 	}
-	if(fs::read(*ifs, fat_size).fail()) {
+	if(fs::read(ifs, fat_size).fail()) {
 		LogError << pakfile << ": error reading FAT size at offset " << fat_offset;
-		delete ifs;
+		delete archive;
 		return false;
 	}
 	
 	// Read the whole FAT.
 	char * fat = new char[fat_size];
-	if(ifs->read(fat, fat_size).fail()) {
+	if(ifs.read(fat, fat_size).fail()) {
 		LogError << pakfile << ": error reading FAT at " << fat_offset
 		         << " with size " << fat_size;
 		delete[] fat;
-		delete ifs;
+		delete archive;
 		return false;
 	}
 	
@@ -489,7 +718,7 @@ bool PakReader::addArchive(const fs::path & pakfile) {
 	
 	char * pos = fat;
 	
-	paks.push_back(ifs);
+	paks.push_back(archive);
 	
 	while(fat_size) {
 		
@@ -531,9 +760,9 @@ bool PakReader::addArchive(const fs::path & pakfile) {
 			const u32 PAK_FILE_COMPRESSED = 1;
 			PakFile * file;
 			if((flags & PAK_FILE_COMPRESSED) && size != 0) {
-				file = new CompressedFile(ifs, offset, uncompressedSize, size);
+				file = new CompressedFile(archive, offset, uncompressedSize, size);
 			} else {
-				file = new UncompressedFile(ifs, offset, size);
+				file = new UncompressedFile(archive, offset, size);
 			}
 			
 			dir->addFile(std::string(filename, len), file);
@@ -554,6 +783,158 @@ error:
 	return false;
 }
 
+//! \return true if the index entry only refers to data inside the archive
+static bool checkIndexedEntry(const PAK_INDEXED_HEADER & header, const PAK_INDEXED_ENTRY & entry,
+                              const u32 * chunks) {
+	
+	// Data is stored between the header and the index
+	u64 begin = sizeof(PAK_INDEXED_HEADER);
+	u64 end = header.index_offset;
+	
+	if(entry.offset < begin || entry.offset > end || entry.size > u64(size_t(-1))) {
+		return false;
+	}
+	
+	if(!(entry.flags & PAK_INDEXED_COMPRESSED)) {
+		return entry.size <= end - entry.offset;
+	}
+	
+	size_t count = pakChunkCount(entry.size);
+	if(entry.first_chunk > header.nb_chunks || count > header.nb_chunks - entry.first_chunk) {
+		return false;
+	}
+	
+	u64 offset = entry.offset;
+	for(size_t j = 0; j < count; j++) {
+		u64 chunkSize = std::min(u64(PAK_INDEXED_CHUNK_SIZE), entry.size - j * PAK_INDEXED_CHUNK_SIZE);
+		u32 storedSize = chunks[entry.first_chunk + j];
+		if(storedSize == 0 || storedSize > chunkSize || storedSize > end - offset) {
+			return false;
+		}
+		offset += storedSize;
+	}
+	
+	return true;
+}
+
+bool PakReader::addIndexedArchive(PakArchive * archive, const fs::path & pakfile,
+                                  const fs::path & source) {
+	
+	std::istream & ifs = archive->stream();
+	
+	PAK_INDEXED_HEADER header;
+	if(ifs.seekg(0).fail() || fs::read(ifs, header).fail()) {
+		LogError << pakfile << ": error reading header";
+		delete archive;
+		return false;
+	}
+	if(header.version != PAK_INDEXED_VERSION) {
+		LogError << pakfile << ": unsupported version " << header.version;
+		delete archive;
+		return false;
+	}
+	
+	if(!source.empty() && (header.source_size != fs::file_size(source)
+	                       || header.source_time != u64(fs::last_write_time(source)))) {
+		LogWarning << pakfile << " is out of date, using " << source;
+		delete archive;
+		return false;
+	}
+	
+	// Check that the index fits into the file before allocating memory for it.
+	u64 fileSize = fs::file_size(pakfile);
+	u64 index_size = u64(header.nb_files) * sizeof(PAK_INDEXED_ENTRY)
+	                 + u64(header.nb_chunks) * sizeof(u32) + header.names_size;
+	if(fileSize == u64(-1) || header.index_offset < sizeof(PAK_INDEXED_HEADER)
+	   || header.index_offset > fileSize || index_size > fileSize - header.index_offset) {
+		LogError << pakfile << ": bad index at " << header.index_offset
+		         << " with size " << index_size;
+		delete archive;
+		return false;
+	}
+	
+	// Read the whole index.
+	std::vector<char> index((size_t(index_size)));
+	if(ifs.seekg(std::streamoff(header.index_offset)).fail()
+	   || (index_size && ifs.read(&index[0], std::streamsize(index_size)).fail())) {
+		LogError << pakfile << ": error reading index at " << header.index_offset
+		         << " with size " << index_size;
+		delete archive;
+		return false;
+	}
+	
+	if(header.nb_files != 0 && (header.names_size == 0 || index.back() != '\0')) {
+		LogError << pakfile << ": bad name table";
+		delete archive;
+		return false;
+	}
+	
+	const PAK_INDEXED_ENTRY * entries = NULL;
+	const u32 * chunks = NULL;
+	const char * names = NULL;
+	if(!index.empty()) {
+		entries = reinterpret_cast<const PAK_INDEXED_ENTRY *>(&index[0]);
+		chunks = reinterpret_cast<const u32 *>(entries + header.nb_files);
+		names = reinterpret_cast<const char *>(chunks + header.nb_chunks);
+	}
+	
+	// Validate all entries first so that a broken archive does not add any files.
+	for(u32 i = 0; i < header.nb_files; i++) {
+		
+		const PAK_INDEXED_ENTRY & entry = entries[i];
+		
+		if(entry.name >= header.names_size) {
+			LogError << pakfile << ": bad name offset for file " << i;
+			delete archive;
+			return false;
+		}
+		if(pakPathHash(names + entry.name) != entry.hash) {
+			LogError << pakfile << ": hash mismatch for " << (names + entry.name);
+			delete archive;
+			return false;
+		}
+		if(!checkIndexedEntry(header, entry, chunks)) {
+			LogError << pakfile << ": bad data range for " << (names + entry.name);
+			delete archive;
+			return false;
+		}
+	}
+	
+	paks.push_back(archive);
+	
+	std::vector<size_t> offsets;
+	for(u32 i = 0; i < header.nb_files; i++) {
+		
+		const PAK_INDEXED_ENTRY & entry = entries[i];
+		
+		res::path path = res::path::load(names + entry.name);
+		PakDirectory * dir = addDirectory(path.parent());
+		
+		PakFile * file;
+		if(entry.flags & PAK_INDEXED_COMPRESSED) {
+			
+			size_t count = pakChunkCount(entry.size);
+			offsets.resize(count + 1);
+			offsets[0] = size_t(entry.offset);
+			for(size_t j = 0; j < count; j++) {
+				offsets[j + 1] = offsets[j] + chunks[entry.first_chunk + j];
+			}
+			
+			file = new ChunkedFile(archive, size_t(entry.size), offsets);
+			
+		} else {
+			file = new UncompressedFile(archive, size_t(entry.offset), size_t(entry.size));
+		}
+		
+		dir->addFile(path.filename(), file);
+	}
+	
+	release |= ReleaseFlags::load(header.release);
+	
+	LogInfo << "Loaded indexed PAK " << pakfile;
+	return true;
+}
+
 void PakReader::clear() {
 	
 	release = 0;
@@ -561,9 +942,10 @@ void PakReader::clear() {
 	files.clear();
 	dirs.clear();
 	
-	BOOST_FOREACH(std::istream * is, paks) {
-		delete is;
+	BOOST_FOREACH(PakArchive * archive, paks) {
+		delete archive;
 	}
+	paks.clear();
 }
 
 bool PakReader::read(const res::path & name, void * buf) {
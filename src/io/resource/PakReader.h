@@ -21,7 +21,6 @@
 #define ARX_IO_RESOURCE_PAKREADER_H
 
 #include <vector>
-#include <istream>
 
 #include <boost/noncopyable.hpp>
 
@@ -31,6 +30,8 @@
 
 namespace fs { class path; }
 
+class PakArchive;
+
 enum Whence {
 	SeekSet,
 	SeekCur,
@@ -51,6 +52,14 @@ public:
 	
 };
 
+/*!
+ * Virtual resource hierarchy made up of .pak archives and files on disk.
+ *
+ * Files can be read from any number of threads at the same time, using read(),
+ * readAlloc(), PakFile::read() or separate PakFileHandle objects. A single
+ * PakFileHandle must not be used by more than one thread at a time. Adding or
+ * removing files and directories is not threadsafe and must not overlap with reads.
+ */
 class PakReader : public PakDirectory {
 	
 public:
@@ -87,7 +96,18 @@ public:
 	 */
 	bool addFiles(const fs::path & path, const res::path & mount = res::path());
 	
+	/*!
+	 * Add the files from an archive.
+	 * Both the original .pak format and indexed .ipak archives are supported.
+	 */
 	bool addArchive(const fs::path & pakfile);
+	
+	/*!
+	 * Add the files from an archive.
+	 * If pakfile is an indexed .ipak archive, it is only used if it was converted from
+	 * source and source has not changed since - otherwise nothing is added.
+	 */
+	bool addArchive(const fs::path & pakfile, const fs::path & source);
 	void clear();
 	
 	bool read(const res::path & name, void * buf);
@@ -100,11 +120,15 @@ public:
 private:
 	
 	ReleaseFlags release;
-	std::vector<std::istream *> paks;
+	std::vector<PakArchive *> paks;
 	
 	bool addFiles(PakDirectory * dir, const fs::path & path);
 	bool addFile(PakDirectory * dir, const fs::path & path, const std::string & name);
 	
+	//! Load an .ipak archive, see io/resource/PakFormat.h
+	bool addIndexedArchive(PakArchive * archive, const fs::path & pakfile,
+	                       const fs::path & source);
+	
 };
 
 DECLARE_FLAGS_OPERATORS(PakReader::ReleaseFlags)
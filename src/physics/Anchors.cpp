@@ -47,20 +47,30 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "physics/Anchors.h"
 
 #include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
 
 #include "ai/PathFinderManager.h"
 #include "game/NPC.h"
 #include "game/Player.h"
 #include "graphics/Math.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/Filesystem.h"
 #include "io/log/Logger.h"
 #include "physics/Collisions.h"
+#include "platform/JobSystem.h"
+#include "platform/Time.h"
 
 using std::min;
 using std::max;
 using std::sprintf;
 
-extern float MAX_ALLOWED_PER_SECOND;
-extern bool DIRECT_PATH;
 
 static EERIEPOLY * ANCHOR_CheckInPolyPrecis(float x, float y, float z) {
 	
@@ -131,8 +141,6 @@ static EERIEPOLY * ANCHOR_CheckInPoly(float x, float y, float z) {
 	return found;
 }
 
-extern Vec3f vector2D;
-
 float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
                               CollisionFlags flags) {
 	
@@ -294,9 +302,14 @@ static float ANCHOR_CheckAnythingInCylinder(EERIE_CYLINDER *cyl, CollisionFlags
 	return anything;
 }
 
-extern long MOVING_CYLINDER;
-static bool ANCHOR_AttemptValidCylinderPos(EERIE_CYLINDER * cyl, Entity * io,
-	                                         CollisionFlags flags) {
+/*!
+ * Anchors are not generated for a specific entity, so unlike AttemptValidCylinderPos()
+ * this does not take one. It also does not touch any global state and can be called
+ * from multiple threads at the same time.
+ * \param moving true if the cylinder is being moved - see ANCHOR_ARX_COLLISION_Move_Cylinder()
+ */
+static bool ANCHOR_AttemptValidCylinderPos(EERIE_CYLINDER * cyl, CollisionFlags flags,
+                                           bool moving) {
 	
 	float anything = ANCHOR_CheckAnythingInCylinder(cyl, flags);
 
@@ -326,49 +339,9 @@ static bool ANCHOR_AttemptValidCylinderPos(EERIE_CYLINDER * cyl, Entity * io,
 		anything = tmp.origin.y - cyl->origin.y;
 	}
 
-	if (MOVING_CYLINDER)
+	if (moving)
 	{
-		if (flags & CFLAG_NPC)
-		{
-			float tolerate;
-
-			if ((io) && (io->ioflags & IO_NPC) && (io->_npcdata->pathfind.listnb > 0) && (io->_npcdata->pathfind.listpos < io->_npcdata->pathfind.listnb))
-			{
-				tolerate = -80;
-			}
-			else
-				tolerate = -45;
-
-			if (anything < tolerate) return false;
-		}
-
-		if (io && (!(flags & CFLAG_JUST_TEST)))
-		{
-			if ((flags & CFLAG_PLAYER) && (anything < 0.f))
-			{
-				if(player.jumpphase != NotJumping) {
-					io->_npcdata->climb_count = MAX_ALLOWED_PER_SECOND;
-					return false;
-				}
-
-				float dist = std::max(vector2D.length(), 1.f);
-				float pente;
-				pente = EEfabs(anything) / dist * ( 1.0f / 2 ); 
-				io->_npcdata->climb_count += pente;
-
-				if (io->_npcdata->climb_count > MAX_ALLOWED_PER_SECOND)
-				{
-					io->_npcdata->climb_count = MAX_ALLOWED_PER_SECOND;
-					return false;
-				}
-
-				if (anything < -55) 
-				{
-					io->_npcdata->climb_count = MAX_ALLOWED_PER_SECOND;
-					return false;
-				}
-			}
-		}
+		if ((flags & CFLAG_NPC) && (anything < -45)) return false;
 	}
 	else if (anything < -45) return false;
 
@@ -405,27 +378,18 @@ static bool ANCHOR_AttemptValidCylinderPos(EERIE_CYLINDER * cyl, Entity * io,
 }
 
 
-static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
-                                               float MOVE_CYLINDER_STEP,
+static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, float MOVE_CYLINDER_STEP,
                                                CollisionFlags flags) {
 	
-	MOVING_CYLINDER = 1;
-	DIRECT_PATH = true;
 	IO_PHYSICS test;
 
 	if (ip == NULL)
-	{
-		MOVING_CYLINDER = 0;
 		return false;
-	}
 
 	float distance = dist(ip->startpos, ip->targetpos);
 
 	if (distance <= 0.f)
-	{
-		MOVING_CYLINDER = 0;
 		return true; 
-	}
 
 	Vec3f mvector = (ip->targetpos - ip->startpos) / distance;
 
@@ -442,15 +406,11 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 		// uses test struct to simulate movement.
 		test.cyl.origin += mvector * curmovedist;
 		
-		vector2D.x = mvector.x * curmovedist;
-		vector2D.y = 0.f;
-		vector2D.z = mvector.z * curmovedist;
-
 		if ((flags & CFLAG_CHECK_VALID_POS)
 		        && (CylinderAboveInvalidZone(&test.cyl)))
 			return false;
 
-		if (ANCHOR_AttemptValidCylinderPos(&test.cyl, io, flags))
+		if (ANCHOR_AttemptValidCylinderPos(&test.cyl, flags, true))
 		{
 			memcpy(ip, &test, sizeof(IO_PHYSICS));
 
@@ -462,14 +422,13 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 				memcpy(&test.cyl, &ip->cyl, sizeof(EERIE_CYLINDER));
 				test.cyl.origin.y += mvector.y * curmovedist;
 
-				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, io, flags))
+				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, flags, true))
 				{
 					memcpy(ip, &test, sizeof(IO_PHYSICS));
 					goto oki;
 				}
 			}
 
-			DIRECT_PATH = false;
 			// Must Attempt To Slide along collisions
 			Vec3f vecatt;
 			Vec3f rpos = Vec3f::ZERO;
@@ -496,7 +455,7 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 				float t = radians(MAKEANGLE(rangle));
 				YRotatePoint(&mvector, &vecatt, EEcos(t), EEsin(t));
 				test.cyl.origin += vecatt * curmovedist;
-				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, io, flags))
+				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, flags, true))
 				{
 					rpos = test.cyl.origin;
 					RFOUND = 1;
@@ -508,7 +467,7 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 				t = radians(MAKEANGLE(langle));
 				YRotatePoint(&mvector, &vecatt, EEcos(t), EEsin(t));
 				test.cyl.origin += vecatt * curmovedist;
-				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, io, flags))
+				if (ANCHOR_AttemptValidCylinderPos(&test.cyl, flags, true))
 				{
 					lpos = test.cyl.origin;
 					LFOUND = 1;
@@ -547,7 +506,6 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 			else  //stopped
 			{
 				ip->velocity = Vec3f::ZERO;
-				MOVING_CYLINDER = 0;
 				return false;
 			}
 		}
@@ -556,7 +514,6 @@ static bool ANCHOR_ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io,
 		;
 	}
 
-	MOVING_CYLINDER = 0;
 	return true;
 }
 
@@ -633,11 +590,78 @@ bool CylinderAboveInvalidZone(EERIE_CYLINDER * cyl) {
 
 	return false;
 }
+namespace {
+
+//! Anchors near a position, indexed by the background tile they are in
+class AnchorGrid {
+	
+	const EERIE_BACKGROUND * m_eb;
+	std::vector< std::vector<long> > m_cells;
+	
+	long getCellX(float x) const {
+		return clamp(long(x * m_eb->Xmul), 0l, m_eb->Xsize - 1l);
+	}
+	
+	long getCellZ(float z) const {
+		return clamp(long(z * m_eb->Zmul), 0l, m_eb->Zsize - 1l);
+	}
+	
+public:
+	
+	explicit AnchorGrid(const EERIE_BACKGROUND * eb)
+		: m_eb(eb), m_cells(eb->Xsize * eb->Zsize) {
+		for(long k = 0; k < eb->nbanchors; k++) {
+			add(k);
+		}
+	}
+	
+	void add(long anchor) {
+		const Vec3f & pos = m_eb->anchors[anchor].pos;
+		m_cells[getCellX(pos.x) + getCellZ(pos.z) * m_eb->Xsize].push_back(anchor);
+	}
+	
+	//! Get all anchors within radius of pos in the xz plane, and possibly some more
+	void getNear(const Vec3f & pos, float radius, std::vector<long> & result) const {
+		result.clear();
+		long ix = getCellX(pos.x - radius), ax = getCellX(pos.x + radius);
+		long iz = getCellZ(pos.z - radius), az = getCellZ(pos.z + radius);
+		for(long z = iz; z <= az; z++) {
+			for(long x = ix; x <= ax; x++) {
+				const std::vector<long> & cell = m_cells[x + z * m_eb->Xsize];
+				result.insert(result.end(), cell.begin(), cell.end());
+			}
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+static void AddAnchor(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg, const EERIE_CYLINDER & cyl) {
+	
+	eg->ianchors = (long *)realloc(eg->ianchors, sizeof(long) * (eg->nbianchors + 1));
+	
+	eg->ianchors[eg->nbianchors] = eb->nbanchors;
+	eg->nbianchors++;
+	
+	eb->anchors = (ANCHOR_DATA *)realloc(eb->anchors, sizeof(ANCHOR_DATA) * (eb->nbanchors + 1));
+	
+	ANCHOR_DATA * ad = &eb->anchors[eb->nbanchors];
+	ad->pos = cyl.origin;
+	ad->height = cyl.height;
+	ad->radius = cyl.radius;
+	ad->linked = NULL;
+	ad->nblinked = 0;
+	ad->flags = 0;
+	eb->nbanchors++;
+}
+
 //*************************************************************************************
 // Adds an Anchor... and tries to generate the best possible cylinder for it
 //*************************************************************************************
 
-static bool DirectAddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg, Vec3f * pos) {
+static bool DirectAddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg,
+                                            Vec3f * pos, AnchorGrid & grid) {
 	
 	long found = 0;
 	long stop_radius = 0;
@@ -661,7 +685,7 @@ static bool DirectAddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INF
 		memcpy(&testcyl, &currcyl, sizeof(EERIE_CYLINDER));
 		testcyl.radius += INC_RADIUS;
 
-		if (ANCHOR_AttemptValidCylinderPos(&testcyl, NULL, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_ANCHOR_GENERATION))
+		if (ANCHOR_AttemptValidCylinderPos(&testcyl, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_ANCHOR_GENERATION, false))
 		{
 			memcpy(&currcyl, &testcyl, sizeof(EERIE_CYLINDER));
 			found = 1;
@@ -693,8 +717,11 @@ static bool DirectAddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INF
 
 	if (CylinderAboveInvalidZone(&bestcyl)) return false;
 
-	for (long k = 0; k < eb->nbanchors; k++)
-	{
+	static std::vector<long> nearby;
+	grid.getNear(bestcyl.origin, 50.f, nearby);
+	
+	BOOST_FOREACH(long k, nearby) {
+		
 		ANCHOR_DATA * ad = &eb->anchors[k];
 
 		if(closerThan(ad->pos, bestcyl.origin, 50.f)) {
@@ -713,25 +740,14 @@ static bool DirectAddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INF
 
 	}
 
-	eg->ianchors = (long *)realloc(eg->ianchors, sizeof(long) * (eg->nbianchors + 1));
+	AddAnchor(eb, eg, bestcyl);
+	grid.add(eb->nbanchors - 1);
 
-	eg->ianchors[eg->nbianchors] = eb->nbanchors;
-	eg->nbianchors++;
-
-	eb->anchors = (ANCHOR_DATA *)realloc(eb->anchors, sizeof(ANCHOR_DATA) * (eb->nbanchors + 1));
-
-	ANCHOR_DATA * ad = &eb->anchors[eb->nbanchors];
-	ad->pos = bestcyl.origin;
-	ad->height = bestcyl.height;
-	ad->radius = bestcyl.radius;
-	ad->linked = NULL;
-	ad->nblinked = 0;
-	ad->flags = 0;
-	eb->nbanchors++;
 	return true;
 }
 
-static bool AddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg, Vec3f * pos) {
+//! Find the best cylinder for an anchor near a position
+static bool FindAnchorCylinder(Vec3f * pos, EERIE_CYLINDER & bestcyl) {
 	
 	long found = 0;
 	long best = 0;
@@ -740,7 +756,6 @@ static bool AddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg
 
 	EERIE_CYLINDER testcyl;
 	EERIE_CYLINDER currcyl;
-	EERIE_CYLINDER bestcyl;
 
 	bestcyl.height = 0;
 	bestcyl.radius = 0;
@@ -766,7 +781,7 @@ static bool AddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg
 				memcpy(&testcyl, &currcyl, sizeof(EERIE_CYLINDER));
 				testcyl.radius += INC_RADIUS;
 
-				if (ANCHOR_AttemptValidCylinderPos(&testcyl, NULL, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_ANCHOR_GENERATION))
+				if (ANCHOR_AttemptValidCylinderPos(&testcyl, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_ANCHOR_GENERATION, false))
 				{
 					memcpy(&currcyl, &testcyl, sizeof(EERIE_CYLINDER));
 					found = 1;
@@ -810,44 +825,147 @@ static bool AddAnchor_Original_Method(EERIE_BACKGROUND * eb, EERIE_BKG_INFO * eg
 
 	if (CylinderAboveInvalidZone(&bestcyl)) return false;
 
-	// avoid to recreate same anchor twice...
-	if (0)
-		for (long k = 0; k < eb->nbanchors; k++)
+	return true;
+}
+
+//! Find the anchors for one background tile without modifying the background
+static void AnchorData_Create_Tile(EERIE_BACKGROUND * eb, long i, long j,
+                                   std::vector<EERIE_CYLINDER> & anchors) {
+	
+	Vec3f pos;
+	
+	for(long divv = 0; divv < 9; divv++) {
+		
+		long divvx = divv % 3;
+		long divvy = divv / 3;
+		
+		if(!anchors.empty()) {
+			break;
+		}
+		
+		pos.x = (float)((float)((float)i + 0.33f * (float)divvx) * (float)eb->Xdiv);
+		pos.y = 0.f;
+		pos.z = (float)((float)((float)j + 0.33f * (float)divvy) * (float)eb->Zdiv);
+		EERIEPOLY * ep = GetMinPoly(pos.x, pos.y, pos.z);
+		EERIE_CYLINDER currcyl;
+		currcyl.radius = 20 - (4.f * divv);
+		currcyl.height = -120.f;
+		currcyl.origin = pos;
+		
+		if(!ep) {
+			continue;
+		}
+		
+		EERIEPOLY * epmax = GetMaxPoly(pos.x, pos.y, pos.z);
+		float roof = ep->min.y - 300;
+		if(epmax) roof = epmax->min.y - 300;
+		
+		float current_y = ep->max.y;
+		
+		while (current_y > roof)
 		{
-			ANCHOR_DATA * ad = &eb->anchors[k];
+			currcyl.origin.y = current_y;
+			EERIEPOLY * ep2 = ANCHOR_CheckInPolyPrecis(currcyl.origin.x, currcyl.origin.y - 30.f, currcyl.origin.z);
 
-			if ((ad->pos.x == bestcyl.origin.x)
-			        &&	(ad->pos.y == bestcyl.origin.y)
-			        &&	(ad->pos.z == bestcyl.origin.z))
+			if (ep2 && !(ep2->type & POLY_DOUBLESIDED) && (ep2->norm.y > 0.f))
+				ep2 = NULL;
+			
+			if ((ep2) && !(ep2->type & POLY_NOPATH))
 			{
-				if (ad->radius >= bestcyl.radius)
-					return false;
+				bool bval = ANCHOR_AttemptValidCylinderPos(&currcyl, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT | CFLAG_ANCHOR_GENERATION, false);
 
-				if (ad->radius <= bestcyl.radius)
+				if ((bval)
+				        && (currcyl.origin.y - 10.f <= current_y))
 				{
-					ad->height = bestcyl.height;
-					ad->radius = bestcyl.radius;
-					return false;
+					EERIEPOLY * ep2 = ANCHOR_CheckInPolyPrecis(currcyl.origin.x, currcyl.origin.y - 38.f, currcyl.origin.z);
+					EERIE_CYLINDER bestcyl;
+					
+					if (ep2 && !(ep2->type & POLY_DOUBLESIDED) && (ep2->norm.y > 0.f))
+					{
+						current_y -= 10.f;
+					}
+					else if ((ep2) && (ep2->type & POLY_NOPATH))
+					{
+						current_y -= 10.f;
+					}
+					else if (FindAnchorCylinder(&currcyl.origin, bestcyl))
+					{
+						anchors.push_back(bestcyl);
+						current_y = currcyl.origin.y + currcyl.height;
+					}
+					else current_y -= 10.f;
 				}
+				else current_y -= 10.f;
 			}
+			else current_y -= 10.f;
 		}
+	}
+}
 
-	eg->ianchors = (long *)realloc(eg->ianchors, sizeof(long) * (eg->nbianchors + 1));
+namespace {
 
-	eg->ianchors[eg->nbianchors] = eb->nbanchors;
-	eg->nbianchors++;
+class AnchorPlacementTask : public jobs::ParallelTask {
+	
+	EERIE_BACKGROUND * m_eb;
+	std::vector< std::vector<EERIE_CYLINDER> > & m_anchors;
+	
+public:
+	
+	AnchorPlacementTask(EERIE_BACKGROUND * eb, std::vector< std::vector<EERIE_CYLINDER> > & anchors)
+		: m_eb(eb), m_anchors(anchors) { }
+	
+	void run(size_t begin, size_t end) {
+		for(size_t j = begin; j < end; j++) {
+			for(long i = 0; i < m_eb->Xsize; i++) {
+				AnchorData_Create_Tile(m_eb, i, long(j), m_anchors[i + j * m_eb->Xsize]);
+			}
+		}
+	}
 
-	eb->anchors = (ANCHOR_DATA *)realloc(eb->anchors, sizeof(ANCHOR_DATA) * (eb->nbanchors + 1));
+};
 
-	ANCHOR_DATA * ad = &eb->anchors[eb->nbanchors];
-	ad->pos = bestcyl.origin;
-	ad->height = bestcyl.height;
-	ad->radius = bestcyl.radius;
-	ad->linked = NULL;
-	ad->nblinked = 0;
-	ad->flags = 0;
-	eb->nbanchors++;
-	return true;
+} // anonymous namespace
+
+/*!
+ * Place anchors in all background tiles
+ *
+ * The tiles are processed in parallel, but the anchors are numbered in the same order as
+ * if they had been added one tile after the other.
+ */
+static void AnchorData_Create_Phase_I(EERIE_BACKGROUND * eb) {
+
+	std::vector< std::vector<EERIE_CYLINDER> > anchors(eb->Xsize * eb->Zsize);
+	
+	AnchorPlacementTask task(eb, anchors);
+	jobs::parallelFor(task, eb->Zsize);
+	
+	size_t count = 0;
+	for(size_t i = 0; i < anchors.size(); i++) {
+		count += anchors[i].size();
+	}
+	
+	eb->nbanchors = long(count);
+	eb->anchors = count ? (ANCHOR_DATA *)malloc(sizeof(ANCHOR_DATA) * count) : NULL;
+	
+	long index = 0;
+	for(size_t i = 0; i < anchors.size(); i++) {
+		
+		EERIE_BKG_INFO * eg = &eb->Backg[i];
+		
+		eg->nbianchors = short(anchors[i].size());
+		eg->ianchors = anchors[i].empty() ? NULL : (long *)malloc(sizeof(long) * anchors[i].size());
+		
+		for(size_t k = 0; k < anchors[i].size(); k++, index++) {
+			ANCHOR_DATA * ad = &eb->anchors[index];
+			ad->pos = anchors[i][k].origin;
+			ad->height = anchors[i][k].height;
+			ad->radius = anchors[i][k].radius;
+			ad->linked = NULL;
+			ad->nblinked = 0;
+			ad->flags = 0;
+			eg->ianchors[k] = index;
+		}
+	}
 }
 
 //**********************************************************************************************
@@ -866,154 +984,153 @@ static void AddAnchorLink(EERIE_BACKGROUND * eb, long anchor, long linked) {
 	eb->anchors[anchor].nblinked++;
 }
 
-//**********************************************************************************************
-// Generates Links between Anchors for a background
-//**********************************************************************************************
-
-static void AnchorData_Create_Links_Original_Method(EERIE_BACKGROUND * eb) {
+//! @return true if an NPC can walk from one of the anchors to the other
+static bool AnchorData_TestLink(EERIE_BACKGROUND * eb, long anchor, long other, bool precise) {
 	
-	EERIE_BKG_INFO * eg;
-	EERIE_BKG_INFO * eg2;
-	Vec3f p1, p2; 
-	long count = 0;
-	long per;
-	long lastper = -1;
-	long total = eb->Zsize * eb->Xsize;
-
-	for (long j = 0; j < eb->Zsize; j++)
-		for (long i = 0; i < eb->Xsize; i++)
-		{
-			per = count / total * 100.f;
+	Vec3f p1 = eb->anchors[anchor].pos;
+	Vec3f p2 = eb->anchors[other].pos;
+	p1.y += 10.f;
+	p2.y += 10.f;
+	float _dist = dist(p1, p2);
+	float dd = dist(Vec2f(p1.x, p1.z), Vec2f(p2.x, p2.z));
+	
+	if (dd < 5.f) return false;
+	
+	if (dd > 200.f) return false; 
+	
+	if (precise)
+	{
+		if (_dist > 120.f) return false;
+	}
+	else	if (_dist > 200.f) return false;
+	
+	if (EEfabs(p1.y - p2.y) > dd * 0.9f) return false;
+	
+	IO_PHYSICS ip;
+	ip.startpos = ip.cyl.origin = p1;
+	ip.targetpos = p2;
+	
+	ip.cyl.height = eb->anchors[anchor].height; 
+	ip.cyl.radius = eb->anchors[anchor].radius;
+	
+	if (ANCHOR_ARX_COLLISION_Move_Cylinder(&ip, 20, CFLAG_CHECK_VALID_POS | CFLAG_NO_INTERCOL | CFLAG_EASY_SLIDING | CFLAG_NPC | CFLAG_JUST_TEST | CFLAG_EXTRA_PRECISION)) //CFLAG_SPECIAL
+	{
+		if(!fartherThan(Vec2f(ip.cyl.origin.x, ip.cyl.origin.z), Vec2f(ip.targetpos.x, ip.targetpos.z), 25.f)) {
+			return true;
+		}
+	}
+	
+	// Try the other direction
+	ip.startpos = ip.cyl.origin = p2;
+	ip.targetpos = p1;
+	
+	ip.cyl.height = eb->anchors[other].height;
+	ip.cyl.radius = eb->anchors[other].radius; 
+	
+	if (ANCHOR_ARX_COLLISION_Move_Cylinder(&ip, 20, CFLAG_CHECK_VALID_POS | CFLAG_NO_INTERCOL | CFLAG_EASY_SLIDING | CFLAG_NPC | CFLAG_JUST_TEST | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT)) //CFLAG_SPECIAL
+	{
+		if(!fartherThan(Vec2f(ip.cyl.origin.x, ip.cyl.origin.z), Vec2f(ip.targetpos.x, ip.targetpos.z), 25.f)) {
+			return true;
+		}
+	}
+	
+	return false;
+}
 
-			if (per != lastper)
-			{
-				LogInfo << "Anchor Links Generation: %" << per;
-				lastper = per;
-			}
+static bool IsPrecisePathTile(const EERIE_BKG_INFO * eg) {
+	
+	for(long k = 0; k < eg->nbpolyin; k++) {
+		if(eg->polyin[k]->type & POLY_PRECISE_PATH) {
+			return true;
+		}
+	}
+	
+	return false;
+}
 
-			count++;
-			eg = &eb->Backg[i+j*eb->Xsize];
-			long precise = 0;
+namespace {
 
-			for (long kkk = 0; kkk < eg->nbpolyin; kkk++)
-			{
-				EERIEPOLY * ep = eg->polyin[kkk];
+typedef std::vector< std::pair<long, long> > AnchorLinks;
 
-				if (ep->type & POLY_PRECISE_PATH)
-				{
-					precise = 1;
-					break;
+//! Finds the links of the anchors in each tile to the anchors in the surrounding tiles
+class AnchorLinkTask : public jobs::ParallelTask {
+	
+	EERIE_BACKGROUND * m_eb;
+	const std::vector<char> & m_precise;
+	std::vector<AnchorLinks> & m_links;
+	
+public:
+	
+	AnchorLinkTask(EERIE_BACKGROUND * eb, const std::vector<char> & precise,
+	               std::vector<AnchorLinks> & links)
+		: m_eb(eb), m_precise(precise), m_links(links) { }
+	
+	void run(size_t begin, size_t end) {
+		
+		EERIE_BACKGROUND * eb = m_eb;
+		
+		for(long j = long(begin); j < long(end); j++)
+		for(long i = 0; i < eb->Xsize; i++) {
+			
+			EERIE_BKG_INFO * eg = &eb->Backg[i + j * eb->Xsize];
+			AnchorLinks & links = m_links[i + j * eb->Xsize];
+			
+			long ii = clamp(i - 2, 0, eb->Xsize - 1);
+			long ia = clamp(i + 2, 0, eb->Xsize - 1);
+			long ji = clamp(j - 2, 0, eb->Zsize - 1);
+			long ja = clamp(j + 2, 0, eb->Zsize - 1);
+			
+			for(long k = 0; k < eg->nbianchors; k++)
+			for(long j2 = ji; j2 <= ja; j2++)
+			for(long i2 = ii; i2 <= ia; i2++) {
+				
+				EERIE_BKG_INFO * eg2 = &eb->Backg[i2 + j2 * eb->Xsize];
+				bool precise = m_precise[i + j * eb->Xsize] || m_precise[i2 + j2 * eb->Xsize];
+				
+				for(long k2 = 0; k2 < eg2->nbianchors; k2++) {
+					
+					// don't treat currently treated anchor
+					if(eg->ianchors[k] == eg2->ianchors[k2]) {
+						continue;
+					}
+					
+					if(AnchorData_TestLink(eb, eg->ianchors[k], eg2->ianchors[k2], precise)) {
+						links.push_back(std::make_pair(eg->ianchors[k], eg2->ianchors[k2]));
+					}
 				}
 			}
+		}
+	}
+	
+};
 
+} // anonymous namespace
 
-			for (long k = 0; k < eg->nbianchors; k++)
-			{
-				long ii = clamp(i - 2, 0, eb->Xsize - 1);
-				long ia = clamp(i + 2, 0, eb->Xsize - 1);
-				long ji = clamp(j - 2, 0, eb->Zsize - 1);
-				long ja = clamp(j + 2, 0, eb->Zsize - 1);
-
-				for (long j2 = ji; j2 <= ja; j2++)
-					for (long i2 = ii; i2 <= ia; i2++)
-					{
-						eg2 = &eb->Backg[i2+j2*eb->Xsize];
-						long precise2 = 0;
-
-						for (long kkk = 0; kkk < eg2->nbpolyin; kkk++)
-						{
-							EERIEPOLY * ep2 = eg2->polyin[kkk];
-
-							if (ep2->type & POLY_PRECISE_PATH)
-							{
-								precise2 = 1;
-								break;
-							}
-						}
-
-						for (long k2 = 0; k2 < eg2->nbianchors; k2++)
-						{
-							// don't treat currently treated anchor
-							if (eg->ianchors[k] == eg2->ianchors[k2]) continue;
-
-							p1 = eb->anchors[eg->ianchors[k]].pos;
-							p2 = eb->anchors[eg2->ianchors[k2]].pos;
-							p1.y += 10.f;
-							p2.y += 10.f;
-							long _onetwo = 0;
-							bool treat = true;
-							float _dist = dist(p1, p2);
-							float dd = dist(Vec2f(p1.x, p1.z), Vec2f(p2.x, p2.z));
-
-							if (dd < 5.f) continue;
-
-							if (dd > 200.f) continue; 
-
-							if (precise || precise2)
-							{
-								if (_dist > 120.f) continue;
-							}
-							else	if (_dist > 200.f) continue;
-
-							if (EEfabs(p1.y - p2.y) > dd * 0.9f) continue;
-
-					
-							IO_PHYSICS ip;
-							ip.startpos = ip.cyl.origin = p1;
-							ip.targetpos = p2;
-						
-							ip.cyl.height = eb->anchors[eg->ianchors[k]].height; 
-							ip.cyl.radius = eb->anchors[eg->ianchors[k]].radius;
-
-							long t = 2;
-
-							if (ANCHOR_ARX_COLLISION_Move_Cylinder(&ip, NULL, 20, CFLAG_CHECK_VALID_POS | CFLAG_NO_INTERCOL | CFLAG_EASY_SLIDING | CFLAG_NPC | CFLAG_JUST_TEST | CFLAG_EXTRA_PRECISION)) //CFLAG_SPECIAL
-							{
-								if(fartherThan(Vec2f(ip.cyl.origin.x, ip.cyl.origin.z), Vec2f(ip.targetpos.x, ip.targetpos.z), 25.f)) { 
-									t--;
-								} else {
-									_onetwo = 1;
-								}
-							}
-							else t--;
-
-							if (t == 1)
-							{
-								ip.startpos = ip.cyl.origin = p2;
-								ip.targetpos = p1;
-
-								ip.cyl.height = eb->anchors[eg2->ianchors[k2]].height;
-								ip.cyl.radius = eb->anchors[eg2->ianchors[k2]].radius; 
+//**********************************************************************************************
+// Generates Links between Anchors for a background
+//**********************************************************************************************
 
-								if (ANCHOR_ARX_COLLISION_Move_Cylinder(&ip, NULL, 20, CFLAG_CHECK_VALID_POS | CFLAG_NO_INTERCOL | CFLAG_EASY_SLIDING | CFLAG_NPC | CFLAG_JUST_TEST | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT)) //CFLAG_SPECIAL
-								{
-									if(fartherThan(Vec2f(ip.cyl.origin.x, ip.cyl.origin.z), Vec2f(ip.targetpos.x, ip.targetpos.z), 25.f)) {
-										t--;
-									} else {
-										_onetwo |= 2;
-									}
-								}
-								else t--;
-							}
-							else t--;
+static void AnchorData_Create_Links(EERIE_BACKGROUND * eb) {
+	
+	size_t tiles = eb->Xsize * eb->Zsize;
 
-							if (t <= 0)
-								treat = false;
-							else treat = true;
+	std::vector<char> precise(tiles);
+	for(size_t i = 0; i < tiles; i++) {
+		precise[i] = IsPrecisePathTile(&eb->Backg[i]);
+	}
 
-							if (treat)
-							{
-								if (_onetwo)
-								{
-									AddAnchorLink(eb, eg->ianchors[k], eg2->ianchors[k2]);
-									AddAnchorLink(eb, eg2->ianchors[k2], eg->ianchors[k]);
-								}
+	// Only anchors in nearby tiles can be linked - test them in parallel
+	std::vector<AnchorLinks> links(tiles);
+	AnchorLinkTask task(eb, precise, links);
+	jobs::parallelFor(task, eb->Zsize);
 
-							}
-						}
-					}
-			}
+	// Add the links in the same order as a serial search would
+	BOOST_FOREACH(const AnchorLinks & tileLinks, links) {
+		BOOST_FOREACH(const AnchorLinks::value_type & link, tileLinks) {
+			AddAnchorLink(eb, link.first, link.second);
+			AddAnchorLink(eb, link.second, link.first);
 		}
+	}
 
 	EERIE_PATHFINDER_Create();
 }
@@ -1027,6 +1144,8 @@ static void AnchorData_Create_Phase_II_Original_Method(EERIE_BACKGROUND * eb) {
 	long lastper	=	-1;
 	long per;
 	float total		=	static_cast<float>(eb->Zsize * eb->Xsize);
+	
+	AnchorGrid grid(eb);
 
 	for (long j = 0; j < eb->Zsize; j++)
 		for (long i = 0; i < eb->Xsize; i++)
@@ -1092,7 +1211,7 @@ static void AnchorData_Create_Phase_II_Original_Method(EERIE_BACKGROUND * eb) {
 							if (ep2->type & POLY_NOPATH)
 								continue;
 
-							if (ANCHOR_AttemptValidCylinderPos(&currcyl, NULL, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT | CFLAG_ANCHOR_GENERATION))
+							if (ANCHOR_AttemptValidCylinderPos(&currcyl, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT | CFLAG_ANCHOR_GENERATION, false))
 							{
 								EERIEPOLY * ep2 = ANCHOR_CheckInPolyPrecis(currcyl.origin.x, currcyl.origin.y - 10.f, currcyl.origin.z);
 
@@ -1105,7 +1224,7 @@ static void AnchorData_Create_Phase_II_Original_Method(EERIE_BACKGROUND * eb) {
 								if (ep2->type & POLY_NOPATH)
 									continue;
 
-								if (DirectAddAnchor_Original_Method(eb, eg, &currcyl.origin))
+								if (DirectAddAnchor_Original_Method(eb, eg, &currcyl.origin, grid))
 								{
 									added = 1;
 								}
@@ -1120,149 +1239,288 @@ static void AnchorData_Create_Phase_II_Original_Method(EERIE_BACKGROUND * eb) {
 				}
 			}
 		}
-
 }
 
-void AnchorData_Create(EERIE_BACKGROUND * eb) {
-	
-	AnchorData_ClearAll(eb);
-	EERIE_BKG_INFO * eg;
-	EERIEPOLY * ep;
-	Vec3f pos;
-#define DECALLL 20.f
-	float count = 0;
-	long lastper	=	-1;
-	long per;
-	float total		=	static_cast<float>(eb->Zsize * eb->Xsize * 9);
+namespace {
 
-	for (long j = 0; j < eb->Zsize; j++)
-		for (long i = 0; i < eb->Xsize; i++)
-		{
-			long LASTFOUND = 0;
+//! Changing this invalidates all cached anchors
+const u32 ANCHOR_CACHE_VERSION = 1;
 
-			for (long divv = 0; divv < 9; divv++)
-			{
-				long divvx, divvy;
+const char ANCHOR_CACHE_MAGIC[4] = { 'A', 'N', 'C', 'H' };
 
-				switch (divv)
-				{
-				case 0:
-					divvx = 0;
-					divvy = 0;
-					break;
-				case 1:
-					divvx = 1;
-					divvy = 0;
-					break;
-				case 2:
-					divvx = 2;
-					divvy = 0;
-					break;
-				case 3:
-					divvx = 0;
-					divvy = 1;
-					break;
-				case 4:
-					divvx = 1;
-					divvy = 1;
-					break;
-				case 5:
-					divvx = 2;
-					divvy = 1;
-					break;
-				case 6:
-					divvx = 0;
-					divvy = 2;
-					break;
-				case 7:
-					divvx = 1;
-					divvy = 2;
-					break;
-				case 8:
-					divvx = 2;
-					divvy = 2;
-					break;
-				default:
-					arx_error_msg("Invalid divv value");
-					divvx = 0;
-					divvy = 0;
-				}
-
-				per = count / total * 100.f;
-
-				if (per != lastper)
-				{
-					LogInfo << "Anchor Generation: %" << per;
-					lastper = per;
-				}
+struct AnchorCacheHeader {
+	char magic[4];
+	u32 version;
+	u64 hash;
+	s32 sizex;
+	s32 sizez;
+	s32 nbanchors;
+};
 
-				count += 1.f;
+struct AnchorCacheData {
+	Vec3f pos;
+	f32 radius;
+	f32 height;
+	s32 nblinked;
+};
 
-				if (LASTFOUND) break;
+//! 64-bit FNV-1a hash
+class SceneHash {
+	
+	u64 m_hash;
+	
+public:
+	
+	SceneHash() : m_hash(0xcbf29ce484222325ull) { }
+	
+	void add(const void * data, size_t size) {
+		const u8 * bytes = reinterpret_cast<const u8 *>(data);
+		for(size_t i = 0; i < size; i++) {
+			m_hash = (m_hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+	}
+	
+	template <class T>
+	void add(const T & value) {
+		add(&value, sizeof(value));
+	}
+	
+	u64 get() const { return m_hash; }
+	
+};
 
-				eg = &eb->Backg[i+j*eb->Xsize];
-				pos.x = (float)((float)((float)i + 0.33f * (float)divvx) * (float)eb->Xdiv);
-				pos.y = 0.f;
-				pos.z = (float)((float)((float)j + 0.33f * (float)divvy) * (float)eb->Zdiv);
-				ep = GetMinPoly(pos.x, pos.y, pos.z);
-				EERIE_CYLINDER currcyl;
-				currcyl.radius = 20 - (4.f * divv);
-				currcyl.height = -120.f;
-				currcyl.origin = pos;
+} // anonymous namespace
 
-				if (ep)
-				{
+//! Hash all background polygon data that is used to generate anchors
+static u64 AnchorData_GetSceneHash(const EERIE_BACKGROUND * eb) {
+	
+	SceneHash hash;
+	hash.add(ANCHOR_CACHE_VERSION);
+	hash.add(s32(eb->Xsize));
+	hash.add(s32(eb->Zsize));
+	hash.add(f32(eb->Xdiv));
+	hash.add(f32(eb->Zdiv));
+	
+	for(long i = 0; i < eb->Xsize * eb->Zsize; i++) {
+		const EERIE_BKG_INFO & eg = eb->Backg[i];
+		hash.add(s32(eg.nbpoly));
+		for(long k = 0; k < eg.nbpoly; k++) {
+			const EERIEPOLY & ep = eg.polydata[k];
+			hash.add(s32(ep.type));
+			// The fourth vertex and norm2 of triangles are not initialized
+			bool quad = (ep.type & POLY_QUAD) != 0;
+			for(size_t n = 0; n < (quad ? 4u : 3u); n++) {
+				hash.add(ep.v[n].p);
+			}
+			hash.add(ep.norm);
+			if(quad) {
+				hash.add(ep.norm2);
+			}
+			hash.add(ep.area);
+		}
+	}
+	
+	return hash.get();
+}
 
-					EERIEPOLY * epmax;
-					epmax = GetMaxPoly(pos.x, pos.y, pos.z);
-					float roof = 9999999.f;
+static fs::path AnchorData_GetCacheFile(const fs::path & cache, u64 hash) {
+	std::ostringstream oss;
+	oss << std::hex << std::setfill('0') << std::setw(16) << hash << ".anchors";
+	return cache / oss.str();
+}
 
-					if (ep) roof = ep->min.y - 300;
+/*!
+ * Check that count items of the given size can still be read from the cache file.
+ * \param limit maximum value of the count
+ */
+static bool AnchorData_CheckCount(std::istream & ifs, u64 fileSize, s32 count,
+                                  size_t itemSize, s32 limit) {
+	if(count < 0 || count > limit) {
+		return false;
+	}
+	std::streamoff pos = ifs.tellg();
+	return pos >= 0 && u64(pos) + u64(count) * itemSize <= fileSize;
+}
 
-					if (epmax) roof = epmax->min.y - 300;
+//! \return true if all indices are valid anchor indices
+static bool AnchorData_CheckIndices(const std::vector<s32> & indices, s32 nbanchors) {
+	for(size_t i = 0; i < indices.size(); i++) {
+		if(indices[i] < 0 || indices[i] >= nbanchors) {
+			return false;
+		}
+	}
+	return true;
+}
 
-					float current_y = ep->max.y;
+static bool AnchorData_LoadCache(EERIE_BACKGROUND * eb, const fs::path & file, u64 hash) {
+	
+	fs::ifstream ifs(file, fs::fstream::in | fs::fstream::binary);
+	if(!ifs.is_open()) {
+		return false;
+	}
+	
+	u64 fileSize = fs::file_size(file);
+	
+	// The cache is only a shortcut: reject it on the first inconsistency so that the
+	// anchors are generated again instead of handing bad indices to the pathfinder
+	
+	AnchorCacheHeader header;
+	if(fileSize == u64(-1) || fs::read(ifs, header).fail()
+	   || memcmp(header.magic, ANCHOR_CACHE_MAGIC, sizeof(header.magic)) != 0
+	   || header.version != ANCHOR_CACHE_VERSION || header.hash != hash
+	   || header.sizex != eb->Xsize || header.sizez != eb->Zsize
+	   || !AnchorData_CheckCount(ifs, fileSize, header.nbanchors, sizeof(AnchorCacheData),
+	                             std::numeric_limits<s32>::max())) {
+		LogWarning << "Ignoring invalid anchor cache " << file;
+		return false;
+	}
+	
+	const s32 maxCount = std::numeric_limits<short>::max();
+	
+	std::vector<AnchorCacheData> anchors(header.nbanchors);
+	std::vector< std::vector<s32> > linked(header.nbanchors);
+	for(s32 i = 0; i < header.nbanchors; i++) {
+		if(fs::read(ifs, anchors[i]).fail()
+		   || !AnchorData_CheckCount(ifs, fileSize, anchors[i].nblinked, sizeof(s32), maxCount)) {
+			LogWarning << "Ignoring invalid anchor cache " << file;
+			return false;
+		}
+		linked[i].resize(anchors[i].nblinked);
+		if(anchors[i].nblinked && fs::read(ifs, &linked[i][0], anchors[i].nblinked * sizeof(s32)).fail()) {
+			LogWarning << "Ignoring truncated anchor cache " << file;
+			return false;
+		}
+		if(!AnchorData_CheckIndices(linked[i], header.nbanchors)) {
+			LogWarning << "Ignoring anchor cache with bad links " << file;
+			return false;
+		}
+	}
+	
+	std::vector< std::vector<s32> > ianchors(eb->Xsize * eb->Zsize);
+	for(size_t i = 0; i < ianchors.size(); i++) {
+		s32 count;
+		if(fs::read(ifs, count).fail()
+		   || !AnchorData_CheckCount(ifs, fileSize, count, sizeof(s32), maxCount)) {
+			LogWarning << "Ignoring invalid anchor cache " << file;
+			return false;
+		}
+		ianchors[i].resize(count);
+		if(count && fs::read(ifs, &ianchors[i][0], count * sizeof(s32)).fail()) {
+			LogWarning << "Ignoring truncated anchor cache " << file;
+			return false;
+		}
+		if(!AnchorData_CheckIndices(ianchors[i], header.nbanchors)) {
+			LogWarning << "Ignoring anchor cache with bad tile anchors " << file;
+			return false;
+		}
+	}
+	
+	eb->nbanchors = header.nbanchors;
+	eb->anchors = anchors.empty() ? NULL : (ANCHOR_DATA *)malloc(sizeof(ANCHOR_DATA) * anchors.size());
+	for(size_t i = 0; i < anchors.size(); i++) {
+		ANCHOR_DATA & ad = eb->anchors[i];
+		ad.pos = anchors[i].pos;
+		ad.radius = anchors[i].radius;
+		ad.height = anchors[i].height;
+		ad.flags = 0;
+		ad.nblinked = short(linked[i].size());
+		ad.linked = linked[i].empty() ? NULL : (long *)malloc(sizeof(long) * linked[i].size());
+		std::copy(linked[i].begin(), linked[i].end(), ad.linked);
+	}
+	
+	for(size_t i = 0; i < ianchors.size(); i++) {
+		EERIE_BKG_INFO & eg = eb->Backg[i];
+		eg.nbianchors = short(ianchors[i].size());
+		eg.ianchors = ianchors[i].empty() ? NULL : (long *)malloc(sizeof(long) * ianchors[i].size());
+		std::copy(ianchors[i].begin(), ianchors[i].end(), eg.ianchors);
+	}
+	
+	return true;
+}
 
-					while (current_y > roof)
-					{
-						currcyl.origin.y = current_y;
-						EERIEPOLY * ep2 = ANCHOR_CheckInPolyPrecis(currcyl.origin.x, currcyl.origin.y - 30.f, currcyl.origin.z);
+static void AnchorData_SaveCache(const EERIE_BACKGROUND * eb, const fs::path & file, u64 hash) {
+	
+	if(!fs::create_directories(file.parent())) {
+		LogWarning << "Could not create anchor cache directory " << file.parent();
+		return;
+	}
+	
+	fs::ofstream ofs(file, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+	if(!ofs.is_open()) {
+		LogWarning << "Could not write anchor cache " << file;
+		return;
+	}
+	
+	AnchorCacheHeader header;
+	memset(&header, 0, sizeof(header)); // Don't write uninitialized padding
+	memcpy(header.magic, ANCHOR_CACHE_MAGIC, sizeof(header.magic));
+	header.version = ANCHOR_CACHE_VERSION;
+	header.hash = hash;
+	header.sizex = eb->Xsize;
+	header.sizez = eb->Zsize;
+	header.nbanchors = eb->nbanchors;
+	fs::write(ofs, header);
+	
+	for(long i = 0; i < eb->nbanchors; i++) {
+		const ANCHOR_DATA & ad = eb->anchors[i];
+		AnchorCacheData data;
+		data.pos = ad.pos;
+		data.radius = ad.radius;
+		data.height = ad.height;
+		data.nblinked = ad.nblinked;
+		fs::write(ofs, data);
+		for(long k = 0; k < ad.nblinked; k++) {
+			fs::write(ofs, s32(ad.linked[k]));
+		}
+	}
+	
+	for(long i = 0; i < eb->Xsize * eb->Zsize; i++) {
+		const EERIE_BKG_INFO & eg = eb->Backg[i];
+		fs::write(ofs, s32(eg.nbianchors));
+		for(long k = 0; k < eg.nbianchors; k++) {
+			fs::write(ofs, s32(eg.ianchors[k]));
+		}
+	}
+	
+	if(ofs.fail()) {
+		LogWarning << "Error writing anchor cache " << file;
+	}
+}
 
-						if (ep2 && !(ep2->type & POLY_DOUBLESIDED) && (ep2->norm.y > 0.f))
-							ep2 = NULL;
+void AnchorData_Create(EERIE_BACKGROUND * eb, const fs::path & cache) {
+	
+	AnchorData_ClearAll(eb);
 
-						if ((ep2) && !(ep2->type & POLY_NOPATH))
-						{
-							bool bval = ANCHOR_AttemptValidCylinderPos(&currcyl, NULL, CFLAG_NO_INTERCOL | CFLAG_EXTRA_PRECISION | CFLAG_RETURN_HEIGHT | CFLAG_ANCHOR_GENERATION);
+	u64 hash = 0;
+	fs::path file;
+	if(!cache.empty()) {
+		hash = AnchorData_GetSceneHash(eb);
+		file = AnchorData_GetCacheFile(cache, hash);
+		if(AnchorData_LoadCache(eb, file, hash)) {
+			LogInfo << "Loaded " << eb->nbanchors << " anchors from " << file;
+			EERIE_PATHFINDER_Create();
+			return;
+		}
+	}
 
-							if ((bval)
-							        && (currcyl.origin.y - 10.f <= current_y))
-							{
-								EERIEPOLY * ep2 = ANCHOR_CheckInPolyPrecis(currcyl.origin.x, currcyl.origin.y - 38.f, currcyl.origin.z);
+	u64 startTime = Time::getUs();
 
-								if (ep2 && !(ep2->type & POLY_DOUBLESIDED) && (ep2->norm.y > 0.f))
-								{
-									current_y -= 10.f;
-								}
-								else if ((ep2) && (ep2->type & POLY_NOPATH))
-								{
-									current_y -= 10.f;
-								}
-								else if (AddAnchor_Original_Method(eb, eg, &currcyl.origin))
-								{
-									LASTFOUND++;
-									current_y = currcyl.origin.y + currcyl.height;
-								}
-								else current_y -= 10.f;
-							}
-							else current_y -= 10.f;
-						}
-						else current_y -= 10.f;
-					}
-				}
-			}
-		}
+	AnchorData_Create_Phase_I(eb);
+	u64 placementTime = Time::getUs();
 
 	AnchorData_Create_Phase_II_Original_Method(eb);
-	AnchorData_Create_Links_Original_Method(eb);
+	u64 preciseTime = Time::getUs();
+	
+	AnchorData_Create_Links(eb);
+	u64 endTime = Time::getUs();
+	
+	LogInfo << "Generated " << eb->nbanchors << " anchors in "
+	        << (Time::getElapsedUs(startTime, endTime) / 1000) << " ms: placement "
+	        << (Time::getElapsedUs(startTime, placementTime) / 1000) << " ms, precise paths "
+	        << (Time::getElapsedUs(placementTime, preciseTime) / 1000) << " ms, links "
+	        << (Time::getElapsedUs(preciseTime, endTime) / 1000) << " ms";
+	
+	if(!file.empty()) {
+		AnchorData_SaveCache(eb, file, hash);
+	}
 }
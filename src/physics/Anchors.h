@@ -47,6 +47,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #ifndef ARX_PHYSICS_ANCHORS_H
 #define ARX_PHYSICS_ANCHORS_H
 
+#include "io/fs/FilePath.h"
 #include "math/Vector3.h"
 #include "platform/Flags.h"
 
@@ -75,6 +76,12 @@ struct ANCHOR_DATA {
 void AnchorData_ClearAll(EERIE_BACKGROUND * eb);
 bool CylinderAboveInvalidZone(EERIE_CYLINDER * cyl);
 
-void AnchorData_Create(EERIE_BACKGROUND * eb);
+/*!
+ * Generates the anchors and anchor links used for pathfinding
+ *
+ * \param cache directory to store generated anchors in, keyed by a hash of the scene
+ *              geometry. If the scene has not changed, the anchors are loaded from there.
+ */
+void AnchorData_Create(EERIE_BACKGROUND * eb, const fs::path & cache = fs::path());
  
 #endif // ARX_PHYSICS_ANCHORS_H
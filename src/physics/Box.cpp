@@ -53,8 +53,6 @@ using std::max;
 
 #define FULLTESTS 0
 
-long CUR_COLLISION_MATERIAL = 0;
-
 // Used to launch an object into the physical world...
 void EERIE_PHYSICS_BOX_Launch(EERIE_3DOBJ * obj, Vec3f * pos, Vec3f * vect, long flag, Anglef * angle)
 {
@@ -93,4 +93,10 @@
 
 #endif
 
+// SSE2 is part of x86-64, for 32-bit x86 it depends on the compiler flags
+#if ARX_ARCH == ARX_ARCH_X86_64 || defined(__SSE2__) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_HAVE_SSE2 1
+#endif
+
 #endif // ARX_PLATFORM_ARCHITECTURE_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Minimal atomic operations on 32-bit integers.
+ *
+ * These are plain functions operating on aligned volatile u32 values so that they can
+ * be used for statically initialized data without needing dynamic initialization.
+ *
+ * Loads have acquire semantics, stores have release semantics and all read-modify-write
+ * operations are full memory barriers.
+ */
+#ifndef ARX_PLATFORM_ATOMIC_H
+#define ARX_PLATFORM_ATOMIC_H
+
+#include "platform/Platform.h"
+
+#if ARX_COMPILER_MSVC
+#include <intrin.h>
+#pragma intrinsic(_InterlockedExchange, _InterlockedExchangeAdd)
+#pragma intrinsic(_InterlockedCompareExchange, _ReadWriteBarrier)
+#endif
+
+//! @return the current value of *value
+inline u32 atomicLoad(const volatile u32 * value) {
+#if ARX_COMPILER_MSVC
+	u32 result = *value;
+	_ReadWriteBarrier();
+	return result;
+#elif defined(__ATOMIC_ACQUIRE)
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#else
+	u32 result = *value;
+	__sync_synchronize();
+	return result;
+#endif
+}
+
+//! Set *value to newValue
+inline void atomicStore(volatile u32 * value, u32 newValue) {
+#if ARX_COMPILER_MSVC
+	_InterlockedExchange(reinterpret_cast<volatile long *>(value), long(newValue));
+#elif defined(__ATOMIC_RELEASE)
+	__atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#else
+	__sync_synchronize();
+	*value = newValue;
+#endif
+}
+
+//! Add increment to *value @return the old value
+inline u32 atomicAdd(volatile u32 * value, u32 increment) {
+#if ARX_COMPILER_MSVC
+	return u32(_InterlockedExchangeAdd(reinterpret_cast<volatile long *>(value),
+	                                   long(increment)));
+#else
+	return __sync_fetch_and_add(value, increment);
+#endif
+}
+
+/*!
+ * Set *value to newValue if it is equal to expected.
+ * @return the old value - the exchange was successful if this is equal to expected
+ */
+inline u32 atomicCompareExchange(volatile u32 * value, u32 expected, u32 newValue) {
+#if ARX_COMPILER_MSVC
+	return u32(_InterlockedCompareExchange(reinterpret_cast<volatile long *>(value),
+	                                       long(newValue), long(expected)));
+#else
+	return __sync_val_compare_and_swap(value, expected, newValue);
+#endif
+}
+
+#endif // ARX_PLATFORM_ATOMIC_H
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform/JobSystem.h"
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <sstream>
+#include <vector>
+
+#include "Configure.h"
+
+#if defined(ARX_HAVE_PTHREADS)
+#include <pthread.h>
+#endif
+
+#if defined(ARX_HAVE_SYSCONF)
+#include <unistd.h>
+#endif
+
+#if defined(ARX_HAVE_WINAPI)
+#include <windows.h>
+#endif
+
+#include "io/log/Logger.h"
+#include "platform/Atomic.h"
+#include "platform/Lock.h"
+#include "platform/Thread.h"
+
+namespace jobs {
+
+namespace {
+
+//! Upper limit for the number of worker threads
+const size_t MAX_WORKER_THREADS = 15;
+
+//! Counting semaphore used to wake up idle workers
+class Semaphore {
+	
+#if defined(ARX_HAVE_PTHREADS)
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	size_t count;
+#elif defined(ARX_HAVE_WINAPI)
+	HANDLE semaphore;
+#endif
+	
+public:
+	
+#if defined(ARX_HAVE_PTHREADS)
+	
+	Semaphore() : count(0) {
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&cond, NULL);
+	}
+	
+	~Semaphore() {
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+	}
+	
+	void post(size_t n = 1) {
+		pthread_mutex_lock(&mutex);
+		count += n;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+	
+	void wait() {
+		pthread_mutex_lock(&mutex);
+		while(count == 0) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		count--;
+		pthread_mutex_unlock(&mutex);
+	}
+	
+#elif defined(ARX_HAVE_WINAPI)
+	
+	Semaphore() {
+		semaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+		arx_assert(semaphore);
+	}
+	
+	~Semaphore() {
+		CloseHandle(semaphore);
+	}
+	
+	void post(size_t n = 1) {
+		ReleaseSemaphore(semaphore, LONG(n), NULL);
+	}
+	
+	void wait() {
+		WaitForSingleObject(semaphore, INFINITE);
+	}
+	
+#endif
+	
+};
+
+class WorkerThread : public Thread {
+	
+	void run();
+	
+};
+
+std::vector<WorkerThread *> g_workers;
+volatile u32 g_stopping = 0;
+
+size_t getCPUCount() {
+	
+#if defined(ARX_HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(count > 0) {
+		return size_t(count);
+	}
+#elif defined(ARX_HAVE_WINAPI)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	if(info.dwNumberOfProcessors > 0) {
+		return size_t(info.dwNumberOfProcessors);
+	}
+#endif
+	
+	return 1;
+}
+
+//! Runs the items of a parallelFor() call in chunks of grain items
+class ParallelForJob : public Job {
+	
+	ParallelTask & m_task;
+	const u32 m_count;
+	const u32 m_grain;
+	volatile u32 m_next;
+	
+public:
+	
+	ParallelForJob(ParallelTask & task, size_t count, size_t grain)
+		: m_task(task), m_count(u32(count)), m_grain(u32(grain)), m_next(0) { }
+	
+	void run() {
+		for(;;) {
+			u32 begin = atomicAdd(&m_next, m_grain);
+			if(begin >= m_count) {
+				break;
+			}
+			m_task.run(begin, std::min(begin + m_grain, m_count));
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+//! Queue of jobs waiting for a worker, each entry is one instance of a job
+class JobQueue {
+	
+	static Lock s_lock;
+	static std::deque<Job *> s_queue;
+	
+public:
+	
+	static Semaphore s_available;
+	
+	static void push(Job & job, size_t instances) {
+		
+		atomicAdd(&job.m_pending, u32(instances));
+		
+		{
+			Autolock lock(s_lock);
+			s_queue.insert(s_queue.end(), instances, &job);
+		}
+		
+		s_available.post(instances);
+	}
+	
+	//! @return the next job or NULL if the queue is empty
+	static Job * pop() {
+		
+		Autolock lock(s_lock);
+		
+		if(s_queue.empty()) {
+			return NULL;
+		}
+		
+		Job * job = s_queue.front();
+		s_queue.pop_front();
+		
+		return job;
+	}
+	
+	//! Remove all instances of a job that have not been started yet
+	static size_t remove(Job & job) {
+		
+		size_t removed;
+		
+		{
+			Autolock lock(s_lock);
+			std::deque<Job *>::iterator it;
+			it = std::remove(s_queue.begin(), s_queue.end(), &job);
+			removed = s_queue.end() - it;
+			s_queue.erase(it, s_queue.end());
+		}
+		
+		finish(job, removed);
+		
+		return removed;
+	}
+	
+	static void finish(Job & job, size_t instances = 1) {
+		if(instances) {
+			atomicAdd(&job.m_pending, u32(-u32(instances)));
+		}
+	}
+	
+	//! Wait until no instances of the job are running
+	static void waitForRunning(Job & job) {
+		while(atomicLoad(&job.m_pending) != 0) {
+			Thread::sleep(0);
+		}
+	}
+	
+};
+
+Lock JobQueue::s_lock;
+std::deque<Job *> JobQueue::s_queue;
+Semaphore JobQueue::s_available;
+
+void WorkerThread::run() {
+	
+	for(;;) {
+		
+		JobQueue::s_available.wait();
+		
+		if(Job * job = JobQueue::pop()) {
+			job->run();
+			JobQueue::finish(*job);
+		} else if(atomicLoad(&g_stopping)) {
+			break;
+		}
+		
+		// Otherwise the job was removed from the queue by wait()
+	}
+	
+}
+
+void initialize(size_t threads) {
+	
+	arx_assert(g_workers.empty());
+	
+	if(threads == 0) {
+		threads = getCPUCount() - 1;
+	}
+	threads = std::min(threads, MAX_WORKER_THREADS);
+	
+	atomicStore(&g_stopping, 0);
+	
+	for(size_t i = 0; i < threads; i++) {
+		WorkerThread * worker = new WorkerThread;
+		std::ostringstream name;
+		name << "Worker " << (i + 1);
+		worker->setThreadName(name.str());
+		worker->start();
+		g_workers.push_back(worker);
+	}
+	
+	LogInfo << "Using " << threads << " worker threads";
+}
+
+void shutdown() {
+	
+	if(g_workers.empty()) {
+		return;
+	}
+	
+	atomicStore(&g_stopping, 1);
+	JobQueue::s_available.post(g_workers.size());
+	
+	for(size_t i = 0; i < g_workers.size(); i++) {
+		g_workers[i]->waitForCompletion();
+		delete g_workers[i];
+	}
+	g_workers.clear();
+}
+
+size_t getThreadCount() {
+	return g_workers.size() + 1;
+}
+
+void submit(Job & job) {
+	
+	if(g_workers.empty()) {
+		job.run();
+		return;
+	}
+	
+	JobQueue::push(job, 1);
+}
+
+void wait(Job & job) {
+	
+	if(JobQueue::remove(job)) {
+		job.run();
+	}
+	
+	JobQueue::waitForRunning(job);
+}
+
+void parallelFor(ParallelTask & task, size_t count, size_t grain) {
+	
+	arx_assert(count < size_t(1) << 31);
+	
+	grain = std::max(grain, size_t(1));
+	size_t chunks = (count + grain - 1) / grain;
+	
+	if(g_workers.empty() || chunks <= 1) {
+		if(count) {
+			task.run(0, count);
+		}
+		return;
+	}
+	
+	ParallelForJob job(task, count, grain);
+	
+	JobQueue::push(job, std::min(chunks - 1, g_workers.size()));
+	
+	job.run();
+	
+	// All items have been started - remaining queue entries would find nothing to do
+	JobQueue::remove(job);
+	JobQueue::waitForRunning(job);
+}
+
+} // namespace jobs
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * A small pool of worker threads for CPU-bound work.
+ *
+ * Jobs must not call into the renderer, the audio system or anything else that is only
+ * safe on the main thread. If the job system has not been initialized, or there is only
+ * one CPU core, all jobs are run synchronously on the calling thread.
+ */
+#ifndef ARX_PLATFORM_JOBSYSTEM_H
+#define ARX_PLATFORM_JOBSYSTEM_H
+
+#include <stddef.h>
+
+#include "platform/Platform.h"
+
+namespace jobs {
+
+//! A unit of work that can be run asynchronously with submit() and wait()
+class Job {
+	
+public:
+	
+	Job() : m_pending(0) { }
+	
+	virtual ~Job() { }
+	
+	virtual void run() = 0;
+	
+private:
+	
+	//! Number of queued or running instances of this job
+	volatile u32 m_pending;
+	
+	friend class JobQueue;
+	
+};
+
+//! Work that can be split into independent ranges, see parallelFor()
+class ParallelTask {
+	
+public:
+	
+	virtual ~ParallelTask() { }
+	
+	//! Process the items in [begin, end). May be called concurrently for disjoint ranges.
+	virtual void run(size_t begin, size_t end) = 0;
+	
+};
+
+/*!
+ * Start the worker threads.
+ * @param threads number of worker threads to start, or 0 to use one less than the
+ *                number of CPU cores.
+ */
+void initialize(size_t threads = 0);
+
+//! Wait for all queued jobs and stop the worker threads.
+void shutdown();
+
+//! @return the number of threads that run jobs, including the calling thread.
+size_t getThreadCount();
+
+/*!
+ * Queue a job to be run on a worker thread.
+ * The job object must stay valid until wait() has returned for it.
+ */
+void submit(Job & job);
+
+/*!
+ * Wait for a submitted job to finish.
+ * If no worker has started the job yet, it is run on the calling thread.
+ */
+void wait(Job & job);
+
+/*!
+ * Run task.run() for all items in [0, count) and wait until it is done.
+ * The calling thread also processes items.
+ * @param grain minimum number of items to process in one call to task.run().
+ */
+void parallelFor(ParallelTask & task, size_t count, size_t grain = 1);
+
+} // namespace jobs
+
+#endif // ARX_PLATFORM_JOBSYSTEM_H
@@ -21,6 +21,7 @@
 
 #include "platform/CrashHandler.h"
 #include "platform/Platform.h"
+#include "platform/profiler/Profiler.h"
 
 void Thread::setThreadName(const std::string & _threadName) {
 	threadName = _threadName;
@@ -116,7 +117,9 @@ void * Thread::entryPoint(void * param) {
 #endif
 	
 	CrashHandler::registerThreadCrashHandlers();
+	profiler::registerThread(thread.threadName);
 	thread.run();
+	profiler::unregisterThread();
 	CrashHandler::unregisterThreadCrashHandlers();
 	return NULL;
 }
@@ -212,7 +215,9 @@ DWORD WINAPI Thread::entryPoint(LPVOID param) {
 	SetCurrentThreadName(((Thread*)param)->threadName);
 	
 	CrashHandler::registerThreadCrashHandlers();
+	profiler::registerThread(((Thread*)param)->threadName);
 	((Thread*)param)->run();
+	profiler::unregisterThread();
 	CrashHandler::unregisterThreadCrashHandlers();
 	return 0;
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform/profiler/LoadStatistics.h"
+
+#include <cstring>
+
+#include "platform/Atomic.h"
+#include "platform/Time.h"
+
+namespace profiler {
+
+namespace {
+
+/*
+ * Raw counters that can be updated from any thread. These wrap around, but only the
+ * differences between two phase switches are used.
+ */
+volatile u32 g_bytesRead = 0;
+volatile u32 g_allocations = 0;
+volatile u32 g_allocatedBytes = 0;
+
+LoadPhaseStats g_stats[LoadPhaseCount];
+
+//! The active phase or LoadPhaseCount if no phase is active
+LoadPhase g_currentPhase = LoadPhaseCount;
+
+u64 g_phaseStartTime;
+u32 g_phaseStartBytesRead;
+u32 g_phaseStartAllocations;
+u32 g_phaseStartAllocatedBytes;
+
+void switchPhase(LoadPhase phase) {
+	
+	u64 now = Time::getUs();
+	u32 bytesRead = atomicLoad(&g_bytesRead);
+	u32 allocations = atomicLoad(&g_allocations);
+	u32 allocatedBytes = atomicLoad(&g_allocatedBytes);
+	
+	if(g_currentPhase != LoadPhaseCount) {
+		LoadPhaseStats & stats = g_stats[g_currentPhase];
+		stats.time += Time::getElapsedUs(g_phaseStartTime, now);
+		stats.bytesRead += u32(bytesRead - g_phaseStartBytesRead);
+		stats.allocations += u32(allocations - g_phaseStartAllocations);
+		stats.allocatedBytes += u32(allocatedBytes - g_phaseStartAllocatedBytes);
+	}
+	
+	g_currentPhase = phase;
+	g_phaseStartTime = now;
+	g_phaseStartBytesRead = bytesRead;
+	g_phaseStartAllocations = allocations;
+	g_phaseStartAllocatedBytes = allocatedBytes;
+}
+
+} // anonymous namespace
+
+const char * getLoadPhaseName(LoadPhase phase) {
+	switch(phase) {
+		case LoadLevel:    return "level";
+		case LoadScene:    return "scene";
+		case LoadModels:   return "models";
+		case LoadTextures: return "textures";
+		case LoadScripts:  return "scripts";
+		case LoadPhaseCount: break;
+	}
+	return "unknown";
+}
+
+void resetLoadStatistics() {
+	
+	// Restart the current phase so that earlier time is not accounted to it
+	switchPhase(g_currentPhase);
+	
+	memset(g_stats, 0, sizeof(g_stats));
+}
+
+const LoadPhaseStats & getLoadStatistics(LoadPhase phase) {
+	arx_assert(phase >= 0 && phase < LoadPhaseCount);
+	return g_stats[phase];
+}
+
+void countBytesRead(size_t bytes) {
+	atomicAdd(&g_bytesRead, u32(bytes));
+}
+
+void countAllocation(size_t bytes) {
+	atomicAdd(&g_allocations, 1);
+	atomicAdd(&g_allocatedBytes, u32(bytes));
+}
+
+LoadPhaseScope::LoadPhaseScope(LoadPhase phase) : m_previous(g_currentPhase) {
+	
+	arx_assert(phase >= 0 && phase < LoadPhaseCount);
+	
+	if(phase != g_currentPhase) {
+		switchPhase(phase);
+	}
+	
+	g_stats[phase].count++;
+}
+
+LoadPhaseScope::~LoadPhaseScope() {
+	if(m_previous != g_currentPhase) {
+		switchPhase(m_previous);
+	}
+}
+
+} // namespace profiler
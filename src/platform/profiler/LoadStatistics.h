@@ -0,0 +1,93 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_PROFILER_LOADSTATISTICS_H
+#define ARX_PLATFORM_PROFILER_LOADSTATISTICS_H
+
+#include <stddef.h>
+
+#include <boost/preprocessor/cat.hpp>
+
+#include "platform/Platform.h"
+
+/*!
+ * Per-phase statistics for level loading.
+ *
+ * Loading code marks the phase it belongs to with ARX_LOAD_PHASE(phase). Time, bytes read
+ * from resources and allocations are attributed to the innermost active phase, so the
+ * phases never overlap and their sum is the total time spent in any phase.
+ *
+ * Unlike the frame profiler, this is always compiled in - the overhead is only incurred
+ * once per loaded resource. Phases must only be entered from the main thread, but the
+ * counters can be updated from any thread.
+ */
+namespace profiler {
+
+enum LoadPhase {
+	LoadLevel,    //!< Level file parsing and anything not covered by another phase
+	LoadScene,    //!< Fast scene (.fts) loading
+	LoadModels,   //!< Model (.ftl) loading
+	LoadTextures, //!< Texture decoding and upload
+	LoadScripts,  //!< Script initialization events
+	LoadPhaseCount
+};
+
+struct LoadPhaseStats {
+	
+	u64 time; //!< Exclusive wall time in microseconds
+	u64 count; //!< Number of times the phase was entered
+	u64 bytesRead; //!< Number of bytes read from resource files
+	u64 allocations; //!< Number of allocations reported via countAllocation()
+	u64 allocatedBytes; //!< Total size of allocations reported via countAllocation()
+	
+};
+
+//! @return a short name for the phase that can be used in reports
+const char * getLoadPhaseName(LoadPhase phase);
+
+//! Reset the statistics of all phases
+void resetLoadStatistics();
+
+//! @return the statistics for the given phase since the last reset
+const LoadPhaseStats & getLoadStatistics(LoadPhase phase);
+
+//! Account bytes read from resource files to the current phase.
+void countBytesRead(size_t bytes);
+
+//! Account an allocation to the current phase.
+void countAllocation(size_t bytes);
+
+class LoadPhaseScope {
+	
+	LoadPhase m_previous;
+	
+public:
+	
+	explicit LoadPhaseScope(LoadPhase phase);
+	
+	~LoadPhaseScope();
+	
+};
+
+} // namespace profiler
+
+#define ARX_LOAD_PHASE(phase) \
+	::profiler::LoadPhaseScope BOOST_PP_CAT(loadPhaseScope, __LINE__)(::profiler::phase)
+
+#endif // ARX_PLATFORM_PROFILER_LOADSTATISTICS_H
@@ -0,0 +1,334 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform/profiler/Profiler.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "platform/Atomic.h"
+#include "platform/Lock.h"
+#include "platform/ProgramOptions.h"
+
+#if ARX_COMPILER_MSVC
+#define ARX_THREAD_LOCAL __declspec(thread)
+#else
+#define ARX_THREAD_LOCAL __thread
+#endif
+
+namespace profiler {
+
+namespace {
+
+struct Zone {
+	const char * tag;
+	u64 startTime;
+	u64 endTime;
+};
+
+//! Number of zones that can be recorded per thread and frame without losing data
+const u32 ThreadBufferSize = 16 * 1024; // must be a power of two
+
+struct ThreadData {
+	
+	std::string name;
+	
+	//! Thread id used in traces
+	u32 id;
+	
+	Zone zones[ThreadBufferSize];
+	
+	//! Only modified by the owning thread
+	volatile u32 writePos;
+	
+	//! Only modified by frame()
+	u32 readPos;
+	
+	//! Cleared when the owning thread exits - the buffer can then be reused.
+	volatile u32 active;
+	
+};
+
+ARX_THREAD_LOCAL ThreadData * currentThread = NULL;
+
+Lock threadsLock;
+std::vector<ThreadData *> threads;
+
+struct Stats {
+	float time;
+	u64 frameTime;
+	unsigned calls;
+	unsigned frameCalls;
+};
+
+//! note: using the pointer value of a string constant as a hash map index.
+typedef boost::unordered_map<const char *, Stats> StatsMap;
+StatsMap stats;
+
+//! Weight of the current frame in the average zone times
+const float StatsSmoothing = 0.05f;
+
+struct CapturedZone {
+	u32 thread;
+	Zone zone;
+};
+
+std::vector<CapturedZone> captured;
+u64 frameIndex = 0;
+u64 captureFirst = 0;
+u64 captureLast = 0;
+bool capturing = false;
+std::string captureFile;
+
+ThreadData * createThreadData(const std::string & name) {
+	
+	Autolock lock(threadsLock);
+	
+	ThreadData * data = NULL;
+	
+	// Reuse buffers from threads that have exited and whose zones have been collected
+	BOOST_FOREACH(ThreadData * thread, threads) {
+		if(!atomicLoad(&thread->active) && thread->readPos == atomicLoad(&thread->writePos)) {
+			data = thread;
+			break;
+		}
+	}
+	
+	if(!data) {
+		data = new ThreadData;
+		data->id = u32(threads.size());
+		data->writePos = data->readPos = 0;
+		threads.push_back(data);
+	}
+	
+	data->name = name.empty() ? "Thread " + boost::lexical_cast<std::string>(data->id) : name;
+	atomicStore(&data->active, 1);
+	
+	return data;
+}
+
+void writeJSONString(std::ostream & os, const char * str) {
+	os << '"';
+	for(; *str; str++) {
+		if(*str == '"' || *str == '\\') {
+			os << '\\' << *str;
+		} else if(u8(*str) >= 0x20) {
+			os << *str;
+		}
+	}
+	os << '"';
+}
+
+void writeTrace() {
+	
+	fs::path file = captureFile;
+	if(file.empty()) {
+		file = fs::paths.user / "profile.json";
+	}
+	
+	fs::ofstream ofs(file, std::ios_base::out | std::ios_base::trunc);
+	if(!ofs.is_open()) {
+		LogError << "Could not write profiler trace to " << file;
+		return;
+	}
+	
+	ofs << "{\"traceEvents\":[\n";
+	
+	bool first = true;
+	
+	{
+		Autolock lock(threadsLock);
+		BOOST_FOREACH(const ThreadData * thread, threads) {
+			ofs << (first ? "" : ",\n");
+			ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+			    << ",\"args\":{\"name\":";
+			writeJSONString(ofs, thread->name.c_str());
+			ofs << "}}";
+			first = false;
+		}
+	}
+	
+	u64 startTime = captured.empty() ? 0 : captured.front().zone.startTime;
+	BOOST_FOREACH(const CapturedZone & zone, captured) {
+		startTime = std::min(startTime, zone.zone.startTime);
+	}
+	
+	BOOST_FOREACH(const CapturedZone & zone, captured) {
+		ofs << (first ? "" : ",\n") << "{\"name\":";
+		writeJSONString(ofs, zone.zone.tag);
+		ofs << ",\"cat\":\"arx\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.thread
+		    << ",\"ts\":" << (zone.zone.startTime - startTime)
+		    << ",\"dur\":" << (zone.zone.endTime - zone.zone.startTime) << '}';
+		first = false;
+	}
+	
+	ofs << "\n]}\n";
+	
+	LogInfo << "Wrote profiler trace with " << captured.size() << " zones to " << file;
+}
+
+bool compareZoneTime(const ZoneStats & a, const ZoneStats & b) {
+	return a.time > b.time;
+}
+
+void captureFramesOption(const std::string & range) {
+	
+	u64 first = 0, last = 0;
+	try {
+		size_t pos = range.find('-');
+		if(pos == std::string::npos) {
+			first = last = boost::lexical_cast<u64>(range);
+		} else {
+			first = boost::lexical_cast<u64>(range.substr(0, pos));
+			last = boost::lexical_cast<u64>(range.substr(pos + 1));
+		}
+	} catch(const boost::bad_lexical_cast &) {
+		LogError << "Invalid frame range: " << range;
+		return;
+	}
+	
+	captureFrames(first, last, std::string());
+}
+
+} // anonymous namespace
+
+void registerThread(const std::string & name) {
+	
+	if(currentThread) {
+		Autolock lock(threadsLock);
+		currentThread->name = name;
+	} else {
+		currentThread = createThreadData(name);
+	}
+}
+
+void unregisterThread() {
+	
+	if(currentThread) {
+		atomicStore(&currentThread->active, 0);
+		currentThread = NULL;
+	}
+}
+
+void addZone(const char * tag, u64 startTime, u64 endTime) {
+	
+	ThreadData * thread = currentThread;
+	if(!thread) {
+		thread = currentThread = createThreadData(std::string());
+	}
+	
+	u32 pos = thread->writePos;
+	Zone & zone = thread->zones[pos & (ThreadBufferSize - 1)];
+	zone.tag = tag;
+	zone.startTime = startTime;
+	zone.endTime = endTime;
+	atomicStore(&thread->writePos, pos + 1);
+}
+
+void frame() {
+	
+	bool capture = capturing && frameIndex >= captureFirst;
+	
+	{
+		Autolock lock(threadsLock);
+		
+		BOOST_FOREACH(ThreadData * thread, threads) {
+			
+			u32 end = atomicLoad(&thread->writePos);
+			if(end - thread->readPos > ThreadBufferSize) {
+				// The thread recorded more zones than we can buffer - skip the oldest
+				thread->readPos = end - ThreadBufferSize;
+			}
+			
+			for(; thread->readPos != end; thread->readPos++) {
+				
+				const Zone & zone = thread->zones[thread->readPos & (ThreadBufferSize - 1)];
+				
+				Stats & zoneStats = stats[zone.tag];
+				zoneStats.frameTime += zone.endTime - zone.startTime;
+				zoneStats.frameCalls++;
+				
+				if(capture) {
+					CapturedZone captureZone;
+					captureZone.thread = thread->id;
+					captureZone.zone = zone;
+					captured.push_back(captureZone);
+				}
+			}
+		}
+	}
+	
+	BOOST_FOREACH(StatsMap::value_type & entry, stats) {
+		Stats & zoneStats = entry.second;
+		zoneStats.time += (float(zoneStats.frameTime) - zoneStats.time) * StatsSmoothing;
+		zoneStats.calls = zoneStats.frameCalls;
+		zoneStats.frameTime = 0;
+		zoneStats.frameCalls = 0;
+	}
+	
+	if(capture && frameIndex >= captureLast) {
+		writeTrace();
+		captured.clear();
+		capturing = false;
+	}
+	
+	frameIndex++;
+}
+
+void getTopZones(std::vector<ZoneStats> & zones, size_t count) {
+	
+	zones.clear();
+	zones.reserve(stats.size());
+	
+	BOOST_FOREACH(const StatsMap::value_type & entry, stats) {
+		ZoneStats zone;
+		zone.tag = entry.first;
+		zone.time = entry.second.time;
+		zone.calls = entry.second.calls;
+		zones.push_back(zone);
+	}
+	
+	count = std::min(count, zones.size());
+	std::partial_sort(zones.begin(), zones.begin() + count, zones.end(), compareZoneTime);
+	zones.resize(count);
+}
+
+void captureFrames(u64 first, u64 last, const std::string & file) {
+	
+	captured.clear();
+	captureFirst = frameIndex + first;
+	captureLast = frameIndex + std::max(first, last);
+	captureFile = file;
+	capturing = true;
+	
+	LogInfo << "Capturing profiler trace for frames " << captureFirst << " to " << captureLast;
+}
+
+} // namespace profiler
+
+ARX_PROGRAM_OPTION("profile", "p", "Write a profiler trace for the given frames",
+                   &profiler::captureFramesOption, "FIRST-LAST");
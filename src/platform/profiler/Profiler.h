@@ -0,0 +1,126 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_PROFILER_PROFILER_H
+#define ARX_PLATFORM_PROFILER_PROFILER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+
+#include "Configure.h"
+#include "platform/Platform.h"
+#include "platform/Time.h"
+
+/*!
+ * Lightweight instrumenting CPU profiler.
+ * 
+ * Code is instrumented by placing ARX_PROFILE(tag) or ARX_PROFILE_FUNC() markers at the
+ * start of a block - the time until the end of the block is recorded as a zone.
+ * Zones from each thread are written to a per-thread buffer without any locking and are
+ * collected once per frame by profiler::frame().
+ * 
+ * Instrumentation is only compiled in if BUILD_PROFILER_INSTRUMENT is enabled,
+ * otherwise all the functions in this file do nothing.
+ */
+namespace profiler {
+
+//! Accumulated statistics for one zone
+struct ZoneStats {
+	
+	const char * tag;
+	
+	//! Average inclusive time per frame in microseconds.
+	float time;
+	
+	//! Number of times the zone was entered in the last frame.
+	unsigned calls;
+	
+};
+
+#ifdef BUILD_PROFILER_INSTRUMENT
+
+//! Register the calling thread with a name to be used in traces.
+void registerThread(const std::string & name);
+
+//! Unregister the calling thread - any future zones will be discarded.
+void unregisterThread();
+
+//! Record a zone for the calling thread.
+void addZone(const char * tag, u64 startTime, u64 endTime);
+
+/*!
+ * Mark the end of a frame.
+ * Collects zones from all threads, updates the per-zone statistics and writes
+ * the trace file once the last captured frame has been reached.
+ * This should only be called from the main thread.
+ */
+void frame();
+
+/*!
+ * Get the zones with the highest average time per frame.
+ * @param count Maximum number of zones to return.
+ */
+void getTopZones(std::vector<ZoneStats> & zones, size_t count);
+
+/*!
+ * Capture all zones from the given frame range and write them to a file
+ * in the Chrome trace event format once the last frame has been reached.
+ * Frame numbers are relative to the time the capture is requested.
+ */
+void captureFrames(u64 first, u64 last, const std::string & file);
+
+class Scope {
+	
+	const char * m_tag;
+	u64 m_startTime;
+	
+public:
+	
+	explicit Scope(const char * tag) : m_tag(tag), m_startTime(Time::getUs()) { }
+	
+	~Scope() {
+		addZone(m_tag, m_startTime, Time::getUs());
+	}
+	
+};
+
+#define ARX_PROFILE(tag) \
+	::profiler::Scope BOOST_PP_CAT(profileScope, __LINE__)(tag)
+#define ARX_PROFILE_FUNC() \
+	::profiler::Scope profileScopeFunc(__FUNCTION__)
+
+#else // BUILD_PROFILER_INSTRUMENT
+
+inline void registerThread(const std::string & name) { ARX_UNUSED(name); }
+inline void unregisterThread() { }
+inline void frame() { }
+inline void getTopZones(std::vector<ZoneStats> & zones, size_t count) {
+	ARX_UNUSED(zones), ARX_UNUSED(count);
+}
+
+#define ARX_PROFILE(tag)   ARX_DISCARD(tag)
+#define ARX_PROFILE_FUNC() ARX_DISCARD()
+
+#endif // BUILD_PROFILER_INSTRUMENT
+
+} // namespace profiler
+
+#endif // ARX_PLATFORM_PROFILER_PROFILER_H
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scene/Culling.h"
+
+#include <algorithm>
+
+#include "graphics/BaseGraphicsTypes.h"
+#include "graphics/data/Mesh.h"
+#include "math/Vector3.h"
+#include "platform/Architecture.h"
+
+#if defined(ARX_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(ARX_HAVE_SSE2)
+
+namespace {
+
+//! Signed distances of four points to one plane of the frustum
+inline __m128 planeDistance(const EERIE_FRUSTRUM * frustrum, size_t plane,
+                            __m128 x, __m128 y, __m128 z) {
+	__m128 dist = _mm_mul_ps(x, _mm_set1_ps(frustrum->a[plane]));
+	dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(frustrum->b[plane])));
+	dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(frustrum->c[plane])));
+	return _mm_add_ps(dist, _mm_set1_ps(frustrum->d[plane]));
+}
+
+//! Signed distances of one point to all four planes of the frustum
+inline __m128 planeDistances(const EERIE_FRUSTRUM * frustrum, const Vec3f * point) {
+	__m128 dist = _mm_mul_ps(_mm_loadu_ps(frustrum->a), _mm_set1_ps(point->x));
+	dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(frustrum->b), _mm_set1_ps(point->y)));
+	dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(frustrum->c), _mm_set1_ps(point->z)));
+	return _mm_add_ps(dist, _mm_loadu_ps(frustrum->d));
+}
+
+} // anonymous namespace
+
+bool IsInFrustrum(const Vec3f * point, const EERIE_FRUSTRUM * frustrum) {
+	__m128 inside = _mm_cmpgt_ps(planeDistances(frustrum, point), _mm_setzero_ps());
+	return _mm_movemask_ps(inside) == 0xf;
+}
+
+bool IsSphereInFrustrum(float radius, const Vec3f * point, const EERIE_FRUSTRUM * frustrum) {
+	__m128 dist = _mm_add_ps(planeDistances(frustrum, point), _mm_set1_ps(radius));
+	return _mm_movemask_ps(_mm_cmpgt_ps(dist, _mm_setzero_ps())) == 0xf;
+}
+
+bool IsBBoxInFrustrum(const EERIE_3D_BBOX * bbox, const EERIE_FRUSTRUM * frustrum) {
+	
+	// The eight corners as two groups of four that only differ in z
+	__m128 x = _mm_setr_ps(bbox->min.x, bbox->max.x, bbox->max.x, bbox->min.x);
+	__m128 y = _mm_setr_ps(bbox->min.y, bbox->min.y, bbox->max.y, bbox->max.y);
+	__m128 zmin = _mm_set1_ps(bbox->min.z);
+	__m128 zmax = _mm_set1_ps(bbox->max.z);
+	
+	__m128 zero = _mm_setzero_ps();
+	__m128 lower = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	__m128 upper = lower;
+	for(size_t i = 0; i < 4; i++) {
+		lower = _mm_and_ps(lower, _mm_cmpgt_ps(planeDistance(frustrum, i, x, y, zmin), zero));
+		upper = _mm_and_ps(upper, _mm_cmpgt_ps(planeDistance(frustrum, i, x, y, zmax), zero));
+	}
+	
+	return _mm_movemask_ps(_mm_or_ps(lower, upper)) != 0;
+}
+
+#else // !defined(ARX_HAVE_SSE2)
+
+bool IsInFrustrum(const Vec3f * point, const EERIE_FRUSTRUM * frustrum) {
+	for(size_t i = 0; i < 4; i++) {
+		float dist = point->x * frustrum->a[i] + point->y * frustrum->b[i]
+		             + point->z * frustrum->c[i] + frustrum->d[i];
+		if(!(dist > 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsSphereInFrustrum(float radius, const Vec3f * point, const EERIE_FRUSTRUM * frustrum) {
+	for(size_t i = 0; i < 4; i++) {
+		float dist = point->x * frustrum->a[i] + point->y * frustrum->b[i]
+		             + point->z * frustrum->c[i] + frustrum->d[i];
+		if(!(dist + radius > 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsBBoxInFrustrum(const EERIE_3D_BBOX * bbox, const EERIE_FRUSTRUM * frustrum) {
+	for(size_t i = 0; i < 8; i++) {
+		Vec3f point((i & 1) ? bbox->max.x : bbox->min.x,
+		            (i & 2) ? bbox->max.y : bbox->min.y,
+		            (i & 4) ? bbox->max.z : bbox->min.z);
+		if(IsInFrustrum(&point, frustrum)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif // !defined(ARX_HAVE_SSE2)
+
+void CullingSpheres::clear() {
+	m_count = 0;
+}
+
+void CullingSpheres::add(const Vec3f & center, float radius) {
+	
+	if(m_count == m_x.size()) {
+		// Keep the arrays padded so that test() can always load four spheres
+		size_t size = m_count + 4;
+		m_x.resize(size, 0.f);
+		m_y.resize(size, 0.f);
+		m_z.resize(size, 0.f);
+		m_radius.resize(size, -1e30f);
+	}
+	
+	m_x[m_count] = center.x;
+	m_y[m_count] = center.y;
+	m_z[m_count] = center.z;
+	m_radius[m_count] = radius;
+	m_count++;
+}
+
+void CullingSpheres::test(const EERIE_FRUSTRUM_DATA & frustrums,
+                          std::vector<char> & visible) const {
+	
+	visible.resize(m_count);
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	__m128 zero = _mm_setzero_ps();
+	__m128 ones = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	
+	for(size_t i = 0; i < m_count; i += 4) {
+		
+		__m128 x = _mm_loadu_ps(&m_x[i]);
+		__m128 y = _mm_loadu_ps(&m_y[i]);
+		__m128 z = _mm_loadu_ps(&m_z[i]);
+		__m128 radius = _mm_loadu_ps(&m_radius[i]);
+		
+		__m128 any = zero;
+		for(long f = 0; f < frustrums.nb_frustrums; f++) {
+			const EERIE_FRUSTRUM * frustrum = &frustrums.frustrums[f];
+			__m128 inside = ones;
+			for(size_t p = 0; p < 4; p++) {
+				__m128 dist = _mm_add_ps(planeDistance(frustrum, p, x, y, z), radius);
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, zero));
+			}
+			any = _mm_or_ps(any, inside);
+			if(_mm_movemask_ps(any) == 0xf) {
+				break;
+			}
+		}
+		
+		int mask = _mm_movemask_ps(any);
+		size_t end = std::min(i + 4, m_count);
+		for(size_t j = i; j < end; j++) {
+			visible[j] = char((mask >> (j - i)) & 1);
+		}
+	}
+	
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < m_count; i++) {
+		Vec3f center(m_x[i], m_y[i], m_z[i]);
+		visible[i] = 0;
+		for(long f = 0; f < frustrums.nb_frustrums; f++) {
+			if(IsSphereInFrustrum(m_radius[i], &center, &frustrums.frustrums[f])) {
+				visible[i] = 1;
+				break;
+			}
+		}
+	}
+	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Frustum tests for the portal renderer.
+ *
+ * The four planes of an EERIE_FRUSTRUM are stored as a structure of arrays so that a
+ * point, sphere or box can be tested against all of them at once. Polygons are tested
+ * in batches of four bounding spheres against each frustum of a room.
+ */
+#ifndef ARX_SCENE_CULLING_H
+#define ARX_SCENE_CULLING_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "math/MathFwd.h"
+
+struct EERIE_FRUSTRUM;
+struct EERIE_FRUSTRUM_DATA;
+struct EERIE_3D_BBOX;
+
+//! \return true if the point is on the inner side of all four planes
+bool IsInFrustrum(const Vec3f * point, const EERIE_FRUSTRUM * frustrum);
+
+//! \return true if the sphere is at least partially on the inner side of all four planes
+bool IsSphereInFrustrum(float radius, const Vec3f * point, const EERIE_FRUSTRUM * frustrum);
+
+//! \return true if any corner of the box is inside the frustum
+bool IsBBoxInFrustrum(const EERIE_3D_BBOX * bbox, const EERIE_FRUSTRUM * frustrum);
+
+//! Bounding spheres stored as a structure of arrays, padded to a multiple of four
+class CullingSpheres {
+	
+public:
+	
+	CullingSpheres() : m_count(0) { }
+	
+	void clear();
+	
+	void add(const Vec3f & center, float radius);
+	
+	size_t size() const { return m_count; }
+	
+	/*!
+	 * Test all spheres against a set of frustums.
+	 * \param visible receives one entry per sphere, non-zero if the sphere intersects
+	 *                at least one of the frustums
+	 */
+	void test(const EERIE_FRUSTRUM_DATA & frustrums, std::vector<char> & visible) const;
+	
+private:
+	
+	size_t m_count;
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_radius;
+	
+};
+
+#endif // ARX_SCENE_CULLING_H
@@ -116,12 +116,16 @@ struct PlayingAmbiance {
 };
 
 static const unsigned long ARX_SOUND_UPDATE_INTERVAL(100);  
+static const unsigned long ARX_SOUND_COMMAND_INTERVAL(10);
 static const unsigned long ARX_SOUND_STREAMING_LIMIT(176400); 
 static const unsigned long MAX_MATERIALS(17);
 static const unsigned long MAX_VARIANTS(5);
 static const unsigned long AMBIANCE_FADE_TIME(2000);
 static const float ARX_SOUND_UNIT_FACTOR(0.01F);
 static const float ARX_SOUND_ROLLOFF_FACTOR(1.3F);
+static const size_t ARX_SOUND_MAX_VOICES(64);
+static const float ARX_SOUND_SPEECH_PRIORITY(4.F);
+static const float ARX_SOUND_AMBIANCE_PRIORITY(2.F);
 static const float ARX_SOUND_DEFAULT_FALLSTART(200.0F);
 
 static const float ARX_SOUND_DEFAULT_FALLEND(2200.0F);
@@ -411,6 +415,9 @@ bool ARX_SOUND_Init() {
 	audio::setUnitFactor(ARX_SOUND_UNIT_FACTOR);
 	audio::setRolloffFactor(ARX_SOUND_ROLLOFF_FACTOR);
 	
+	// Keep the number of backend voices bounded, quiet sounds are virtualized
+	audio::setMaxVoices(ARX_SOUND_MAX_VOICES);
+	
 	ARX_SOUND_LaunchUpdateThread();
 	
 	bIsActive = true;
@@ -430,6 +437,9 @@ void ARX_SOUND_LoadData() {
 	ARX_SOUND_CreateCollisionMaps();
 	ARX_SOUND_CreatePresenceMap();
 	
+	// Decode the interface, spell and collision sounds before they are first played
+	audio::preloadSamples();
+	
 	// Load environments, enable environment system and set default one if required
 	ARX_SOUND_CreateEnvironments();
 	
@@ -445,6 +455,14 @@ void ARX_SOUND_Release() {
 		return;
 	}
 	
+	audio::SampleCacheStats stats;
+	if(!audio::getSampleCacheStats(stats)) {
+		LogInfo << "Sample cache: " << stats.entries << " samples, " << (stats.size / 1024)
+		        << " KiB, " << stats.hits << " hits, " << stats.misses << " misses, "
+		        << (stats.decodeTime / 1000) << " ms decoding, "
+		        << (stats.savedTime / 1000) << " ms saved";
+	}
+	
 	ARX_SOUND_ReleaseStaticSamples();
 	collisionMaps.clear();
 	presence.clear();
@@ -617,6 +635,7 @@ long ARX_SOUND_PlaySpeech(const res::path & name, const Entity * io)
 	channel.mixer = ARX_SOUND_MixerGameSpeech;
 	channel.flags = FLAG_VOLUME | FLAG_POSITION | FLAG_REVERBERATION | FLAG_AUTOFREE | FLAG_FALLOFF;
 	channel.volume = 1.f;
+	channel.priority = ARX_SOUND_SPEECH_PRIORITY;
 	channel.falloff.start = ARX_SOUND_DEFAULT_FALLSTART;
 	channel.falloff.end = ARX_SOUND_DEFAULT_FALLEND;
 
@@ -847,6 +866,7 @@ long ARX_SOUND_PlayCinematic(const res::path & name, bool isSpeech) {
 	channel.flags = FLAG_VOLUME | FLAG_AUTOFREE | FLAG_POSITION | FLAG_FALLOFF
 	                | FLAG_REVERBERATION | FLAG_POSITION;
 	channel.volume = 1.0f;
+	channel.priority = ARX_SOUND_SPEECH_PRIORITY;
 	channel.falloff.start = ARX_SOUND_DEFAULT_FALLSTART;
 	channel.falloff.end = ARX_SOUND_DEFAULT_FALLEND;
 	
@@ -971,6 +991,7 @@ bool ARX_SOUND_PlayScriptAmbiance(const res::path & name, SoundLoopMode loop, fl
 		channel.mixer = ARX_SOUND_MixerGameAmbiance;
 		channel.flags = FLAG_VOLUME | FLAG_AUTOFREE;
 		channel.volume = volume;
+		channel.priority = ARX_SOUND_AMBIANCE_PRIORITY;
 
 		audio::ambiancePlay(ambiance_id, channel, loop == ARX_SOUND_PLAY_LOOPED);
 	}
@@ -1018,6 +1039,7 @@ bool ARX_SOUND_PlayZoneAmbiance(const res::path & name, SoundLoopMode loop, floa
 	channel.mixer = ARX_SOUND_MixerGameAmbiance;
 	channel.flags = FLAG_VOLUME | FLAG_AUTOFREE;
 	channel.volume = volume;
+	channel.priority = ARX_SOUND_AMBIANCE_PRIORITY;
 
 	audio::ambianceStop(ambiance_zone, AMBIANCE_FADE_TIME);
 	ambiance_zone = ambiance_id;
@@ -1074,6 +1096,7 @@ AmbianceId ARX_SOUND_PlayMenuAmbiance(const res::path & ambiance_name) {
 	channel.mixer = ARX_SOUND_MixerMenuAmbiance;
 	channel.flags = FLAG_VOLUME;
 	channel.volume = 1.0F;
+	channel.priority = ARX_SOUND_AMBIANCE_PRIORITY;
 	
 	audio::ambiancePlay(ambiance_menu, channel, true);
 	
@@ -1747,11 +1770,21 @@ class SoundUpdateThread : public StoppableThread {
 	
 	void run() {
 		
+		unsigned long elapsed = 0;
+		
 		while(!isStopRequested()) {
 			
-			sleep(ARX_SOUND_UPDATE_INTERVAL);
+			sleep(ARX_SOUND_COMMAND_INTERVAL);
 			
-			audio::update();
+			// Apply queued volume, position and stop requests more often than
+			// refilling the stream buffers
+			elapsed += ARX_SOUND_COMMAND_INTERVAL;
+			if(elapsed >= ARX_SOUND_UPDATE_INTERVAL) {
+				elapsed = 0;
+				audio::update();
+			} else {
+				audio::processCommands();
+			}
 		}
 		
 	}
@@ -44,6 +44,19 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "scene/Light.h"
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "platform/Architecture.h"
+
+#if defined(ARX_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
 #include "core/Application.h"
 #include "core/GameTime.h"
 #include "core/Core.h"
@@ -52,6 +65,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "game/Inventory.h"
 #include "graphics/Math.h"
 #include "graphics/Draw.h"
+#include "platform/JobSystem.h"
 #include "scene/Object.h"
 #include "scene/GameSound.h"
 #include "scene/Interactive.h"
@@ -69,6 +83,104 @@ long TOTPDL = 0;
 EERIE_LIGHT * IO_PDL[MAX_DYNLIGHTS];
 long TOTIOPDL = 0;
 
+namespace {
+
+/*!
+ * Registry of the allocated GLight entries.
+ *
+ * All lights are listed densely in index order. For proximity queries the lights are also
+ * sorted into a grid of cells in the xz plane, which is hashed into a fixed number of
+ * buckets so that it does not depend on the level size. The grid is rebuilt lazily after
+ * lights have been added, removed or moved.
+ */
+const float LIGHT_GRID_CELL_SIZE = 500.f;
+const size_t LIGHT_GRID_BUCKETS = 64;
+
+std::vector<size_t> g_lights;
+size_t g_firstFreeLight = 0;
+
+std::vector<size_t> g_lightGrid[LIGHT_GRID_BUCKETS][LIGHT_GRID_BUCKETS];
+bool g_lightGridDirty = true;
+
+long LightGridCell(float coord) {
+	return long(std::floor(coord * (1.f / LIGHT_GRID_CELL_SIZE)));
+}
+
+size_t LightGridBucket(long cell) {
+	return size_t(cell) & (LIGHT_GRID_BUCKETS - 1);
+}
+
+void RegisterLight(size_t index) {
+	std::vector<size_t>::iterator it = std::lower_bound(g_lights.begin(), g_lights.end(), index);
+	arx_assert(it == g_lights.end() || *it != index);
+	g_lights.insert(it, index);
+	g_lightGridDirty = true;
+}
+
+void UnregisterLight(size_t index) {
+	std::vector<size_t>::iterator it = std::lower_bound(g_lights.begin(), g_lights.end(), index);
+	arx_assert(it != g_lights.end() && *it == index);
+	g_lights.erase(it);
+	g_firstFreeLight = std::min(g_firstFreeLight, index);
+	g_lightGridDirty = true;
+}
+
+void RebuildLightGrid() {
+	
+	for(size_t z = 0; z < LIGHT_GRID_BUCKETS; z++) {
+		for(size_t x = 0; x < LIGHT_GRID_BUCKETS; x++) {
+			g_lightGrid[x][z].clear();
+		}
+	}
+	
+	BOOST_FOREACH(size_t i, g_lights) {
+		const Vec3f & pos = GLight[i]->pos;
+		size_t x = LightGridBucket(LightGridCell(pos.x));
+		size_t z = LightGridBucket(LightGridCell(pos.z));
+		g_lightGrid[x][z].push_back(i);
+	}
+	
+	g_lightGridDirty = false;
+}
+
+} // anonymous namespace
+
+const std::vector<size_t> & EERIE_LIGHT_GetAll() {
+	return g_lights;
+}
+
+void EERIE_LIGHT_GetNear(const Vec3f & pos, float radius, std::vector<size_t> & result) {
+	
+	result.clear();
+	
+	if(g_lightGridDirty) {
+		RebuildLightGrid();
+	}
+	
+	long x0 = LightGridCell(pos.x - radius);
+	long x1 = LightGridCell(pos.x + radius);
+	long z0 = LightGridCell(pos.z - radius);
+	long z1 = LightGridCell(pos.z + radius);
+	
+	// Each bucket must only be visited once
+	x1 = std::min(x1, x0 + long(LIGHT_GRID_BUCKETS) - 1);
+	z1 = std::min(z1, z0 + long(LIGHT_GRID_BUCKETS) - 1);
+	
+	for(long z = z0; z <= z1; z++) {
+		for(long x = x0; x <= x1; x++) {
+			BOOST_FOREACH(size_t i, g_lightGrid[LightGridBucket(x)][LightGridBucket(z)]) {
+				const Vec3f & lpos = GLight[i]->pos;
+				if(lpos.x >= pos.x - radius && lpos.x <= pos.x + radius
+				   && lpos.z >= pos.z - radius && lpos.z <= pos.z + radius) {
+					result.push_back(i);
+				}
+			}
+		}
+	}
+	
+	std::sort(result.begin(), result.end());
+}
+
 static void ARX_EERIE_LIGHT_Make(EERIEPOLY * ep, float * epr, float * epg, float * epb, EERIE_LIGHT * light);
 
 bool ValidDynLight(long num)
@@ -92,29 +204,47 @@ void PrecalcIOLighting(const Vec3f * pos, float radius, long flags) {
 	
 	TOTIOPDL = 0;
 	
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
+	static std::vector<size_t> lights;
+	EERIE_LIGHT_GetNear(*pos, radius, lights);
+	
+	BOOST_FOREACH(size_t i, lights) {
 		EERIE_LIGHT * el = GLight[i];
 
-		if(el && el->exist && el->status && !(el->extras & EXTRAS_SEMIDYNAMIC)) {
-			if((el->pos.x >= pos->x - radius) && (el->pos.x <= pos->x + radius)
-			        && (el->pos.z >= pos->z - radius) && (el->pos.z <= pos->z + radius))
-			{
-				el->rgb255 = el->rgb * 255.f;
-				el->falldiff = el->fallend - el->fallstart;
-				el->falldiffmul = 1.f / el->falldiff;
-				el->precalc = el->intensity * GLOBAL_LIGHT_FACTOR;
-				IO_PDL[TOTIOPDL] = el;
+		if(el->exist && el->status && !(el->extras & EXTRAS_SEMIDYNAMIC)) {
+			el->rgb255 = el->rgb * 255.f;
+			el->falldiff = el->fallend - el->fallstart;
+			el->falldiffmul = 1.f / el->falldiff;
+			el->precalc = el->intensity * GLOBAL_LIGHT_FACTOR;
+			IO_PDL[TOTIOPDL] = el;
 			
-				TOTIOPDL++;
+			TOTIOPDL++;
 
-				if((size_t)TOTIOPDL >= MAX_DYNLIGHTS)
-					TOTIOPDL--;
-			}
+			if((size_t)TOTIOPDL >= MAX_DYNLIGHTS)
+				TOTIOPDL--;
 		}
 	}
 }
 
-void EERIE_LIGHT_Apply(EERIEPOLY * ep) {
+//! Collect the lights that contribute to the precomputed background lighting
+static void GetStaticLights(std::vector<EERIE_LIGHT *> & lights) {
+	
+	lights.clear();
+	
+	BOOST_FOREACH(size_t i, g_lights) {
+		EERIE_LIGHT * el = GLight[i];
+		if(el->treat && el->exist && el->status && !(el->extras & EXTRAS_SEMIDYNAMIC)) {
+			lights.push_back(el);
+		}
+	}
+	
+	for(size_t i = 0; i < MAX_ACTIONS; i++) {
+		if(actions[i].exist && (actions[i].type == ACT_FIRE2 || actions[i].type == ACT_FIRE)) {
+			lights.push_back(&actions[i].light);
+		}
+	}
+}
+
+static void ApplyStaticLights(EERIEPOLY * ep, EERIE_LIGHT * const * lights, size_t count) {
 	
 	if(ep->type & POLY_IGNORE)
 		return;
@@ -127,21 +257,10 @@ void EERIE_LIGHT_Apply(EERIEPOLY * ep) {
 	epg[3] = epg[2] = epg[1] = epg[0] = 0; 
 	epb[3] = epb[2] = epb[1] = epb[0] = 0; 
 
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		EERIE_LIGHT * el = GLight[i];
-
-		if(el && el->treat && el->exist && el->status && !(el->extras & EXTRAS_SEMIDYNAMIC)) {
-			if(closerThan(el->pos, ep->center, el->fallend + 100.f)) {
-				ARX_EERIE_LIGHT_Make(ep, epr, epg, epb, el);
-			}
-		}
-	}
-
-	for(size_t i = 0; i < MAX_ACTIONS; i++) {
-		if(actions[i].exist && (actions[i].type == ACT_FIRE2 || actions[i].type == ACT_FIRE)) {
-			if(closerThan(actions[i].light.pos, ep->center, actions[i].light.fallend + 100.f)) {
-				ARX_EERIE_LIGHT_Make(ep, epr, epg, epb, &actions[i].light);
-			}
+	for(size_t i = 0; i < count; i++) {
+		EERIE_LIGHT * el = lights[i];
+		if(closerThan(el->pos, ep->center, el->fallend + 100.f)) {
+			ARX_EERIE_LIGHT_Make(ep, epr, epg, epb, el);
 		}
 	}
 
@@ -155,21 +274,30 @@ void EERIE_LIGHT_Apply(EERIEPOLY * ep) {
 	}
 }
 
+void EERIE_LIGHT_Apply(EERIEPOLY * ep) {
+	
+	std::vector<EERIE_LIGHT *> lights;
+	GetStaticLights(lights);
+	
+	ApplyStaticLights(ep, lights.empty() ? NULL : &lights[0], lights.size());
+}
+
 void EERIE_LIGHT_TranslateSelected(const Vec3f * trans) {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] && GLight[i]->selected) {
+	BOOST_FOREACH(size_t i, g_lights) {
+		if(GLight[i]->selected) {
 			if(GLight[i]->tl > 0) {
 				DynLight[GLight[i]->tl].exist = 0;
 			}
 			GLight[i]->tl = -1;
 			GLight[i]->pos += *trans;
+			g_lightGridDirty = true;
 		}
 	}
 }
 
 void EERIE_LIGHT_UnselectAll() {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] && GLight[i]->exist && GLight[i]->treat) {
+	BOOST_FOREACH(size_t i, g_lights) {
+		if(GLight[i]->exist && GLight[i]->treat) {
 			GLight[i]->selected = 0;
 		}
 	}
@@ -182,19 +310,21 @@ void EERIE_LIGHT_ClearByIndex(long num) {
 
 		free(GLight[num]);
 		GLight[num] = NULL;
+		UnregisterLight(num);
 	}
 }
 
 void EERIE_LIGHT_ClearAll() {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		EERIE_LIGHT_ClearByIndex(i);
+	while(!g_lights.empty()) {
+		EERIE_LIGHT_ClearByIndex(g_lights.back());
 	}
 }
 
 void EERIE_LIGHT_ClearSelected() {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] && GLight[i]->selected) {
-			EERIE_LIGHT_ClearByIndex(i);
+	for(size_t i = g_lights.size(); i > 0; i--) {
+		size_t index = g_lights[i - 1];
+		if(GLight[index]->selected) {
+			EERIE_LIGHT_ClearByIndex(index);
 		}
 	}
 }
@@ -205,58 +335,65 @@ void EERIE_LIGHT_GlobalInit() {
 	
 	if(!init) {
 		memset(GLight, 0, sizeof(*GLight) * MAX_LIGHTS);
+		g_lights.clear();
+		g_firstFreeLight = 0;
+		g_lightGridDirty = true;
 		init = 1;
 		return;
 	}
 	
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i]) {
-			if(GLight[i]->tl > 0) {
-				DynLight[GLight[i]->tl].exist = 0;
-			}
-			free(GLight[i]);
-			GLight[i] = NULL;
+	while(!g_lights.empty()) {
+		size_t i = g_lights.back();
+		if(GLight[i]->tl > 0) {
+			DynLight[GLight[i]->tl].exist = 0;
 		}
+		free(GLight[i]);
+		GLight[i] = NULL;
+		UnregisterLight(i);
 	}
 }
 
 long EERIE_LIGHT_GetFree() {
 	
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
+	// All entries before g_firstFreeLight are in use
+	for(size_t i = g_firstFreeLight; i < MAX_LIGHTS; i++) {
 		if(!GLight[i]) {
+			g_firstFreeLight = i;
 			return i;
 		}
 	}
 	
+	g_firstFreeLight = MAX_LIGHTS;
+	
 	return -1;
 }
 
 long EERIE_LIGHT_Create() {
 	
-	for (size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(!GLight[i]) {
-			
-			GLight[i] = (EERIE_LIGHT *)malloc(sizeof(EERIE_LIGHT));
-			if(!GLight[i]) {
-				return -1;
-			}
-			
-			memset(GLight[i], 0, sizeof(EERIE_LIGHT));
-			GLight[i]->sample = audio::INVALID_ID;
-			GLight[i]->tl = -1;
-			return i;
-		}
+	long i = EERIE_LIGHT_GetFree();
+	if(i < 0) {
+		return -1;
 	}
 	
-	return -1;
+	GLight[i] = (EERIE_LIGHT *)malloc(sizeof(EERIE_LIGHT));
+	if(!GLight[i]) {
+		return -1;
+	}
+	
+	memset(GLight[i], 0, sizeof(EERIE_LIGHT));
+	GLight[i]->sample = audio::INVALID_ID;
+	GLight[i]->tl = -1;
+	RegisterLight(i);
+	
+	return i;
 }
 
 
 long EERIE_LIGHT_Count() {
 	
 	long count = 0;
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] && !(GLight[i]->type & TYP_SPECIAL1)) {
+	BOOST_FOREACH(size_t i, g_lights) {
+		if(!(GLight[i]->type & TYP_SPECIAL1)) {
 			count++;
 		}
 	}
@@ -274,15 +411,15 @@ void EERIE_LIGHT_GlobalAdd(const EERIE_LIGHT * el)
 		memcpy(GLight[num], el, sizeof(EERIE_LIGHT));
 		GLight[num]->tl = -1;
 		GLight[num]->sample = audio::INVALID_ID;
+		RegisterLight(num);
 	}
 }
 
 void EERIE_LIGHT_MoveAll(const Vec3f * trans) {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i]) {
-			GLight[i]->pos += *trans;
-		}
+	BOOST_FOREACH(size_t i, g_lights) {
+		GLight[i]->pos += *trans;
 	}
+	g_lightGridDirty = true;
 }
 
 //*************************************************************************************
@@ -442,12 +579,57 @@ void ComputeLight2DPos(EERIE_LIGHT * _pL) {
 
 //*************************************************************************************
 //*************************************************************************************
+namespace {
+
+//! Marker entities that are notified when lights are toggled, collected on first use
+class MarkerList {
+	
+	std::vector<std::pair<size_t, Vec3f> > m_markers;
+	bool m_collected;
+	
+	void collect() {
+		for(size_t l = 0; l < entities.size(); l++) {
+			if(entities[l] && (entities[l]->ioflags & IO_MARKER)) {
+				Vec3f pos;
+				GetItemWorldPosition(entities[l], &pos);
+				m_markers.push_back(std::make_pair(l, pos));
+			}
+		}
+		m_collected = true;
+	}
+	
+public:
+	
+	MarkerList() : m_collected(false) { }
+	
+	//! Send a custom script event to all markers within a distance of a position
+	void sendEvent(const Vec3f & pos, float radius, const char * event) {
+		
+		if(!m_collected) {
+			collect();
+		}
+		
+		for(size_t i = 0; i < m_markers.size(); i++) {
+			// The entity may have been destroyed by an earlier event
+			Entity * marker = entities[m_markers[i].first];
+			if(marker && !fartherThan(pos, m_markers[i].second, radius)) {
+				SendIOScriptEvent(marker, SM_CUSTOM, event);
+			}
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
 void TreatBackgroundDynlights()
 {
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
+	MarkerList markers;
+	
+	BOOST_FOREACH(size_t i, g_lights) {
 		EERIE_LIGHT *light = GLight[i];
 
-		if(light && (light->extras & EXTRAS_SEMIDYNAMIC)) {
+		if(light->extras & EXTRAS_SEMIDYNAMIC) {
 
 			float fMaxdist = 300;
 			if(Project.telekinesis)
@@ -462,31 +644,12 @@ void TreatBackgroundDynlights()
 				if(light->tl > 0) {
 					DynLight[light->tl].exist = 0;
 					light->tl = -1;
-					Vec3f _pos2;
-
-					for(size_t l = 0; l < entities.size(); l++) {
-						if(entities[l] && (entities[l]->ioflags & IO_MARKER)) {
-							GetItemWorldPosition(entities[l], &_pos2);
-							if(!fartherThan(light->pos, _pos2, 300.f)) {
-								SendIOScriptEvent(entities[l], SM_CUSTOM, "douse");
-							}
-						}
-					}
+					markers.sendEvent(light->pos, 300.f, "douse");
 				}
 			} else {
 				// just light up
 				if(light->tl <= 0) {
-					Vec3f _pos2;
-
-					for(size_t l = 0; l < entities.size(); l++) {
-						if(entities[l] && (entities[l]->ioflags & IO_MARKER)) {
-							GetItemWorldPosition(entities[l], &_pos2);
-							if(!fartherThan(light->pos, _pos2, 300.f)) {
-								SendIOScriptEvent(entities[l], SM_CUSTOM, "fire");
-							}
-						}
-					}
-
+					markers.sendEvent(light->pos, 300.f, "fire");
 					light->tl = GetFreeDynLight();
 				}
 				
@@ -606,6 +769,69 @@ void EERIE_LIGHT_ChangeLighting()
 //*************************************************************************************
 //*************************************************************************************
 
+namespace {
+
+//! Applies the static lights to one row of background tiles per item
+class PrecalcLightsTask : public jobs::ParallelTask {
+	
+	const std::vector<EERIE_LIGHT *> & m_lights;
+	long m_minx;
+	long m_maxx;
+	long m_minz;
+	
+public:
+	
+	PrecalcLightsTask(const std::vector<EERIE_LIGHT *> & lights, long minx, long maxx,
+	                  long minz)
+		: m_lights(lights), m_minx(minx), m_maxx(maxx), m_minz(minz) { }
+	
+	void run(size_t begin, size_t end) {
+		
+		std::vector<EERIE_LIGHT *> tileLights;
+		tileLights.reserve(m_lights.size());
+		
+		for(long j = m_minz + long(begin); j < m_minz + long(end); j++) {
+			for(long i = m_minx; i <= m_maxx; i++) {
+				EERIE_BKG_INFO * eg = &ACTIVEBKG->Backg[i + j * ACTIVEBKG->Xsize];
+				
+				if(eg->nbpoly == 0) {
+					continue;
+				}
+				
+				// Only consider lights that can reach the center of any polygon in this tile
+				Vec3f mins = eg->polydata[0].center;
+				Vec3f maxs = mins;
+				for(long k = 1; k < eg->nbpoly; k++) {
+					const Vec3f & center = eg->polydata[k].center;
+					mins = Vec3f(std::min(mins.x, center.x), std::min(mins.y, center.y),
+					             std::min(mins.z, center.z));
+					maxs = Vec3f(std::max(maxs.x, center.x), std::max(maxs.y, center.y),
+					             std::max(maxs.z, center.z));
+				}
+				
+				tileLights.clear();
+				BOOST_FOREACH(EERIE_LIGHT * el, m_lights) {
+					Vec3f closest(clamp(el->pos.x, mins.x, maxs.x), clamp(el->pos.y, mins.y, maxs.y),
+					              clamp(el->pos.z, mins.z, maxs.z));
+					if(closerThan(el->pos, closest, el->fallend + 100.f)) {
+						tileLights.push_back(el);
+					}
+				}
+				
+				for(long k = 0; k < eg->nbpoly; k++) {
+					EERIEPOLY * ep = &eg->polydata[k];
+					ep->type &= ~POLY_IGNORE;
+					ApplyStaticLights(ep, tileLights.empty() ? NULL : &tileLights[0],
+					                  tileLights.size());
+				}
+			}
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
 void EERIEPrecalcLights(long minx, long minz, long maxx, long maxz)
 { 
 	minx = clamp(minx, 0, ACTIVEBKG->Xsize - 1);
@@ -613,35 +839,29 @@ void EERIEPrecalcLights(long minx, long minz, long maxx, long maxz)
 	minz = clamp(minz, 0, ACTIVEBKG->Zsize - 1);
 	maxz = clamp(maxz, 0, ACTIVEBKG->Zsize - 1);
 
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i]) {
-			if((GLight[i]->extras & EXTRAS_SEMIDYNAMIC)) {
-				GLight[i]->treat = 0;
-			} else if (!GLight[i]->treat) {
-				GLight[i]->treat = 1;
-			}
-
-			GLight[i]->falldiff = GLight[i]->fallend - GLight[i]->fallstart;
-			GLight[i]->falldiffmul = 1.f / GLight[i]->falldiff;
-			GLight[i]->rgb255 = GLight[i]->rgb * 255.f;
-			GLight[i]->precalc = GLight[i]->intensity * GLOBAL_LIGHT_FACTOR;
+	BOOST_FOREACH(size_t i, g_lights) {
+		if((GLight[i]->extras & EXTRAS_SEMIDYNAMIC)) {
+			GLight[i]->treat = 0;
+		} else if (!GLight[i]->treat) {
+			GLight[i]->treat = 1;
 		}
+
+		GLight[i]->falldiff = GLight[i]->fallend - GLight[i]->fallstart;
+		GLight[i]->falldiffmul = 1.f / GLight[i]->falldiff;
+		GLight[i]->rgb255 = GLight[i]->rgb * 255.f;
+		GLight[i]->precalc = GLight[i]->intensity * GLOBAL_LIGHT_FACTOR;
 	}
 	
-	for(long j = minz; j <= maxz; j++) {
-		for(long i = minx; i <= maxx; i++) {
-			EERIE_BKG_INFO *eg = &ACTIVEBKG->Backg[i+j*ACTIVEBKG->Xsize];
+	std::vector<EERIE_LIGHT *> lights;
+	GetStaticLights(lights);
 
-			for(long k = 0; k < eg->nbpoly; k++) {
-				EERIEPOLY * ep = &eg->polydata[k];
+	PrecalcLightsTask task(lights, minx, maxx, minz);
+	size_t rows = size_t(maxz - minz + 1);
 					
-				if(ep) {
-					ep->type &= ~POLY_IGNORE;
-					EERIE_LIGHT_Apply(ep);
-				}
-			}
-		}
-	}
+	// Shadow rays test the flags of polygons in neighbouring tiles, which are being updated
+	size_t grain = (ModeLight & MODE_RAYLAUNCH) ? rows : 1;
+	
+	jobs::parallelFor(task, rows, grain);
 }
 
 void RecalcLightZone(float x, float z, long siz) {
@@ -662,9 +882,8 @@ void RecalcLightZone(float x, float z, long siz) {
 
 void EERIERemovePrecalcLights() {
 
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] != NULL)
-			GLight[i]->treat = 1;
+	BOOST_FOREACH(size_t i, g_lights) {
+		GLight[i]->treat = 1;
 	}
 	
 	for(int j = 0; j < ACTIVEBKG->Zsize; j++) {
@@ -688,8 +907,8 @@ void ClearDynLights() {
 		}
 	}
 
-	for(size_t i = 0; i < MAX_LIGHTS; i++) {
-		if(GLight[i] && GLight[i]->tl > 0) {
+	BOOST_FOREACH(size_t i, g_lights) {
+		if(GLight[i]->tl > 0) {
 			GLight[i]->tl = 0;
 		}
 	}
@@ -716,6 +935,183 @@ long GetFreeDynLight() {
 }
 
 
+namespace {
+
+#if defined(ARX_HAVE_SSE2)
+
+//! Lane masks for all combinations of four bits
+const u32 laneMasks[16][4] = {
+	{ 0, 0, 0, 0 }, { ~0u, 0, 0, 0 }, { 0, ~0u, 0, 0 }, { ~0u, ~0u, 0, 0 },
+	{ 0, 0, ~0u, 0 }, { ~0u, 0, ~0u, 0 }, { 0, ~0u, ~0u, 0 }, { ~0u, ~0u, ~0u, 0 },
+	{ 0, 0, 0, ~0u }, { ~0u, 0, 0, ~0u }, { 0, ~0u, 0, ~0u }, { ~0u, ~0u, 0, ~0u },
+	{ 0, 0, ~0u, ~0u }, { ~0u, 0, ~0u, ~0u }, { 0, ~0u, ~0u, ~0u }, { ~0u, ~0u, ~0u, ~0u },
+};
+
+//! Bits for the lanes before the first set bit, or all lanes if no bit is set
+const int lanesBeforeFirst[16] = {
+	15, 0, 1, 0, 3, 0, 1, 0, 7, 0, 1, 0, 3, 0, 1, 0
+};
+
+inline __m128 laneMask(int bits) {
+	return _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(laneMasks[bits])));
+}
+
+//! Four-wide version of ffsqrt()
+inline __m128 ffsqrt(__m128 f) {
+	const __m128i one = _mm_set1_epi32(0x3f800000);
+	__m128i bits = _mm_sub_epi32(_mm_castps_si128(f), one);
+	return _mm_castsi128_ps(_mm_add_epi32(_mm_srli_epi32(bits, 1), one));
+}
+
+#endif // defined(ARX_HAVE_SSE2)
+
+} // anonymous namespace
+
+void AccumulateDynLights(const EERIEPOLY & ep, EERIE_LIGHT * const * lights, size_t count,
+                         float * r, float * g, float * b, DynLightMode mode) {
+	
+	int nbvert = (ep.type & POLY_QUAD) ? 4 : 3;
+	bool polygon = (mode == DynLightPolygon);
+	
+#if defined(ARX_HAVE_SSE2)
+	
+	// Process all vertices of the polygon at once, the fourth lane is unused for triangles
+	const TexturedVertex * v = ep.v;
+	const Vec3f * n = ep.nrml;
+	int last = nbvert - 1;
+	__m128 px = _mm_setr_ps(v[0].p.x, v[1].p.x, v[2].p.x, v[last].p.x);
+	__m128 py = _mm_setr_ps(v[0].p.y, v[1].p.y, v[2].p.y, v[last].p.y);
+	__m128 pz = _mm_setr_ps(v[0].p.z, v[1].p.z, v[2].p.z, v[last].p.z);
+	__m128 nx = _mm_setr_ps(n[0].x, n[1].x, n[2].x, n[last].x);
+	__m128 ny = _mm_setr_ps(n[0].y, n[1].y, n[2].y, n[last].y);
+	__m128 nz = _mm_setr_ps(n[0].z, n[1].z, n[2].z, n[last].z);
+	
+	__m128 accr = _mm_loadu_ps(r);
+	__m128 accg = _mm_loadu_ps(g);
+	__m128 accb = _mm_loadu_ps(b);
+	
+	const int vertexBits = (1 << nbvert) - 1;
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	
+	for(size_t i = 0; i < count; i++) {
+		const EERIE_LIGHT & el = *lights[i];
+		
+		__m128 dx = _mm_sub_ps(_mm_set1_ps(el.pos.x), px);
+		__m128 dy = _mm_sub_ps(_mm_set1_ps(el.pos.y), py);
+		__m128 dz = _mm_sub_ps(_mm_set1_ps(el.pos.z), pz);
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+		                      _mm_mul_ps(dz, dz));
+		d = ffsqrt(d);
+		
+		// Vertices after the first one that is far outside the light are not lit
+		int far = _mm_movemask_ps(_mm_cmpgt_ps(d, _mm_set1_ps(el.fallend + 100.f)));
+		int bits = vertexBits & lanesBeforeFirst[far];
+		__m128 fallend = _mm_set1_ps(el.fallend);
+		__m128 inside = polygon ? _mm_cmple_ps(d, fallend) : _mm_cmplt_ps(d, fallend);
+		__m128 active = _mm_and_ps(laneMask(bits), inside);
+		if(_mm_movemask_ps(active) == 0) {
+			continue;
+		}
+		
+		// Keep the operation order of the scalar code so that the results are identical
+		__m128 nvalue;
+		if(polygon) {
+			__m128 divd = _mm_div_ps(one, d);
+			__m128 dn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(dx, divd), nx),
+			                                  _mm_mul_ps(_mm_mul_ps(dy, divd), ny)),
+			                       _mm_mul_ps(_mm_mul_ps(dz, divd), nz));
+			nvalue = _mm_mul_ps(dn, half);
+		} else {
+			__m128 dn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, nx), _mm_mul_ps(dy, ny)),
+			                       _mm_mul_ps(dz, nz));
+			nvalue = _mm_div_ps(_mm_mul_ps(dn, half), d);
+		}
+		active = _mm_and_ps(active, _mm_cmpgt_ps(nvalue, zero));
+		if(polygon) {
+			nvalue = _mm_min_ps(nvalue, one);
+		}
+		
+		__m128 fallstart = _mm_set1_ps(el.fallstart);
+		__m128 precalc = _mm_set1_ps(el.precalc);
+		__m128 falloff = _mm_sub_ps(_mm_set1_ps(el.falldiff), _mm_sub_ps(d, fallstart));
+		falloff = _mm_mul_ps(falloff, _mm_set1_ps(el.falldiffmul));
+		if(polygon) {
+			falloff = _mm_mul_ps(_mm_mul_ps(falloff, nvalue), precalc);
+		} else {
+			falloff = _mm_mul_ps(_mm_mul_ps(falloff, precalc), nvalue);
+		}
+		__m128 inner = _mm_cmple_ps(d, fallstart);
+		__m128 att = _mm_mul_ps(nvalue, precalc);
+		att = _mm_or_ps(_mm_and_ps(inner, att), _mm_andnot_ps(inner, falloff));
+		att = _mm_and_ps(active, att);
+		
+		Color3f rgb = el.rgb255;
+		if(polygon && Project.improve) {
+			rgb.r = el.rgb255.r * 4.f;
+			rgb.g = rgb.b = 0.2f;
+		}
+		
+		accr = _mm_add_ps(accr, _mm_mul_ps(_mm_set1_ps(rgb.r), att));
+		accg = _mm_add_ps(accg, _mm_mul_ps(_mm_set1_ps(rgb.g), att));
+		accb = _mm_add_ps(accb, _mm_mul_ps(_mm_set1_ps(rgb.b), att));
+	}
+	
+	_mm_storeu_ps(r, accr);
+	_mm_storeu_ps(g, accg);
+	_mm_storeu_ps(b, accb);
+	
+#else // !defined(ARX_HAVE_SSE2)
+	
+	for(size_t i = 0; i < count; i++) {
+		const EERIE_LIGHT & el = *lights[i];
+		
+		Color3f rgb = el.rgb255;
+		if(polygon && Project.improve) {
+			rgb.r = el.rgb255.r * 4.f;
+			rgb.g = rgb.b = 0.2f;
+		}
+		
+		for(int j = 0; j < nbvert; j++) {
+			
+			float d = fdist(el.pos, ep.v[j].p);
+			
+			if(polygon ? (d <= el.fallend) : (d < el.fallend)) {
+				
+				float nvalue;
+				if(polygon) {
+					Vec3f v1 = (el.pos - ep.v[j].p) * (1.f / d);
+					nvalue = clamp(dot(v1, ep.nrml[j]) * 0.5f, 0.f, 1.f);
+				} else {
+					nvalue = dot(el.pos - ep.v[j].p, ep.nrml[j]) * 0.5f / d;
+				}
+				
+				if(nvalue > 0.f) {
+					if(d <= el.fallstart) {
+						d = nvalue * el.precalc;
+					} else if(polygon) {
+						d -= el.fallstart;
+						d = (el.falldiff - d) * el.falldiffmul * nvalue * el.precalc;
+					} else {
+						d -= el.fallstart;
+						d = (el.falldiff - d) * el.falldiffmul * el.precalc * nvalue;
+					}
+					r[j] += rgb.r * d;
+					g[j] += rgb.g * d;
+					b[j] += rgb.b * d;
+				}
+				
+			} else if(d > el.fallend + 100.f) {
+				break;
+			}
+		}
+	}
+	
+#endif // !defined(ARX_HAVE_SSE2)
+	
+}
+
 void ApplyDynLight(EERIEPOLY * ep)
 {
 	int nbvert = (ep->type & POLY_QUAD) ? 4 : 3;
@@ -727,11 +1123,9 @@ void ApplyDynLight(EERIEPOLY * ep)
 		return;
 	}
 
-	Color3f rgb;
-
-	float epr[4];
-	float epg[4];
-	float epb[4];
+	float epr[4] = { 0.f, 0.f, 0.f, 0.f };
+	float epg[4] = { 0.f, 0.f, 0.f, 0.f };
+	float epb[4] = { 0.f, 0.f, 0.f, 0.f };
 
 	for(int i = 0; i < nbvert; i++) {
 		long c = ep->v[i].color;
@@ -740,6 +1134,9 @@ void ApplyDynLight(EERIEPOLY * ep)
 		epb[i] = (float)(c & 255);
 	}
 
+	// Only consider lights that reach the polygon
+	EERIE_LIGHT * lights[MAX_DYNLIGHTS];
+	size_t count = 0;
 	for(int i = 0; i < TOTPDL; i++) {
 		EERIE_LIGHT * el = PDL[i];
 
@@ -749,49 +1146,16 @@ void ApplyDynLight(EERIEPOLY * ep)
 		}
 
 		if(distSqr(el->pos, ep->center) <= square(el->fallend + 35.f)) {
-			if(Project.improve) {
-				rgb.r = el->rgb255.r * 4.f;
-				rgb.g = rgb.b = 0.2f;
-			} else {
-				rgb = el->rgb255;
-			}
-
-			for(int j = 0; j < nbvert; j++) {
-				Vec3f v(ep->v[j].p.x, ep->v[j].p.y, ep->v[j].p.z);
-				if(el->fallend < 0) {
-					TSU_TEST_NB ++;
-					continue;
-				}
-
-				float d = fdist(el->pos, ep->v[j].p);
-
-				if(d <= el->fallend) {
-					float divd = 1.f / d;
-
-					Vec3f v1 = (el->pos - ep->v[j].p) * divd;
-					float nvalue = dot(v1, ep->nrml[j]) * (1.0f / 2);
-
-					nvalue = clamp(nvalue, 0.f, 1.f);
-
-					if(nvalue > 0.f) {
-						if(d <= el->fallstart) {
-							d = nvalue * el->precalc;
-						} else {
-							d -= el->fallstart;
-							d = (el->falldiff - d) * el->falldiffmul * nvalue * el->precalc;
-						}
-
-						epr[j] += rgb.r * d;
-						epg[j] += rgb.g * d;
-						epb[j] += rgb.b * d;
-					}
-				}
-				else if(d > el->fallend + 100.f)
-					break;
+			if(el->fallend < 0) {
+				TSU_TEST_NB += nbvert;
+				continue;
 			}
+			lights[count++] = el;
 		}
 	}
 
+	AccumulateDynLights(*ep, lights, count, epr, epg, epb, DynLightPolygon);
+
 	for(int j = 0; j < nbvert; j++) {
 		u8 lepr = clipByte255(epr[j]);
 		u8 lepg = clipByte255(epg[j]);
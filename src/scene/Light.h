@@ -49,6 +49,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #define ARX_SCENE_LIGHT_H
 
 #include <stddef.h>
+#include <vector>
 
 #include "math/MathFwd.h"
 
@@ -80,6 +81,19 @@ void EERIE_LIGHT_GlobalAdd(const EERIE_LIGHT * el);
 void EERIE_LIGHT_MoveAll(const Vec3f * trans);
 long EERIE_LIGHT_Create();
 
+/*!
+ * @return the indices of all allocated GLight entries in ascending order.
+ * The list is changed when lights are created or removed.
+ */
+const std::vector<size_t> & EERIE_LIGHT_GetAll();
+
+/*!
+ * Find the lights whose position is inside a square in the xz plane.
+ * Lights must only be moved with EERIE_LIGHT_MoveAll() or EERIE_LIGHT_TranslateSelected().
+ * @param result receives the GLight indices of the lights in ascending order
+ */
+void EERIE_LIGHT_GetNear(const Vec3f & pos, float radius, std::vector<size_t> & result);
+
 void RecalcLightZone(float x, float z, long siz);
  
 bool ValidDynLight(long num);
@@ -88,6 +102,23 @@ void EERIEPrecalcLights(long minx=0,long minz=0,long maxx=99999,long maxz=99999)
 void EERIERemovePrecalcLights();
 void PrecalcDynamicLighting(long x0,long x1,long z0,long z1);
 void ApplyDynLight(EERIEPOLY *ep);
+
+//! Lighting rules of the two background polygon render paths
+enum DynLightMode {
+	//! ApplyDynLight(): lit up to fallend, clamped intensity, Project.improve colors
+	DynLightPolygon,
+	//! ApplyDynLight_VertexBuffer_2(): lit inside fallend, unclamped intensity
+	DynLightVertexBuffer
+};
+
+/*!
+ * Add the light from a list of dynamic lights to the vertex colors of a background polygon.
+ * The colors are in the range [0, 255] and are not clamped. r, g and b must each have room
+ * for four vertices, even for triangles.
+ * \param mode selects the rules of the render path, the results match its old code
+ */
+void AccumulateDynLights(const EERIEPOLY & ep, EERIE_LIGHT * const * lights, size_t count,
+                         float * r, float * g, float * b, DynLightMode mode);
 long GetFreeDynLight();
 
 #endif // ARX_SCENE_LIGHT_H
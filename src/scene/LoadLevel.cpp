@@ -85,11 +85,14 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "physics/CollisionShapes.h"
 
+#include "platform/profiler/LoadStatistics.h"
+
 #include "scene/Object.h"
 #include "scene/GameSound.h"
 #include "scene/Interactive.h"
 #include "scene/LevelFormat.h"
 #include "scene/Light.h"
+#include "scene/Scene.h"
 
 #include "util/String.h"
 
@@ -620,10 +623,14 @@ extern long FASTmse;
 
 long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 	
+	ARX_LOAD_PHASE(LoadLevel);
+	
 	LogInfo << "Loading Level " << file;
 	
 	CURRENTLEVEL = GetLevelNumByName(file.string());
 	
+	ARX_SCENE_InvalidateRoomVisibility();
+	
 	res::path lightingFileName = res::path(file).set_ext("llf");
 
 	LogDebug("fic2 " << lightingFileName);
@@ -699,9 +706,10 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 #else
 			LogError << "Fast loading scene failed";
 #endif
+			// FastSceneLoad() already does this for a successfully loaded scene
+			EERIEPOLY_Compute_PolyIn();
 		}
 		
-		EERIEPOLY_Compute_PolyIn();
 		LastLoadedScene = scene;
 	}
 	
@@ -1134,6 +1142,7 @@ void DanaeClearLevel(long flag)
 	FlyingOverIO = NULL;
 
 	EERIE_PATHFINDER_Release();
+	ARX_SCENE_InvalidateRoomVisibility();
 
 	InitBkg(ACTIVEBKG, MAX_BKGX, MAX_BKGZ, BKG_SIZX, BKG_SIZZ);
 	RemoveAllBackgroundActions();
@@ -78,6 +78,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "io/log/Logger.h"
 
+#include "platform/profiler/Profiler.h"
+
+#include "scene/Culling.h"
 #include "scene/Light.h"
 #include "scene/Interactive.h"
 
@@ -183,6 +186,19 @@ void PopAllTriangleListTransparency();
 std::vector<PORTAL_ROOM_DRAW> RoomDraw;
 std::vector<long> RoomDrawList;
 
+static SceneCullingStats cullingStats;
+
+//! Camera state for which RoomDraw and RoomDrawList were last computed
+static struct RoomVisibilityCache {
+	bool valid;
+	long room;
+	Vec3f pos;
+	EERIE_FRUSTRUM frustrum;
+	EERIE_FRUSTRUM_PLANE nearPlane;
+	float zfar;
+	const EERIE_PORTAL_DATA * portals;
+} roomVisibility;
+
 //*************************************************************************************
 //*************************************************************************************
 void ApplyWaterFXToVertex(Vec3f * odtv,TexturedVertex * dtv,float power)
@@ -255,7 +271,6 @@ void EERIERTPPoly2(EERIEPOLY *ep)
 		ep->tv[3].p.z=1.f;
 }
 
-bool IsSphereInFrustrum(float radius, const Vec3f *point, const EERIE_FRUSTRUM *frustrum);
 bool FrustrumsClipSphere(EERIE_FRUSTRUM_DATA * frustrums,EERIE_SPHERE * sphere)
 {
 	float dists=sphere->origin.x*efpPlaneNear.a + sphere->origin.y*efpPlaneNear.b + sphere->origin.z*efpPlaneNear.c + efpPlaneNear.d;
@@ -294,53 +309,6 @@ bool VisibleSphere(float x, float y, float z, float radius) {
 
 	return true;
 }
-bool IsInFrustrum(Vec3f * point,EERIE_FRUSTRUM * frustrum);
-
-bool IsBBoxInFrustrum(EERIE_3D_BBOX * bbox, EERIE_FRUSTRUM * frustrum) {
-	
-	Vec3f point = bbox->min;
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->max.x, bbox->min.y, bbox->min.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->max.x, bbox->max.y, bbox->min.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->min.x, bbox->max.y, bbox->min.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->min.x, bbox->min.y, bbox->max.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->max.x, bbox->min.y, bbox->max.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = bbox->max;
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	point = Vec3f(bbox->min.x, bbox->max.y, bbox->max.z);
-	if(IsInFrustrum(&point, frustrum)) {
-		return true;
-	}
-	
-	return	false;
-}
-
 bool FrustrumsClipBBox3D(EERIE_FRUSTRUM_DATA * frustrums,EERIE_3D_BBOX * bbox)
 {
 	for (long i=0;i<frustrums->nb_frustrums;i++)
@@ -684,6 +652,9 @@ void ARX_PORTALS_InitDrawnRooms()
 	}
 
 	RoomDrawList.clear();
+}
+
+static void ARX_PORTALS_ResetRoomBuffers() {
 
 	vPolyWater.clear();
 	vPolyLava.clear();
@@ -694,51 +665,12 @@ void ARX_PORTALS_InitDrawnRooms()
 	}
 }
 
-bool IsInFrustrum(Vec3f * point, EERIE_FRUSTRUM *frustrum)
-{
-	if (	((point->x*frustrum->plane[0].a + point->y*frustrum->plane[0].b + point->z*frustrum->plane[0].c + frustrum->plane[0].d)>0)
-		&&	((point->x*frustrum->plane[1].a + point->y*frustrum->plane[1].b + point->z*frustrum->plane[1].c + frustrum->plane[1].d)>0)
-		&&	((point->x*frustrum->plane[2].a + point->y*frustrum->plane[2].b + point->z*frustrum->plane[2].c + frustrum->plane[2].d)>0)
-		&&	((point->x*frustrum->plane[3].a + point->y*frustrum->plane[3].b + point->z*frustrum->plane[3].c + frustrum->plane[3].d)>0) )
-		return true;
-
-	return false;
-}
-
-
-bool IsSphereInFrustrum(float radius, const Vec3f *point, const EERIE_FRUSTRUM *frustrum)
-{
-	float dists[4];
-	dists[0]=point->x*frustrum->plane[0].a + point->y*frustrum->plane[0].b + point->z*frustrum->plane[0].c + frustrum->plane[0].d;
-	dists[1]=point->x*frustrum->plane[1].a + point->y*frustrum->plane[1].b + point->z*frustrum->plane[1].c + frustrum->plane[1].d;
-	dists[2]=point->x*frustrum->plane[2].a + point->y*frustrum->plane[2].b + point->z*frustrum->plane[2].c + frustrum->plane[2].d;
-	dists[3]=point->x*frustrum->plane[3].a + point->y*frustrum->plane[3].b + point->z*frustrum->plane[3].c + frustrum->plane[3].d;
-
-	if (	(dists[0]+radius>0)
-		&&	(dists[1]+radius>0)
-		&&	(dists[2]+radius>0)
-		&&	(dists[3]+radius>0) )
-		return true;
-
-	return false;
-	
-}
-
-bool FrustrumsClipPoly(EERIE_FRUSTRUM_DATA *frustrums, EERIEPOLY *ep){
-	for(long i=0; i<frustrums->nb_frustrums; i++) {
-		if(IsSphereInFrustrum(ep->v[0].rhw, &ep->center, &frustrums->frustrums[i]))
-			return false;
-	}
-
-	return true;
-}
-
 void Frustrum_Set(EERIE_FRUSTRUM * fr,long plane,float a,float b,float c,float d)
 {
-	fr->plane[plane].a=a;
-	fr->plane[plane].b=b;
-	fr->plane[plane].c=c;
-	fr->plane[plane].d=d;
+	fr->a[plane]=a;
+	fr->b[plane]=b;
+	fr->c[plane]=c;
+	fr->d[plane]=d;
 }
 
 void CreatePlane(EERIE_FRUSTRUM * frustrum,long numplane,Vec3f * orgn,Vec3f * pt1,Vec3f * pt2)
@@ -752,22 +684,17 @@ void CreatePlane(EERIE_FRUSTRUM * frustrum,long numplane,Vec3f * orgn,Vec3f * pt
 	By=pt2->y-orgn->y;
 	Bz=pt2->z-orgn->z;
 
-	frustrum->plane[numplane].a=Ay*Bz-Az*By;
-	frustrum->plane[numplane].b=Az*Bx-Ax*Bz;
-	frustrum->plane[numplane].c=Ax*By-Ay*Bx;
+	float a=Ay*Bz-Az*By;
+	float b=Az*Bx-Ax*Bz;
+	float c=Ax*By-Ay*Bx;
 
-	epnlen = (float)sqrt(	frustrum->plane[numplane].a * frustrum->plane[numplane].a
-						+	frustrum->plane[numplane].b * frustrum->plane[numplane].b
-						+	frustrum->plane[numplane].c * frustrum->plane[numplane].c	);
+	epnlen = (float)sqrt(a * a + b * b + c * c);
 	epnlen=1.f/epnlen;
-	frustrum->plane[numplane].a*=epnlen;
-	frustrum->plane[numplane].b*=epnlen;
-	frustrum->plane[numplane].c*=epnlen;
-	frustrum->plane[numplane].d=-(	orgn->x * frustrum->plane[numplane].a +
-									orgn->y * frustrum->plane[numplane].b +
-									orgn->z * frustrum->plane[numplane].c		);
+	a*=epnlen;
+	b*=epnlen;
+	c*=epnlen;
 
-	
+	Frustrum_Set(frustrum, numplane, a, b, c, -(orgn->x * a + orgn->y * b + orgn->z * c));
 }
 
 void CreateFrustrum(EERIE_FRUSTRUM *frustrum, EERIEPOLY *ep, bool cull) {
@@ -850,6 +777,12 @@ void CreateScreenFrustrum(EERIE_FRUSTRUM * frustrum) {
 void RoomDrawRelease() {
 	RoomDrawList.resize(0);
 	RoomDraw.resize(0);
+	ARX_SCENE_InvalidateRoomVisibility();
+}
+
+void ARX_SCENE_InvalidateRoomVisibility() {
+	roomVisibility.valid = false;
+	roomVisibility.portals = NULL;
 }
 
 void RoomFrustrumAdd(long num, const EERIE_FRUSTRUM * fr)
@@ -1220,24 +1153,48 @@ void InitTileLights()
 	}
 }
 
-void ComputeTileLights(short x,short z)
-{
-	tilelights[x][z].num=0;
-	float xx=((float)x+0.5f)*ACTIVEBKG->Xdiv;
-	float zz=((float)z+0.5f)*ACTIVEBKG->Zdiv;
+static void AddTileLight(TILE_LIGHTS & tile, EERIE_LIGHT * el) {
 
-	for (long i=0;i<TOTPDL;i++)
-	{
-		if(closerThan(Vec2f(xx, zz), Vec2f(PDL[i]->pos.x, PDL[i]->pos.z), PDL[i]->fallend + 60.f)) {
+	if(tile.num >= tile.max) {
+		tile.max = std::max<short>(4, tile.max * 2);
+		tile.el = (EERIE_LIGHT **)realloc(tile.el, sizeof(EERIE_LIGHT *) * tile.max);
+	}
 			
-			if (tilelights[x][z].num>=tilelights[x][z].max)
-			{
-				tilelights[x][z].max++;
-				tilelights[x][z].el=(EERIE_LIGHT **)realloc(tilelights[x][z].el,sizeof(EERIE_LIGHT *)*(tilelights[x][z].max));
-			}
+	tile.el[tile.num++] = el;
+}
 
-			tilelights[x][z].el[tilelights[x][z].num]=PDL[i];
-			tilelights[x][z].num++;
+/*!
+ * Bin the dynamic lights into the background tiles they can reach.
+ * Each light only visits the tiles covered by its falloff radius, so the cost does not
+ * depend on the number of visible tiles.
+ */
+static void ComputeTileLights() {
+	
+	for(long j = 0; j < ACTIVEBKG->Zsize; j++) {
+		for(long i = 0; i < ACTIVEBKG->Xsize; i++) {
+			tilelights[i][j].num = 0;
+		}
+	}
+	
+	for(long l = 0; l < TOTPDL; l++) {
+		EERIE_LIGHT * el = PDL[l];
+		
+		float radius = el->fallend + 60.f;
+		float extent = EEfabs(radius);
+		
+		long x0 = std::max(long((el->pos.x - extent) * ACTIVEBKG->Xmul), 0L);
+		long x1 = std::min(long((el->pos.x + extent) * ACTIVEBKG->Xmul), ACTIVEBKG->Xsize - 1L);
+		long z0 = std::max(long((el->pos.z - extent) * ACTIVEBKG->Zmul), 0L);
+		long z1 = std::min(long((el->pos.z + extent) * ACTIVEBKG->Zmul), ACTIVEBKG->Zsize - 1L);
+		
+		for(long z = z0; z <= z1; z++) {
+			float zz = ((float)z + 0.5f) * ACTIVEBKG->Zdiv;
+			for(long x = x0; x <= x1; x++) {
+				float xx = ((float)x + 0.5f) * ACTIVEBKG->Xdiv;
+				if(closerThan(Vec2f(xx, zz), Vec2f(el->pos.x, el->pos.z), radius)) {
+					AddTileLight(tilelights[x][z], el);
+				}
+			}
 		}
 	}
 }
@@ -1267,6 +1224,18 @@ void ARX_PORTALS_Frustrum_RenderRoomTCullSoft(long room_num, EERIE_FRUSTRUM_DATA
 
 	EP_DATA *pEPDATA = &portals->room[room_num].epdata[0];
 
+	// Test the bounding spheres of all room polygons against the room frustums up front
+	static CullingSpheres spheres;
+	static std::vector<char> visible;
+	spheres.clear();
+	for(long lll=0; lll<portals->room[room_num].nb_polys; lll++) {
+		const EP_DATA & epd = pEPDATA[lll];
+		const EERIEPOLY & ep = ACTIVEBKG->fastdata[epd.px][epd.py].polydata[epd.idx];
+		spheres.add(ep.center, ep.v[0].rhw);
+	}
+	spheres.test(*frustrums, visible);
+	cullingStats.polysTested += spheres.size();
+	
 	for(long lll=0; lll<portals->room[room_num].nb_polys; lll++, pEPDATA++) {
 		FAST_BKG_DATA *feg = &ACTIVEBKG->fastdata[pEPDATA->px][pEPDATA->py];
 
@@ -1285,10 +1254,7 @@ void ARX_PORTALS_Frustrum_RenderRoomTCullSoft(long room_num, EERIE_FRUSTRUM_DATA
 			for(long nx=ix; nx<=ax; nx++) {
 				FAST_BKG_DATA * feg2 = &ACTIVEBKG->fastdata[nx][nz];
 
-				if(!feg2->treat) {
-					feg2->treat=1;
-					ComputeTileLights(static_cast<short>(nx), static_cast<short>(nz));
-				}
+				feg2->treat=1;
 			}
 		}
 
@@ -1302,7 +1268,7 @@ void ARX_PORTALS_Frustrum_RenderRoomTCullSoft(long room_num, EERIE_FRUSTRUM_DATA
 			continue;
 		}
 
-		if(FrustrumsClipPoly(frustrums,ep)) {
+		if(!visible[lll]) {
 			continue;
 		}
 
@@ -1362,6 +1328,8 @@ void ARX_PORTALS_Frustrum_RenderRoomTCullSoft(long room_num, EERIE_FRUSTRUM_DATA
 		}
 
 		SMY_VERTEX *pMyVertexCurr;
+		
+		cullingStats.polysDrawn++;
 
 		*pIndicesCurr++ = ep->uslInd[0];
 		*pIndicesCurr++ = ep->uslInd[1];
@@ -1742,7 +1710,47 @@ void ARX_PORTALS_Frustrum_ComputeRoom(long room_num, const EERIE_FRUSTRUM * frus
 	}
 }
 
+static bool IsPlaneClose(float a0, float b0, float c0, float d0,
+                         float a1, float b1, float c1, float d1) {
+	const float normalTolerance = 0.001f;
+	const float distanceTolerance = 1.f;
+	return fabs(a0 - a1) <= normalTolerance && fabs(b0 - b1) <= normalTolerance
+	       && fabs(c0 - c1) <= normalTolerance && fabs(d0 - d1) <= distanceTolerance;
+}
+
+/*!
+ * Check if the rooms and room frustums computed for an earlier frame can be reused.
+ * This is the case if the camera is still in the same room and has (almost) not moved.
+ */
+static bool IsRoomVisibilityCached(long room_num, const EERIE_FRUSTRUM & frustrum, float zfar) {
+	
+	const RoomVisibilityCache & cache = roomVisibility;
+	
+	if(!cache.valid || cache.room != room_num || cache.portals != portals || cache.zfar != zfar
+	   || RoomDraw.size() != size_t(portals->nb_rooms + 1)) {
+		return false;
+	}
+	
+	if(!closerThan(cache.pos, ACTIVECAM->orgTrans.pos, 1.f)) {
+		return false;
+	}
+	
+	for(size_t i = 0; i < 4; i++) {
+		if(!IsPlaneClose(cache.frustrum.a[i], cache.frustrum.b[i], cache.frustrum.c[i],
+		                 cache.frustrum.d[i], frustrum.a[i], frustrum.b[i], frustrum.c[i],
+		                 frustrum.d[i])) {
+			return false;
+		}
+	}
+	
+	const EERIE_FRUSTRUM_PLANE & near0 = cache.nearPlane;
+	const EERIE_FRUSTRUM_PLANE & near1 = efpPlaneNear;
+	return IsPlaneClose(near0.a, near0.b, near0.c, near0.d, near1.a, near1.b, near1.c, near1.d);
+}
+
 void ARX_SCENE_Update() {
+	
+	ARX_PROFILE_FUNC();
 	arx_assert(USE_PORTALS && portals);
 
 	unsigned long tim = (unsigned long)(arxtime);
@@ -1777,27 +1785,49 @@ void ARX_SCENE_Update() {
 		}
 	}
 
-	for(long j=0; j<ACTIVEBKG->Zsize; j++) {
-		for(long i=0; i<ACTIVEBKG->Xsize; i++) {
-			if (tilelights[i][j].num)
-				tilelights[i][j].num=0;
-		}
-	}
+	ComputeTileLights();
 
+	cullingStats.rooms = 0;
+	cullingStats.polysTested = 0;
+	cullingStats.polysDrawn = 0;
+	cullingStats.cached = false;
+	
 	long room_num=ARX_PORTALS_GetRoomNumForPosition(&ACTIVECAM->orgTrans.pos,1);
 	if(room_num>-1) {
 
-		ARX_PORTALS_InitDrawnRooms();
 		EERIE_FRUSTRUM frustrum;
 		CreateScreenFrustrum(&frustrum);
-		ARX_PORTALS_Frustrum_ComputeRoom(room_num, &frustrum);
 
+		float zfar = ACTIVECAM->cdepth * (fZFogEnd*1.1f);
+		if(IsRoomVisibilityCached(room_num, frustrum, zfar)) {
+			cullingStats.cached = true;
+		} else {
+			ARX_PORTALS_InitDrawnRooms();
+			ARX_PORTALS_Frustrum_ComputeRoom(room_num, &frustrum);
+			roomVisibility.valid = true;
+			roomVisibility.room = room_num;
+			roomVisibility.pos = ACTIVECAM->orgTrans.pos;
+			roomVisibility.frustrum = frustrum;
+			roomVisibility.nearPlane = efpPlaneNear;
+			roomVisibility.zfar = zfar;
+			roomVisibility.portals = portals;
+		}
+		
+		ARX_PORTALS_ResetRoomBuffers();
+		
+		cullingStats.rooms = RoomDrawList.size();
 		for(size_t i = 0; i < RoomDrawList.size(); i++) {
 			ARX_PORTALS_Frustrum_RenderRoomTCullSoft(RoomDrawList[i], &RoomDraw[RoomDrawList[i]].frustrum, tim);
 		}
+	} else {
+		roomVisibility.valid = false;
 	}
 }
 
+const SceneCullingStats & ARX_SCENE_GetCullingStats() {
+	return cullingStats;
+}
+
 void DebugPortalsRender() {
 	GRenderer->SetRenderState(Renderer::Fog, false);
 	GRenderer->SetRenderState(Renderer::DepthTest, false);
@@ -1831,6 +1861,8 @@ extern long SPECIAL_DRAGINTER_RENDER;
 //*************************************************************************************
 ///////////////////////////////////////////////////////////
 void ARX_SCENE_Render() {
+	
+	ARX_PROFILE_FUNC();
 
 	if(uw_mode)
 		GRenderer->GetTextureStage(0)->SetMipMapLODBias(10.f);
@@ -47,16 +47,29 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #ifndef ARX_SCENE_SCENE_H
 #define ARX_SCENE_SCENE_H
 
+#include <stddef.h>
+
 #include "math/MathFwd.h"
 
 class Entity;
 
+//! Portal culling statistics for the last call to ARX_SCENE_Update()
+struct SceneCullingStats {
+	size_t rooms; //!< Number of visible rooms
+	size_t polysTested; //!< Room polygons tested against the room frustums
+	size_t polysDrawn; //!< Room polygons that passed all culling tests
+	bool cached; //!< Room visibility was reused from the previous frame
+};
+
 long ARX_PORTALS_GetRoomNumForPosition(Vec3f * pos, long flag = 0);
 
 void ARX_SCENE_Update();
+const SceneCullingStats & ARX_SCENE_GetCullingStats();
 void ARX_SCENE_Render();
 bool ARX_SCENE_PORTAL_ClipIO(Entity * io, Vec3f * position);
 void RoomDrawRelease();
+//! Forget the rooms computed for the last frame - needed whenever the portal data changes
+void ARX_SCENE_InvalidateRoomVisibility();
 bool ARX_SCENE_PORTAL_Basic_ClipIO(Entity * io);
 
 bool VisibleSphere(float x, float y, float z, float radius);
@@ -77,6 +77,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/resource/PakReader.h"
 #include "io/log/Logger.h"
 
+#include "platform/profiler/LoadStatistics.h"
+#include "platform/profiler/Profiler.h"
+
 #include "scene/Scene.h"
 #include "scene/Interactive.h"
 
@@ -169,6 +172,8 @@ void ARX_SCRIPT_ResetObject(Entity * io, long flags)
 	// Now go for Script INIT/RESET depending on Mode
 	if(io) {
 		
+		ARX_LOAD_PHASE(LoadScripts);
+		
 		long num = io->index();
 		
 		if (entities[num] && entities[num]->script.data)
@@ -1690,6 +1695,8 @@ ScriptResult SendInitScriptEvent(Entity * io) {
 	
 	if (!io) return REFUSE;
 
+	ARX_LOAD_PHASE(LoadScripts);
+
 	Entity * oes = EVENT_SENDER;
 	EVENT_SENDER = NULL;
 	long num = io->index();
@@ -1904,6 +1911,8 @@ long Manage_Specific_RAT_Timer(SCR_TIMER * st)
 
 void ARX_SCRIPT_Timer_Check() {
 	
+	ARX_PROFILE_FUNC();
+	
 	if(!ActiveTimers) {
 		return;
 	}
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PakReaderTest.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <cppunit/TestAssert.h>
+
+#include "io/fs/Filesystem.h"
+#include "io/fs/FileStream.h"
+#include "io/resource/PakReader.h"
+#include "platform/Atomic.h"
+#include "unpak/PakConvert.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PakReaderTest);
+
+void PakReaderTest::Worker::run() {
+	m_test.work(m_seed);
+}
+
+void PakReaderTest::BitWriter::write(u32 value, size_t count) {
+	m_buffer |= value << m_count;
+	m_count += count;
+	for(; m_count >= 8; m_count -= 8, m_buffer >>= 8) {
+		m_out += char(m_buffer & 0xff);
+	}
+}
+
+void PakReaderTest::BitWriter::flush() {
+	if(m_count) {
+		m_out += char(m_buffer & 0xff);
+	}
+	m_buffer = 0, m_count = 0;
+}
+
+u32 PakReaderTest::random(u32 & seed) {
+	seed = seed * 1103515245u + 12345u;
+	return seed >> 8;
+}
+
+void PakReaderTest::createFile(const fs::path & path, size_t size, bool compressible, u32 seed) {
+	fs::ofstream ofs(path, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+	CPPUNIT_ASSERT(ofs.is_open());
+	for(size_t i = 0; i < size; i++) {
+		ofs.put(char(compressible ? (i / 64 + seed) % 7 : random(seed)));
+	}
+}
+
+bool PakReaderTest::check(size_t index, size_t offset, const char * data, size_t size) {
+	const std::vector<char> & expected = m_expected[index];
+	if(offset + size > expected.size()) {
+		return false;
+	}
+	return size == 0 || !std::memcmp(&expected[offset], data, size);
+}
+
+void PakReaderTest::work(u32 seed) {
+	
+	std::vector<char> buffer;
+	
+	for(size_t i = 0; i < iterations; i++) {
+		
+		size_t index = random(seed) % m_names.size();
+		size_t size = m_expected[index].size();
+		
+		bool ok;
+		if(random(seed) % 2) {
+			
+			// Whole file
+			size_t nread = 0;
+			char * data = m_pak->readAlloc(m_names[index], nread);
+			ok = (nread == size) && check(index, 0, data, nread);
+			free(data);
+			
+		} else {
+			
+			// Random range through a handle
+			PakFileHandle * handle = m_pak->open(m_names[index]);
+			size_t offset = size ? random(seed) % size : 0;
+			buffer.resize(random(seed) % (200 * 1024) + 1);
+			handle->seek(SeekSet, int(offset));
+			size_t nread = handle->read(&buffer[0], buffer.size());
+			delete handle;
+			ok = (nread == std::min(buffer.size(), size - offset))
+			     && check(index, offset, &buffer[0], nread);
+			
+		}
+		
+		if(!ok) {
+			atomicAdd(&m_mismatches, 1);
+		}
+	}
+}
+
+std::string PakReaderTest::implode(const std::string & data) {
+	
+	std::string out;
+	out += char(0); // uncoded literals
+	out += char(4); // 1024 byte dictionary
+	
+	BitWriter writer(out);
+	for(size_t i = 0; i < data.size(); i++) {
+		writer.write(0, 1); // literal
+		writer.write(u8(data[i]), 8);
+	}
+	
+	// End of stream: length 519, encoded as length symbol 15 (inverted code 0000000)
+	// with all extra bits set
+	writer.write(1, 1);
+	writer.write(0, 7);
+	writer.write(0xff, 8);
+	writer.flush();
+	
+	return out;
+}
+
+void PakReaderTest::append(std::string & out, u32 value) {
+	out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void PakReaderTest::createPak(const fs::path & path, const std::string & dir,
+                              const std::vector<std::string> & files) {
+	
+	std::string data;
+	std::string fat;
+	
+	fat.append(dir.c_str(), dir.length() + 1);
+	append(fat, u32(files.size()));
+	
+	for(size_t i = 0; i < files.size(); i++) {
+		std::string stored = (i % 2) ? implode(files[i]) : files[i];
+		std::string name = std::string(1, char('a' + i)) + ".dat";
+		fat.append(name.c_str(), name.length() + 1);
+		append(fat, u32(sizeof(u32) + data.size()));
+		append(fat, u32(i % 2));
+		append(fat, u32(files[i].size()));
+		append(fat, u32(stored.size()));
+		data += stored;
+	}
+	
+	fs::ofstream ofs(path, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+	CPPUNIT_ASSERT(ofs.is_open());
+	std::string header;
+	append(header, u32(sizeof(u32) + data.size()));
+	append(header, u32(fat.size()));
+	ofs << header.substr(0, sizeof(u32)) << data << header.substr(sizeof(u32)) << fat;
+	CPPUNIT_ASSERT(!ofs.flush().fail());
+}
+
+void PakReaderTest::setUp() {
+	
+	m_dir = fs::path("pakreadertest");
+	fs::remove_all(m_dir);
+	CPPUNIT_ASSERT(fs::create_directories(m_dir / "files" / "sub"));
+	
+	// Sizes around the chunk boundaries, compressible and incompressible data
+	const size_t sizes[] = { 0, 1, 1000, 65535, 65536, 65537, 200000, 1000000 };
+	for(size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+		for(size_t j = 0; j < 2; j++) {
+			std::string name = std::string(j ? "sub/" : "") + char('a' + i) + (j ? ".bin" : ".txt");
+			createFile(m_dir / "files" / name, sizes[i], j == 0, u32(i));
+			m_names.push_back(res::path(name));
+		}
+	}
+	
+	PakReader plain;
+	CPPUNIT_ASSERT(plain.addFiles(m_dir / "files"));
+	CPPUNIT_ASSERT(convertPak(plain, m_dir / "test.ipak", fs::path()));
+	
+	m_pak = new PakReader;
+	CPPUNIT_ASSERT(m_pak->addArchive(m_dir / "test.ipak"));
+	CPPUNIT_ASSERT(m_pak->addFiles(m_dir / "files", "plain"));
+	
+	size_t count = m_names.size();
+	for(size_t i = 0; i < count; i++) {
+		m_names.push_back(res::path("plain") / m_names[i]);
+	}
+	
+	// Single-threaded reference reads
+	m_expected.resize(m_names.size());
+	for(size_t i = 0; i < m_names.size(); i++) {
+		size_t size = 0;
+		char * data = m_pak->readAlloc(m_names[i], size);
+		CPPUNIT_ASSERT(data != NULL || size == 0);
+		m_expected[i].assign(data, data + size);
+		free(data);
+	}
+	
+	m_mismatches = 0;
+}
+
+void PakReaderTest::tearDown() {
+	delete m_pak;
+	m_pak = NULL;
+	m_names.clear();
+	m_expected.clear();
+	fs::remove_all(m_dir);
+}
+
+void PakReaderTest::concurrentReads() {
+	
+	Worker * workers[threadCount];
+	
+	for(size_t i = 0; i < threadCount; i++) {
+		workers[i] = new Worker(*this, u32(i + 1));
+		workers[i]->start();
+	}
+	
+	for(size_t i = 0; i < threadCount; i++) {
+		workers[i]->waitForCompletion();
+		delete workers[i];
+	}
+	
+	CPPUNIT_ASSERT_EQUAL(u32(0), u32(m_mismatches));
+}
+
+void PakReaderTest::implodedFiles() {
+	
+	std::vector<std::string> files;
+	u32 seed = 42;
+	const size_t sizes[] = { 1, 13, 1000, 1000, 70000, 70000 };
+	for(size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+		std::string file;
+		for(size_t j = 0; j < sizes[i]; j++) {
+			file += char(random(seed));
+		}
+		files.push_back(file);
+	}
+	
+	createPak(m_dir / "test.pak", "legacy", files);
+	
+	PakReader pak;
+	CPPUNIT_ASSERT(pak.addArchive(m_dir / "test.pak"));
+	
+	for(size_t i = 0; i < files.size(); i++) {
+		
+		res::path name = res::path("legacy") / (std::string(1, char('a' + i)) + ".dat");
+		const std::string & expected = files[i];
+		
+		// Whole file
+		size_t size = 0;
+		char * data = pak.readAlloc(name, size);
+		CPPUNIT_ASSERT(data != NULL);
+		CPPUNIT_ASSERT_EQUAL(expected.size(), size);
+		CPPUNIT_ASSERT(!std::memcmp(expected.data(), data, size));
+		free(data);
+		
+		// Several parts through the same handle
+		PakFileHandle * handle = pak.open(name);
+		CPPUNIT_ASSERT(handle != NULL);
+		std::vector<char> buffer(expected.size());
+		size_t first = expected.size() / 3;
+		CPPUNIT_ASSERT_EQUAL(int(first), handle->seek(SeekSet, int(first)));
+		size_t second = handle->read(&buffer[first], expected.size() / 2);
+		CPPUNIT_ASSERT_EQUAL(expected.size() / 2, second);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), size_t(handle->seek(SeekSet, 0)));
+		CPPUNIT_ASSERT_EQUAL(first, handle->read(&buffer[0], first));
+		size_t rest = expected.size() - first - second;
+		CPPUNIT_ASSERT_EQUAL(first + second, size_t(handle->seek(SeekSet, int(first + second))));
+		CPPUNIT_ASSERT_EQUAL(rest, handle->read(&buffer[first + second], rest + 100));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), handle->read(&buffer[0], 1));
+		delete handle;
+		CPPUNIT_ASSERT(!std::memcmp(expected.data(), &buffer[0], expected.size()));
+	}
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_IO_PAKREADERTEST_H
+#define ARX_IO_PAKREADERTEST_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "io/fs/FilePath.h"
+#include "io/resource/ResourcePath.h"
+#include "platform/Platform.h"
+#include "platform/Thread.h"
+
+class PakReader;
+
+/*!
+ * Reads random parts of random files from several threads at once and compares them
+ * against single-threaded reads of the same files.
+ *
+ * The files are read both from an indexed archive (chunk-compressed and stored entries)
+ * and from plain files on disk.
+ *
+ * Imploded files from the original .pak format are checked separately.
+ */
+class PakReaderTest : public CppUnit::TestCase {
+	
+	CPPUNIT_TEST_SUITE(PakReaderTest);
+	CPPUNIT_TEST(concurrentReads);
+	CPPUNIT_TEST(implodedFiles);
+	CPPUNIT_TEST_SUITE_END();
+	
+	static const size_t threadCount = 8;
+	static const size_t iterations = 2000;
+	
+	fs::path m_dir;
+	PakReader * m_pak;
+	std::vector<res::path> m_names;
+	std::vector<std::vector<char> > m_expected;
+	volatile u32 m_mismatches;
+	
+	class Worker : public Thread {
+		
+		PakReaderTest & m_test;
+		u32 m_seed;
+		
+	public:
+		
+		Worker(PakReaderTest & test, u32 seed) : m_test(test), m_seed(seed) { }
+		
+		void run();
+		
+	};
+	
+	//! Bit writer for PKWARE DCL streams, which are filled starting at the lowest bit
+	class BitWriter {
+		
+		std::string & m_out;
+		u32 m_buffer;
+		size_t m_count;
+		
+	public:
+		
+		explicit BitWriter(std::string & out) : m_out(out), m_buffer(0), m_count(0) { }
+		
+		void write(u32 value, size_t count);
+		
+		void flush();
+		
+	};
+	
+	static u32 random(u32 & seed);
+	
+	void createFile(const fs::path & path, size_t size, bool compressible, u32 seed);
+	
+	bool check(size_t index, size_t offset, const char * data, size_t size);
+	
+	void work(u32 seed);
+	
+	/*!
+	 * Implode data using uncoded literals only - enough to exercise the blast decoder
+	 * without needing the implode implementation from the save game editor.
+	 */
+	static std::string implode(const std::string & data);
+	
+	static void append(std::string & out, u32 value);
+	
+	/*!
+	 * Write an unencrypted archive in the original .pak format.
+	 * Odd files are imploded, even files stored as-is.
+	 */
+	static void createPak(const fs::path & path, const std::string & dir,
+	                      const std::vector<std::string> & files);
+	
+public:
+	
+	PakReaderTest() : CppUnit::TestCase("PakReaderTest"), m_pak(NULL), m_mismatches(0) { }
+	
+	void setUp();
+	void tearDown();
+	
+	void concurrentReads();
+	void implodedFiles();
+	
+};
+
+#endif // ARX_IO_PAKREADERTEST_H
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark for the batch math functions.
+ *
+ * Runs each batch function and the equivalent loop over the single-element function on
+ * the same data and prints the time per element.
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "graphics/Math.h"
+
+namespace {
+
+const size_t COUNT = 1024;
+const size_t ITERATIONS = 10000;
+
+std::vector<EERIE_QUAT> g_from(COUNT);
+std::vector<EERIE_QUAT> g_to(COUNT);
+std::vector<EERIE_QUAT> g_quats(COUNT);
+std::vector<Vec3f> g_vectors(COUNT);
+std::vector<Vec3f> g_result(COUNT);
+std::vector<float> g_rhw(COUNT);
+EERIEMATRIX g_matrix;
+
+float random(float scale) {
+	return (float(std::rand()) / RAND_MAX * 2.f - 1.f) * scale;
+}
+
+void setup() {
+	
+	for(size_t i = 0; i < COUNT; i++) {
+		Anglef from(random(3.f), random(3.f), random(3.f));
+		QuatFromAngles(&g_from[i], &from);
+		Anglef to(random(3.f), random(3.f), random(3.f));
+		QuatFromAngles(&g_to[i], &to);
+		g_vectors[i] = Vec3f(random(100.f), random(100.f), random(100.f));
+	}
+	
+	float * m = &g_matrix._11;
+	for(size_t i = 0; i < 16; i++) {
+		m[i] = random(1.f);
+	}
+	g_matrix._44 = 10.f;
+}
+
+void quatMultiplySingle() {
+	for(size_t i = 0; i < COUNT; i++) {
+		Quat_Multiply(&g_quats[i], &g_from[i], &g_to[i]);
+	}
+}
+
+void quatMultiplyBatch() {
+	Quat_MultiplyArray(&g_quats[0], &g_from[0], &g_to[0], COUNT);
+}
+
+void quatSlerpSingle() {
+	for(size_t i = 0; i < COUNT; i++) {
+		EERIE_QUAT to = g_to[i];
+		Quat_Slerp(&g_quats[i], &g_from[i], &to, 0.3f);
+	}
+}
+
+void quatSlerpBatch() {
+	Quat_SlerpArray(&g_quats[0], &g_from[0], &g_to[0], 0.3f, COUNT);
+}
+
+void transformQuatSingle() {
+	for(size_t i = 0; i < COUNT; i++) {
+		TransformVertexQuat(&g_from[0], &g_vectors[i], &g_result[i]);
+	}
+}
+
+void transformQuatBatch() {
+	TransformVertexQuatArray(&g_from[0], &g_vectors[0], &g_result[0], COUNT);
+}
+
+void transformMatrixSingle() {
+	for(size_t i = 0; i < COUNT; i++) {
+		VectorMatrixMultiply(&g_result[i], &g_vectors[i], &g_matrix);
+	}
+}
+
+void transformMatrixBatch() {
+	VectorMatrixMultiplyArray(&g_result[0], &g_vectors[0], COUNT, &g_matrix);
+}
+
+void projectSingle() {
+	for(size_t i = 0; i < COUNT; i++) {
+		const Vec3f & v = g_vectors[i];
+		float w = v.x * g_matrix._14 + v.y * g_matrix._24 + v.z * g_matrix._34 + g_matrix._44;
+		g_rhw[i] = 1.f / w;
+		VectorMatrixMultiply(&g_result[i], &v, &g_matrix);
+		g_result[i] *= g_rhw[i];
+	}
+}
+
+void projectBatch() {
+	ProjectVertexArray(&g_result[0], &g_rhw[0], &g_vectors[0], COUNT, &g_matrix);
+}
+
+//! @return the time per element in nanoseconds
+double measure(void (*function)()) {
+	std::clock_t start = std::clock();
+	for(size_t i = 0; i < ITERATIONS; i++) {
+		function();
+	}
+	double seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+	return seconds * 1000000000.0 / double(COUNT * ITERATIONS);
+}
+
+void report(const char * name, void (*single)(), void (*batch)()) {
+	double singleTime = measure(single);
+	double batchTime = measure(batch);
+	std::cout << name << ": " << singleTime << " ns single, " << batchTime << " ns batch";
+	if(batchTime > 0) {
+		std::cout << " (" << (singleTime / batchTime) << "x)";
+	}
+	std::cout << '\n';
+}
+
+} // anonymous namespace
+
+int main() {
+	
+	std::srand(0);
+	setup();
+	
+	report("Quat_Multiply", &quatMultiplySingle, &quatMultiplyBatch);
+	report("Quat_Slerp", &quatSlerpSingle, &quatSlerpBatch);
+	report("TransformVertexQuat", &transformQuatSingle, &transformQuatBatch);
+	report("VectorMatrixMultiply", &transformMatrixSingle, &transformMatrixBatch);
+	report("ProjectVertex", &projectSingle, &projectBatch);
+	
+	return EXIT_SUCCESS;
+}
@@ -17,7 +17,12 @@
  * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
+
 #include <cppunit/TestCase.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/extensions/HelperMacros.h>
+
 #include "graphics/Math.h"
 
 class VectorTest : public CppUnit::TestCase {
@@ -33,3 +38,129 @@ public:
 	CPPUNIT_ASSERT( a._11 == b._11 );
   }
 };
+
+/*!
+ * Checks that the batch functions give the same results as the functions for a single
+ * element. The counts are not multiples of four so that the remainder is also tested.
+ */
+class BatchMathTest : public CppUnit::TestCase {
+	
+	CPPUNIT_TEST_SUITE(BatchMathTest);
+	CPPUNIT_TEST(quatMultiply);
+	CPPUNIT_TEST(quatSlerp);
+	CPPUNIT_TEST(transformQuat);
+	CPPUNIT_TEST(transformMatrix);
+	CPPUNIT_TEST(project);
+	CPPUNIT_TEST_SUITE_END();
+	
+	static const size_t count = 23;
+	
+	EERIE_QUAT from[count];
+	EERIE_QUAT to[count];
+	Vec3f vectors[count];
+	EERIEMATRIX matrix;
+	
+	static float random(float scale) {
+		return (float(std::rand()) / RAND_MAX * 2.f - 1.f) * scale;
+	}
+	
+	static EERIE_QUAT randomQuat() {
+		EERIE_QUAT q;
+		Quat_Init(&q, random(1.f), random(1.f), random(1.f), random(1.f));
+		float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		Quat_Init(&q, q.x / len, q.y / len, q.z / len, q.w / len);
+		return q;
+	}
+	
+	static void checkQuat(const EERIE_QUAT & expected, const EERIE_QUAT & actual) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x, actual.x, 0.0001f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y, actual.y, 0.0001f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z, actual.z, 0.0001f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.w, actual.w, 0.0001f);
+	}
+	
+	static void checkVector(const Vec3f & expected, const Vec3f & actual) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x, actual.x, 0.001f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y, actual.y, 0.001f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z, actual.z, 0.001f);
+	}
+	
+public:
+	
+	void setUp() {
+		
+		std::srand(0);
+		
+		for(size_t i = 0; i < count; i++) {
+			from[i] = randomQuat();
+			to[i] = randomQuat();
+			vectors[i] = Vec3f(random(100.f), random(100.f), random(100.f));
+		}
+		
+		// Nearly identical quaternions use linear interpolation
+		to[5] = from[5];
+		
+		float * m = &matrix._11;
+		for(size_t i = 0; i < 16; i++) {
+			m[i] = random(1.f);
+		}
+		matrix._44 = 10.f;
+	}
+	
+	void quatMultiply() {
+		EERIE_QUAT result[count];
+		Quat_MultiplyArray(result, from, to, count);
+		for(size_t i = 0; i < count; i++) {
+			EERIE_QUAT expected;
+			Quat_Multiply(&expected, &from[i], &to[i]);
+			checkQuat(expected, result[i]);
+		}
+	}
+	
+	void quatSlerp() {
+		EERIE_QUAT result[count];
+		Quat_SlerpArray(result, from, to, 0.3f, count);
+		for(size_t i = 0; i < count; i++) {
+			EERIE_QUAT expected, target = to[i];
+			Quat_Slerp(&expected, &from[i], &target, 0.3f);
+			checkQuat(expected, result[i]);
+		}
+	}
+	
+	void transformQuat() {
+		Vec3f result[count];
+		TransformVertexQuatArray(&from[0], vectors, result, count);
+		for(size_t i = 0; i < count; i++) {
+			Vec3f expected;
+			TransformVertexQuat(&from[0], &vectors[i], &expected);
+			checkVector(expected, result[i]);
+		}
+	}
+	
+	void transformMatrix() {
+		Vec3f result[count];
+		VectorMatrixMultiplyArray(result, vectors, count, &matrix);
+		for(size_t i = 0; i < count; i++) {
+			Vec3f expected;
+			VectorMatrixMultiply(&expected, &vectors[i], &matrix);
+			checkVector(expected, result[i]);
+		}
+	}
+	
+	void project() {
+		Vec3f result[count];
+		float rhw[count];
+		ProjectVertexArray(result, rhw, vectors, count, &matrix);
+		for(size_t i = 0; i < count; i++) {
+			const Vec3f & v = vectors[i];
+			float w = v.x * matrix._14 + v.y * matrix._24 + v.z * matrix._34 + matrix._44;
+			Vec3f expected;
+			VectorMatrixMultiply(&expected, &v, &matrix);
+			checkVector(expected * (1.f / w), result[i]);
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(1.f / w, rhw[i], 0.0001f);
+		}
+	}
+	
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BatchMathTest);
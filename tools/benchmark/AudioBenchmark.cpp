@@ -0,0 +1,275 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Audio mixing benchmark.
+ *
+ * Plays a number of looped ambiances plus a steady stream of positioned one-shot
+ * samples through the null audio backend, which decodes, resamples and mixes everything
+ * in software as fast as possible. Reports the mixing and decoding cost, the number of
+ * voices and the sources that took the longest to decode. No audio device is needed.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "audio/Audio.h"
+#include "audio/AudioTypes.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakReader.h"
+#include "io/resource/ResourcePath.h"
+#include "math/Random.h"
+#include "math/Vector3.h"
+#include "platform/Environment.h"
+#include "platform/ProgramOptions.h"
+#include "platform/Time.h"
+#include "util/cmdline/Parser.h"
+
+namespace {
+
+size_t g_ambiances = 4;
+size_t g_rate = 20;
+size_t g_duration = 60;
+fs::path g_output;
+
+//! Mixing step in milliseconds, roughly what the game's sound thread does
+const size_t STEP = 10;
+
+void showHelp() {
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	
+	std::cout << "Usage: arxaudiobench [options]\n\n";
+	std::cout << "Mixes ambiances and samples with the null audio backend.\n\n";
+	std::cout << "Options:\n" << cli << std::endl;
+	
+	std::exit(EXIT_SUCCESS);
+}
+
+size_t parseCount(const std::string & value, const char * what) {
+	try {
+		return boost::lexical_cast<size_t>(value);
+	} catch(const boost::bad_lexical_cast &) {
+		throw util::cmdline::error(util::cmdline::error::invalid_value,
+		                           std::string("invalid ") + what + ": " + value);
+	}
+}
+
+void ambiancesOption(const std::string & value) {
+	g_ambiances = parseCount(value, "ambiance count");
+}
+
+void rateOption(const std::string & value) {
+	g_rate = parseCount(value, "sample rate");
+}
+
+void durationOption(const std::string & value) {
+	g_duration = parseCount(value, "duration");
+}
+
+void outputOption(const std::string & file) {
+	g_output = file;
+}
+
+bool mountResources() {
+	
+	resources = new PakReader;
+	
+	bool found = false;
+	static const char * const paks[] = { "sfx.pak", "speech.pak", "speech_default.pak" };
+	for(size_t i = 0; i < ARRAY_SIZE(paks); i++) {
+		found = resources->addArchive(fs::paths.find(paks[i])) || found;
+	}
+	
+	BOOST_REVERSE_FOREACH(const fs::path & base, fs::paths.data) {
+		resources->addFiles(base / "sfx", "sfx");
+	}
+	
+	return found;
+}
+
+//! List the files with the given extension in a resource directory
+std::vector<res::path> listFiles(const res::path & dir, const char * ext) {
+	
+	std::vector<res::path> result;
+	
+	PakDirectory * directory = resources->getDirectory(dir);
+	if(!directory) {
+		return result;
+	}
+	
+	for(PakDirectory::files_iterator i = directory->files_begin();
+	    i != directory->files_end(); ++i) {
+		res::path name = i->first;
+		if(name.has_ext(ext)) {
+			result.push_back(name);
+		}
+	}
+	
+	return result;
+}
+
+} // anonymous namespace
+
+ARX_PROGRAM_OPTION("help", "h", "Show supported options", &showHelp);
+ARX_PROGRAM_OPTION("ambiances", "a", "Number of looped ambiances", &ambiancesOption, "COUNT");
+ARX_PROGRAM_OPTION("rate", "S", "Samples started per second", &rateOption, "COUNT");
+ARX_PROGRAM_OPTION("duration", "t", "Seconds of audio to mix", &durationOption, "SECONDS");
+ARX_PROGRAM_OPTION("output", "o", "Write the mixed audio to a WAV file", &outputOption, "FILE");
+
+int main(int argc, char ** argv) {
+	
+	Random::seed(0);
+	
+	Logger::initialize();
+	
+	defineSystemDirectories(argv[0]);
+	
+	util::cmdline::interpreter<std::string> cli;
+	try {
+		BaseOption::registerAll(cli);
+		util::cmdline::parse(cli, argc, argv);
+	} catch(util::cmdline::error & e) {
+		std::cerr << e.what() << "\n\n";
+		return EXIT_FAILURE;
+	}
+	
+	if(fs::paths.init() != RunProgram) {
+		return EXIT_FAILURE;
+	}
+	
+	Time::init();
+	
+	if(!mountResources()) {
+		LogError << "Could not load any sound archives";
+		return EXIT_FAILURE;
+	}
+	
+	if(audio::init("Null", false) || audio::setSamplePath("sfx")
+	   || audio::setAmbiancePath("sfx/ambiance") || audio::setOffline(g_output)) {
+		audio::clean();
+		return EXIT_FAILURE;
+	}
+	
+	// Same settings as the game
+	audio::setStreamLimit(176400);
+	audio::setUnitFactor(0.01f);
+	audio::setRolloffFactor(1.3f);
+	
+	audio::MixerId mixer = audio::createMixer();
+	
+	std::vector<res::path> ambiances = listFiles("sfx/ambiance", "amb");
+	for(size_t i = 0; i < g_ambiances && i < ambiances.size(); i++) {
+		audio::AmbianceId id = audio::createAmbiance(ambiances[i]);
+		if(id == audio::INVALID_ID) {
+			continue;
+		}
+		audio::Channel channel;
+		channel.mixer = mixer;
+		channel.flags = audio::FLAG_VOLUME | audio::FLAG_AUTOFREE;
+		channel.volume = 1.f;
+		audio::ambiancePlay(id, channel, true);
+	}
+	
+	std::vector<audio::SampleId> samples;
+	BOOST_FOREACH(const res::path & name, listFiles("sfx", "wav")) {
+		audio::SampleId id = audio::createSample(name);
+		if(id != audio::INVALID_ID) {
+			samples.push_back(id);
+		}
+	}
+	
+	u64 start = Time::getUs();
+	
+	size_t steps = g_duration * 1000 / STEP;
+	size_t started = 0;
+	for(size_t step = 0; step < steps; step++) {
+		
+		// Start one-shot samples around the listener at the requested rate
+		size_t due = (step + 1) * g_rate * STEP / 1000;
+		for(; started < due && !samples.empty(); started++) {
+			audio::Channel channel;
+			channel.mixer = mixer;
+			channel.flags = audio::FLAG_VOLUME | audio::FLAG_POSITION | audio::FLAG_FALLOFF;
+			channel.volume = 1.f;
+			channel.position = Vec3f(Random::getf(-1000.f, 1000.f), 0.f,
+			                         Random::getf(-1000.f, 1000.f));
+			channel.falloff.start = 200.f;
+			channel.falloff.end = 2200.f;
+			audio::SampleId id = samples[Random::get(0, int(samples.size()) - 1)];
+			audio::samplePlay(id, channel);
+		}
+		
+		audio::update();
+		audio::renderOffline(STEP);
+	}
+	
+	u64 elapsed = Time::getElapsedUs(start);
+	
+	audio::MixStats stats;
+	std::vector<audio::SourceStats> sources;
+	audio::getMixStats(stats);
+	audio::getSourceStats(sources);
+	
+	std::cout << "mixed: " << g_duration << " s in " << (elapsed / 1000) << " ms";
+	if(elapsed) {
+		std::cout << " (" << (g_duration * 1000000.0 / elapsed) << "x real time)";
+	}
+	std::cout << '\n';
+	std::cout << "samples started: " << started << '\n';
+	std::cout << "sources: " << stats.sources << '\n';
+	std::cout << "max voices: " << stats.maxVoices << '\n';
+	std::cout << "mix time: " << (stats.mixTime / 1000) << " ms\n";
+	std::cout << "decode time: " << (stats.decodeTime / 1000) << " ms\n";
+	
+	// The live sources that spent the most time decoding, usually streamed ambiance tracks
+	std::cout << "\nslowest sources:\n";
+	size_t count = std::min(sources.size(), size_t(10));
+	for(size_t i = 0; i < count; i++) {
+		size_t slowest = i;
+		for(size_t j = i + 1; j < sources.size(); j++) {
+			if(sources[j].decodeTime > sources[slowest].decodeTime) {
+				slowest = j;
+			}
+		}
+		std::swap(sources[i], sources[slowest]);
+		res::path name;
+		audio::getSampleName(sources[i].id, name);
+		std::cout << "  " << name << ": " << sources[i].decodeTime << " us, "
+		          << sources[i].decoded << " bytes" << (sources[i].streaming ? ", streamed" : "")
+		          << '\n';
+	}
+	
+	audio::clean();
+	
+	delete resources, resources = NULL;
+	
+	Logger::shutdown();
+	
+	return EXIT_SUCCESS;
+}
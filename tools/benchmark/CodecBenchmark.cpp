@@ -0,0 +1,529 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Audio codec benchmark.
+ *
+ * Decodes every ADPCM sample in the game's resource files with the block decoder used
+ * by the game and with a copy of the original sample-at-a-time decoder, checks that
+ * both produce exactly the same PCM data and reports the time spent in each. Stereo
+ * samples are also converted to mono with both the batched and a plain conversion.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "audio/AudioGlobal.h"
+#include "audio/AudioTypes.h"
+#include "audio/codec/ADPCM.h"
+#include "audio/codec/Codec.h"
+#include "audio/codec/WAVFormat.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakReader.h"
+#include "io/resource/ResourcePath.h"
+#include "platform/Environment.h"
+#include "platform/ProgramOptions.h"
+#include "platform/Time.h"
+#include "util/cmdline/Parser.h"
+
+namespace {
+
+void showHelp() {
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	
+	std::cout << "Usage: arxcodecbench [options]\n\n";
+	std::cout << "Decodes all ADPCM samples and compares them against the reference decoder.\n\n";
+	std::cout << "Options:\n" << cli << std::endl;
+	
+	std::exit(EXIT_SUCCESS);
+}
+
+//! Read-only file handle for a block of memory
+class MemoryHandle : public PakFileHandle {
+	
+public:
+	
+	MemoryHandle(const char * data, size_t size) : m_data(data), m_size(size), m_offset(0) { }
+	
+	size_t read(void * buf, size_t size) {
+		size = std::min(size, m_size - m_offset);
+		std::memcpy(buf, m_data + m_offset, size);
+		m_offset += size;
+		return size;
+	}
+	
+	int seek(Whence whence, int offset) {
+		size_t base = (whence == SeekSet) ? 0 : (whence == SeekCur) ? m_offset : m_size;
+		if(offset < 0 ? size_t(-offset) > base : base + offset > m_size) {
+			return -1;
+		}
+		m_offset = base + offset;
+		return int(m_offset);
+	}
+	
+	size_t tell() {
+		return m_offset;
+	}
+	
+private:
+	
+	const char * m_data;
+	size_t m_size;
+	size_t m_offset;
+	
+};
+
+/*!
+ * The original sample-at-a-time ADPCM decoder, kept to check that the block decoder
+ * produces identical output.
+ */
+class ReferenceADPCM : public audio::Codec {
+	
+public:
+	
+	ReferenceADPCM() : stream(NULL), header(NULL), padding(0), shift(0), sample_i(0),
+	                   nybble_c(0), nybble_i(0), nybble(0), odd(false), cache_c(0), cache_i(0) { }
+	
+	audio::aalError setHeader(void * _header) {
+		
+		header = (ADPCMHeader *)_header;
+		
+		shift = header->wfx.channels - 1;
+		
+		cache_c = cache_i = (u8)(sizeof(s16) << shift);
+		
+		nybble_c = header->samplesPerBlock - 2;
+		if(!shift) {
+			nybble_c >>= 1;
+		}
+		nybble_l.resize(nybble_c);
+		
+		padding = ((header->wfx.blockAlign - (7 << shift)) << 3) -
+		          (header->samplesPerBlock - 2) * (header->wfx.bitsPerSample << shift);
+		
+		if(audio::aalError error = getNextBlock()) {
+			return error;
+		}
+		
+		sample_i++;
+		
+		return audio::AAL_OK;
+	}
+	
+	void setStream(PakFileHandle * _stream) {
+		stream = _stream;
+	}
+	
+	audio::aalError setPosition(size_t position) {
+		ARX_UNUSED(position);
+		return audio::AAL_ERROR_SYSTEM;
+	}
+	
+	size_t getPosition() {
+		return 0;
+	}
+	
+	audio::aalError read(void * buffer, size_t to_read, size_t & read) {
+		
+		read = 0;
+		while(read < to_read) {
+			
+			if(cache_i < cache_c) {
+				((s8 *)buffer)[read++] = ((s8 *)cache)[cache_i++];
+				continue;
+			}
+			
+			if(sample_i >= header->samplesPerBlock) {
+				
+				if(padding) {
+					stream->seek(SeekCur, padding);
+				}
+				
+				if(audio::aalError error = getNextBlock()) {
+					return error;
+				}
+				
+			} else if(sample_i == 1) {
+				for(size_t i = 0; i < header->wfx.channels; i++) {
+					cache[i] = samp1[i];
+				}
+			} else {
+				for(size_t i = 0; i < header->wfx.channels; i++) {
+					if(odd) {
+						getSample(i, (s8)(nybble & 0x0f));
+						odd = false;
+					} else {
+						nybble = nybble_l[nybble_i++];
+						getSample(i, s8((nybble >> 4) & 0x0f));
+						odd = true;
+					}
+					cache[i] = samp1[i];
+				}
+			}
+			
+			sample_i++;
+			cache_i = 0;
+		}
+		
+		return audio::AAL_OK;
+	}
+	
+private:
+	
+	void getSample(size_t i, s8 adpcm_sample) {
+		
+		static const short gai_p4[] = {
+			230, 230, 230, 230, 307, 409, 512, 614,
+			768, 614, 512, 409, 307, 230, 230, 230
+		};
+		
+		s32 old_delta = delta[i];
+		delta[i] = s16((gai_p4[adpcm_sample] * old_delta) >> 8);
+		if(delta[i] < 16) {
+			delta[i] = 16;
+		}
+		
+		if(adpcm_sample & 0x08) {
+			adpcm_sample -= 16;
+		}
+		
+		s32 predict = ((s32)samp1[i] * coef1[i] + (s32)samp2[i] * coef2[i]) >> 8;
+		
+		s32 pcm_sample = adpcm_sample * old_delta + predict;
+		if(pcm_sample > 32767) {
+			pcm_sample = 32767;
+		} else if(pcm_sample < -32768) {
+			pcm_sample = -32768;
+		}
+		
+		samp2[i] = samp1[i];
+		samp1[i] = (s16)pcm_sample;
+	}
+	
+	audio::aalError getNextBlock() {
+		
+		if(!stream->read(predictor, sizeof(*predictor) << shift)
+		   || !stream->read(delta, sizeof(*delta) << shift)
+		   || !stream->read(samp1, sizeof(*samp1) << shift)
+		   || !stream->read(samp2, sizeof(*samp2) << shift)) {
+			return audio::AAL_ERROR_FILEIO;
+		}
+		
+		odd = false;
+		sample_i = 0;
+		nybble_i = 0;
+		
+		for(size_t i = 0; i < header->wfx.channels; i++) {
+			if(predictor[i] >= header->coefficientCount) {
+				return audio::AAL_ERROR_FORMAT;
+			}
+			coef1[i] = header->coefficients[predictor[i]].coef1;
+			coef2[i] = header->coefficients[predictor[i]].coef2;
+			cache[i] = samp2[i];
+		}
+		
+		if(!stream->read(&nybble_l[0], nybble_c)) {
+			return audio::AAL_ERROR_FILEIO;
+		}
+		
+		return audio::AAL_OK;
+	}
+	
+	PakFileHandle * stream;
+	ADPCMHeader * header;
+	u32 padding;
+	u32 shift;
+	u32 sample_i;
+	u8 predictor[2];
+	s16 delta[2];
+	s16 samp1[2];
+	s16 samp2[2];
+	s16 coef1[2];
+	s16 coef2[2];
+	std::vector<s8> nybble_l;
+	u32 nybble_c, nybble_i;
+	s8 nybble;
+	bool odd;
+	u8 cache_c, cache_i;
+	s16 cache[2];
+	
+};
+
+//! An ADPCM sample loaded into memory
+struct Sample {
+	res::path name;
+	std::vector<char> file;
+	std::vector<char> header; //!< The ADPCMHeader from the 'fmt ' chunk
+	size_t data;
+	size_t dataSize;
+	size_t length; //!< Size of the decoded PCM data in bytes
+};
+
+//! Find the chunks needed to decode an ADPCM WAV file
+bool parseWAV(Sample & sample) {
+	
+	const std::vector<char> & file = sample.file;
+	if(file.size() < 12 || std::memcmp(&file[0], "RIFF", 4) || std::memcmp(&file[8], "WAVE", 4)) {
+		return false;
+	}
+	
+	u32 samples = 0;
+	bool data = false;
+	
+	for(size_t pos = 12; pos + 8 <= file.size(); ) {
+		
+		u32 size;
+		std::memcpy(&size, &file[pos + 4], 4);
+		size = u32(std::min(size_t(size), file.size() - pos - 8));
+		const char * chunk = &file[pos + 8];
+		
+		if(!std::memcmp(&file[pos], "fmt ", 4) && size >= sizeof(ADPCMHeader)) {
+			sample.header.assign(chunk, chunk + size);
+		} else if(!std::memcmp(&file[pos], "fact", 4) && size >= 4) {
+			std::memcpy(&samples, chunk, 4);
+		} else if(!std::memcmp(&file[pos], "data", 4)) {
+			sample.data = pos + 8;
+			sample.dataSize = size;
+			data = true;
+		}
+		
+		pos += 8 + size;
+	}
+	
+	if(!data || sample.header.empty()) {
+		return false;
+	}
+	
+	const ADPCMHeader * header = reinterpret_cast<const ADPCMHeader *>(&sample.header[0]);
+	if(header->wfx.formatTag != WAV_FORMAT_ADPCM
+	   || (header->wfx.channels != 1 && header->wfx.channels != 2)) {
+		return false;
+	}
+	
+	sample.length = size_t(samples) * 2 * header->wfx.channels;
+	
+	return true;
+}
+
+void collectSamples(PakDirectory * dir, const res::path & path, std::vector<Sample> & samples) {
+	
+	for(PakDirectory::files_iterator i = dir->files_begin(); i != dir->files_end(); ++i) {
+		
+		res::path name = path / i->first;
+		if(!name.has_ext("wav")) {
+			continue;
+		}
+		
+		samples.push_back(Sample());
+		Sample & sample = samples.back();
+		sample.name = name;
+		sample.file.resize(i->second->size());
+		if(!sample.file.empty()) {
+			i->second->read(&sample.file[0]);
+		}
+		
+		// Only ADPCM samples are relevant, PCM samples are copied as-is
+		if(!parseWAV(sample)) {
+			samples.pop_back();
+		}
+	}
+	
+	for(PakDirectory::dirs_iterator i = dir->dirs_begin(); i != dir->dirs_end(); ++i) {
+		collectSamples(&i->second, path / i->first, samples);
+	}
+}
+
+bool mountResources() {
+	
+	resources = new PakReader;
+	
+	bool found = false;
+	static const char * const paks[] = {
+		"data.pak", "data2.pak", "sfx.pak", "speech.pak", "speech_default.pak"
+	};
+	for(size_t i = 0; i < ARRAY_SIZE(paks); i++) {
+		found = resources->addArchive(fs::paths.find(paks[i])) || found;
+	}
+	
+	BOOST_REVERSE_FOREACH(const fs::path & base, fs::paths.data) {
+		resources->addFiles(base / "sfx", "sfx");
+		resources->addFiles(base / "speech", "speech");
+	}
+	
+	return found;
+}
+
+//! Decode a sample, returns the decode time in microseconds or -1 on error
+s64 decode(audio::Codec & codec, Sample & sample, std::vector<char> & buffer) {
+	
+	u64 start = Time::getUs();
+	
+	MemoryHandle handle(&sample.file[sample.data], sample.dataSize);
+	codec.setStream(&handle);
+	if(codec.setHeader(&sample.header[0])) {
+		return -1;
+	}
+	
+	buffer.resize(sample.length);
+	size_t read = 0;
+	if(!buffer.empty() && (codec.read(&buffer[0], buffer.size(), read) || read != buffer.size())) {
+		return -1;
+	}
+	
+	return s64(Time::getElapsedUs(start));
+}
+
+//! Plain conversion to compare stereoToMono() against
+void referenceStereoToMono(std::vector<char> & data) {
+	s16 * buf = reinterpret_cast<s16 *>(&data[0]);
+	size_t nbsamples = data.size() / sizeof(s16);
+	for(size_t in = 0, out = 0; in + 1 < nbsamples; in += 2, out++) {
+		buf[out] = s16((int(buf[in]) + int(buf[in + 1])) / 2);
+	}
+	data.resize(data.size() / 2);
+}
+
+} // anonymous namespace
+
+ARX_PROGRAM_OPTION("help", "h", "Show supported options", &showHelp);
+
+int main(int argc, char ** argv) {
+	
+	Logger::initialize();
+	
+	defineSystemDirectories(argv[0]);
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	try {
+		util::cmdline::parse(cli, argc, argv);
+	} catch(util::cmdline::error & e) {
+		std::cerr << e.what() << "\n\n";
+		return EXIT_FAILURE;
+	}
+	
+	if(fs::paths.init() != RunProgram) {
+		return EXIT_FAILURE;
+	}
+	
+	Time::init();
+	
+	if(!mountResources()) {
+		LogError << "Could not load any sound archives";
+		return EXIT_FAILURE;
+	}
+	
+	std::vector<Sample> samples;
+	collectSamples(resources, res::path(), samples);
+	
+	u64 referenceTime = 0;
+	u64 blockTime = 0;
+	u64 referenceMonoTime = 0;
+	u64 batchMonoTime = 0;
+	u64 decodedBytes = 0;
+	size_t failed = 0;
+	size_t mismatches = 0;
+	
+	std::vector<char> expected;
+	std::vector<char> actual;
+	
+	BOOST_FOREACH(Sample & sample, samples) {
+		
+		ReferenceADPCM reference;
+		audio::CodecADPCM block;
+		
+		s64 referenceElapsed = decode(reference, sample, expected);
+		s64 blockElapsed = decode(block, sample, actual);
+		if(referenceElapsed < 0 || blockElapsed < 0) {
+			if((referenceElapsed < 0) != (blockElapsed < 0)) {
+				LogError << "Decoders disagree on errors in " << sample.name;
+				mismatches++;
+			}
+			failed++;
+			continue;
+		}
+		
+		referenceTime += u64(referenceElapsed);
+		blockTime += u64(blockElapsed);
+		decodedBytes += expected.size();
+		
+		if(expected != actual) {
+			LogError << "Decoded data differs for " << sample.name;
+			mismatches++;
+			continue;
+		}
+		
+		const ADPCMHeader * header = reinterpret_cast<const ADPCMHeader *>(&sample.header[0]);
+		if(header->wfx.channels == 2) {
+			
+			audio::PCMFormat format;
+			format.frequency = header->wfx.samplesPerSec;
+			format.channels = 2;
+			format.quality = 16;
+			
+			u64 start = Time::getUs();
+			referenceStereoToMono(expected);
+			referenceMonoTime += Time::getElapsedUs(start);
+			
+			start = Time::getUs();
+			actual.resize(audio::stereoToMono(&actual[0], actual.size(), format));
+			batchMonoTime += Time::getElapsedUs(start);
+			
+			if(expected != actual) {
+				LogError << "Mono conversion differs for " << sample.name;
+				mismatches++;
+			}
+		}
+	}
+	
+	delete resources, resources = NULL;
+	
+	double megabytes = decodedBytes / (1024.0 * 1024.0);
+	
+	std::cout << "samples: " << samples.size() << '\n';
+	std::cout << "failed to decode: " << failed << '\n';
+	std::cout << "mismatches: " << mismatches << '\n';
+	std::cout << "decoded: " << megabytes << " MiB\n";
+	std::cout << "reference decoder: " << (referenceTime / 1000.0) << " ms";
+	if(referenceTime) {
+		std::cout << " (" << (megabytes * 1000000.0 / referenceTime) << " MiB/s)";
+	}
+	std::cout << '\n';
+	std::cout << "block decoder: " << (blockTime / 1000.0) << " ms";
+	if(blockTime) {
+		std::cout << " (" << (megabytes * 1000000.0 / blockTime) << " MiB/s)";
+	}
+	std::cout << '\n';
+	std::cout << "stereo to mono: " << (referenceMonoTime / 1000.0) << " ms reference, "
+	          << (batchMonoTime / 1000.0) << " ms batched\n";
+	
+	Logger::shutdown();
+	
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,421 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Headless level loading benchmark.
+ *
+ * Loads each level of the game without creating a window and writes a per-phase
+ * breakdown of the wall time, bytes read from the resource files and allocations
+ * as CSV. This is linked against the game sources, but not the game's entry point.
+ *
+ * With --anchors, the pathfinding anchors of each level are also regenerated once
+ * serially and once using all worker threads, and compared against the anchors stored
+ * in the scene file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "core/Application.h"
+#include "core/Config.h"
+#include "core/Core.h"
+#include "core/GameTime.h"
+#include "game/EntityManager.h"
+#include "game/Equipment.h"
+#include "game/Levels.h"
+#include "game/Player.h"
+#include "graphics/data/Mesh.h"
+#include "graphics/effects/Fog.h"
+#include "graphics/null/NullRenderer.h"
+#include "gui/MiniMap.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakReader.h"
+#include "math/Random.h"
+#include "physics/Anchors.h"
+#include "platform/Environment.h"
+#include "platform/JobSystem.h"
+#include "platform/ProgramOptions.h"
+#include "platform/Time.h"
+#include "platform/profiler/LoadStatistics.h"
+#include "scene/Interactive.h"
+#include "scene/Light.h"
+#include "scene/LoadLevel.h"
+#include "script/Script.h"
+#include "script/ScriptEvent.h"
+#include "util/cmdline/Parser.h"
+
+// Defined in core/Core.cpp
+extern void InitializeDanae();
+extern long LaunchDemo;
+
+/*
+ * Count all allocations made through operator new so that they can be attributed
+ * to the active load phase. Allocations made with malloc() are not included.
+ */
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define ARX_NEW_THROW
+#define ARX_DELETE_THROW noexcept
+#else
+#define ARX_NEW_THROW throw(std::bad_alloc)
+#define ARX_DELETE_THROW throw()
+#endif
+
+void * operator new(size_t size) ARX_NEW_THROW {
+	profiler::countAllocation(size);
+	void * ptr = std::malloc(size ? size : 1);
+	if(!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void * operator new[](size_t size) ARX_NEW_THROW {
+	return operator new(size);
+}
+
+void operator delete(void * ptr) ARX_DELETE_THROW {
+	std::free(ptr);
+}
+
+void operator delete[](void * ptr) ARX_DELETE_THROW {
+	std::free(ptr);
+}
+
+namespace {
+
+//! Number of level slots known to GetLevelNameByNum() - also means "no level"
+const long LEVEL_COUNT = 32;
+
+std::vector<long> g_levels;
+fs::path g_outputFile;
+size_t g_iterations = 1;
+bool g_anchors = false;
+
+void showHelp() {
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	
+	std::cout << "Usage: arxloadbench [options]\n\n";
+	std::cout << "Loads all game levels without a window and reports load times as CSV.\n\n";
+	std::cout << "Options:\n" << cli << std::endl;
+	
+	std::exit(EXIT_SUCCESS);
+}
+
+void levelsOption(const std::string & levels) {
+	
+	std::istringstream iss(levels);
+	std::string level;
+	while(std::getline(iss, level, ',')) {
+		try {
+			g_levels.push_back(boost::lexical_cast<long>(level));
+		} catch(const boost::bad_lexical_cast &) {
+			throw util::cmdline::error(util::cmdline::error::invalid_value,
+			                           "invalid level number: " + level);
+		}
+	}
+}
+
+void outputOption(const std::string & file) {
+	g_outputFile = file;
+}
+
+void iterationsOption(const std::string & iterations) {
+	try {
+		g_iterations = boost::lexical_cast<size_t>(iterations);
+	} catch(const boost::bad_lexical_cast &) {
+		throw util::cmdline::error(util::cmdline::error::invalid_value,
+		                           "invalid iteration count: " + iterations);
+	}
+}
+
+void anchorsOption() {
+	g_anchors = true;
+}
+
+bool mountResources() {
+	
+	static const char * paks[][2] = {
+		{ "data.pak", NULL },
+		{ "loc.pak", "loc_default.pak" },
+		{ "data2.pak", NULL },
+		{ "sfx.pak", NULL },
+		{ "speech.pak", "speech_default.pak" },
+	};
+	
+	resources = new PakReader;
+	
+	for(size_t i = 0; i < ARRAY_SIZE(paks); i++) {
+		if(resources->addArchive(fs::paths.find(paks[i][0]))) {
+			continue;
+		}
+		if(paks[i][1] && resources->addArchive(fs::paths.find(paks[i][1]))) {
+			continue;
+		}
+		LogError << "Could not load " << paks[i][0];
+		return false;
+	}
+	
+	BOOST_REVERSE_FOREACH(const fs::path & base, fs::paths.data) {
+		resources->addFiles(base / "game", "game");
+		resources->addFiles(base / "graph", "graph");
+	}
+	
+	return true;
+}
+
+//! Initialize the parts of the game needed to load levels, see initializeGame()
+void initializeHeadless() {
+	
+	arxtime.init();
+	
+	GRenderer = new NullRenderer;
+	GRenderer->Initialize();
+	
+	ScriptEvent::init();
+	ARX_SCRIPT_EventStackInit();
+	ARX_EQUIPMENT_Init();
+	ARX_SCRIPT_Timer_FirstInit(512);
+	ARX_FOGS_FirstInit();
+	EERIE_LIGHT_GlobalInit();
+	
+	entities.init();
+	memset(&player, 0, sizeof(ARXCHARACTER));
+	ARX_PLAYER_InitPlayer();
+	
+	g_miniMap.firstInit(&player, resources, &entities, NULL);
+	
+	Project = PROJECT();
+	Project.demo = LEVEL_COUNT;
+	LaunchDemo = 0;
+	InitializeDanae();
+}
+
+res::path getLevelFile(long num) {
+	char id[256];
+	GetLevelNameByNum(num, id);
+	return std::string("graph/levels/level") + id + "/level" + id + ".dlf";
+}
+
+void writeRow(std::ostream & os, long level, size_t iteration, const char * phase,
+              u64 time, const profiler::LoadPhaseStats & stats) {
+	os << level << ',' << iteration << ',' << phase << ',' << (time / 1000.0) << ','
+	   << stats.count << ',' << stats.bytesRead << ',' << stats.allocations << ','
+	   << stats.allocatedBytes << '\n';
+}
+
+//! Copy of the anchor data of a background that can be compared
+struct AnchorSnapshot {
+	
+	std::vector<float> values;
+	std::vector<long> links;
+	
+	explicit AnchorSnapshot(const EERIE_BACKGROUND * eb) {
+		
+		for(long i = 0; i < eb->nbanchors; i++) {
+			const ANCHOR_DATA & ad = eb->anchors[i];
+			values.push_back(ad.pos.x);
+			values.push_back(ad.pos.y);
+			values.push_back(ad.pos.z);
+			values.push_back(ad.radius);
+			values.push_back(ad.height);
+			links.push_back(ad.nblinked);
+			links.insert(links.end(), ad.linked, ad.linked + ad.nblinked);
+		}
+		
+		for(long i = 0; i < eb->Xsize * eb->Zsize; i++) {
+			const EERIE_BKG_INFO & eg = eb->Backg[i];
+			links.push_back(eg.nbianchors);
+			links.insert(links.end(), eg.ianchors, eg.ianchors + eg.nbianchors);
+		}
+	}
+	
+	bool operator==(const AnchorSnapshot & o) const {
+		return values == o.values && links == o.links;
+	}
+	
+};
+
+//! Regenerate the anchors of the current level and compare them to the loaded ones
+void benchmarkAnchors(long level) {
+	
+	AnchorSnapshot loaded(ACTIVEBKG);
+	
+	jobs::shutdown();
+	u64 startTime = Time::getUs();
+	AnchorData_Create(ACTIVEBKG);
+	u64 serialTime = Time::getElapsedUs(startTime);
+	AnchorSnapshot serial(ACTIVEBKG);
+	
+	jobs::initialize();
+	startTime = Time::getUs();
+	AnchorData_Create(ACTIVEBKG);
+	u64 parallelTime = Time::getElapsedUs(startTime);
+	AnchorSnapshot parallel(ACTIVEBKG);
+	
+	LogInfo << "Level " << level << ": generated " << ACTIVEBKG->nbanchors << " anchors in "
+	        << (serialTime / 1000) << " ms serially and " << (parallelTime / 1000)
+	        << " ms using " << jobs::getThreadCount() << " threads";
+	LogInfo << "Level " << level << ": anchors "
+	        << ((serial == parallel) ? "match" : "DIFFER") << " between runs, "
+	        << ((parallel == loaded) ? "match" : "differ from") << " the scene file";
+}
+
+bool benchmarkLevel(std::ostream & os, long level, size_t iteration) {
+	
+	res::path file = getLevelFile(level);
+	
+	DanaeClearLevel();
+	
+	profiler::resetLoadStatistics();
+	u64 startTime = Time::getUs();
+	
+	if(DanaeLoadLevel(file, true) <= 0) {
+		return false;
+	}
+	
+	// Initialize the scripts like for a new game
+	CleanScriptLoadedIO();
+	RestoreInitialIOStatus();
+	ARX_SCRIPT_ResetAll(1);
+	
+	u64 totalTime = Time::getElapsedUs(startTime);
+	
+	profiler::LoadPhaseStats total;
+	memset(&total, 0, sizeof(total));
+	for(size_t i = 0; i < profiler::LoadPhaseCount; i++) {
+		profiler::LoadPhase phase = profiler::LoadPhase(i);
+		const profiler::LoadPhaseStats & stats = profiler::getLoadStatistics(phase);
+		writeRow(os, level, iteration, profiler::getLoadPhaseName(phase), stats.time, stats);
+		total.count += stats.count;
+		total.bytesRead += stats.bytesRead;
+		total.allocations += stats.allocations;
+		total.allocatedBytes += stats.allocatedBytes;
+	}
+	writeRow(os, level, iteration, "total", totalTime, total);
+	
+	LogInfo << "Loaded " << file << " in " << (totalTime / 1000) << " ms";
+	
+	if(g_anchors) {
+		benchmarkAnchors(level);
+	}
+	
+	return true;
+}
+
+} // anonymous namespace
+
+ARX_PROGRAM_OPTION("help", "h", "Show supported options", &showHelp);
+ARX_PROGRAM_OPTION("levels", "L", "Comma-separated list of level numbers to load",
+                   &levelsOption, "LEVELS");
+ARX_PROGRAM_OPTION("output", "o", "Write the CSV report to a file instead of stdout",
+                   &outputOption, "FILE");
+ARX_PROGRAM_OPTION("iterations", "i", "Number of times to load each level",
+                   &iterationsOption, "COUNT");
+ARX_PROGRAM_OPTION("anchors", "a", "Also time anchor generation and compare the results",
+                   &anchorsOption);
+
+int main(int argc, char ** argv) {
+	
+	Random::seed(0);
+	
+	Logger::initialize();
+	
+	defineSystemDirectories(argv[0]);
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	try {
+		util::cmdline::parse(cli, argc, argv);
+	} catch(util::cmdline::error & e) {
+		std::cerr << e.what() << "\n\n";
+		return EXIT_FAILURE;
+	}
+	
+	if(fs::paths.init() != RunProgram) {
+		return EXIT_FAILURE;
+	}
+	
+	Time::init();
+	
+	jobs::initialize();
+	
+	config.init(fs::paths.config / "cfg.ini");
+	
+	if(!mountResources()) {
+		return EXIT_FAILURE;
+	}
+	
+	initializeHeadless();
+	
+	if(g_levels.empty()) {
+		for(long level = 0; level < LEVEL_COUNT; level++) {
+			if(resources->getFile(getLevelFile(level))) {
+				g_levels.push_back(level);
+			}
+		}
+	}
+	
+	fs::ofstream ofs;
+	if(!g_outputFile.empty()) {
+		ofs.open(g_outputFile, fs::fstream::out | fs::fstream::trunc);
+		if(!ofs.is_open()) {
+			LogError << "Could not open " << g_outputFile << " for writing";
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream & os = g_outputFile.empty() ? std::cout : ofs;
+	
+	os << "level,iteration,phase,time_ms,calls,bytes_read,allocations,allocated_bytes\n";
+	
+	int ret = EXIT_SUCCESS;
+	for(size_t iteration = 0; iteration < g_iterations; iteration++) {
+		BOOST_FOREACH(long level, g_levels) {
+			if(!benchmarkLevel(os, level, iteration)) {
+				LogError << "Failed to load level " << level;
+				ret = EXIT_FAILURE;
+			}
+		}
+	}
+	
+	DanaeClearLevel();
+	
+	delete resources, resources = NULL;
+	delete GRenderer, GRenderer = NULL;
+	
+	jobs::shutdown();
+	
+	Logger::shutdown();
+	
+	return ret;
+}
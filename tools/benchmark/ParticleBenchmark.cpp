@@ -0,0 +1,172 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Particle system stress benchmark.
+ *
+ * Runs a number of particle systems with short-lived particles for a fixed number of
+ * frames and reports the time spent updating them. The systems have no textures, so
+ * they are not rendered and only the simulation is measured.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "core/GameTime.h"
+#include "graphics/Math.h"
+#include "graphics/particle/ParticleManager.h"
+#include "graphics/particle/ParticleSystem.h"
+#include "io/log/Logger.h"
+#include "math/Random.h"
+#include "platform/ProgramOptions.h"
+#include "platform/Time.h"
+#include "util/cmdline/Parser.h"
+
+namespace {
+
+size_t g_systems = 100;
+size_t g_particles = 200;
+size_t g_frames = 1000;
+
+//! Simulated frame time in milliseconds
+const long FRAME_TIME = 16;
+
+void showHelp() {
+	
+	util::cmdline::interpreter<std::string> cli;
+	BaseOption::registerAll(cli);
+	
+	std::cout << "Usage: arxparticlebench [options]\n\n";
+	std::cout << "Measures the CPU time needed to update particle systems.\n\n";
+	std::cout << "Options:\n" << cli << std::endl;
+	
+	std::exit(EXIT_SUCCESS);
+}
+
+size_t parseCount(const std::string & value, const char * what) {
+	try {
+		return boost::lexical_cast<size_t>(value);
+	} catch(const boost::bad_lexical_cast &) {
+		throw util::cmdline::error(util::cmdline::error::invalid_value,
+		                           std::string("invalid ") + what + ": " + value);
+	}
+}
+
+void systemsOption(const std::string & value) {
+	g_systems = parseCount(value, "system count");
+}
+
+void particlesOption(const std::string & value) {
+	g_particles = parseCount(value, "particle count");
+}
+
+void framesOption(const std::string & value) {
+	g_frames = parseCount(value, "frame count");
+}
+
+ParticleSystem * createSystem(size_t index) {
+	
+	ParticleSystem * system = new ParticleSystem;
+	
+	system->iParticleNbMax = int(g_particles);
+	system->fParticleLife = 300;
+	system->fParticleLifeRandom = 500;
+	system->fParticleSpeed = 20;
+	system->fParticleSpeedRandom = 40;
+	system->fParticleAngle = radians(30);
+	system->p3ParticleGravity = Vec3f(0.f, 1.f, 0.f);
+	system->p3ParticlePos = Vec3f(10.f, 5.f, 10.f);
+	system->ulParticleSpawn = PARTICLE_CIRCULAR;
+	system->fParticleRotation = (index % 2) ? 0.01f : 0.f;
+	system->SetPos(Vec3f(float(index % 10) * 100.f, 0.f, float(index / 10) * 100.f));
+	
+	return system;
+}
+
+} // anonymous namespace
+
+ARX_PROGRAM_OPTION("help", "h", "Show supported options", &showHelp);
+ARX_PROGRAM_OPTION("systems", "s", "Number of particle systems", &systemsOption, "COUNT");
+ARX_PROGRAM_OPTION("particles", "P", "Maximum number of particles per system",
+                   &particlesOption, "COUNT");
+ARX_PROGRAM_OPTION("frames", "f", "Number of frames to simulate", &framesOption, "COUNT");
+
+int main(int argc, char ** argv) {
+	
+	Random::seed(0);
+	
+	Logger::initialize();
+	
+	util::cmdline::interpreter<std::string> cli;
+	try {
+		BaseOption::registerAll(cli);
+		util::cmdline::parse(cli, argc, argv);
+	} catch(util::cmdline::error & e) {
+		std::cerr << e.what() << "\n\n";
+		return EXIT_FAILURE;
+	}
+	
+	Time::init();
+	arxtime.init();
+	
+	// The systems never die as their maximum particle count is not zero
+	ParticleManager manager;
+	std::vector<ParticleSystem *> systems;
+	for(size_t i = 0; i < g_systems; i++) {
+		systems.push_back(createSystem(i));
+		manager.AddSystem(systems.back());
+	}
+	
+	u64 updateTime = 0;
+	u64 particleFrames = 0;
+	
+	for(size_t frame = 0; frame < g_frames; frame++) {
+		
+		u64 start = Time::getUs();
+		manager.Update(FRAME_TIME);
+		updateTime += Time::getElapsedUs(start, Time::getUs());
+		
+		for(size_t i = 0; i < systems.size(); i++) {
+			particleFrames += systems[i]->particles.count();
+		}
+	}
+	
+	manager.Clear();
+	
+	double frames = double(std::max(g_frames, size_t(1)));
+	double seconds = updateTime / 1000000.0;
+	
+	std::cout << "systems: " << g_systems << '\n';
+	std::cout << "particles per system: " << g_particles << '\n';
+	std::cout << "frames: " << g_frames << '\n';
+	std::cout << "average particles per frame: " << (particleFrames / frames) << '\n';
+	std::cout << "update: " << (updateTime / frames) << " us/frame\n";
+	if(seconds > 0) {
+		std::cout << "throughput: " << u64(particleFrames / seconds) << " particles/s\n";
+	}
+	
+	Logger::shutdown();
+	
+	return EXIT_SUCCESS;
+}
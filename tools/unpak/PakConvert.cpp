@@ -0,0 +1,270 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unpak/PakConvert.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/Filesystem.h"
+#include "io/resource/PakFormat.h"
+
+namespace {
+
+//! Don't bother compressing files that shrink by less than 1/PAK_MIN_SAVING
+const size_t PAK_MIN_SAVING = 8;
+
+class PakConverter {
+	
+	fs::ofstream ofs;
+	
+	std::vector<PAK_INDEXED_ENTRY> entries;
+	std::vector<u32> chunks;
+	std::string names;
+	
+	u64 offset;
+	
+	//! Compressed chunks of the current file
+	std::vector<char> compressed;
+	std::vector<u32> compressedSizes;
+	
+	bool write(const void * data, size_t size);
+	bool align();
+	
+	/*!
+	 * Read and decompress a complete file from the source archive.
+	 * \return false on read or decode errors - PakFile::read() does not report them.
+	 */
+	static bool read(const PakFile * file, std::vector<char> & data);
+	
+	//! Compress a file, \return false if the file should be stored uncompressed
+	bool compress(const char * data, size_t size);
+	
+public:
+	
+	explicit PakConverter(const fs::path & output)
+		: ofs(output, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc), offset(0) { }
+	
+	bool is_open() const { return ofs.is_open(); }
+	
+	//! Reserve space for the header, it is written once the index is known
+	bool start();
+	
+	bool addFiles(PakDirectory & dir, const std::string & prefix);
+	
+	bool finish(u32 release, const fs::path & source);
+	
+	void close();
+	
+};
+
+bool PakConverter::write(const void * data, size_t size) {
+	if(size != 0 && fs::write(ofs, data, size).fail()) {
+		return false;
+	}
+	offset += size;
+	return true;
+}
+
+bool PakConverter::align() {
+	static const char padding[PAK_INDEXED_ALIGNMENT] = { 0 };
+	return write(padding, size_t((PAK_INDEXED_ALIGNMENT - offset % PAK_INDEXED_ALIGNMENT)
+	                             % PAK_INDEXED_ALIGNMENT));
+}
+
+bool PakConverter::read(const PakFile * file, std::vector<char> & data) {
+	
+	data.resize(file->size());
+	if(data.empty()) {
+		return true;
+	}
+	
+	PakFileHandle * handle = file->open();
+	if(!handle) {
+		return false;
+	}
+	
+	size_t nread = handle->read(&data[0], data.size());
+	delete handle;
+	
+	return nread == data.size();
+}
+
+bool PakConverter::compress(const char * data, size_t size) {
+	
+	compressed.clear();
+	compressedSizes.clear();
+	
+	std::vector<Bytef> buffer(compressBound(PAK_INDEXED_CHUNK_SIZE));
+	
+	for(size_t start = 0; start < size; start += PAK_INDEXED_CHUNK_SIZE) {
+		
+		size_t length = std::min(PAK_INDEXED_CHUNK_SIZE, size - start);
+		const Bytef * chunk = reinterpret_cast<const Bytef *>(data + start);
+		
+		// Use the fastest level: decompression speed is what matters
+		uLongf stored = buffer.size();
+		if(compress2(&buffer[0], &stored, chunk, length, Z_BEST_SPEED) != Z_OK
+		   || stored >= length) {
+			stored = length;
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		} else {
+			compressed.insert(compressed.end(), buffer.begin(), buffer.begin() + stored);
+		}
+		
+		compressedSizes.push_back(u32(stored));
+	}
+	
+	return compressed.size() < size - size / PAK_MIN_SAVING;
+}
+
+bool PakConverter::start() {
+	PAK_INDEXED_HEADER header;
+	std::memset(&header, 0, sizeof(header));
+	return write(&header, sizeof(header));
+}
+
+bool PakConverter::addFiles(PakDirectory & dir, const std::string & prefix) {
+	
+	for(PakDirectory::files_iterator i = dir.files_begin(); i != dir.files_end(); ++i) {
+		
+		std::string name = prefix + i->first;
+		PakFile * file = i->second;
+		
+		printf("%s\n", name.c_str());
+		
+		PAK_INDEXED_ENTRY entry;
+		entry.hash = pakPathHash(name);
+		entry.name = u32(names.size());
+		entry.flags = 0;
+		entry.first_chunk = 0;
+		entry.size = file->size();
+		
+		names.append(name.c_str(), name.length() + 1);
+		
+		std::vector<char> data;
+		if(!read(file, data)) {
+			printf("error reading %s\n", name.c_str());
+			return false;
+		}
+		
+		bool ok;
+		if(!data.empty() && compress(&data[0], data.size())) {
+			entry.flags |= PAK_INDEXED_COMPRESSED;
+			entry.first_chunk = u32(chunks.size());
+			entry.offset = offset;
+			chunks.insert(chunks.end(), compressedSizes.begin(), compressedSizes.end());
+			ok = write(&compressed[0], compressed.size());
+		} else {
+			ok = align();
+			entry.offset = offset;
+			ok = ok && write(data.empty() ? NULL : &data[0], data.size());
+		}
+		
+		if(!ok) {
+			return false;
+		}
+		
+		entries.push_back(entry);
+	}
+	
+	for(PakDirectory::dirs_iterator i = dir.dirs_begin(); i != dir.dirs_end(); ++i) {
+		if(!addFiles(i->second, prefix + i->first + '/')) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+bool PakConverter::finish(u32 release, const fs::path & source) {
+	
+	PAK_INDEXED_HEADER header;
+	header.magic = PAK_INDEXED_MAGIC;
+	header.version = PAK_INDEXED_VERSION;
+	header.release = release;
+	header.nb_files = u32(entries.size());
+	header.nb_chunks = u32(chunks.size());
+	header.names_size = u32(names.size());
+	header.index_offset = offset;
+	header.source_size = 0;
+	header.source_time = 0;
+	if(!source.empty()) {
+		header.source_size = fs::file_size(source);
+		header.source_time = u64(fs::last_write_time(source));
+	}
+	
+	if(!entries.empty() && !write(&entries[0], entries.size() * sizeof(PAK_INDEXED_ENTRY))) {
+		return false;
+	}
+	
+	if(!chunks.empty() && !write(&chunks[0], chunks.size() * sizeof(u32))) {
+		return false;
+	}
+	
+	if(!write(names.data(), names.size())) {
+		return false;
+	}
+	
+	ofs.seekp(0);
+	return !fs::write(ofs, header).fail() && !ofs.flush().fail();
+}
+
+void PakConverter::close() {
+	ofs.close();
+}
+
+} // anonymous namespace
+
+bool convertPak(PakReader & pak, const fs::path & output, const fs::path & source) {
+	
+	// Never leave a partial archive behind where the game would pick it up
+	fs::path temp = output;
+	temp.append(".tmp");
+	
+	PakConverter converter(temp);
+	if(!converter.is_open()) {
+		printf("error opening file for writing: %s\n", temp.string().c_str());
+		return false;
+	}
+	
+	bool ok = converter.start() && converter.addFiles(pak, std::string())
+	          && converter.finish(pak.getReleaseType(), source);
+	converter.close();
+	if(!ok) {
+		printf("error converting to %s\n", output.string().c_str());
+		fs::remove(temp);
+		return false;
+	}
+	
+	if(!fs::rename(temp, output, true)) {
+		printf("error renaming %s to %s\n", temp.string().c_str(), output.string().c_str());
+		fs::remove(temp);
+		return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_TOOLS_UNPAK_PAKCONVERT_H
+#define ARX_TOOLS_UNPAK_PAKCONVERT_H
+
+#include "io/resource/PakReader.h"
+
+namespace fs { class path; }
+
+/*!
+ * Write all files of a PakReader to an indexed .ipak archive.
+ * \param source the .pak file that was loaded into pak, used to detect outdated archives
+ * \return false if the archive could not be written.
+ */
+bool convertPak(PakReader & pak, const fs::path & output, const fs::path & source);
+
+#endif // ARX_TOOLS_UNPAK_PAKCONVERT_H
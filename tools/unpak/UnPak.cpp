@@ -18,10 +18,13 @@
  */
 
 #include <string>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
-#include <sstream>
-#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
 
 #include "io/fs/FilePath.h"
 #include "io/fs/Filesystem.h"
@@ -30,72 +33,229 @@
 #include "io/resource/PakEntry.h"
 #include "io/resource/ResourcePath.h"
 #include "io/log/Logger.h"
+#include "platform/Atomic.h"
+#include "platform/JobSystem.h"
+#include "platform/Time.h"
+
+#include "unpak/PakConvert.h"
 
-using std::transform;
-using std::ostringstream;
 using std::string;
 
-void dump(PakDirectory & dir, const fs::path & dirname = fs::path()) {
+namespace {
+	
+struct Entry {
+	res::path name;
+	fs::path output;
+	size_t size;
+};
+
+//! List all files in a directory and create the output directories
+void list(PakDirectory & dir, std::vector<Entry> & entries, bool create,
+          const res::path & name = res::path(), const fs::path & dirname = fs::path()) {
 	
-	fs::create_directories(dirname);
+	if(create) {
+		fs::create_directories(dirname);
+	}
 	
 	for(PakDirectory::files_iterator i = dir.files_begin(); i != dir.files_end(); ++i) {
+		Entry entry;
+		entry.name = name / i->first;
+		entry.output = dirname / i->first;
+		entry.size = i->second->size();
+		entries.push_back(entry);
+	}
 		
-		fs::path filename = dirname / i->first;
-		
-		PakFile * file = i->second;
+	for(PakDirectory::dirs_iterator i = dir.dirs_begin(); i != dir.dirs_end(); ++i) {
+		list(i->second, entries, create, name / i->first, dirname / i->first);
+	}
 		
-		printf("%s\n", filename.string().c_str());
+}
 		
-		fs::ofstream ofs(filename, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
-		if(!ofs.is_open()) {
-			printf("error opening file for writing: %s\n", filename.string().c_str());
-			exit(1);
+/*!
+ * Extract or verify files on all worker threads.
+ *
+ * Every thread only holds one file in memory at a time, so memory use is bounded by
+ * the number of threads times the size of the largest file. All threads share the same
+ * PakReader, which also makes this a good stress test for concurrent reads.
+ */
+class ExtractTask : public jobs::ParallelTask {
+	
+	const std::vector<Entry> & m_entries;
+	PakReader & m_pak;
+	bool m_verify;
+	
+public:
+	
+	volatile u32 errors;
+	
+	ExtractTask(const std::vector<Entry> & entries, PakReader & pak, bool verify)
+		: m_entries(entries), m_pak(pak), m_verify(verify), errors(0) { }
+	
+	void run(size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			if(!(m_verify ? verify(m_entries[i]) : extract(m_entries[i]))) {
+				atomicAdd(&errors, 1);
+			}
 		}
+	}
+	
+	bool extract(const Entry & entry);
+	
+	bool verify(const Entry & entry);
+	
+};
+
+bool ExtractTask::extract(const Entry & entry) {
+	
+	const string & filename = entry.output.string();
+	
+	printf("%s\n", filename.c_str());
+	
+	fs::ofstream ofs(entry.output, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+	if(!ofs.is_open()) {
+		printf("error opening file for writing: %s\n", filename.c_str());
+		return false;
+	}
+	
+	if(entry.size > 0) {
 		
-		if(file->size() > 0) {
-			
-			char * data = (char*)file->readAlloc();
-			arx_assert(data != NULL);
-			
-			if(ofs.write(data, file->size()).fail()) {
-				printf("error writing to file: %s\n", filename.string().c_str());
-				exit(1);
-			}
-			
-			free(data);
-			
+		size_t size;
+		char * data = m_pak.readAlloc(entry.name, size);
+		arx_assert(data != NULL);
+		
+		bool failed = ofs.write(data, size).fail();
+		
+		free(data);
+		
+		if(failed) {
+			printf("error writing to file: %s\n", filename.c_str());
+			return false;
 		}
 		
 	}
 	
-	for(PakDirectory::dirs_iterator i = dir.dirs_begin(); i != dir.dirs_end(); ++i) {
-		dump(i->second, dirname / i->first);
+	return true;
+}
+
+bool ExtractTask::verify(const Entry & entry) {
+	
+	PakFile * file = m_pak.getFile(entry.name);
+	arx_assert(file != NULL);
+	
+	// Read the file both at once and through a file handle, both must match
+	
+	std::vector<Bytef> data(entry.size);
+	Bytef * buf = data.empty() ? NULL : &data[0];
+	
+	file->read(buf);
+	uLong checksum = crc32(0, buf, uInt(data.size()));
+	
+	std::fill(data.begin(), data.end(), 0);
+	
+	PakFileHandle * handle = file->open();
+	size_t nread = handle->read(buf, data.size());
+	delete handle;
+	uLong checksum2 = crc32(0, buf, uInt(data.size()));
+	
+	if(nread != entry.size || checksum != checksum2) {
+		printf("checksum mismatch: %s\n", entry.name.string().c_str());
+		return false;
+	}
+	
+	printf("%08lx %s\n", (unsigned long)checksum, entry.name.string().c_str());
+	
+	return true;
+}
+
+bool process(const fs::path & pakfile, bool verify) {
+	
+	PakReader pak;
+	if(!pak.addArchive(pakfile)) {
+		printf("error opening PAK file\n");
+		return false;
+	}
+	
+	std::vector<Entry> entries;
+	list(pak, entries, !verify);
+	
+	u64 total = 0;
+	for(size_t i = 0; i < entries.size(); i++) {
+		total += entries[i].size;
 	}
 	
+	u64 start = Time::getUs();
+	
+	ExtractTask task(entries, pak, verify);
+	jobs::parallelFor(task, entries.size());
+	
+	u64 elapsed = std::max(Time::getElapsedUs(start), u64(1));
+	
+	printf("%s %lu files, %.1f MiB in %.2f s: %.1f MiB/s\n", verify ? "verified" : "extracted",
+	       (unsigned long)entries.size(), double(total) / (1024 * 1024),
+	       double(elapsed) / 1000000, double(total) / (1024 * 1024) * 1000000 / elapsed);
+	
+	if(task.errors) {
+		printf("%lu errors\n", (unsigned long)task.errors);
+		return false;
+	}
+	
+	return true;
 }
 
+} // anonymous namespace
+
 int main(int argc, char ** argv) {
 	
 	ARX_UNUSED(resources);
 	
 	Logger::initialize();
 	
-	if(argc < 2) {
-		printf("usage: unpak <pakfile> [<pakfile>...]\n");
+	bool convert = (argc >= 2 && !strcmp(argv[1], "--convert"));
+	bool verify = (argc >= 2 && !strcmp(argv[1], "--verify"));
+	int first = (convert || verify) ? 2 : 1;
+	
+	if(argc <= first) {
+		printf("usage: unpak <pakfile> [<pakfile>...]\n"
+		       "       unpak --verify <pakfile> [<pakfile>...]\n"
+		       "       unpak --convert <pakfile> [<pakfile>...]\n");
 		return 1;
 	}
 	
-	for(int i = 1; i < argc; i++) {
+	jobs::initialize();
+	
+	int ret = 0;
+	
+	for(int i = first; i < argc; i++) {
 		
-		PakReader pak;
-		if(!pak.addArchive(argv[i])) {
-			printf("error opening PAK file\n");
-			return 1;
-		}
+		if(convert) {
 		
-		dump(pak);
+			fs::path output = fs::path(argv[i]).set_ext("ipak");
+			if(fs::path(argv[i]).has_ext("ipak")) {
+				printf("refusing to overwrite the input file %s\n", argv[i]);
+				ret = 1;
+				break;
+			}
+			
+			PakReader pak;
+			if(!pak.addArchive(argv[i])) {
+				printf("error opening PAK file\n");
+				ret = 1;
+				break;
+			}
+			
+			if(!convertPak(pak, output, argv[i])) {
+				ret = 1;
+				break;
+			}
+			
+		} else if(!process(argv[i], verify)) {
+			ret = 1;
+			break;
+		}
 		
 	}
 	
+	jobs::shutdown();
+	
+	return ret;
 }